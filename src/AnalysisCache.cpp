@@ -0,0 +1,176 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AnalysisCache.cpp
+
+*******************************************************************//**
+
+\class AnalysisCache
+\brief Keeps sums of sample blocks, and results of analyses of ranges of
+channels, for as long as the blocks they came from exist.
+
+*//*******************************************************************/
+
+#include "AnalysisCache.h"
+
+#include <algorithm>
+
+#include "SampleBlock.h"
+#include "WaveTrack.h"
+
+namespace {
+
+// Results for so many ranges are kept
+constexpr size_t MaxRanges = 16;
+
+double SumSamples( const float *buffer, size_t len )
+{
+   double sum = 0.0;
+   for ( size_t ii = 0; ii < len; ++ii )
+      sum += buffer[ ii ];
+   return sum;
+}
+
+}
+
+AnalysisCache &AnalysisCache::Get()
+{
+   static AnalysisCache instance;
+   return instance;
+}
+
+bool AnalysisCache::Sum( const WaveTrack &channel,
+   sampleCount start, sampleCount end,
+   double &sum, sampleCount &count, const ProgressCallback &progress )
+{
+   sum = 0.0;
+   count = 0;
+   if ( end <= start )
+      return true;
+
+   const auto total = ( end - start ).as_double();
+   Floats buffer;
+   size_t bufferSize = 0;
+   for ( const auto &piece : channel.GetBlockPieces( start, end ) ) {
+      const auto &pBlock = piece.pBlock;
+      if ( piece.len == pBlock->GetSampleCount() )
+         sum += BlockSum( pBlock );
+      else {
+         // The range begins or ends within this block
+         if ( bufferSize < piece.len )
+            buffer.reinit( bufferSize = piece.len );
+         pBlock->GetSamples( (samplePtr) buffer.get(), floatSample,
+            piece.offset, piece.len );
+         sum += SumSamples( buffer.get(), piece.len );
+      }
+      count += piece.len;
+      if ( progress &&
+          !progress( ( piece.start + piece.len - start ).as_double()
+             / total ) )
+         return false;
+   }
+   return true;
+}
+
+double AnalysisCache::BlockSum( const std::shared_ptr<SampleBlock> &pBlock )
+{
+   {
+      std::lock_guard<std::mutex> guard( mMutex );
+      auto iter = mBlocks.find( pBlock.get() );
+      // The address may have been reused by a newer block
+      if ( iter != mBlocks.end() && !iter->second.pBlock.expired() )
+         return iter->second.sum;
+   }
+
+   // Read without holding the lock
+   const auto len = pBlock->GetSampleCount();
+   Floats buffer{ len };
+   pBlock->GetSamples( (samplePtr) buffer.get(), floatSample, 0, len );
+   const auto sum = SumSamples( buffer.get(), len );
+
+   std::lock_guard<std::mutex> guard( mMutex );
+   mBlocks[ pBlock.get() ] = { pBlock, sum };
+   if ( mBlocks.size() >= mSweepSize )
+      Sweep();
+   return sum;
+}
+
+void AnalysisCache::Sweep()
+{
+   for ( auto iter = mBlocks.begin(); iter != mBlocks.end(); ) {
+      if ( iter->second.pBlock.expired() )
+         iter = mBlocks.erase( iter );
+      else
+         ++iter;
+   }
+   // Don't sweep again until the live entries have doubled
+   mSweepSize = std::max< size_t >( 1024, 2 * mBlocks.size() );
+}
+
+bool AnalysisCache::Key::operator == ( const Key &other ) const
+{
+   return analysis == other.analysis &&
+      integers == other.integers && reals == other.reals &&
+      std::equal( blocks.begin(), blocks.end(),
+         other.blocks.begin(), other.blocks.end(),
+         []( const std::weak_ptr<SampleBlock> &a,
+             const std::weak_ptr<SampleBlock> &b ){
+            return !a.owner_before( b ) && !b.owner_before( a ); } );
+}
+
+auto AnalysisCache::MakeKey( const std::string &analysis,
+   const std::vector<const WaveTrack*> &channels, double t0, double t1 ) -> Key
+{
+   Key result;
+   result.analysis = analysis;
+   auto &integers = result.integers;
+   auto &reals = result.reals;
+
+   reals.push_back( t0 );
+   reals.push_back( t1 );
+   for ( const auto pChannel : channels ) {
+      reals.push_back( pChannel->GetRate() );
+      const auto start = pChannel->TimeToLongSamples( t0 );
+      const auto end = pChannel->TimeToLongSamples( t1 );
+      // Mark where each channel's blocks begin
+      integers.push_back( -1 );
+      for ( const auto &piece : pChannel->GetBlockPieces( start, end ) ) {
+         integers.push_back( piece.start.as_long_long() );
+         integers.push_back( piece.offset );
+         integers.push_back( piece.len );
+         result.blocks.push_back( piece.pBlock );
+      }
+   }
+   return result;
+}
+
+bool AnalysisCache::Find( const Key &key, std::vector<double> &results )
+{
+   std::lock_guard<std::mutex> guard( mMutex );
+   for ( auto iter = mRanges.begin(); iter != mRanges.end(); ) {
+      const auto &blocks = iter->key.blocks;
+      if ( std::any_of( blocks.begin(), blocks.end(),
+         []( const std::weak_ptr<SampleBlock> &pBlock ){
+            return pBlock.expired(); } ) ) {
+         // Its results can never be found again
+         iter = mRanges.erase( iter );
+         continue;
+      }
+      if ( iter->key == key ) {
+         results = iter->results;
+         mRanges.splice( mRanges.begin(), mRanges, iter );
+         return true;
+      }
+      ++iter;
+   }
+   return false;
+}
+
+void AnalysisCache::Store( const Key &key, std::vector<double> results )
+{
+   std::lock_guard<std::mutex> guard( mMutex );
+   mRanges.push_front( { key, std::move( results ) } );
+   if ( mRanges.size() > MaxRanges )
+      mRanges.pop_back();
+}
@@ -0,0 +1,100 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AnalysisCache.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_ANALYSIS_CACHE__
+#define __AUDACITY_ANALYSIS_CACHE__
+
+#include "Audacity.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "audacity/Types.h"
+
+class SampleBlock;
+class WaveTrack;
+
+///\brief Remembers analyses of audio, so that effects that first measure
+/// and then change the samples need not read them all twice
+/**
+ Sample blocks are never modified, only replaced, so figures computed from a
+ block stay good for as long as the block exists.  Sums of whole blocks are
+ kept by block; results of analyses that cannot be divided among blocks,
+ such as filtered loudness, are kept for whole ranges of channels.
+
+ Entries hold only weak pointers, so they never keep blocks alive, and are
+ discarded when any of their blocks is destroyed.
+ */
+class AUDACITY_DLL_API AnalysisCache final
+{
+public:
+   //! Receives the fraction done; returns false to cancel
+   using ProgressCallback = std::function< bool(double) >;
+
+   static AnalysisCache &Get();
+
+   AnalysisCache(const AnalysisCache&) = delete;
+   AnalysisCache &operator=(const AnalysisCache&) = delete;
+
+   //! Sum the samples of channel from start to end that lie within clips
+   /*!
+    Only blocks cut by the ends of the range, or not summed before, are read.
+    @return false if progress cancelled
+    May throw
+    */
+   bool Sum(const WaveTrack &channel, sampleCount start, sampleCount end,
+      double &sum, sampleCount &count,
+      const ProgressCallback &progress = {});
+
+   //! Identifies an analysis of the samples of some channels in a time
+   //! range; the caller appends any parameters that change its results
+   struct Key {
+      std::string analysis;
+      std::vector<long long> integers;
+      std::vector<double> reals;
+      // Compared by identity, not by id, which is unique only within one
+      // project
+      std::vector< std::weak_ptr<SampleBlock> > blocks;
+      bool operator == (const Key &other) const;
+   };
+   static Key MakeKey(const std::string &analysis,
+      const std::vector<const WaveTrack*> &channels, double t0, double t1);
+
+   //! Find results stored for key, if all blocks it was made from still exist
+   bool Find(const Key &key, std::vector<double> &results);
+   void Store(const Key &key, std::vector<double> results);
+
+private:
+   AnalysisCache() = default;
+
+   double BlockSum(const std::shared_ptr<SampleBlock> &pBlock);
+   void Sweep();
+
+   struct BlockEntry {
+      std::weak_ptr<SampleBlock> pBlock;
+      double sum;
+   };
+   std::unordered_map<const SampleBlock*, BlockEntry> mBlocks;
+   size_t mSweepSize{ 1024 };
+
+   struct RangeEntry {
+      Key key;
+      std::vector<double> results;
+   };
+   // Most recently used first
+   std::list<RangeEntry> mRanges;
+
+   std::mutex mMutex;
+};
+
+#endif
@@ -1972,17 +1972,19 @@ bool AudioIO::AllocateBuffers(
             }
 
             mCaptureBuffers.reinit(mCaptureTracks.size());
-            mResample.reinit(mCaptureTracks.size());
             mFactor = sampleRate / mRate;
 
             for( unsigned int i = 0; i < mCaptureTracks.size(); i++ )
             {
                mCaptureBuffers[i] = std::make_unique<RingBuffer>(
                   mCaptureTracks[i]->GetSampleFormat(), captureBufferSize );
-               mResample[i] =
-                  std::make_unique<Resample>(true, mFactor, mFactor);
-                  // constant rate resampling
             }
+
+            // One converter for all capture channels, which are consumed
+            // in lockstep
+            mResample = std::make_unique<Resample>(true, mFactor, mFactor,
+               mCaptureTracks.size());
+               // constant rate resampling
          }
       }
       catch(std::bad_alloc&)
@@ -2899,6 +2901,18 @@ void AudioIO::FillBuffers()
             // The WaveTracks have their own buffering for efficiency.
             auto numChannels = mCaptureTracks.size();
 
+            // Per channel state carried from the fetching pass to the
+            // appending pass
+            ArrayOf<SampleBuffer> temps{ numChannels };
+            ArrayOf<size_t> sizes{ numChannels };
+            ArrayOf<sampleFormat> formats{ numChannels };
+            ArrayOf<const float *> crossfadeSrcs{ numChannels };
+            ArrayOf<size_t> crossfadeStarts{ numChannels };
+            ArrayOf<size_t> crossfadeLengths{ numChannels };
+            // Input to the resampler, when there is any
+            ArrayOf<SampleBuffer> resampleIn{ numChannels };
+            size_t toResample = avail;
+
             for( i = 0; i < numChannels; i++ )
             {
                sampleFormat trackFormat = mCaptureTracks[i]->GetSampleFormat();
@@ -2948,10 +2962,13 @@ void AudioIO::FillBuffers()
                         pCrossfadeSrc = data.data() + crossfadeStart;
                   }
                }
+               crossfadeSrcs[i] = pCrossfadeSrc;
+               crossfadeStarts[i] = crossfadeStart;
+               crossfadeLengths[i] = totalCrossfadeLength;
 
                wxASSERT(discarded <= avail);
                size_t toGet = avail - discarded;
-               SampleBuffer temp;
+               auto &temp = temps[i];
                size_t size;
                sampleFormat format;
                if( mFactor == 1.0 )
@@ -2976,26 +2993,57 @@ void AudioIO::FillBuffers()
                {
                   size = lrint(toGet * mFactor);
                   format = floatSample;
-                  SampleBuffer temp1(toGet, floatSample);
+                  auto &temp1 = resampleIn[i];
+                  temp1.Allocate(toGet, floatSample);
                   temp.Allocate(size, format);
                   const auto got =
                      mCaptureBuffers[i]->Get(temp1.ptr(), floatSample, toGet);
                   // wxASSERT(got == toGet);
                   // but we can't assert in this thread
                   wxUnusedVar(got);
-                  /* we are re-sampling on the fly. The last resampling call
-                   * must flush any samples left in the rate conversion buffer
-                   * so that they get recorded
-                   */
-                  if (toGet > 0 ) {
-                     if (double(toGet) > remainingSamples)
-                        toGet = floor(remainingSamples);
-                     const auto results =
-                     mResample[i]->Process(mFactor, (float *)temp1.ptr(), toGet,
-                                           !IsStreamActive(), (float *)temp.ptr(), size);
-                     size = results.second;
+                  // All channels discard alike, so this is really the
+                  // common amount
+                  toResample = std::min(toResample, toGet);
+               }
+               sizes[i] = size;
+               formats[i] = format;
+            }
+
+            if( mFactor != 1.0 )
+            {
+               /* we are re-sampling on the fly. The last resampling call
+                * must flush any samples left in the rate conversion buffer
+                * so that they get recorded
+                */
+               size_t produced = 0;
+               if (toResample > 0) {
+                  if (double(toResample) > remainingSamples)
+                     toResample = floor(remainingSamples);
+                  ArrayOf<const float *> inBuffers{ numChannels };
+                  ArrayOf<float *> outBuffers{ numChannels };
+                  size_t outLen = sizes[0];
+                  for( i = 0; i < numChannels; i++ ) {
+                     inBuffers[i] = (const float *)resampleIn[i].ptr();
+                     outBuffers[i] = (float *)temps[i].ptr();
+                     outLen = std::min(outLen, sizes[i]);
                   }
+                  const auto results =
+                     mResample->Process(mFactor, inBuffers.get(), toResample,
+                                        !IsStreamActive(), outBuffers.get(), outLen);
+                  produced = results.second;
                }
+               for( i = 0; i < numChannels; i++ )
+                  sizes[i] = produced;
+            }
+
+            for( i = 0; i < numChannels; i++ )
+            {
+               auto &temp = temps[i];
+               const auto size = sizes[i];
+               const auto format = formats[i];
+               auto pCrossfadeSrc = crossfadeSrcs[i];
+               const auto crossfadeStart = crossfadeStarts[i];
+               const auto totalCrossfadeLength = crossfadeLengths[i];
 
                if (pCrossfadeSrc) {
                   wxASSERT(format == floatSample);
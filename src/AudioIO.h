@@ -424,7 +424,7 @@ public:
    std::unique_ptr<AudioThread> mMidiThread;
 #endif
 #endif
-   ArrayOf<std::unique_ptr<Resample>> mResample;
+   std::unique_ptr<Resample> mResample;
    ArrayOf<std::unique_ptr<RingBuffer>> mCaptureBuffers;
    WaveTrackArray      mCaptureTracks;
    ArrayOf<std::unique_ptr<RingBuffer>> mPlaybackBuffers;
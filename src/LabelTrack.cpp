@@ -92,6 +92,7 @@ LabelTrack::LabelTrack(const LabelTrack &orig) :
 
 void LabelTrack::SetLabel( size_t iLabel, const LabelStruct &newLabel )
 {
+   mpIndex.reset();
    if( iLabel >= mLabels.size() ) {
       wxASSERT( false );
       mLabels.resize( iLabel + 1 );
@@ -105,12 +106,14 @@ LabelTrack::~LabelTrack()
 
 void LabelTrack::SetOffset(double dOffset)
 {
+   mpIndex.reset();
    for (auto &labelStruct: mLabels)
       labelStruct.selectedRegion.move(dOffset);
 }
 
 void LabelTrack::Clear(double b, double e)
 {
+   mpIndex.reset();
    // May DELETE labels, so use subscripts to iterate
    for (size_t i = 0; i < mLabels.size(); ++i) {
       auto &labelStruct = mLabels[i];
@@ -160,6 +163,7 @@ bool LabelTrack::SplitDelete(double b, double e)
 
 void LabelTrack::ShiftLabelsOnInsert(double length, double pt)
 {
+   mpIndex.reset();
    for (auto &labelStruct: mLabels) {
       LabelStruct::TimeRelations relation =
                         labelStruct.RegionRelation(pt, pt, this);
@@ -173,6 +177,7 @@ void LabelTrack::ShiftLabelsOnInsert(double length, double pt)
 
 void LabelTrack::ChangeLabelsOnReverse(double b, double e)
 {
+   mpIndex.reset();
    for (auto &labelStruct: mLabels) {
       if (labelStruct.RegionRelation(b, e, this) ==
                                     LabelStruct::SURROUNDS_LABEL)
@@ -188,6 +193,7 @@ void LabelTrack::ChangeLabelsOnReverse(double b, double e)
 
 void LabelTrack::ScaleLabels(double b, double e, double change)
 {
+   mpIndex.reset();
    for (auto &labelStruct: mLabels) {
       labelStruct.selectedRegion.setTimes(
          AdjustTimeStampOnScale(labelStruct.getT0(), b, e, change),
@@ -215,6 +221,7 @@ double LabelTrack::AdjustTimeStampOnScale(double t, double b, double e, double c
 // (If necessary this could be optimised by ignoring labels that occur before a
 // specified time, as in most cases they don't need to move.)
 void LabelTrack::WarpLabels(const TimeWarper &warper) {
+   mpIndex.reset();
    for (auto &labelStruct: mLabels) {
       labelStruct.selectedRegion.setTimes(
          warper.Warp(labelStruct.getT0()),
@@ -503,6 +510,7 @@ void LabelTrack::Export(wxTextFile & f) const
 /// Import labels, handling files with or without end-times.
 void LabelTrack::Import(wxTextFile & in)
 {
+   mpIndex.reset();
    int lines = in.GetLineCount();
 
    mLabels.clear();
@@ -527,6 +535,7 @@ void LabelTrack::Import(wxTextFile & in)
 
 bool LabelTrack::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
 {
+   mpIndex.reset();
    if (!wxStrcmp(tag, wxT("label"))) {
 
       SelectedRegion selectedRegion;
@@ -704,6 +713,7 @@ Track::Holder LabelTrack::Copy(double t0, double t1, bool) const
 bool LabelTrack::PasteOver(double t, const Track * src)
 {
    auto result = src->TypeSwitch< bool >( [&](const LabelTrack *sl) {
+      mpIndex.reset();
       int len = mLabels.size();
       int pos = 0;
 
@@ -749,6 +759,7 @@ void LabelTrack::Paste(double t, const Track *src)
 // This repeats the labels in a time interval a specified number of times.
 bool LabelTrack::Repeat(double t0, double t1, int n)
 {
+   mpIndex.reset();
    // Sanity-check the arguments
    if (n < 0 || t1 < t0)
       return false;
@@ -819,6 +830,7 @@ void LabelTrack::SyncLockAdjust(double oldT1, double newT1)
 
 void LabelTrack::Silence(double t0, double t1)
 {
+   mpIndex.reset();
    int len = mLabels.size();
 
    // mLabels may resize as we iterate, so use subscripting
@@ -865,6 +877,7 @@ void LabelTrack::Silence(double t0, double t1)
 
 void LabelTrack::InsertSilence(double t, double len)
 {
+   mpIndex.reset();
    for (auto &labelStruct: mLabels) {
       double t0 = labelStruct.getT0();
       double t1 = labelStruct.getT1();
@@ -887,9 +900,78 @@ const LabelStruct *LabelTrack::GetLabel(int index) const
    return &mLabels[index];
 }
 
+// The running maximum of end times of the labels in order, so that binary
+// searches find those overlapping any time, and all their edges, sorted
+struct LabelTrack::LabelIndex
+{
+   unsigned long long generation;
+   bool sorted;
+   std::vector<double> ends;
+   std::vector<double> edges;
+};
+
+auto LabelTrack::GetIndex() const -> const LabelIndex &
+{
+   if (!mpIndex) {
+      static unsigned long long sGeneration = 0;
+      auto pIndex = std::make_unique<LabelIndex>();
+      pIndex->generation = ++sGeneration;
+      pIndex->sorted = std::is_sorted(mLabels.begin(), mLabels.end(),
+         [](const LabelStruct &a, const LabelStruct &b)
+            { return a.getT0() < b.getT0(); });
+
+      auto &ends = pIndex->ends;
+      auto &edges = pIndex->edges;
+      ends.reserve(mLabels.size());
+      edges.reserve(2 * mLabels.size());
+      auto end = -DBL_MAX;
+      for (const auto &labelStruct : mLabels) {
+         ends.push_back(end = std::max(end, labelStruct.getT1()));
+         edges.push_back(labelStruct.getT0());
+         if (labelStruct.getT1() != labelStruct.getT0())
+            edges.push_back(labelStruct.getT1());
+      }
+      std::sort(edges.begin(), edges.end());
+
+      mpIndex = std::move(pIndex);
+   }
+   return *mpIndex;
+}
+
+std::pair<size_t, size_t> LabelTrack::FindLabels(double t0, double t1) const
+{
+   const auto &index = GetIndex();
+   if (!index.sorted)
+      return { 0, mLabels.size() };
+
+   // Skip labels that, with all before them, end before t0
+   const auto &ends = index.ends;
+   const size_t first =
+      std::lower_bound(ends.begin(), ends.end(), t0) - ends.begin();
+   // Stop at the first label starting after t1
+   const size_t last = std::upper_bound(mLabels.begin() + first, mLabels.end(),
+      t1, [](double t, const LabelStruct &labelStruct)
+         { return t < labelStruct.getT0(); }
+   ) - mLabels.begin();
+   return { first, last };
+}
+
+size_t LabelTrack::CountEdges(double t0, double t1) const
+{
+   const auto &edges = GetIndex().edges;
+   return std::lower_bound(edges.begin(), edges.end(), t1) -
+      std::lower_bound(edges.begin(), edges.end(), t0);
+}
+
+unsigned long long LabelTrack::GetIndexGeneration() const
+{
+   return GetIndex().generation;
+}
+
 int LabelTrack::AddLabel(const SelectedRegion &selectedRegion,
                          const wxString &title)
 {
+   mpIndex.reset();
    LabelStruct l { selectedRegion, title };
 
    int len = mLabels.size();
@@ -910,6 +992,7 @@ int LabelTrack::AddLabel(const SelectedRegion &selectedRegion,
 
 void LabelTrack::DeleteLabel(int index)
 {
+   mpIndex.reset();
    wxASSERT((index < (int)mLabels.size()));
    auto iter = mLabels.begin() + index;
    const auto title = iter->title;
@@ -927,6 +1010,7 @@ void LabelTrack::DeleteLabel(int index)
 /// sort (with a linear search) is a reasonable choice.
 void LabelTrack::SortLabels()
 {
+   mpIndex.reset();
    const auto begin = mLabels.begin();
    const auto nn = (int)mLabels.size();
    int i = 1;
@@ -129,6 +129,15 @@ public:
    const LabelStruct *GetLabel(int index) const;
    const LabelArray &GetLabels() const { return mLabels; }
 
+   //! Range of indices of the labels that may overlap times t0 to t1
+   /*! Found in an index that is made on demand and discarded by changes of
+    the labels; while they are out of order, the range is all of them */
+   std::pair<size_t, size_t> FindLabels(double t0, double t1) const;
+   //! How many starts and ends of labels are at times from t0 to before t1
+   size_t CountEdges(double t0, double t1) const;
+   //! Differs after each change of the labels, and among label tracks
+   unsigned long long GetIndexGeneration() const;
+
    void OnLabelAdded( const wxString &title, int pos );
    //This returns the index of the label we just added.
    int AddLabel(const SelectedRegion &region, const wxString &title);
@@ -163,6 +172,11 @@ public:
 
    LabelArray mLabels;
 
+   struct LabelIndex;
+   const LabelIndex &GetIndex() const;
+   // Made on demand from mLabels, and reset by every change of them
+   mutable std::unique_ptr<LabelIndex> mpIndex;
+
    // Set in copied label tracks
    double mClipLen;
 
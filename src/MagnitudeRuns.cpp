@@ -0,0 +1,57 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MagnitudeRuns.cpp
+
+*******************************************************************//**
+
+\namespace MagnitudeRuns
+\brief Finds runs of samples on one side of a level.
+
+*//*******************************************************************/
+
+#include "MagnitudeRuns.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAGNITUDE_RUNS_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace MagnitudeRuns {
+
+float RoundUp(double threshold)
+{
+   float rounded = threshold;
+   if (rounded < threshold)
+      rounded = std::nextafter(rounded, HUGE_VALF);
+   return rounded;
+}
+
+size_t RunLength(const float *samples, size_t len, float threshold,
+   bool &above)
+{
+   // Written so that NaN counts as above
+   above = !(std::fabs(samples[0]) < threshold);
+   size_t ii = 1;
+#ifdef MAGNITUDE_RUNS_USE_SSE2
+   // Compare four magnitudes at a time, until some differ
+   const __m128 vThreshold = _mm_set1_ps(threshold);
+   const __m128 vSign = _mm_set1_ps(-0.0f);
+   const int alike = above ? 0xF : 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const __m128 magnitude = _mm_andnot_ps(vSign, _mm_loadu_ps(samples + ii));
+      if (_mm_movemask_ps(_mm_cmpnlt_ps(magnitude, vThreshold)) != alike)
+         break;
+   }
+#endif
+   for (; ii < len; ++ii)
+      if (!(std::fabs(samples[ii]) < threshold) != above)
+         break;
+   return ii;
+}
+
+}
@@ -0,0 +1,34 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MagnitudeRuns.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_MAGNITUDE_RUNS__
+#define __AUDACITY_MAGNITUDE_RUNS__
+
+#include <cstddef>
+
+//! Divides samples into runs that are all at or above a level, or all below
+//! it, as for finding silence or clipping
+namespace MagnitudeRuns {
+
+//! The least float not less than threshold, so that comparing a float with
+//! it agrees with comparing the float with threshold in double
+float RoundUp(double threshold);
+
+//! How many of the len > 0 samples, from the first, agree in whether their
+//! magnitudes are at least threshold
+/*!
+ Compares four samples at a time where SSE2 is available.  NaN counts as
+ at least threshold, so that it is never taken for silence.
+ @param above receives whether the magnitudes are at least threshold
+ */
+size_t RunLength(const float *samples, size_t len, float threshold,
+   bool &above);
+
+}
+
+#endif
@@ -35,6 +35,7 @@
 #include "Prefs.h"
 #include "Resample.h"
 #include "TimeTrack.h"
+#include "TrackFreeze.h"
 #include "float_cast.h"
 
 #include "widgets/ProgressDialog.h"
@@ -246,13 +247,46 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
 {
    mHighQuality = highQuality;
    mInputTrack.reinit(mNumInputTracks);
+   mOriginalTrack.reinit(mNumInputTracks);
 
    // mSamplePos holds for each track the next sample position not
    // yet processed.
    mSamplePos.reinit(mNumInputTracks);
+   const bool warped = warpOptions.envelope ||
+      (warpOptions.minSpeed > 0.0 && warpOptions.maxSpeed > 0.0);
    for(size_t i=0; i<mNumInputTracks; i++) {
-      mInputTrack[i].SetTrack(inputTracks[i]);
-      mSamplePos[i] = inputTracks[i]->TimeToLongSamples(startTime);
+      // Read the pre-rendered samples of a frozen track, if they are current
+      const auto pTrack = warped
+         ? inputTracks[i]
+         : TrackFreeze::Substitute(inputTracks[i], outRate);
+      mInputTrack[i].SetTrack(pTrack);
+      mOriginalTrack[i] = inputTracks[i];
+      mSamplePos[i] = pTrack->TimeToLongSamples(startTime);
+   }
+
+   // Channels of one track, when they are consecutive inputs with equal
+   // rates, are resampled together
+   mGroupSize.resize(mNumInputTracks);
+   mMaxGroupSize = 1;
+   for (size_t i = 0; i < mNumInputTracks;) {
+      const auto track = mOriginalTrack[i].get();
+      size_t nChannels = 1;
+      if (track->HasOwner() && track->IsLeader()) {
+         for (auto pChannel : TrackList::Channels(track)) {
+            if (pChannel == track)
+               continue;
+            if (i + nChannels < mNumInputTracks &&
+                mOriginalTrack[i + nChannels].get() == pChannel &&
+                mInputTrack[i + nChannels].GetTrack()->GetRate() ==
+                   mInputTrack[i].GetTrack()->GetRate())
+               ++nChannels;
+            else
+               break;
+         }
+      }
+      mGroupSize[i] = nChannels;
+      mMaxGroupSize = std::max(mMaxGroupSize, nChannels);
+      i += nChannels;
    }
    mEnvelope = warpOptions.envelope;
    mT0 = startTime;
@@ -285,7 +319,7 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
       mBuffer[c].Allocate(mInterleavedBufferSize, mFormat);
       mTemp[c].Allocate(mInterleavedBufferSize, floatSample);
    }
-   mFloatBuffer = Floats{ mInterleavedBufferSize };
+   mFloatBuffers = FloatBuffers{ mMaxGroupSize, mInterleavedBufferSize };
 
    // But cut the queue into blocks of this finer size
    // for variable rate resampling.  Each block is resampled at some
@@ -336,8 +370,16 @@ Mixer::~Mixer()
 
 void Mixer::MakeResamplers()
 {
-   for (size_t i = 0; i < mNumInputTracks; i++)
-      mResample[i] = std::make_unique<Resample>(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+   for (size_t i = 0; i < mNumInputTracks; i++) {
+      // High quality mixes are offline, as for export, and may give the
+      // channels of a group threads of their own
+      if (mGroupSize[i] > 0)
+         mResample[i] = std::make_unique<Resample>(mHighQuality,
+            mMinFactor[i], mMaxFactor[i], mGroupSize[i], false,
+            mHighQuality ? mGroupSize[i] : 1);
+      else
+         mResample[i].reset();
+   }
 }
 
 void Mixer::ApplyTrackGains(bool apply)
@@ -401,16 +443,19 @@ double ComputeWarpFactor(const Envelope &env, double t0, double t1)
 
 }
 
-size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
-                                    sampleCount *pos, float *queue,
-                                    int *queueStart, int *queueLen,
-                                    Resample * pResample)
+size_t Mixer::MixVariableRates(size_t iTrack, size_t nChannels,
+                                    const ArraysOf<int> &channelFlags)
 {
-   const WaveTrack *const track = cache.GetTrack().get();
+   // The channels of the group share rate, position and queue bookkeeping;
+   // only the queued samples and the output are per channel
+   const WaveTrack *const track = mInputTrack[iTrack].GetTrack().get();
    const double trackRate = track->GetRate();
    const double initialWarp = mRate / mSpeed / trackRate;
    const double tstep = 1.0 / trackRate;
    auto sampleSize = SAMPLE_SIZE(floatSample);
+   sampleCount *const pos = &mSamplePos[iTrack];
+   int *const queueStart = &mQueueStart[iTrack];
+   int *const queueLen = &mQueueLen[iTrack];
 
    decltype(mMaxOut) out = 0;
 
@@ -425,9 +470,15 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
     *       to calculate the position.
     */
 
-   // Find the last sample
+   // Find the last sample of any channel; a shorter channel is padded with
+   // silence by the cache
    double endTime = track->GetEndTime();
    double startTime = track->GetStartTime();
+   for (size_t j = 1; j < nChannels; ++j) {
+      const auto pChannel = mInputTrack[iTrack + j].GetTrack().get();
+      endTime = std::max(endTime, pChannel->GetEndTime());
+      startTime = std::min(startTime, pChannel->GetStartTime());
+   }
    const bool backwards = (mT1 < mT0);
    const double tEnd = backwards
       ? std::max(startTime, mT1)
@@ -437,53 +488,53 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
    double t = ((*pos).as_long_long() +
                (backwards ? *queueLen : - *queueLen)) / trackRate;
 
+   ArrayOf<const float *> inBuffers{ nChannels };
+   ArrayOf<float *> outBuffers{ nChannels };
+
    while (out < mMaxOut) {
       if (*queueLen < (int)mProcessLen) {
-         // Shift pending portion to start of the buffer
-         memmove(queue, &queue[*queueStart], (*queueLen) * sampleSize);
-         *queueStart = 0;
-
          auto getLen = limitSampleBufferSize(
             mQueueMaxLen - *queueLen,
             backwards ? *pos - endPos : endPos - *pos
          );
 
-         // Nothing to do if past end of play interval
-         if (getLen > 0) {
-            if (backwards) {
-               auto results = cache.Get(floatSample, *pos - (getLen - 1), getLen, mMayThrow);
-               if (results)
-                  memcpy(&queue[*queueLen], results, sizeof(float) * getLen);
-               else
-                  memset(&queue[*queueLen], 0, sizeof(float) * getLen);
+         for (size_t j = 0; j < nChannels; ++j) {
+            auto &cache = mInputTrack[iTrack + j];
+            const WaveTrack *const channel = cache.GetTrack().get();
+            float *const queue = mSampleQueue[iTrack + j].get();
 
-               track->GetEnvelopeValues(mEnvValues.get(),
-                                        getLen,
-                                        (*pos - (getLen- 1)).as_double() / trackRate);
-               *pos -= getLen;
-            }
-            else {
-               auto results = cache.Get(floatSample, *pos, getLen, mMayThrow);
+            // Shift pending portion to start of the buffer
+            memmove(queue, &queue[*queueStart], (*queueLen) * sampleSize);
+
+            // Nothing to do if past end of play interval
+            if (getLen > 0) {
+               const auto start = backwards ? *pos - (getLen - 1) : *pos;
+               auto results = cache.Get(floatSample, start, getLen, mMayThrow);
                if (results)
                   memcpy(&queue[*queueLen], results, sizeof(float) * getLen);
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
-                                        getLen,
-                                        (*pos).as_double() / trackRate);
+               channel->GetEnvelopeValues(mEnvValues.get(),
+                                          getLen,
+                                          start.as_double() / trackRate);
 
-               *pos += getLen;
-            }
+               for (decltype(getLen) i = 0; i < getLen; i++) {
+                  queue[(*queueLen) + i] *= mEnvValues[i];
+               }
 
-            for (decltype(getLen) i = 0; i < getLen; i++) {
-               queue[(*queueLen) + i] *= mEnvValues[i];
+               if (backwards)
+                  ReverseSamples((samplePtr)&queue[0], floatSample,
+                                 *queueLen, getLen);
             }
+         }
+         *queueStart = 0;
 
+         if (getLen > 0) {
             if (backwards)
-               ReverseSamples((samplePtr)&queue[0], floatSample,
-                              *queueLen, getLen);
-
+               *pos -= getLen;
+            else
+               *pos += getLen;
             *queueLen += getLen;
          }
       }
@@ -510,11 +561,15 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                t, t + (double)thisProcessLen / trackRate);
       }
 
-      auto results = pResample->Process(factor,
-                                      &queue[*queueStart],
+      for (size_t j = 0; j < nChannels; ++j) {
+         inBuffers[j] = &mSampleQueue[iTrack + j][*queueStart];
+         outBuffers[j] = &mFloatBuffers[j][out];
+      }
+      auto results = mResample[iTrack]->Process(factor,
+                                      inBuffers.get(),
                                       thisProcessLen,
                                       last,
-                                      &mFloatBuffer[out],
+                                      outBuffers.get(),
                                       mMaxOut - out);
 
       const auto input_used = results.first;
@@ -528,29 +583,40 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
       }
    }
 
-   for (size_t c = 0; c < mNumChannels; c++) {
-      if (mApplyTrackGains) {
-         mGains[c] = track->GetChannelGain(c);
-      }
-      else {
-         mGains[c] = 1.0;
+   for (size_t j = 0; j < nChannels; ++j) {
+      const WaveTrack *const channel = mOriginalTrack[iTrack + j].get();
+      for (size_t c = 0; c < mNumChannels; c++) {
+         if (mApplyTrackGains) {
+            mGains[c] = channel->GetChannelGain(c);
+         }
+         else {
+            mGains[c] = 1.0;
+         }
       }
+
+      MixBuffers(mNumChannels,
+                 channelFlags[j].get(),
+                 mGains.get(),
+                 (samplePtr)mFloatBuffers[j].get(),
+                 mTemp.get(),
+                 out,
+                 mInterleaved);
    }
 
-   MixBuffers(mNumChannels,
-              channelFlags,
-              mGains.get(),
-              (samplePtr)mFloatBuffer.get(),
-              mTemp.get(),
-              out,
-              mInterleaved);
+   // Keep the bookkeeping of the other channels consistent
+   for (size_t j = 1; j < nChannels; ++j) {
+      mSamplePos[iTrack + j] = *pos;
+      mQueueStart[iTrack + j] = *queueStart;
+      mQueueLen[iTrack + j] = *queueLen;
+   }
 
    return out;
 }
 
-size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
-                               sampleCount *pos)
+size_t Mixer::MixSameRate(size_t iTrack, int *channelFlags)
 {
+   WaveTrackCache &cache = mInputTrack[iTrack];
+   sampleCount *const pos = &mSamplePos[iTrack];
    const WaveTrack *const track = cache.GetTrack().get();
    const double t = ( *pos ).as_double() / track->GetRate();
    const double trackEndTime = track->GetEndTime();
@@ -575,41 +641,72 @@ size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
    if (backwards) {
       auto results = cache.Get(floatSample, *pos - (slen - 1), slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(mFloatBuffers[0].get(), results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
+         memset(mFloatBuffers[0].get(), 0, sizeof(float) * slen);
       track->GetEnvelopeValues(mEnvValues.get(), slen, t - (slen - 1) / mRate);
       for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
-      ReverseSamples((samplePtr)mFloatBuffer.get(), floatSample, 0, slen);
+         mFloatBuffers[0][i] *= mEnvValues[i]; // Track gain control will go here?
+      ReverseSamples((samplePtr)mFloatBuffers[0].get(), floatSample, 0, slen);
 
       *pos -= slen;
    }
    else {
       auto results = cache.Get(floatSample, *pos, slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(mFloatBuffers[0].get(), results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
+         memset(mFloatBuffers[0].get(), 0, sizeof(float) * slen);
       track->GetEnvelopeValues(mEnvValues.get(), slen, t);
       for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+         mFloatBuffers[0][i] *= mEnvValues[i]; // Track gain control will go here?
 
       *pos += slen;
    }
 
    for(size_t c=0; c<mNumChannels; c++)
       if (mApplyTrackGains)
-         mGains[c] = track->GetChannelGain(c);
+         mGains[c] = mOriginalTrack[iTrack]->GetChannelGain(c);
       else
          mGains[c] = 1.0;
 
    MixBuffers(mNumChannels, channelFlags, mGains.get(),
-              (samplePtr)mFloatBuffer.get(), mTemp.get(), slen, mInterleaved);
+              (samplePtr)mFloatBuffers[0].get(), mTemp.get(), slen, mInterleaved);
 
    return slen;
 }
 
+void Mixer::FindChannelFlags(size_t iTrack, int *channelFlags)
+{
+   const WaveTrack *const track = mOriginalTrack[iTrack].get();
+   for(size_t j=0; j<mNumChannels; j++)
+      channelFlags[j] = 0;
+
+   if( mMixerSpec ) {
+      //ignore left and right when downmixing is not required
+      for(size_t j = 0; j < mNumChannels; j++ )
+         channelFlags[ j ] = mMixerSpec->mMap[ iTrack ][ j ] ? 1 : 0;
+   }
+   else {
+      switch(track->GetChannel()) {
+      case Track::MonoChannel:
+      default:
+         for(size_t j=0; j<mNumChannels; j++)
+            channelFlags[j] = 1;
+         break;
+      case Track::LeftChannel:
+         channelFlags[0] = 1;
+         break;
+      case Track::RightChannel:
+         if (mNumChannels >= 2)
+            channelFlags[1] = 1;
+         else
+            channelFlags[0] = 1;
+         break;
+      }
+   }
+}
+
 size_t Mixer::Process(size_t maxToProcess)
 {
    // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
@@ -618,55 +715,36 @@ size_t Mixer::Process(size_t maxToProcess)
    //   return 0;
 
    decltype(Process(0)) maxOut = 0;
-   ArrayOf<int> channelFlags{ mNumChannels };
+   ArraysOf<int> channelFlags{ mMaxGroupSize, mNumChannels };
 
    mMaxOut = maxToProcess;
 
    Clear();
-   for(size_t i=0; i<mNumInputTracks; i++) {
+   for(size_t i=0; i<mNumInputTracks;) {
       const WaveTrack *const track = mInputTrack[i].GetTrack().get();
-      for(size_t j=0; j<mNumChannels; j++)
-         channelFlags[j] = 0;
+      const auto nChannels = mGroupSize[i];
+      for(size_t j = 0; j < nChannels; j++)
+         FindChannelFlags(i + j, channelFlags[j].get());
 
-      if( mMixerSpec ) {
-         //ignore left and right when downmixing is not required
-         for(size_t j = 0; j < mNumChannels; j++ )
-            channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
-      }
-      else {
-         switch(track->GetChannel()) {
-         case Track::MonoChannel:
-         default:
-            for(size_t j=0; j<mNumChannels; j++)
-               channelFlags[j] = 1;
-            break;
-         case Track::LeftChannel:
-            channelFlags[0] = 1;
-            break;
-         case Track::RightChannel:
-            if (mNumChannels >= 2)
-               channelFlags[1] = 1;
-            else
-               channelFlags[0] = 1;
-            break;
-         }
-      }
       if (mbVariableRates || track->GetRate() != mRate)
          maxOut = std::max(maxOut,
-            MixVariableRates(channelFlags.get(), mInputTrack[i],
-               &mSamplePos[i], mSampleQueue[i].get(),
-               &mQueueStart[i], &mQueueLen[i], mResample[i].get()));
+            MixVariableRates(i, nChannels, channelFlags));
       else
-         maxOut = std::max(maxOut,
-            MixSameRate(channelFlags.get(), mInputTrack[i], &mSamplePos[i]));
+         for(size_t j = 0; j < nChannels; j++)
+            maxOut = std::max(maxOut,
+               MixSameRate(i + j, channelFlags[j].get()));
+
+      for(size_t j = 0; j < nChannels; j++) {
+         double t = mSamplePos[i + j].as_double() / (double)track->GetRate();
+         if (mT0 > mT1)
+            // backwards (as possibly in scrubbing)
+            mTime = std::max(std::min(t, mTime), mT1);
+         else
+            // forwards (the usual)
+            mTime = std::min(std::max(t, mTime), mT1);
+      }
 
-      double t = mSamplePos[i].as_double() / (double)track->GetRate();
-      if (mT0 > mT1)
-         // backwards (as possibly in scrubbing)
-         mTime = std::max(std::min(t, mTime), mT1);
-      else
-         // forwards (the usual)
-         mTime = std::min(std::max(t, mTime), mT1);
+      i += nChannels;
    }
    if(mInterleaved) {
       for(size_t c=0; c<mNumChannels; c++) {
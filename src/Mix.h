@@ -149,13 +149,13 @@ class AUDACITY_DLL_API Mixer {
  private:
 
    void Clear();
-   size_t MixSameRate(int *channelFlags, WaveTrackCache &cache,
-                           sampleCount *pos);
+   size_t MixSameRate(size_t iTrack, int *channelFlags);
 
-   size_t MixVariableRates(int *channelFlags, WaveTrackCache &cache,
-                                sampleCount *pos, float *queue,
-                                int *queueStart, int *queueLen,
-                                Resample * pResample);
+   // Resamples the nChannels input tracks starting at index iTrack together
+   size_t MixVariableRates(size_t iTrack, size_t nChannels,
+                                const ArraysOf<int> &channelFlags);
+
+   void FindChannelFlags(size_t iTrack, int *channelFlags);
 
    void MakeResamplers();
 
@@ -164,6 +164,9 @@ class AUDACITY_DLL_API Mixer {
     // Input
    size_t           mNumInputTracks;
    ArrayOf<WaveTrackCache> mInputTrack;
+   // The tracks as given, whose gain, pan, channel and grouping apply even
+   // where mInputTrack reads a frozen rendering instead
+   ArrayOf<std::shared_ptr<const WaveTrack>> mOriginalTrack;
    bool             mbVariableRates;
    const BoundedEnvelope *mEnvelope;
    ArrayOf<sampleCount> mSamplePos;
@@ -172,6 +175,10 @@ class AUDACITY_DLL_API Mixer {
    double           mT0; // Start time
    double           mT1; // Stop time (none if mT0==mT1)
    double           mTime;  // Current time (renamed from mT to mTime for consistency with AudioIO - mT represented warped time there)
+   // For each track, how many input tracks starting there share one
+   // resampler, which is held at the same index; zero for the others
+   std::vector<size_t> mGroupSize;
+   size_t           mMaxGroupSize;
    ArrayOf<std::unique_ptr<Resample>> mResample;
    size_t           mQueueMaxLen;
    FloatBuffers     mSampleQueue;
@@ -190,7 +197,8 @@ class AUDACITY_DLL_API Mixer {
    sampleFormat     mFormat;
    bool             mInterleaved;
    ArrayOf<SampleBuffer> mBuffer, mTemp;
-   Floats           mFloatBuffer;
+   // One buffer for each channel of the largest group
+   FloatBuffers     mFloatBuffers;
    double           mRate;
    double           mSpeed;
    bool             mHighQuality;
@@ -28,6 +28,9 @@
 #if defined(USE_MIDI)
 #include "../lib-src/header-substitutes/allegro.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <sstream>
 
 #define ROUND(x) ((int) ((x) + 0.5))
@@ -170,6 +173,179 @@ Alg_seq &NoteTrack::GetSeq() const
    return *mSeq;
 }
 
+// The notes in order of start time, with the running maximum of their end
+// times, so that binary searches find those sounding at any time; and
+// pyramids of bins saying which pitches and channels sound in each span of
+// time, made for one set of visible channels
+struct NoteTrack::NoteIndex
+{
+   std::vector< Alg_note_ptr > notes;
+   std::vector< double > ends;
+
+   // Level 0 has the narrowest bins, and each later level has half as many
+   int densityChannels{ -1 };
+   double binDuration{ 0 };
+   std::vector< std::vector< PitchMask > > pitchLevels;
+   std::vector< std::vector< unsigned > > channelLevels;
+};
+
+namespace {
+   // How many bins at the finest level of density cover the sequence
+   constexpr size_t DensityBins = 1 << 16;
+}
+
+auto NoteTrack::GetIndex() const -> NoteIndex &
+{
+   auto &seq = GetSeq();
+   // Index in seconds; converting back after conversion to beats leaves the
+   // same times
+   seq.convert_to_seconds();
+   if (!mpIndex) {
+      auto pIndex = std::make_unique<NoteIndex>();
+      auto &notes = pIndex->notes;
+      Alg_iterator iter(&seq, false);
+      iter.begin();
+      Alg_event_ptr event;
+      while (0 != (event = iter.next()))
+         if (event->is_note())
+            notes.push_back(static_cast<Alg_note_ptr>(event));
+      iter.end();
+
+      // The iterator merges the tracks of the sequence in time order, but
+      // don't depend on that
+      const auto earlier = [](Alg_note_ptr a, Alg_note_ptr b)
+         { return a->time < b->time; };
+      if (!std::is_sorted(notes.begin(), notes.end(), earlier))
+         std::stable_sort(notes.begin(), notes.end(), earlier);
+
+      auto &ends = pIndex->ends;
+      ends.reserve(notes.size());
+      auto end = -std::numeric_limits<double>::infinity();
+      for (const auto note : notes)
+         ends.push_back(end = std::max(end, note->time + note->dur));
+
+      mpIndex = std::move(pIndex);
+   }
+   return *mpIndex;
+}
+
+auto NoteTrack::FindNotes(double t0, double t1) const -> NoteRange
+{
+   const auto &index = GetIndex();
+   const auto &notes = index.notes;
+   const auto &ends = index.ends;
+   // Skip notes that, with all before them, end no later than t0
+   const auto first =
+      std::upper_bound(ends.begin(), ends.end(), t0) - ends.begin();
+   // Stop at the first note starting at t1 or later
+   const auto last = std::lower_bound(notes.begin() + first, notes.end(), t1,
+      [](Alg_note_ptr note, double t){ return note->time < t; }
+   ) - notes.begin();
+   return { notes.data() + first, notes.data() + last };
+}
+
+bool NoteTrack::FindNoteDensity(double t0, double dt, size_t count,
+   PitchMask pitches[], unsigned channels[]) const
+{
+   auto &index = GetIndex();
+   auto &pitchLevels = index.pitchLevels;
+   auto &channelLevels = index.channelLevels;
+
+   if (index.densityChannels != mVisibleChannels) {
+      pitchLevels.clear();
+      channelLevels.clear();
+      index.densityChannels = mVisibleChannels;
+      index.binDuration = 0;
+
+      const auto &notes = index.notes;
+      const auto duration = notes.empty() ? 0 : index.ends.back();
+      if (duration > 0) {
+         const auto binDuration = index.binDuration = duration / DensityBins;
+         pitchLevels.emplace_back(DensityBins, PitchMask{});
+         channelLevels.emplace_back(DensityBins, 0u);
+         auto &pitchBins = pitchLevels[0];
+         auto &channelBins = channelLevels[0];
+
+         // Notes come in order of start time, so for each pitch and channel
+         // remember how many bins are marked already, and mark each bin at
+         // most once
+         size_t pitchMarked[MaxPitch + 1]{};
+         size_t channelMarked[NUM_CHANNELS]{};
+         for (const auto note : notes) {
+            if (!IsVisibleChan(note->chan))
+               continue;
+            const auto bin0 = std::min<double>(DensityBins - 1,
+               std::max(0.0, floor(note->time / binDuration)));
+            const auto bin1 = std::min<double>(DensityBins, std::max(bin0 + 1,
+               ceil((note->time + note->dur) / binDuration)));
+            const size_t first = bin0, last = bin1;
+
+            const auto pitch = std::max<int>(MinPitch,
+               std::min<int>(MaxPitch, ROUND(note->pitch)));
+            const uint64_t bit = uint64_t(1) << (pitch % 64);
+            auto &marked = pitchMarked[pitch];
+            for (auto bin = std::max(first, marked); bin < last; ++bin)
+               pitchBins[bin][pitch / 64] |= bit;
+            marked = std::max(marked, last);
+
+            if (note->chan < 0)
+               continue;
+            const unsigned channelBit = CHANNEL_BIT(note->chan);
+            auto &channelMark = channelMarked[note->chan % NUM_CHANNELS];
+            for (auto bin = std::max(first, channelMark); bin < last; ++bin)
+               channelBins[bin] |= channelBit;
+            channelMark = std::max(channelMark, last);
+         }
+
+         while (pitchLevels.back().size() > 1) {
+            const auto &finer = pitchLevels.back();
+            const auto &finerChannels = channelLevels.back();
+            const auto size = finer.size();
+            std::vector< PitchMask > coarser((size + 1) / 2);
+            std::vector< unsigned > coarserChannels((size + 1) / 2);
+            for (size_t ii = 0; ii < size; ++ii) {
+               coarser[ii / 2][0] |= finer[ii][0];
+               coarser[ii / 2][1] |= finer[ii][1];
+               coarserChannels[ii / 2] |= finerChannels[ii];
+            }
+            pitchLevels.push_back(std::move(coarser));
+            channelLevels.push_back(std::move(coarserChannels));
+         }
+      }
+   }
+
+   if (!(index.binDuration > 0 && dt >= index.binDuration))
+      return false;
+
+   // The coarsest bins that are no wider than the columns, so that each
+   // column combines only two or three bins
+   size_t level = 0;
+   auto binDuration = index.binDuration;
+   while (level + 1 < pitchLevels.size() && 2 * binDuration <= dt)
+      ++level, binDuration *= 2;
+   const auto &pitchBins = pitchLevels[level];
+   const auto &channelBins = channelLevels[level];
+   const double nBins = pitchBins.size();
+
+   for (size_t ii = 0; ii < count; ++ii) {
+      const auto start = t0 + ii * dt;
+      const size_t first =
+         std::min(nBins, std::max(0.0, floor(start / binDuration)));
+      const size_t last =
+         std::min(nBins, std::max(0.0, ceil((start + dt) / binDuration)));
+      PitchMask mask{};
+      unsigned channelMask = 0;
+      for (auto bin = first; bin < last; ++bin) {
+         mask[0] |= pitchBins[bin][0];
+         mask[1] |= pitchBins[bin][1];
+         channelMask |= channelBins[bin];
+      }
+      pitches[ii] = mask;
+      channels[ii] = channelMask;
+   }
+   return true;
+}
+
 Track::Holder NoteTrack::Clone() const
 {
    auto duplicate = std::make_shared<NoteTrack>();
@@ -230,6 +406,7 @@ void NoteTrack::WarpAndTransposeNotes(double t0, double t1,
                                       const TimeWarper &warper,
                                       double semitones)
 {
+   mpIndex.reset();
    double offset = this->GetOffset(); // track is shifted this amount
    auto &seq = GetSeq();
    seq.convert_to_seconds(); // make sure time units are right
@@ -391,6 +568,7 @@ bool NoteTrack::LabelClick(const wxRect &rect, int mx, int my, bool right)
 
 void NoteTrack::SetSequence(std::unique_ptr<Alg_seq> &&seq)
 {
+   mpIndex.reset();
    mSeq = std::move(seq);
 }
 
@@ -455,6 +633,7 @@ void NoteTrack::PrintSequence()
 
 Track::Holder NoteTrack::Cut(double t0, double t1)
 {
+   mpIndex.reset();
    if (t1 < t0)
       THROW_INCONSISTENCY_EXCEPTION;
 
@@ -508,6 +687,7 @@ Track::Holder NoteTrack::Copy(double t0, double t1, bool) const
 
 bool NoteTrack::Trim(double t0, double t1)
 {
+   mpIndex.reset();
    if (t1 < t0)
       return false;
    auto &seq = GetSeq();
@@ -532,6 +712,7 @@ bool NoteTrack::Trim(double t0, double t1)
 
 void NoteTrack::Clear(double t0, double t1)
 {
+   mpIndex.reset();
    if (t1 < t0)
       THROW_INCONSISTENCY_EXCEPTION;
 
@@ -565,6 +746,7 @@ void NoteTrack::Clear(double t0, double t1)
 
 void NoteTrack::Paste(double t, const Track *src)
 {
+   mpIndex.reset();
    // Paste inserts src at time t. If src has a positive offset,
    // the offset is treated as silence which is also inserted. If
    // the offset is negative, the offset is ignored and the ENTIRE
@@ -615,6 +797,7 @@ void NoteTrack::Paste(double t, const Track *src)
 
 void NoteTrack::Silence(double t0, double t1)
 {
+   mpIndex.reset();
    if (t1 < t0)
       THROW_INCONSISTENCY_EXCEPTION;
 
@@ -630,6 +813,7 @@ void NoteTrack::Silence(double t0, double t1)
 
 void NoteTrack::InsertSilence(double t, double len)
 {
+   mpIndex.reset();
    if (len < 0)
       THROW_INCONSISTENCY_EXCEPTION;
 
@@ -653,6 +837,7 @@ void NoteTrack::SetVelocity(float velocity)
 // NOT the function that handles horizontal dragging.
 bool NoteTrack::Shift(double t) // t is always seconds
 {
+   mpIndex.reset();
    if (t > 0) {
       auto &seq = GetSeq();
       // insert an even number of measures
@@ -691,6 +876,7 @@ QuantizedTimeAndBeat NoteTrack::NearestBeatTime( double time ) const
 
 void NoteTrack::AddToDuration( double delta )
 {
+   mpIndex.reset();
    auto &seq = GetSeq();
 #if 0
    // PRL:  Would this be better ?
@@ -704,6 +890,7 @@ void NoteTrack::AddToDuration( double delta )
 bool NoteTrack::StretchRegion
    ( QuantizedTimeAndBeat t0, QuantizedTimeAndBeat t1, double newDur )
 {
+   mpIndex.reset();
    auto &seq = GetSeq();
    bool result = seq.stretch_region( t0.second, t1.second, newDur );
    if (result) {
@@ -910,6 +1097,7 @@ bool NoteTrack::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
              std::string s(strValue.mb_str(wxConvUTF8));
              std::istringstream data(s);
              mSeq = std::make_unique<Alg_seq>(data, false);
+             mpIndex.reset();
          }
       } // while
       return true;
@@ -15,6 +15,8 @@
 
 #include "Experimental.h"
 
+#include <array>
+#include <cstdint>
 #include <utility>
 #include "Track.h"
 
@@ -46,6 +48,7 @@ SONFNS(AutoSave)
 class wxDC;
 class wxRect;
 
+class Alg_note;  // from "allegro.h"
 class Alg_seq;   // from "allegro.h"
 
 using NoteTrackBase =
@@ -80,6 +83,25 @@ public:
 
    Alg_seq &GetSeq() const;
 
+   //! A range of notes of GetSeq(), in order of start time
+   using NoteRange = std::pair< Alg_note *const *, Alg_note *const * >;
+   //! Notes that may sound after t0 and before t1
+   /*! Times are in seconds, without the offset.  The notes are found in an
+    index that is made on demand and discarded by edits.  This converts the
+    sequence to seconds. */
+   NoteRange FindNotes(double t0, double t1) const;
+
+   //! Bit p % 64 of word p / 64 is set if pitch p sounds
+   using PitchMask = std::array< uint64_t, 2 >;
+   //! For each of count consecutive columns of duration dt, beginning at t0,
+   //! which pitches of visible channels sound, and in which channels
+   /*! Times are as for FindNotes(), and channels are sets of CHANNEL_BIT.
+    The answers come from bins summarizing the notes, so the cost depends
+    on count only.  Returns false, without answers, if dt is too short for
+    the finest bins. */
+   bool FindNoteDensity(double t0, double dt, size_t count,
+      PitchMask pitches[], unsigned channels[]) const;
+
    void WarpAndTransposeNotes(double t0, double t1,
                               const TimeWarper &warper, double semitones);
 
@@ -199,6 +221,11 @@ public:
    mutable std::unique_ptr<char[]> mSerializationBuffer;
    mutable long mSerializationLength;
 
+   struct NoteIndex;
+   NoteIndex &GetIndex() const;
+   // Made on demand from mSeq, and reset by every edit of it
+   mutable std::unique_ptr<NoteIndex> mpIndex;
+
 #ifdef EXPERIMENTAL_MIDI_OUT
    float mVelocity; // velocity offset
 #endif
@@ -27,6 +27,7 @@ Paul Licameli split from ProjectManager.cpp
 #include "ProjectSettings.h"
 #include "ProjectStatus.h"
 #include "TimeTrack.h"
+#include "TrackFreeze.h"
 #include "TrackPanelAx.h"
 #include "UndoManager.h"
 #include "ViewInfo.h"
@@ -208,6 +209,11 @@ int ProjectAudioManager::PlayPlayRegion(const SelectedRegion &selectedRegion,
          std::swap(t0, t1);
    }
 
+   // Bring frozen tracks up to date, but not for scrubbing, which should
+   // respond at once.  If that fails, play the tracks themselves.
+   if (!options.pScrubbingOptions)
+      GuardedCall( [&]{ TrackFreeze::RefreshAll( tracks, options.rate ); } );
+
    int token = -1;
 
    if (t1 != t0) {
@@ -13,6 +13,7 @@ Paul Licameli split from AudacityProject.cpp
 
 #include <sqlite3.h>
 #include <wx/crt.h>
+#include <wx/thread.h>
 #include <wx/frame.h>
 #include <wx/sstream.h>
 #include <wx/xml/xml.h>
@@ -302,6 +303,11 @@ ProjectFileIO::~ProjectFileIO()
       }
    }
 
+   {
+      std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
+      CloseReaders();
+   }
+
    // Tell the checkpoint thread to shutdown
    {
       std::lock_guard<std::mutex> guard(mCheckpointMutex);
@@ -393,6 +399,54 @@ int ProjectFileIO::CheckpointHook(void *data, sqlite3 *db, const char *schema, i
    return SQLITE_OK;
 }
 
+sqlite3 *ProjectFileIO::ReaderDB(std::unique_lock<std::mutex> &lock)
+{
+   wxASSERT(!wxThread::IsMain());
+
+   std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
+   if (!mDB)
+   {
+      return nullptr;
+   }
+
+   auto &pReader = mReaders[std::this_thread::get_id()];
+   if (!pReader)
+   {
+      pReader = std::make_unique<ReaderConnection>();
+   }
+   lock = std::unique_lock<std::mutex>(pReader->mutex);
+
+   if (!pReader->db)
+   {
+      // No mutexes of SQLite are needed, because only this thread uses it
+      const char *filename = sqlite3_db_filename(mDB, nullptr);
+      int rc = sqlite3_open_v2(filename, &pReader->db,
+         SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+      if (rc != SQLITE_OK)
+      {
+         // sqlite3 docs say you should close anyway to avoid leaks
+         sqlite3_close(pReader->db);
+         pReader->db = nullptr;
+      }
+   }
+
+   return pReader->db;
+}
+
+void ProjectFileIO::CloseReaders()
+{
+   for (auto &pair : mReaders)
+   {
+      auto &reader = *pair.second;
+      std::lock_guard<std::mutex> guard(reader.mutex);
+      // Okay to call with null pointer
+      sqlite3_close(reader.db);
+      reader.db = nullptr;
+   }
+   // Forget threads that may have finished
+   mReaders.clear();
+}
+
 sqlite3 *ProjectFileIO::DB()
 {
    if (!mDB)
@@ -413,6 +467,8 @@ sqlite3 *ProjectFileIO::DB()
 // another may be opened with OpenDB()
 void ProjectFileIO::SaveConnection()
 {
+   std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
+   CloseReaders();
    // Should do nothing in proper usage, but be sure not to leak a connection:
    DiscardConnection();
 
@@ -426,6 +482,7 @@ void ProjectFileIO::SaveConnection()
 // Close any set-aside connection
 void ProjectFileIO::DiscardConnection()
 {
+   std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
    if ( mPrevDB )
    {
       auto rc = sqlite3_close( mPrevDB );
@@ -444,6 +501,8 @@ void ProjectFileIO::DiscardConnection()
 // Close any current connection and switch back to using the saved
 void ProjectFileIO::RestoreConnection()
 {
+   std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
+   CloseReaders();
    if ( mDB )
    {
       auto rc = sqlite3_close( mDB );
@@ -464,6 +523,8 @@ void ProjectFileIO::RestoreConnection()
 
 void ProjectFileIO::UseConnection( sqlite3 *db, const FilePath &filePath )
 {
+   std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
+   CloseReaders();
    wxASSERT(mDB == nullptr);
    mDB = db;
    SetFileName( filePath );
@@ -496,6 +557,8 @@ void ProjectFileIO::Config(sqlite3 *db, const char *config, const wxString &sche
 
 sqlite3 *ProjectFileIO::OpenDB(FilePath fileName)
 {
+   std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
+   CloseReaders();
    wxASSERT(mDB == nullptr);
    bool temp = false;
 
@@ -544,6 +607,8 @@ sqlite3 *ProjectFileIO::OpenDB(FilePath fileName)
 
 bool ProjectFileIO::CloseDB()
 {
+   std::lock_guard<std::recursive_mutex> readerGuard(mReaderMutex);
+   CloseReaders();
    int rc;
 
    if (mDB)
@@ -14,6 +14,7 @@ Paul Licameli split from AudacityProject.h
 #include <atomic>
 #include <condition_variable>
 #include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -198,6 +199,17 @@ private:
    void CheckpointThread();
    static int CheckpointHook(void *that, sqlite3 *db, const char *schema, int pages);
 
+   // Return a read only connection to the current database for the calling
+   // thread, which must not be the main thread, opening it if needed; lock
+   // is set to hold it while it is used.  Returns null if there is no
+   // database or it can't be opened.
+   // It sees only committed transactions.
+   sqlite3 *ReaderDB(std::unique_lock<std::mutex> &lock);
+
+   // Close the connections of other threads, waiting for any reads in
+   // progress; called with mReaderMutex held, whenever mDB changes
+   void CloseReaders();
+
 private:
    // non-static data members
    std::weak_ptr<AudacityProject> mpProject;
@@ -237,6 +249,21 @@ private:
    std::atomic_bool mCheckpointStop;
    std::mutex mCheckpointActive;
 
+   // Held while mDB is opened, closed or swapped, while connections of
+   // other threads are opened, and while other threads must read with mDB
+   std::recursive_mutex mReaderMutex;
+
+   // A connection of one thread other than the main, so that threads
+   // reading sample blocks, such as for drawing and playback, need not
+   // contend for mDB.  They last until mDB changes.
+   struct ReaderConnection
+   {
+      // Held by the owning thread while reading, and by CloseReaders()
+      std::mutex mutex;
+      sqlite3 *db{ nullptr };
+   };
+   std::map<std::thread::id, std::unique_ptr<ReaderConnection>> mReaders;
+
    friend SqliteSampleBlock;
    friend AutoCommitTransaction;
 };
@@ -48,6 +48,25 @@
 
 #include <wx/thread.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REALFFTF_USE_SSE2
+#include <emmintrin.h>
+
+// AVX is not assumed at compile time, but chosen on first use when the
+// processor has it, with the butterflies compiled for it alone
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define REALFFTF_USE_AVX
+#define REALFFTF_TARGET_AVX __attribute__((target("avx")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define REALFFTF_USE_AVX
+#define REALFFTF_TARGET_AVX
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
 #ifndef M_PI
 #define	M_PI		3.14159265358979323846  /* pi */
 #endif
@@ -87,63 +106,190 @@ HFFT InitializeFFT(size_t fftlen)
       h->SinTable[h->BitReversed[i]+1]=(fft_type)-cos(2*M_PI*i/(2*h->Points));
    }
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   // NEW SSE FFT routines work on live data
-   for(size_t i = 0; i < 32; i++)
-      if((1 << i) & fftlen)
-         h->pow2Bits = i;
-#endif
-
    return h;
 }
 
-enum : size_t { MAX_HFFT = 10 };
+// Tables up to this length are kept for the life of the process and shared
+// by all callers; longer ones are rare and big, and are freed after use
+enum : size_t { MAX_SHARED_FFT = 1 << 16 };
 
 // Maintain a pool:
-static std::vector< std::unique_ptr<FFTParam> > hFFTArray(MAX_HFFT);
+static std::vector< std::unique_ptr<FFTParam> > hFFTArray;
 wxCriticalSection getFFTMutex;
 
 /* Get a handle to the FFT tables of the desired length */
 /* This version keeps common tables rather than allocating a NEW table every time */
+/* It may be called from any thread; the tables are not modified after creation */
 HFFT GetFFT(size_t fftlen)
 {
-   // To do:  smarter policy about when to retain in the pool and when to
-   // allocate a unique instance.
+   if (fftlen > MAX_SHARED_FFT)
+      return InitializeFFT(fftlen);
 
    wxCriticalSectionLocker locker{ getFFTMutex };
-   
-   size_t h = 0;
+
    auto n = fftlen/2;
-   auto size = hFFTArray.size();
-   for(;
-       (h < size) && hFFTArray[h] && (n != hFFTArray[h]->Points);
-       h++)
-      ;
-   if(h < size) {
-      if(hFFTArray[h] == NULL) {
-         hFFTArray[h].reset( InitializeFFT(fftlen).release() );
-      }
-      return HFFT{ hFFTArray[h].get() };
-   } else {
-      // All buffers used, so fall back to allocating a NEW set of tables
-      return InitializeFFT(fftlen);
-   }
+   for (const auto &pFFT : hFFTArray)
+      if (pFFT->Points == n)
+         return HFFT{ pFFT.get() };
+
+   hFFTArray.emplace_back( InitializeFFT(fftlen).release() );
+   return HFFT{ hFFTArray.back().get() };
 }
 
 /* Release a previously requested handle to the FFT tables */
 void FFTDeleter::operator() (FFTParam *hFFT) const
 {
+   // Shared tables are never released
    wxCriticalSectionLocker locker{ getFFTMutex };
 
    auto it = hFFTArray.begin(), end = hFFTArray.end();
    while (it != end && it->get() != hFFT)
       ++it;
-   if ( it != end )
-      ;
-   else
+   if ( it == end )
       delete hFFT;
 }
 
+/*
+*  One group of butterflies of the forward transform, all with the same
+*  twiddle factor.  The SSE2 version does two at a time with the same
+*  operations in the same order, so results do not depend on it.
+*/
+static inline void ForwardButterflies(fft_type *A, fft_type *B, size_t count,
+   fft_type sin, fft_type cos)
+{
+   fft_type v1, v2;
+   size_t ii = 0;
+#ifdef REALFFTF_USE_SSE2
+   const __m128 vcos = _mm_set1_ps(cos);
+   const __m128 vsin = _mm_setr_ps(sin, -sin, sin, -sin);
+   const __m128 two = _mm_set1_ps(2);
+   for (; ii + 2 <= count; ii += 2, A += 4, B += 4) {
+      // (v1, -v2) for two butterflies
+      const __m128 b = _mm_loadu_ps(B);
+      const __m128 bswap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+      const __m128 w =
+         _mm_add_ps(_mm_mul_ps(b, vcos), _mm_mul_ps(bswap, vsin));
+      const __m128 bout = _mm_add_ps(_mm_loadu_ps(A), w);
+      _mm_storeu_ps(B, bout);
+      _mm_storeu_ps(A, _mm_sub_ps(bout, _mm_mul_ps(two, w)));
+   }
+#endif
+   for (; ii < count; ++ii)
+   {
+      v1 = *B * cos + *(B + 1) * sin;
+      v2 = *B * sin - *(B + 1) * cos;
+      *B = (*A + v1);
+      *(A++) = *(B++) - 2 * v1;
+      *B = (*A - v2);
+      *(A++) = *(B++) + 2 * v2;
+   }
+}
+
+/*
+*  One group of butterflies of the inverse transform, as above
+*/
+static inline void InverseButterflies(fft_type *A, fft_type *B, size_t count,
+   fft_type sin, fft_type cos)
+{
+   fft_type v1, v2;
+   size_t ii = 0;
+#ifdef REALFFTF_USE_SSE2
+   const __m128 vcos = _mm_set1_ps(cos);
+   const __m128 vsin = _mm_setr_ps(-sin, sin, -sin, sin);
+   const __m128 half = _mm_set1_ps(0.5f);
+   for (; ii + 2 <= count; ii += 2, A += 4, B += 4) {
+      // (v1, v2) for two butterflies
+      const __m128 b = _mm_loadu_ps(B);
+      const __m128 bswap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+      const __m128 w =
+         _mm_add_ps(_mm_mul_ps(b, vcos), _mm_mul_ps(bswap, vsin));
+      const __m128 bout = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(A), w), half);
+      _mm_storeu_ps(B, bout);
+      _mm_storeu_ps(A, _mm_sub_ps(bout, w));
+   }
+#endif
+   for (; ii < count; ++ii)
+   {
+      v1 = *B * cos - *(B + 1) * sin;
+      v2 = *B * sin + *(B + 1) * cos;
+      *B = (*A + v1) * (fft_type)0.5;
+      *(A++) = *(B++) - v1;
+      *B = (*A + v2) * (fft_type)0.5;
+      *(A++) = *(B++) - v2;
+   }
+}
+
+#ifdef REALFFTF_USE_AVX
+static bool HaveAVX()
+{
+#ifdef _MSC_VER
+   // The processor must support AVX, and the system must save its registers
+   int info[4];
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   const bool avx = (info[2] & (1 << 28)) != 0;
+   return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+   return __builtin_cpu_supports("avx");
+#endif
+}
+
+// Decided once, on first use
+static bool UseAVX()
+{
+   static const bool use = HaveAVX();
+   return use;
+}
+
+/*
+*  The butterflies as above, four at a time, again with the operations of
+*  the scalar loop in the same order.  AVX is worth it only for groups of at
+*  least four butterflies, the earlier passes, which are most of the work.
+*/
+REALFFTF_TARGET_AVX
+static void ForwardButterfliesAVX(fft_type *A, fft_type *B, size_t count,
+   fft_type sin, fft_type cos)
+{
+   const __m256 vcos = _mm256_set1_ps(cos);
+   const __m256 vsin =
+      _mm256_setr_ps(sin, -sin, sin, -sin, sin, -sin, sin, -sin);
+   const __m256 two = _mm256_set1_ps(2);
+   size_t ii = 0;
+   for (; ii + 4 <= count; ii += 4, A += 8, B += 8) {
+      const __m256 b = _mm256_loadu_ps(B);
+      const __m256 bswap = _mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1));
+      const __m256 w =
+         _mm256_add_ps(_mm256_mul_ps(b, vcos), _mm256_mul_ps(bswap, vsin));
+      const __m256 bout = _mm256_add_ps(_mm256_loadu_ps(A), w);
+      _mm256_storeu_ps(B, bout);
+      _mm256_storeu_ps(A, _mm256_sub_ps(bout, _mm256_mul_ps(two, w)));
+   }
+   ForwardButterflies(A, B, count - ii, sin, cos);
+}
+
+REALFFTF_TARGET_AVX
+static void InverseButterfliesAVX(fft_type *A, fft_type *B, size_t count,
+   fft_type sin, fft_type cos)
+{
+   const __m256 vcos = _mm256_set1_ps(cos);
+   const __m256 vsin =
+      _mm256_setr_ps(-sin, sin, -sin, sin, -sin, sin, -sin, sin);
+   const __m256 half = _mm256_set1_ps(0.5f);
+   size_t ii = 0;
+   for (; ii + 4 <= count; ii += 4, A += 8, B += 8) {
+      const __m256 b = _mm256_loadu_ps(B);
+      const __m256 bswap = _mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1));
+      const __m256 w =
+         _mm256_add_ps(_mm256_mul_ps(b, vcos), _mm256_mul_ps(bswap, vsin));
+      const __m256 bout =
+         _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(A), w), half);
+      _mm256_storeu_ps(B, bout);
+      _mm256_storeu_ps(A, _mm256_sub_ps(bout, w));
+   }
+   InverseButterflies(A, B, count - ii, sin, cos);
+}
+#endif
+
 /*
 *  Forward FFT routine.  Must call GetFFT(fftlen) first!
 *
@@ -166,12 +312,15 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
 {
    fft_type *A,*B;
    const fft_type *sptr;
-   const fft_type *endptr1,*endptr2;
+   const fft_type *endptr1;
    const int *br1,*br2;
    fft_type HRplus,HRminus,HIplus,HIminus;
    fft_type v1,v2,sin,cos;
 
    auto ButterfliesPerGroup = h->Points/2;
+#ifdef REALFFTF_USE_AVX
+   const bool useAVX = UseAVX();
+#endif
 
    /*
    *  Butterfly:
@@ -193,18 +342,14 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
       {
          sin = *sptr;
          cos = *(sptr+1);
-         endptr2 = B;
-         while(A < endptr2)
-         {
-            v1 = *B * cos + *(B + 1) * sin;
-            v2 = *B * sin - *(B + 1) * cos;
-            *B = (*A + v1);
-            *(A++) = *(B++) - 2 * v1;
-            *B = (*A - v2);
-            *(A++) = *(B++) + 2 * v2;
-         }
-         A = B;
-         B += ButterfliesPerGroup * 2;
+#ifdef REALFFTF_USE_AVX
+         if (useAVX && ButterfliesPerGroup >= 4)
+            ForwardButterfliesAVX(A, B, ButterfliesPerGroup, sin, cos);
+         else
+#endif
+         ForwardButterflies(A, B, ButterfliesPerGroup, sin, cos);
+         A = B + ButterfliesPerGroup * 2;
+         B = A + ButterfliesPerGroup * 2;
          sptr += 2;
       }
       ButterfliesPerGroup >>= 1;
@@ -268,12 +413,15 @@ void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
 {
    fft_type *A,*B;
    const fft_type *sptr;
-   const fft_type *endptr1,*endptr2;
+   const fft_type *endptr1;
    const int *br1;
    fft_type HRplus,HRminus,HIplus,HIminus;
    fft_type v1,v2,sin,cos;
 
    auto ButterfliesPerGroup = h->Points / 2;
+#ifdef REALFFTF_USE_AVX
+   const bool useAVX = UseAVX();
+#endif
 
    /* Massage input to get the input for a real output sequence. */
    A = buffer + 2;
@@ -330,18 +478,14 @@ void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
       {
          sin = *(sptr++);
          cos = *(sptr++);
-         endptr2 = B;
-         while(A < endptr2)
-         {
-            v1 = *B * cos - *(B + 1) * sin;
-            v2 = *B * sin + *(B + 1) * cos;
-            *B = (*A + v1) * (fft_type)0.5;
-            *(A++) = *(B++) - v1;
-            *B = (*A + v2) * (fft_type)0.5;
-            *(A++) = *(B++) - v2;
-         }
-         A = B;
-         B += ButterfliesPerGroup * 2;
+#ifdef REALFFTF_USE_AVX
+         if (useAVX && ButterfliesPerGroup >= 4)
+            InverseButterfliesAVX(A, B, ButterfliesPerGroup, sin, cos);
+         else
+#endif
+         InverseButterflies(A, B, ButterfliesPerGroup, sin, cos);
+         A = B + ButterfliesPerGroup * 2;
+         B = A + ButterfliesPerGroup * 2;
       }
       ButterfliesPerGroup >>= 1;
    }
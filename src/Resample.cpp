@@ -16,9 +16,9 @@
 
       libsoxr, written by Rob Sykes. LGPL.
 
-   Since Audacity always does resampling on mono streams that are
-   contiguous in memory, this class doesn't support multiple channels
-   or some of the other optional features of some of these resamplers.
+   Channels of the same track may be resampled by one instance, given
+   either as one interleaved buffer or as separate buffers per channel,
+   so that they share the cost of the filter setup.
 
 *//*******************************************************************/
 
@@ -27,9 +27,14 @@
 #include "Internat.h"
 #include "../include/audacity/ComponentInterface.h"
 
+#include <algorithm>
 #include <soxr.h>
 
-Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+                   const unsigned numChannels, const bool interleaved,
+                   const unsigned numThreads)
+   : mNumChannels{ std::max(1u, numChannels) }
+   , mbInterleaved{ interleaved || numChannels <= 1 }
 {
    this->SetMethod(useBestMethod);
    soxr_quality_spec_t q_spec;
@@ -43,7 +48,12 @@ Resample::Resample(const bool useBestMethod, const double dMinFactor, const doub
       mbWantConstRateResampling = false; // variable rate resampling
       q_spec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
    }
-   mHandle.reset(soxr_create(1, dMinFactor, 1, 0, 0, &q_spec, 0));
+   const auto io_spec = mbInterleaved
+      ? soxr_io_spec(SOXR_FLOAT32_I, SOXR_FLOAT32_I)
+      : soxr_io_spec(SOXR_FLOAT32_S, SOXR_FLOAT32_S);
+   const auto runtime_spec = soxr_runtime_spec(std::max(1u, numThreads));
+   mHandle.reset(soxr_create(1, dMinFactor, mNumChannels, 0,
+      &io_spec, &q_spec, &runtime_spec));
 }
 
 Resample::~Resample()
@@ -92,22 +102,47 @@ std::pair<size_t, size_t>
                         float  *outBuffer,
                         size_t  outBufferLen)
 {
-   size_t idone, odone;
-   if (mbWantConstRateResampling)
-   {
-      soxr_process(mHandle.get(),
-            inBuffer , (lastFlag? ~inBufferLen : inBufferLen), &idone,
-            outBuffer,                           outBufferLen, &odone);
+   // Planar multichannel converters must use the other overload
+   wxASSERT(mbInterleaved);
+   return DoProcess(factor, inBuffer, inBufferLen, lastFlag,
+                    outBuffer, outBufferLen);
+}
+
+std::pair<size_t, size_t>
+      Resample::Process(double  factor,
+                        const float * const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float * const *outBuffers,
+                        size_t  outBufferLen)
+{
+   if (mbInterleaved) {
+      // Only the degenerate mono case makes planar and interleaved the same
+      wxASSERT(mNumChannels == 1);
+      return DoProcess(factor, inBuffers[0], inBufferLen, lastFlag,
+                       outBuffers[0], outBufferLen);
    }
-   else
-   {
+
+   // soxr writes the samples but not the array of channel pointers
+   return DoProcess(factor, inBuffers, inBufferLen, lastFlag,
+                    const_cast<float **>(outBuffers), outBufferLen);
+}
+
+std::pair<size_t, size_t>
+      Resample::DoProcess(double  factor,
+                          const void *in,
+                          size_t  inBufferLen,
+                          bool    lastFlag,
+                          void   *out,
+                          size_t  outBufferLen)
+{
+   size_t idone, odone;
+   if (!mbWantConstRateResampling)
       soxr_set_io_ratio(mHandle.get(), 1/factor, 0);
 
-      inBufferLen = lastFlag? ~inBufferLen : inBufferLen;
-      soxr_process(mHandle.get(),
-            inBuffer , inBufferLen , &idone,
-            outBuffer, outBufferLen, &odone);
-   }
+   soxr_process(mHandle.get(),
+         in , (lastFlag? ~inBufferLen : inBufferLen), &idone,
+         out,                           outBufferLen, &odone);
    return { idone, odone };
 }
 
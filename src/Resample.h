@@ -38,7 +38,16 @@ class Resample final
    /// the fast method.
    // dMinFactor and dMaxFactor specify the range of factors for variable-rate resampling.
    // For constant-rate, pass the same value for both.
-   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
+   //
+   /// numChannels channels are converted together by one instance, sharing
+   /// the filter setup.  Their samples are passed either interleaved in one
+   /// buffer or planar, as one buffer per channel.
+   /// numThreads lets the converter filter the channels on up to that many
+   /// threads; it is only useful for long, offline conversions of more than
+   /// one channel.
+   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+            const unsigned numChannels = 1, const bool interleaved = false,
+            const unsigned numThreads = 1);
    ~Resample();
 
    static EnumSetting< int > FastMethodSetting;
@@ -55,7 +64,8 @@ class Resample final
     * This function may do nothing if you don't pass a large enough output
     * buffer (i.e. there is no where to put a full block of output data)
     @param factor The scaling factor to resample by.
-    @param inBuffer Buffer of input samples to be processed (mono)
+    @param inBuffer Buffer of input samples to be processed (mono, or
+    interleaved if so constructed)
     @param inBufferLen Length of the input buffer, in samples.
     @param lastFlag Flag to indicate this is the last lot of input samples and
     the buffer needs to be emptied out into the rate converter.
@@ -74,13 +84,41 @@ class Resample final
                         float  *outBuffer,
                         size_t  outBufferLen);
 
+   /** @brief Planar multichannel variant of Process().
+    *
+    * inBuffers and outBuffers each hold GetNumChannels() pointers.  Lengths
+    * and return values count samples per channel, which are consumed and
+    * produced in lockstep.
+   */
+   std::pair<size_t, size_t>
+                Process(double  factor,
+                        const float * const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float * const *outBuffers,
+                        size_t  outBufferLen);
+
+   unsigned GetNumChannels() const { return mNumChannels; }
+
  protected:
    void SetMethod(const bool useBestMethod);
 
+   // in and out point to one interleaved buffer, or to an array of
+   // channel buffers, as the converter was configured
+   std::pair<size_t, size_t>
+                DoProcess(double  factor,
+                          const void *in,
+                          size_t  inBufferLen,
+                          bool    lastFlag,
+                          void   *out,
+                          size_t  outBufferLen);
+
  protected:
    int   mMethod; // resampler-specific enum for resampling method
    soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
    bool mbWantConstRateResampling;
+   unsigned mNumChannels;
+   bool mbInterleaved;
 };
 
 #endif // __AUDACITY_RESAMPLE_H__
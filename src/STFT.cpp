@@ -0,0 +1,127 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  STFT.cpp
+
+*******************************************************************//**
+
+\class STFT
+\brief Short time Fourier transform of many frames in one call, with the
+windowing and the conversion of results done in loops that vectorize.
+
+*//*******************************************************************/
+
+#include "STFT.h"
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace {
+// Frames transformed in turn by one job of the worker pool
+const size_t FramesPerJob = 16;
+}
+
+STFT::STFT(size_t fftLen, const float *window, size_t windowLen)
+   : mFFTLen{ fftLen }
+   , mWindowLen{ std::min(windowLen, fftLen) }
+   , mPadding{ (fftLen - mWindowLen) / 2 }
+   , hFFT{ GetFFT(fftLen) }
+   , mWindow{ mWindowLen }
+{
+   std::copy(window, window + mWindowLen, mWindow.get());
+}
+
+size_t STFT::FrameSize(Output output) const
+{
+   return output == Output::Complex ? mFFTLen + 2 : mFFTLen / 2;
+}
+
+void STFT::Process(const float *samples, size_t hop, size_t nFrames,
+   Output output, float *results) const
+{
+   DoProcess([=](size_t ii){ return samples + ii * hop; },
+      nFrames, output, results);
+}
+
+void STFT::Process(const float *samples, const size_t *starts,
+   size_t nFrames, Output output, float *results) const
+{
+   DoProcess([=](size_t ii){ return samples + starts[ii]; },
+      nFrames, output, results);
+}
+
+void STFT::DoProcess(const FrameFunction &frame, size_t nFrames,
+   Output output, float *results) const
+{
+   const auto frameSize = FrameSize(output);
+   const size_t nJobs = (nFrames + FramesPerJob - 1) / FramesPerJob;
+   // This may be called from a job already on the pool, as when the
+   // spectrogram cache divides its columns among jobs.  That is safe, because
+   // ParallelFor lets the calling thread take jobs too, so it does not wait
+   // on workers that may all be busy.
+   WorkerPool::Get().ParallelFor(nJobs, [&](size_t iJob) {
+      Floats buffer{ mFFTLen };
+      const auto end = std::min(nFrames, (iJob + 1) * FramesPerJob);
+      for (auto ii = iJob * FramesPerJob; ii < end; ++ii)
+         Transform(frame(ii), output, buffer.get(), results + ii * frameSize);
+   });
+}
+
+void STFT::Transform(const float * __restrict samples, Output output,
+   float * __restrict buffer, float * __restrict results) const
+{
+   // Window the samples, and zero pad them
+   {
+      const float * __restrict window = mWindow.get();
+      float * __restrict dest = buffer + mPadding;
+      std::fill(buffer, dest, 0.0f);
+      for (size_t ii = 0; ii < mWindowLen; ++ii)
+         dest[ii] = samples[ii] * window[ii];
+      std::fill(dest + mWindowLen, buffer + mFFTLen, 0.0f);
+   }
+
+   RealFFTf(buffer, hFFT.get());
+
+   const auto half = mFFTLen / 2;
+   const int *const bitReversed = hFFT->BitReversed.get();
+   if (output == Output::Complex) {
+      // Undo the bit reversal; DC and Fs/2 are both real, and packed
+      // together in the first two values
+      results[0] = buffer[0];
+      results[1] = 0;
+      for (size_t ii = 1; ii < half; ++ii) {
+         const auto index = bitReversed[ii];
+         results[2 * ii] = buffer[index];
+         results[2 * ii + 1] = buffer[index + 1];
+      }
+      results[2 * half] = buffer[1];
+      results[2 * half + 1] = 0;
+      return;
+   }
+
+   // Handle the (real-only) DC
+   results[0] = buffer[0] * buffer[0];
+   for (size_t ii = 1; ii < half; ++ii) {
+      const auto index = bitReversed[ii];
+      const float re = buffer[index], im = buffer[index + 1];
+      results[ii] = re * re + im * im;
+   }
+
+   switch (output) {
+   case Output::Magnitude:
+      for (size_t ii = 0; ii < half; ++ii)
+         results[ii] = sqrtf(results[ii]);
+      break;
+   case Output::PowerDB:
+      for (size_t ii = 0; ii < half; ++ii) {
+         const float power = results[ii];
+         results[ii] = (power <= 0) ? -160.0f : 10.0 * log10f(power);
+      }
+      break;
+   default:
+      break;
+   }
+}
@@ -0,0 +1,66 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  STFT.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_STFT__
+#define __AUDACITY_STFT__
+
+#include "RealFFTf.h"
+
+#include <functional>
+
+///\brief Windowed real FFTs of many frames of a signal at once
+/**
+ Each frame is windowLen samples, multiplied by the window and centered in
+ fftLen points with zero padding on both sides.  Frames are transformed in
+ batches, divided among the threads of WorkerPool when there are many, so
+ this may be called from worker jobs too.
+
+ Results for frame ii start at results + ii * FrameSize(output):
+ - Complex gives fftLen / 2 + 1 bins, from DC through Fs/2, as interleaved
+   real and imaginary parts
+ - Power, Magnitude and PowerDB give fftLen / 2 bins, from DC up to but
+   excluding Fs/2; PowerDB is 10 log10 of the power, floored at -160 dB
+ */
+class AUDACITY_DLL_API STFT final
+{
+public:
+   enum class Output {
+      Complex,
+      Power,
+      Magnitude,
+      PowerDB,
+   };
+
+   STFT(size_t fftLen, const float *window, size_t windowLen);
+
+   size_t FFTLength() const { return mFFTLen; }
+   size_t FrameSize(Output output) const;
+
+   //! Transform nFrames frames, the ii-th starting at samples + ii * hop
+   void Process(const float *samples, size_t hop, size_t nFrames,
+      Output output, float *results) const;
+
+   //! Transform nFrames frames, the ii-th starting at samples + starts[ii]
+   void Process(const float *samples, const size_t *starts, size_t nFrames,
+      Output output, float *results) const;
+
+private:
+   using FrameFunction = std::function< const float*(size_t) >;
+   void DoProcess(const FrameFunction &frame, size_t nFrames,
+      Output output, float *results) const;
+   void Transform(const float *samples, Output output,
+      float *buffer, float *results) const;
+
+   const size_t mFFTLen;
+   const size_t mWindowLen;
+   const size_t mPadding;
+   HFFT hFFT;
+   Floats mWindow;
+};
+
+#endif
@@ -995,6 +995,13 @@ void Sequence::WriteXML(XMLWriter &xmlFile) const
 }
 
 int Sequence::FindBlock(sampleCount pos) const
+{
+   return FindBlock(mBlock, mNumSamples, pos);
+}
+
+//static
+int Sequence::FindBlock(const BlockArray &mBlock, sampleCount mNumSamples,
+                        sampleCount pos)
 {
    wxASSERT(pos >= 0 && pos < mNumSamples);
 
@@ -1262,6 +1269,16 @@ struct MinMaxSumsq
 
 bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
                               size_t len, const sampleCount *where) const
+{
+   return GetWaveDisplay(mBlock, mNumSamples, mMaxSamples,
+      min, max, rms, bl, len, where);
+}
+
+//static
+bool Sequence::GetWaveDisplay(const BlockArray &mBlock,
+                              sampleCount mNumSamples, size_t mMaxSamples,
+                              float *min, float *max, float *rms, int* bl,
+                              size_t len, const sampleCount *where)
 {
    wxASSERT(len > 0);
    const auto s0 = std::max(sampleCount(0), where[0]);
@@ -1287,7 +1304,7 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
    // Loop over block files, opening and reading and closing each
    // not more than once
    unsigned nBlocks = mBlock.size();
-   const unsigned int block0 = FindBlock(s0);
+   const unsigned int block0 = FindBlock(mBlock, mNumSamples, s0);
    for (unsigned int b = block0; b < nBlocks; ++b) {
       if (b > block0)
          srcX = nextSrcX;
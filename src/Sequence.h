@@ -94,6 +94,14 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    bool GetWaveDisplay(float *min, float *max, float *rms, int* bl,
                        size_t len, const sampleCount *where) const;
 
+   // The same, for a copy of the block array of a sequence.  This touches
+   // nothing else, so it may be used by a worker thread while the sequence
+   // itself changes.
+   static bool GetWaveDisplay(const BlockArray &blocks,
+                       sampleCount numSamples, size_t maxSamples,
+                       float *min, float *max, float *rms, int* bl,
+                       size_t len, const sampleCount *where);
+
    // Return non-null, or else throw!
    // Must pass in the correct factory for the result.  If it's not the same
    // as in this, then block contents must be copied.
@@ -198,6 +206,8 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    //
 
    int FindBlock(sampleCount pos) const;
+   static int FindBlock(const BlockArray &blocks, sampleCount numSamples,
+                        sampleCount pos);
 
    static void AppendBlock(SampleBlockFactory *pFactory, sampleFormat format,
                            BlockArray &blocks,
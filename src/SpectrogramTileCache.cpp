@@ -0,0 +1,444 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SpectrogramTileCache.cpp
+
+*******************************************************************//**
+
+\class SpectrogramTileCache
+\brief Saves and finds columns of spectrograms in a side file of the
+project, so that they need not be computed again after scrolling or zooming
+back, or in a later session.
+
+*//*******************************************************************/
+
+#include "SpectrogramTileCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <sqlite3.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+
+#include "FileNames.h"
+#include "MemoryX.h"
+#include "Project.h"
+#include "ProjectFileIO.h"
+
+namespace {
+
+// Total size of the tiles in the file; older ones are deleted as more are
+// saved
+const size_t MaxBytes = 256 * 1024 * 1024;
+
+// Total size of the tiles waiting to be written; more are dropped
+const size_t MaxPendingBytes = 32 * 1024 * 1024;
+
+const char *TileConfig =
+   "PRAGMA journal_mode = WAL;"
+   "PRAGMA synchronous = OFF;";
+
+const char *TileSchema =
+   "CREATE TABLE IF NOT EXISTS spectrogramtiles"
+   "("
+   "  id                   INTEGER PRIMARY KEY AUTOINCREMENT,"
+   "  hash                 INTEGER,"
+   "  tuple                BLOB,"
+   "  columns              BLOB"
+   ");"
+   "CREATE INDEX IF NOT EXISTS spectrogramtilehash"
+   "  ON spectrogramtiles (hash);"
+   "CREATE TABLE IF NOT EXISTS spectrogramtileblocks"
+   "("
+   "  tile                 INTEGER,"
+   "  block                INTEGER"
+   ");"
+   "CREATE INDEX IF NOT EXISTS spectrogramtileblocktile"
+   "  ON spectrogramtileblocks (tile);";
+
+// FNV-1a, of bytes
+void HashBytes( unsigned long long &hash, const void *data, size_t size )
+{
+   const auto bytes = static_cast<const unsigned char *>( data );
+   for ( size_t ii = 0; ii < size; ++ii ) {
+      hash ^= bytes[ii];
+      hash *= 1099511628211ull;
+   }
+}
+
+// Only to find candidates; the whole tuple is compared
+sqlite3_int64 Hash( const SpectrogramTileCache::Key &tuple )
+{
+   unsigned long long hash = 14695981039346656037ull;
+   for ( auto value : tuple ) {
+      unsigned char bytes[8];
+      for ( int ii = 0; ii < 8; ++ii )
+         bytes[ii] = ( value >> ( 8 * ii ) ) & 0xff;
+      HashBytes( hash, bytes, sizeof( bytes ) );
+   }
+   return (sqlite3_int64)hash;
+}
+
+// The side file of a project file, named after its path
+FilePath SideFileName( const FilePath &projectFileName )
+{
+   const auto path = projectFileName.ToUTF8();
+   unsigned long long hash = 14695981039346656037ull;
+   HashBytes( hash, path.data(), path.length() );
+   return wxFileName{ FileNames::TempDir(),
+      wxString::Format( wxT("%s-%016llx"),
+         wxFileName{ projectFileName }.GetName(), hash ),
+      wxT("spectrogram") }.GetFullPath();
+}
+
+void RemoveSideFile( const FilePath &fileName )
+{
+   for ( auto suffix : { wxT(""), wxT("-wal"), wxT("-shm") } ) {
+      const auto path = fileName + suffix;
+      if ( wxFileExists( path ) )
+         wxRemoveFile( path );
+   }
+}
+
+// Bind the hash and the tuple as the first two parameters
+bool BindTuple( sqlite3_stmt *stmt, const SpectrogramTileCache::Key &tuple )
+{
+   return
+      sqlite3_bind_int64( stmt, 1, Hash( tuple ) ) == SQLITE_OK &&
+      sqlite3_bind_blob( stmt, 2, tuple.data(),
+         tuple.size() * sizeof( tuple[0] ), SQLITE_STATIC ) == SQLITE_OK;
+}
+
+}
+
+static const AudacityProject::AttachedObjects::RegisteredFactory sTileCacheKey{
+   []( AudacityProject &parent ){
+      return std::make_shared< SpectrogramTileCache >( parent );
+   }
+};
+
+SpectrogramTileCache &SpectrogramTileCache::Get( AudacityProject &project )
+{
+   return project.AttachedObjects::Get< SpectrogramTileCache >(
+      sTileCacheKey );
+}
+
+SpectrogramTileCache::SpectrogramTileCache( AudacityProject &project )
+   : mIO{ ProjectFileIO::Get( project ) }
+{
+}
+
+SpectrogramTileCache::~SpectrogramTileCache()
+{
+   Close();
+}
+
+void SpectrogramTileCache::Close()
+{
+   if ( mWriter.joinable() ) {
+      // Tiles not yet written are not needed any more
+      {
+         std::lock_guard<std::mutex> guard( mMutex );
+         mStop = true;
+         mCondition.notify_one();
+      }
+      mWriter.join();
+   }
+   mStop = false;
+   mQueue.clear();
+   mPending.clear();
+   mPendingBytes = 0;
+
+   // Okay to call with null pointer
+   sqlite3_close( mReadDB );
+   mReadDB = nullptr;
+
+   // A temporary project file is deleted, or replaced by another project
+   // whose block ids may coincide
+   if ( mTemporary && !mFileName.empty() )
+      RemoveSideFile( mFileName );
+   mFileName.clear();
+}
+
+bool SpectrogramTileCache::Prepare()
+{
+   const auto &projectFileName = mIO.GetFileName();
+   if ( projectFileName.empty() )
+      return false;
+   if ( projectFileName == mProjectFileName )
+      return !mFailed;
+
+   // Open the file at first use, and again for each other project file
+   Close();
+   mFailed = true;
+   mProjectFileName = projectFileName;
+   mTemporary = mIO.IsTemporary();
+   mFileName = SideFileName( projectFileName );
+
+   if ( sqlite3_open( mFileName.ToUTF8(), &mReadDB ) != SQLITE_OK ||
+        sqlite3_exec( mReadDB, TileConfig, nullptr, nullptr, nullptr )
+           != SQLITE_OK ||
+        sqlite3_exec( mReadDB, TileSchema, nullptr, nullptr, nullptr )
+           != SQLITE_OK ) {
+      wxLogDebug( wxT("SQLITE error %s"), sqlite3_errmsg( mReadDB ) );
+      sqlite3_close( mReadDB );
+      mReadDB = nullptr;
+      return false;
+   }
+
+   mWriter = std::thread( [this]{ WriterThread(); } );
+   mFailed = false;
+   return true;
+}
+
+bool SpectrogramTileCache::Load( const Key &key, float *values, size_t count )
+{
+   if ( key.empty() || !Prepare() )
+      return false;
+
+   // It may be waiting to be written
+   {
+      std::lock_guard<std::mutex> guard( mMutex );
+      auto iter = mPending.find( key );
+      if ( iter != mPending.end() ) {
+         const auto &stored = iter->second->values;
+         if ( stored.size() != count )
+            return false;
+         std::copy( stored.begin(), stored.end(), values );
+         return true;
+      }
+   }
+
+   sqlite3_stmt *stmt = nullptr;
+   auto cleanup = finally( [&] {
+      if ( stmt )
+         sqlite3_finalize( stmt );
+   } );
+
+   if ( sqlite3_prepare_v2( mReadDB,
+         "SELECT columns FROM spectrogramtiles"
+         " WHERE hash = ?1 AND tuple = ?2;",
+         -1, &stmt, nullptr ) != SQLITE_OK ||
+       !BindTuple( stmt, key ) ||
+       sqlite3_step( stmt ) != SQLITE_ROW )
+      return false;
+
+   const auto bytes = count * sizeof( float );
+   if ( (size_t)sqlite3_column_bytes( stmt, 0 ) != bytes )
+      return false;
+   memcpy( values, sqlite3_column_blob( stmt, 0 ), bytes );
+   return true;
+}
+
+void SpectrogramTileCache::Store( const Key &key, const BlockIDs &blocks,
+   const float *values, size_t count )
+{
+   if ( key.empty() || !Prepare() )
+      return;
+
+   const auto bytes = count * sizeof( float );
+   auto pTile = std::make_shared<Tile>();
+   pTile->key = key;
+   pTile->blocks = blocks;
+   pTile->values.assign( values, values + count );
+
+   std::lock_guard<std::mutex> guard( mMutex );
+   // When the disk is slow, drop tiles rather than let memory grow
+   if ( mPendingBytes + bytes > MaxPendingBytes )
+      return;
+   auto &pPending = mPending[ pTile->key ];
+   if ( pPending )
+      mPendingBytes -= pPending->values.size() * sizeof( float );
+   pPending = pTile;
+   mPendingBytes += bytes;
+   mQueue.push_back( pTile );
+   mCondition.notify_one();
+}
+
+void SpectrogramTileCache::WriterThread()
+{
+   // A connection of this thread only
+   sqlite3 *db = nullptr;
+   if ( sqlite3_open_v2( mFileName.ToUTF8(), &db,
+         SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr ) != SQLITE_OK ||
+        sqlite3_exec( db, TileConfig, nullptr, nullptr, nullptr )
+           != SQLITE_OK ) {
+      // Tiles will still be taken from the queue, and forgotten
+      sqlite3_close( db );
+      db = nullptr;
+   }
+   auto cleanup = finally( [&] {
+      // Okay to call with null pointer
+      sqlite3_close( db );
+   } );
+
+   if ( db )
+      Purge( db );
+
+   while ( true ) {
+      std::shared_ptr<Tile> pTile;
+      {
+         std::unique_lock<std::mutex> lock( mMutex );
+         mCondition.wait( lock, [&]{ return mStop || !mQueue.empty(); } );
+         if ( mStop )
+            break;
+         pTile = mQueue.front();
+         mQueue.pop_front();
+      }
+
+      if ( db )
+         Write( db, *pTile );
+
+      {
+         // From now on, Load() finds it in the file, if writing succeeded
+         std::lock_guard<std::mutex> guard( mMutex );
+         auto iter = mPending.find( pTile->key );
+         if ( iter != mPending.end() && iter->second == pTile ) {
+            mPendingBytes -= pTile->values.size() * sizeof( float );
+            mPending.erase( iter );
+         }
+      }
+   }
+}
+
+void SpectrogramTileCache::Purge( sqlite3 *db )
+{
+   // Tiles with a block deleted since they were stored can never be found
+   // again, and the file of an earlier project at the same path may have
+   // any tiles at all.  If the project can't be read, keep no tiles.  Don't
+   // let ATTACH create the project file.
+   char *sql = !wxFileExists( mProjectFileName ) ? nullptr : sqlite3_mprintf(
+      "ATTACH DATABASE %Q AS project;"
+      "DELETE FROM main.spectrogramtiles WHERE id IN"
+      "  (SELECT tile FROM main.spectrogramtileblocks WHERE block NOT IN"
+      "     (SELECT blockid FROM project.sampleblocks));",
+      (const char *)mProjectFileName.ToUTF8() );
+   auto cleanup = finally( [&] {
+      sqlite3_free( sql );
+      sqlite3_exec( db, "DETACH DATABASE project;",
+         nullptr, nullptr, nullptr );
+   } );
+   if ( !sql ||
+        sqlite3_exec( db, sql, nullptr, nullptr, nullptr ) != SQLITE_OK ) {
+      wxLogDebug( wxT("SQLITE error %s"), sqlite3_errmsg( db ) );
+      sqlite3_exec( db, "DELETE FROM spectrogramtiles;",
+         nullptr, nullptr, nullptr );
+   }
+   sqlite3_exec( db,
+      "DELETE FROM spectrogramtileblocks WHERE tile NOT IN"
+      "  (SELECT id FROM spectrogramtiles);",
+      nullptr, nullptr, nullptr );
+
+   // The total size of the tiles that remain
+   sqlite3_stmt *stmt = nullptr;
+   auto finalize = finally( [&] {
+      if ( stmt )
+         sqlite3_finalize( stmt );
+   } );
+   mBytes = 0;
+   if ( sqlite3_prepare_v2( db,
+         "SELECT total(length(tuple) + length(columns))"
+         " FROM spectrogramtiles;",
+         -1, &stmt, nullptr ) == SQLITE_OK &&
+        sqlite3_step( stmt ) == SQLITE_ROW )
+      mBytes = (size_t)sqlite3_column_double( stmt, 0 );
+}
+
+void SpectrogramTileCache::Write( sqlite3 *db, const Tile &tile )
+{
+   // The tile and its blocks together, or neither, so that Purge() finds
+   // every tile of a deleted block
+   if ( sqlite3_exec( db, "BEGIN;", nullptr, nullptr, nullptr )
+       != SQLITE_OK )
+      return;
+   bool committed = false;
+   const auto bytes = mBytes;
+   auto rollback = finally( [&] {
+      if ( !committed ) {
+         sqlite3_exec( db, "ROLLBACK;", nullptr, nullptr, nullptr );
+         mBytes = bytes;
+      }
+   } );
+
+   // Run sql, binding the tuple and then the values as the parameters
+   // that it has, and calling each for each row
+   const auto run = [&]( const char *sql,
+      const std::function< void( sqlite3_stmt* ) > &each ) {
+      sqlite3_stmt *stmt = nullptr;
+      auto cleanup = finally( [&] {
+         if ( stmt )
+            sqlite3_finalize( stmt );
+      } );
+      if ( sqlite3_prepare_v2( db, sql, -1, &stmt, nullptr ) != SQLITE_OK ||
+           ( sqlite3_bind_parameter_count( stmt ) >= 2 &&
+             !BindTuple( stmt, tile.key ) ) ||
+           ( sqlite3_bind_parameter_count( stmt ) >= 3 &&
+             sqlite3_bind_blob( stmt, 3, tile.values.data(),
+               tile.values.size() * sizeof( float ), SQLITE_STATIC )
+                  != SQLITE_OK ) ) {
+         wxLogDebug( wxT("SQLITE error %s"), sqlite3_errmsg( db ) );
+         return false;
+      }
+      int rc;
+      while ( ( rc = sqlite3_step( stmt ) ) == SQLITE_ROW )
+         each( stmt );
+      return rc == SQLITE_DONE;
+   };
+
+   // Replace any tile of the same tuple
+   std::vector< std::pair< sqlite3_int64, size_t > > replaced;
+   const auto collect = [&]( sqlite3_stmt *stmt ) {
+      replaced.emplace_back( sqlite3_column_int64( stmt, 0 ),
+         (size_t)sqlite3_column_int64( stmt, 1 ) );
+   };
+   const auto remove = [&] {
+      for ( const auto &pair : replaced ) {
+         char sql[192];
+         sqlite3_snprintf( sizeof( sql ), sql,
+            "DELETE FROM spectrogramtiles WHERE id = %lld;"
+            "DELETE FROM spectrogramtileblocks WHERE tile = %lld;",
+            (long long)pair.first, (long long)pair.first );
+         if ( sqlite3_exec( db, sql, nullptr, nullptr, nullptr )
+             == SQLITE_OK )
+            mBytes -= std::min( mBytes, pair.second );
+      }
+      replaced.clear();
+   };
+
+   run( "SELECT id, length(tuple) + length(columns) FROM spectrogramtiles"
+        " WHERE hash = ?1 AND tuple = ?2;", collect );
+   remove();
+
+   if ( !run( "INSERT INTO spectrogramtiles (hash, tuple, columns)"
+              " VALUES(?1, ?2, ?3);", []( sqlite3_stmt* ){} ) )
+      return;
+   const auto id = sqlite3_last_insert_rowid( db );
+   for ( auto block : tile.blocks ) {
+      char sql[128];
+      sqlite3_snprintf( sizeof( sql ), sql,
+         "INSERT INTO spectrogramtileblocks (tile, block)"
+         " VALUES(%lld, %lld);",
+         (long long)id, (long long)block );
+      if ( sqlite3_exec( db, sql, nullptr, nullptr, nullptr ) != SQLITE_OK )
+         return;
+   }
+   mBytes += tile.key.size() * sizeof( tile.key[0] ) +
+      tile.values.size() * sizeof( float );
+
+   // Delete the oldest tiles while there are too many bytes
+   while ( mBytes > MaxBytes ) {
+      if ( !run( "SELECT id, length(tuple) + length(columns)"
+                 " FROM spectrogramtiles ORDER BY id LIMIT 16;",
+                 collect ) ||
+           replaced.empty() ) {
+         mBytes = 0;
+         break;
+      }
+      remove();
+   }
+
+   committed =
+      sqlite3_exec( db, "COMMIT;", nullptr, nullptr, nullptr ) == SQLITE_OK;
+}
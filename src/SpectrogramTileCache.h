@@ -0,0 +1,112 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SpectrogramTileCache.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SPECTROGRAM_TILE_CACHE__
+#define __AUDACITY_SPECTROGRAM_TILE_CACHE__
+
+#include "ClientData.h" // to inherit
+#include "audacity/Types.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class AudacityProject;
+class ProjectFileIO;
+struct sqlite3;
+
+using SampleBlockID = long long;
+
+///\brief Columns of spectrograms, saved in a side file of the project
+/**
+ Tiles are found by a key that the caller makes of everything that
+ determines their contents, such as the ids of the sample blocks and the
+ spectrogram settings, so they never need to be invalidated.  The whole key
+ is compared, not only a hash of it.
+
+ The file is in the temporary directory, named after the path of the
+ project file, and is kept between sessions, because sample block ids are
+ never reused in a project file.  Each tile records the blocks it was
+ computed from, and when the file is opened, tiles are deleted if any of
+ their blocks no longer exists in the project.  When another project file is
+ opened in the window, its own side file is used.  The oldest tiles are
+ deleted when they exceed a total size.  The file of a temporary project is
+ deleted when the project closes or another file replaces it.
+
+ Store() only queues the tile, and a thread of the cache writes it, so
+ that drawing does not wait for the disk.
+
+ Failures are not reported; the caller computes the columns again.
+ */
+class SpectrogramTileCache final : public ClientData::Base
+{
+public:
+   //! Everything that determines the contents of a tile; empty for none
+   using Key = std::vector<unsigned long long>;
+   //! The sample blocks that a tile was computed from
+   using BlockIDs = std::vector<SampleBlockID>;
+
+   static SpectrogramTileCache &Get( AudacityProject &project );
+
+   explicit SpectrogramTileCache( AudacityProject &project );
+   SpectrogramTileCache( const SpectrogramTileCache & ) = delete;
+   SpectrogramTileCache &operator=( const SpectrogramTileCache & ) = delete;
+   ~SpectrogramTileCache() override;
+
+   //! Fill count values and return true, if a tile of that size was stored
+   bool Load( const Key &key, float *values, size_t count );
+
+   void Store( const Key &key, const BlockIDs &blocks,
+      const float *values, size_t count );
+
+private:
+   struct Tile {
+      Key key;
+      BlockIDs blocks;
+      std::vector<float> values;
+   };
+
+   // Open the side file of the project file and start the writer, if not
+   // yet done for that project file; return false if the cache is not
+   // usable
+   bool Prepare();
+   // Stop the writer and close the file, deleting it if the project is
+   // temporary
+   void Close();
+   void WriterThread();
+   // Delete the tiles of blocks that are not in the project
+   void Purge( sqlite3 *db );
+   void Write( sqlite3 *db, const Tile &tile );
+
+   ProjectFileIO &mIO;
+   FilePath mProjectFileName;
+   bool mTemporary{ false };
+   FilePath mFileName;
+   bool mFailed{ false };
+   // For Load() on the main thread
+   sqlite3 *mReadDB{};
+
+   // Tiles not yet written, in order, and the same by key, for Load()
+   std::deque< std::shared_ptr<Tile> > mQueue;
+   std::map< Key, std::shared_ptr<Tile> > mPending;
+   size_t mPendingBytes{ 0 };
+   // Guards mQueue, mPending, mPendingBytes and mStop
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   bool mStop{ false };
+   std::thread mWriter;
+   // Total size of the tiles in the file, used by the writer only
+   size_t mBytes{ 0 };
+};
+
+#endif
@@ -26,6 +26,7 @@ and in the spectrogram spectral selection.
 #include "Audacity.h"
 #include "SpectrumAnalyst.h"
 #include "FFT.h"
+#include "STFT.h"
 
 #include "SampleFormat.h"
 #include <wx/dcclient.h>
@@ -151,18 +152,40 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
 
    size_t start = 0;
    int windows = 0;
+   if (alg == Spectrum) {
+      // Transform many windows in each call, updating progress between calls;
+      // this leaves nothing for the loop below, which does the other algorithms
+      STFT stft{ mWindowSize, win.get(), mWindowSize };
+      // About a million samples per call
+      const size_t batch = std::max<size_t>(1, 1048576 / mWindowSize);
+      Floats powers{ batch * half };
+      while (start + mWindowSize <= dataLen) {
+         const size_t count =
+            std::min(batch, (dataLen - mWindowSize - start) / half + 1);
+         stft.Process(data + start, half, count,
+            STFT::Output::Power, powers.get());
+
+         for (size_t ii = 0; ii < count; ++ii) {
+            const float *const power = &powers[ii * half];
+            for (size_t i = 0; i < half; i++)
+               mProcessed[i] += power[i];
+         }
+
+         start += count * half;
+         windows += count;
+
+         // Update the progress bar
+         if (progress) {
+            progress->SetValue(start - half);
+         }
+      }
+   }
+
    while (start + mWindowSize <= dataLen) {
       for (size_t i = 0; i < mWindowSize; i++)
          in[i] = win[i] * data[start + i];
 
       switch (alg) {
-         case Spectrum:
-            PowerSpectrum(mWindowSize, in.get(), out.get());
-
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
          case Autocorrelation:
          case CubeRootAutocorrelation:
          case EnhancedAutocorrelation:
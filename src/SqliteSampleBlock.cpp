@@ -9,10 +9,22 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 **********************************************************************/
 
 #include <float.h>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <vector>
 #include <sqlite3.h>
+#include <wx/thread.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SUMMARY_USE_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "SampleFormat.h"
 #include "ProjectFileIO.h"
+#include "WorkerPool.h"
 #include "xml/XMLTagHandler.h"
 
 #include "SampleBlock.h" // to inherit
@@ -61,6 +73,12 @@ public:
 
 private:
    void Load(SampleBlockID sbid);
+   // Load the block once, if it is not valid, though several threads
+   // may read it at once
+   void EnsureLoaded();
+   // Run sql on a connection suitable for the calling thread, passing the
+   // statement stepped to its first row to use; throws if there is no row
+   void ReadRow(const char *sql, const std::function<void(sqlite3_stmt *)> &use);
    bool GetSummary(float *dest,
                    size_t frameoffset,
                    size_t numframes,
@@ -84,6 +102,7 @@ private:
    bool mLocked = false;
 
    SampleBlockID mBlockID;
+   std::once_flag mLoadOnce;
 
    ArrayOf<char> mSamples;
    size_t mSampleBytes;
@@ -372,6 +391,12 @@ double SqliteSampleBlock::GetSumRms() const
    return mSumRms;
 }
 
+namespace {
+// Fewer whole 256 sample summaries in a range are not worth reading apart
+// from its samples
+const size_t MinSummaryFrames = 16;
+}
+
 /// Retrieves the minimum, maximum, and maximum RMS of the
 /// specified sample data in this block.
 ///
@@ -381,27 +406,28 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
 {
    float min = FLT_MAX;
    float max = -FLT_MAX;
-   float sumsq = 0;
+   // Summed in double, because a range may hold many millions of samples
+   double sumsq = 0;
 
-   if (!mValid && mBlockID)
-   {
-      Load(mBlockID);
-   }
+   EnsureLoaded();
 
-   if (start < mSampleCount)
+   // Read count samples from offset into the results
+   const auto readSamples = [&](size_t offset, size_t count)
    {
-      len = std::min(len, mSampleCount - start);
+      if (count == 0)
+      {
+         return;
+      }
 
-      // TODO: actually use summaries
-      SampleBuffer blockData(len, floatSample);
+      SampleBuffer blockData(count, floatSample);
       float *samples = (float *) blockData.ptr();
 
       size_t copied = GetBlob(samples,
                               floatSample,
                               "samples",
                               mSampleFormat,
-                              start * SAMPLE_SIZE(mSampleFormat),
-                              len * SAMPLE_SIZE(mSampleFormat)) / SAMPLE_SIZE(mSampleFormat);
+                              offset * SAMPLE_SIZE(mSampleFormat),
+                              count * SAMPLE_SIZE(mSampleFormat)) / SAMPLE_SIZE(mSampleFormat);
       for (size_t i = 0; i < copied; ++i, ++samples)
       {
          float sample = *samples;
@@ -418,6 +444,43 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
 
          sumsq += (sample * sample);
       }
+   };
+
+   if (start < mSampleCount)
+   {
+      len = std::min(len, mSampleCount - start);
+
+      // Take the frames of the 256 sample summary that lie wholly within the
+      // range from the summary, and read only the samples at the ends
+      const size_t frame0 = (start + 255) / 256;
+      const size_t frame1 = (start + len) / 256;
+      if (frame1 >= frame0 + MinSummaryFrames)
+      {
+         readSamples(start, frame0 * 256 - start);
+
+         const size_t frames = frame1 - frame0;
+         Floats summary{ 3 * frames };
+         if (GetSummary256(summary.get(), frame0, frames))
+         {
+            for (size_t i = 0; i < frames; ++i)
+            {
+               min = std::min(min, summary[3 * i]);
+               max = std::max(max, summary[3 * i + 1]);
+               const double rms = summary[3 * i + 2];
+               sumsq += rms * rms * 256;
+            }
+         }
+         else
+         {
+            readSamples(frame0 * 256, frames * 256);
+         }
+
+         readSamples(frame1 * 256, start + len - frame1 * 256);
+      }
+      else
+      {
+         readSamples(start, len);
+      }
    }
 
    return { min, max, (float) sqrt(sumsq / len) };
@@ -444,16 +507,10 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
                                   size_t srcoffset,
                                   size_t srcbytes)
 {
-   auto db = mIO.DB();
-
    wxASSERT(mBlockID > 0);
 
-   if (!mValid && mBlockID)
-   {
-      Load(mBlockID);
-   }
+   EnsureLoaded();
 
-   int rc;
    size_t minbytes = 0;
 
    char sql[256];
@@ -463,70 +520,117 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
                     srccolumn,
                     mBlockID);
 
-   sqlite3_stmt *stmt = nullptr;
-   auto cleanup = finally([&]
+   ReadRow(sql, [&](sqlite3_stmt *stmt)
    {
-      if (stmt)
-      {
-         sqlite3_finalize(stmt);
-      }
+      samplePtr src = (samplePtr) sqlite3_column_blob(stmt, 0);
+      size_t blobbytes = (size_t) sqlite3_column_bytes(stmt, 0);
+
+      srcoffset = std::min(srcoffset, blobbytes);
+      minbytes = std::min(srcbytes, blobbytes - srcoffset);
+
+      CopySamples(src + srcoffset,
+                  srcformat,
+                  (samplePtr) dest,
+                  destformat,
+                  minbytes / SAMPLE_SIZE(srcformat));
+
+      dest = ((samplePtr) dest) + minbytes;
    });
 
-   rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-   if (rc != SQLITE_OK)
+   if (srcbytes - minbytes)
    {
-      wxLogDebug(wxT("SQLITE error %s"), sqlite3_errmsg(db));
+      memset(dest, 0, srcbytes - minbytes);
    }
-   else
+
+   return srcbytes;
+}
+
+void SqliteSampleBlock::ReadRow(const char *sql,
+   const std::function<void(sqlite3_stmt *)> &use)
+{
+   const auto tryRead = [&](sqlite3 *db, bool log)
    {
-      rc = sqlite3_step(stmt);
-      if (rc != SQLITE_ROW)
+      sqlite3_stmt *stmt = nullptr;
+      auto cleanup = finally([&]
       {
-         wxLogDebug(wxT("SQLITE error %s"), sqlite3_errmsg(db));
+         if (stmt)
+         {
+            sqlite3_finalize(stmt);
+         }
+      });
+
+      int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+      if (rc == SQLITE_OK)
+      {
+         rc = sqlite3_step(stmt);
       }
-      else
+      if (rc != SQLITE_ROW)
       {
-         samplePtr src = (samplePtr) sqlite3_column_blob(stmt, 0);
-         size_t blobbytes = (size_t) sqlite3_column_bytes(stmt, 0);
+         if (log)
+         {
+            wxLogDebug(wxT("SQLITE error %s"), sqlite3_errmsg(db));
+         }
+         return false;
+      }
 
-         srcoffset = std::min(srcoffset, blobbytes);
-         minbytes = std::min(srcbytes, blobbytes - srcoffset);
+      use(stmt);
+      return true;
+   };
 
-         if (srcoffset != 0)
+   if (wxThread::IsMain())
+   {
+      if (tryRead(mIO.DB(), true))
+      {
+         return;
+      }
+   }
+   else
+   {
+      // Other threads, such as for drawing and playback, read with
+      // connections of their own, so they don't wait for one another
+      {
+         std::unique_lock<std::mutex> lock;
+         if (auto db = mIO.ReaderDB(lock))
          {
-            srcoffset += 0;
+            if (tryRead(db, false))
+            {
+               return;
+            }
          }
-         CopySamples(src + srcoffset,
-                     srcformat,
-                     (samplePtr) dest,
-                     destformat,
-                     minbytes / SAMPLE_SIZE(srcformat));
+      }
 
-         dest = ((samplePtr) dest) + minbytes;
+      // But such a connection does not see a transaction of the main
+      // connection before it commits, and can be shut out by an exclusive
+      // lock; then use the main connection, which SQLite serializes, only
+      // keeping the main thread from replacing it meanwhile
+      std::lock_guard<std::recursive_mutex> readerGuard(mIO.mReaderMutex);
+      if (mIO.mDB && tryRead(mIO.mDB, true))
+      {
+         return;
       }
    }
 
-   if ( rc != SQLITE_ROW )
-      // Just showing the user a simple message, not the library error too
-      // which isn't internationalized
-      throw SimpleMessageBoxException{ XO("Failed to retrieve samples") };
+   // Just showing the user a simple message, not the library error too
+   // which isn't internationalized
+   throw SimpleMessageBoxException{ XO("Failed to retrieve samples") };
+}
 
-   if (srcbytes - minbytes)
+void SqliteSampleBlock::EnsureLoaded()
+{
+   // If Load throws, another call may try again
+   std::call_once(mLoadOnce, [this]
    {
-      memset(dest, 0, srcbytes - minbytes);
-   }
-
-   return srcbytes;
+      if (!mValid && mBlockID)
+      {
+         Load(mBlockID);
+      }
+   });
 }
 
 void SqliteSampleBlock::Load(SampleBlockID sbid)
 {
-   auto db = mIO.DB();
-
    wxASSERT(sbid > 0);
 
-   int rc;
-
    mValid = false;
    mSummary256Bytes = 0;
    mSummary64kBytes = 0;
@@ -544,43 +648,19 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
                     "  FROM sampleblocks WHERE blockid = %lld;",
                     sbid);
 
-   sqlite3_stmt *stmt = nullptr;
-   auto cleanup = finally([&]
+   ReadRow(sql, [&](sqlite3_stmt *stmt)
    {
-      if (stmt)
-      {
-         sqlite3_finalize(stmt);
-      }
+      mBlockID = sbid;
+      mSampleFormat = (sampleFormat) sqlite3_column_int(stmt, 0);
+      mSumMin = sqlite3_column_double(stmt, 1);
+      mSumMax = sqlite3_column_double(stmt, 2);
+      mSumRms = sqlite3_column_double(stmt, 3);
+      mSummary256Bytes = sqlite3_column_int(stmt, 4);
+      mSummary64kBytes = sqlite3_column_int(stmt, 5);
+      mSampleBytes = sqlite3_column_int(stmt, 6);
+      mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
    });
 
-   rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-   if (rc != SQLITE_OK)
-   {
-      wxLogDebug(wxT("SQLITE error %s"), sqlite3_errmsg(db));
-   }
-   else {
-      rc = sqlite3_step(stmt);
-      if (rc != SQLITE_ROW)
-      {
-         wxLogDebug(wxT("SQLITE error %s"), sqlite3_errmsg(db));
-      }
-   }
-
-   if ( rc != SQLITE_ROW )
-      // Just showing the user a simple message, not the library error too
-      // which isn't internationalized
-      throw SimpleMessageBoxException{ XO("Failed to retrieve samples") };
-
-   mBlockID = sbid;
-   mSampleFormat = (sampleFormat) sqlite3_column_int(stmt, 0);
-   mSumMin = sqlite3_column_double(stmt, 1);
-   mSumMax = sqlite3_column_double(stmt, 2);
-   mSumRms = sqlite3_column_double(stmt, 3);
-   mSummary256Bytes = sqlite3_column_int(stmt, 4);
-   mSummary64kBytes = sqlite3_column_int(stmt, 5);
-   mSampleBytes = sqlite3_column_int(stmt, 6);
-   mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
-
    mValid = true;
 }
 
@@ -681,6 +761,47 @@ void SqliteSampleBlock::SaveXML(XMLWriter &xmlFile)
    xmlFile.WriteAttr(wxT("rms"), mSumRms);
 }
 
+namespace {
+// Fewer 256 sample summaries are not worth another job
+const int MinFramesPerJob = 64;
+
+// Find min, max and sum of squares of count > 0 samples
+inline void SummarizeFrame(const float *samples, int count,
+   float &min, float &max, float &sumsq)
+{
+   int j = 1;
+   min = max = samples[0];
+   sumsq = min * min;
+#ifdef SUMMARY_USE_SSE2
+   if (count >= 8) {
+      __m128 vmin = _mm_loadu_ps(samples);
+      __m128 vmax = vmin;
+      __m128 vsum = _mm_mul_ps(vmin, vmin);
+      for (j = 4; j + 4 <= count; j += 4) {
+         const __m128 v = _mm_loadu_ps(samples + j);
+         vmin = _mm_min_ps(vmin, v);
+         vmax = _mm_max_ps(vmax, v);
+         vsum = _mm_add_ps(vsum, _mm_mul_ps(v, v));
+      }
+      float mins[4], maxs[4], sums[4];
+      _mm_storeu_ps(mins, vmin);
+      _mm_storeu_ps(maxs, vmax);
+      _mm_storeu_ps(sums, vsum);
+      min = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+      max = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+      sumsq = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+   }
+#endif
+   for (; j < count; ++j)
+   {
+      float f1 = samples[j];
+      sumsq += f1 * f1;
+      min = std::min(min, f1);
+      max = std::max(max, f1);
+   }
+}
+}
+
 /// Calculates summary block data describing this sample data.
 ///
 /// This method also has the side effect of setting the mSumMin,
@@ -733,41 +854,30 @@ void SqliteSampleBlock::CalcSummary()
    int sumLen = (mSampleCount + 255) / 256;
    int summaries = 256;
 
-   for (int i = 0; i < sumLen; ++i)
-   {
-      min = samples[i * 256];
-      max = samples[i * 256];
-      sumsq = min * min;
-
-      int jcount = 256;
-      if (jcount > mSampleCount - i * 256)
+   // Large blocks, as from import and effects, divide the work among threads
+   std::vector<float> sumsqs(sumLen);
+   auto &pool = WorkerPool::Get();
+   const int nJobs = std::max(1,
+      std::min<int>(pool.Concurrency(), sumLen / MinFramesPerJob));
+   pool.ParallelFor(nJobs, [&](size_t iJob) {
+      const int i0 = sumLen * iJob / nJobs;
+      const int i1 = sumLen * (iJob + 1) / nJobs;
+      for (int i = i0; i < i1; ++i)
       {
-         jcount = mSampleCount - i * 256;
-         fraction = 1.0 - (jcount / 256.0);
-      }
-
-      for (int j = 1; j < jcount; ++j)
-      {
-         float f1 = samples[i * 256 + j];
-         sumsq += f1 * f1;
-
-         if (f1 < min)
-         {
-            min = f1;
-         }
-         else if (f1 > max)
-         {
-            max = f1;
-         }
+         const int jcount = std::min<int>(256, mSampleCount - i * 256);
+         float min, max;
+         SummarizeFrame(samples + i * 256, jcount, min, max, sumsqs[i]);
+         summary256[i * 3] = min;
+         summary256[i * 3 + 1] = max;
+         // The rms is correct, but this may be for less than 256 samples in last loop.
+         summary256[i * 3 + 2] = (float) sqrt(sumsqs[i] / jcount);
       }
+   });
 
-      totalSquares += sumsq;
-
-      summary256[i * 3] = min;
-      summary256[i * 3 + 1] = max;
-      // The rms is correct, but this may be for less than 256 samples in last loop.
-      summary256[i * 3 + 2] = (float) sqrt(sumsq / jcount);
-   }
+   for (int i = 0; i < sumLen; ++i)
+      totalSquares += sumsqs[i];
+   if (sumLen > 0 && mSampleCount - (sumLen - 1) * 256 < 256)
+      fraction = 1.0 - ((mSampleCount - (sumLen - 1) * 256) / 256.0);
 
    for (int i = sumLen; i < frames256; ++i)
    {
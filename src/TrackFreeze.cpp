@@ -0,0 +1,169 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  TrackFreeze.cpp
+
+*******************************************************************//**
+
+\class TrackFreeze
+\brief Keeps a pre-rendered copy of a WaveTrack channel for playback and
+export, re-rendered lazily after edits.
+
+*//*******************************************************************/
+
+#include "TrackFreeze.h"
+
+#include "Envelope.h"
+#include "Mix.h"
+#include "SampleBlock.h"
+#include "UserException.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+#include "widgets/ProgressDialog.h"
+
+static const AttachedTrackObjects::RegisteredFactory key{
+   []( Track &track ) -> std::shared_ptr<TrackFreeze> {
+      if ( auto pTrack = dynamic_cast<WaveTrack*>( &track ) )
+         return std::make_shared<TrackFreeze>( *pTrack );
+      return nullptr;
+   }
+};
+
+TrackFreeze &TrackFreeze::Get( WaveTrack &track )
+{
+   return track.AttachedObjects::Get< TrackFreeze >( key );
+}
+
+const TrackFreeze *TrackFreeze::Find( const WaveTrack &track )
+{
+   return track.AttachedObjects::Find< const TrackFreeze >( key );
+}
+
+void TrackFreeze::RefreshAll( TrackList &tracks, double rate )
+{
+   for ( auto pTrack : tracks.Any< WaveTrack >() ) {
+      auto pFreeze =
+         pTrack->AttachedObjects::Find< TrackFreeze >( key );
+      if ( pFreeze )
+         pFreeze->Refresh( rate );
+   }
+}
+
+std::shared_ptr<const WaveTrack> TrackFreeze::Substitute(
+   const std::shared_ptr<const WaveTrack> &pTrack, double rate )
+{
+   auto pFreeze = pTrack
+      ? pTrack->AttachedObjects::Find< const TrackFreeze >( key )
+      : nullptr;
+   if ( !( pFreeze && pFreeze->IsCurrent( rate ) ) )
+      return pTrack;
+
+   // The rendering may be shared with a mixer still playing on another
+   // thread, so it is never modified; Mixer takes gain and pan from pTrack
+   return pFreeze->mpRendered;
+}
+
+TrackFreeze::TrackFreeze( WaveTrack &track )
+   : mTrack{ track }
+{
+}
+
+TrackFreeze::~TrackFreeze()
+{
+}
+
+void TrackFreeze::SetEnabled( bool enabled )
+{
+   mEnabled = enabled;
+   if ( !enabled ) {
+      mpRendered.reset();
+      mFingerprint = {};
+   }
+}
+
+bool TrackFreeze::IsCurrent( double rate ) const
+{
+   return mEnabled && mpRendered &&
+      mpRendered->GetRate() == rate &&
+      mFingerprint == Compute();
+}
+
+void TrackFreeze::Refresh( double rate )
+{
+   if ( !mEnabled || IsCurrent( rate ) )
+      return;
+
+   // Discard the stale rendering first, so that the mixer below reads the
+   // channel itself
+   mpRendered.reset();
+
+   const auto fingerprint = Compute();
+   const auto t0 = mTrack.GetStartTime();
+   const auto t1 = mTrack.GetEndTime();
+
+   // Render in float, whatever the channel's format, so the gain applied
+   // later does not compound any rounding
+   auto pRendered = mTrack.EmptyCopy();
+   pRendered->ConvertToSampleFormat( floatSample );
+   pRendered->SetRate( rate );
+   pRendered->SetOffset( t0 );
+
+   if ( t1 > t0 ) {
+      auto maxBlockLen = pRendered->GetIdealBlockSize();
+      Mixer mixer{ { mTrack.SharedPointer< const WaveTrack >() },
+         // Throw to abort freezing if read fails:
+         true,
+         Mixer::WarpOptions{ nullptr },
+         t0, t1, 1, maxBlockLen, false,
+         rate, floatSample };
+      mixer.ApplyTrackGains( false );
+
+      ProgressDialog progress( XO("Freeze"),
+         XO("Rendering frozen track %s").Format( mTrack.GetName() ) );
+
+      while ( auto blockLen = mixer.Process( maxBlockLen ) ) {
+         pRendered->Append( mixer.GetBuffer(), floatSample, blockLen );
+         if ( progress.Update( mixer.MixGetCurrentTime() - t0, t1 - t0 )
+             != ProgressResult::Success )
+            throw UserException{};
+      }
+   }
+   pRendered->Flush();
+
+   mpRendered = std::move( pRendered );
+   mFingerprint = fingerprint;
+}
+
+auto TrackFreeze::Compute() const -> Fingerprint
+{
+   Fingerprint result;
+   auto &integers = result.integers;
+   auto &reals = result.reals;
+
+   reals.push_back( mTrack.GetRate() );
+   for ( const auto pClip : mTrack.SortedClipArray() ) {
+      reals.push_back( pClip->GetOffset() );
+      integers.push_back( pClip->GetRate() );
+
+      // Sample blocks are never modified, only replaced, so their ids and
+      // positions stand for the samples
+      for ( const auto &piece : mTrack.GetBlockPieces(
+            pClip->GetStartSample(), pClip->GetEndSample() ) ) {
+         integers.push_back( piece.pBlock->GetBlockID() );
+         integers.push_back( piece.start.as_long_long() );
+         integers.push_back( piece.len );
+      }
+
+      const auto &envelope = *pClip->GetEnvelope();
+      integers.push_back( envelope.GetExponential() );
+      reals.push_back( envelope.GetOffset() );
+      reals.push_back( envelope.GetTrackLen() );
+      const auto nPoints = envelope.GetNumberOfPoints();
+      for ( size_t ii = 0; ii < nPoints; ++ii ) {
+         reals.push_back( envelope[ ii ].GetT() );
+         reals.push_back( envelope[ ii ].GetVal() );
+      }
+   }
+   return result;
+}
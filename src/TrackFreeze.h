@@ -0,0 +1,85 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  TrackFreeze.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_TRACK_FREEZE__
+#define __AUDACITY_TRACK_FREEZE__
+
+#include "ClientData.h"
+
+#include <memory>
+#include <vector>
+
+class TrackList;
+class WaveTrack;
+
+///\brief A "frozen" rendering of one WaveTrack channel
+/**
+ While freezing is enabled for a channel, its samples are kept rendered,
+ with the clip envelopes applied and converted to the project rate, in
+ sample blocks of a hidden track.  Mixer reads those instead of repeating the
+ work, when they are current and no time warping is requested.
+
+ The rendering is compared with the channel's clips, sample blocks and
+ envelopes on each use, so edits invalidate it automatically.  It is made
+ again lazily, by Refresh(), before the next playback or export.
+
+ Gain, pan, mute and solo are not frozen and may still be changed freely;
+ Mixer applies them from the original track.
+
+ Freezing is a playback cache for the current session, not part of the
+ project:  it is not saved, and, because track attachments are not copied,
+ it is not kept in undo states.  So undo and redo, and other commands that
+ replace tracks with copies, leave the replacing tracks unfrozen.
+ */
+class AUDACITY_DLL_API TrackFreeze final : public ClientData::Base
+{
+public:
+   static TrackFreeze &Get( WaveTrack &track );
+   static const TrackFreeze *Find( const WaveTrack &track );
+
+   //! Render, if needed, every frozen channel in tracks
+   /*! May throw, and may show progress */
+   static void RefreshAll( TrackList &tracks, double rate );
+
+   //! Return the rendering of track if it is current for rate, else track
+   /*! The rendering is never modified after it is made, so it may be read
+    from other threads; it has the channel's samples only, and the caller
+    applies the gain, pan and channel of pTrack */
+   static std::shared_ptr<const WaveTrack> Substitute(
+      const std::shared_ptr<const WaveTrack> &pTrack, double rate );
+
+   explicit TrackFreeze( WaveTrack &track );
+   ~TrackFreeze() override;
+
+   bool IsEnabled() const { return mEnabled; }
+   //! Enabling does not render until Refresh(); disabling discards the rendering
+   void SetEnabled( bool enabled );
+
+   bool IsCurrent( double rate ) const;
+
+   //! Render again if enabled and not current for rate
+   /*! May throw, and may show progress */
+   void Refresh( double rate );
+
+private:
+   // Everything about the channel that determines its rendering
+   struct Fingerprint {
+      std::vector<long long> integers;
+      std::vector<double> reals;
+      bool operator == ( const Fingerprint &other ) const
+      { return integers == other.integers && reals == other.reals; }
+   };
+   Fingerprint Compute() const;
+
+   WaveTrack &mTrack;
+   bool mEnabled{ false };
+   std::shared_ptr<WaveTrack> mpRendered;
+   Fingerprint mFingerprint;
+};
+
+#endif
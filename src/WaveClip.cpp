@@ -24,26 +24,34 @@
 #include "Experimental.h"
 
 #include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <condition_variable>
 #include <functional>
+#include <future>
+#include <mutex>
+#include <utility>
 #include <vector>
+#include <wx/app.h>
 #include <wx/log.h>
 
 #include "Sequence.h"
+#include "SampleBlock.h"
 #include "Spectrum.h"
 #include "Prefs.h"
 #include "Envelope.h"
 #include "Resample.h"
 #include "WaveTrack.h"
+#include "SpectrogramTileCache.h"
+#include "STFT.h"
 #include "Profiler.h"
 #include "InconsistencyException.h"
 #include "UserException.h"
+#include "WorkerPool.h"
 
 #include "prefs/SpectrogramSettings.h"
 #include "widgets/ProgressDialog.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
 
 class WaveCache {
 public:
@@ -90,6 +98,101 @@ public:
    std::vector<int> bl;
 };
 
+// Columns of a WaveCache, computed on a worker thread from a copy of the
+// block array.  The copy is made and released on the main thread, because
+// releasing the last reference to a sample block deletes it from the database.
+struct WaveCacheFill {
+   std::mutex mutex;
+   std::condition_variable finished;
+   bool running{ false };
+   bool cancelled{ false };
+   bool done{ false };
+
+   BlockArray blocks;
+   sampleCount numSamples;
+   size_t maxSamples;
+   int dirty;
+   double pps;
+   std::vector<sampleCount> where;
+
+   std::vector<float> min;
+   std::vector<float> max;
+   std::vector<float> rms;
+   std::vector<int> bl;
+   bool success{ false };
+};
+
+namespace {
+
+// Rough values for columns, from the summaries of whole blocks, which are
+// in memory; bl is -1 to say that better values are yet to come
+void FillRoughly(const BlockArray &blocks,
+   float *min, float *max, float *rms, int *bl,
+   size_t len, const sampleCount *where)
+{
+   auto iter = std::upper_bound(blocks.begin(), blocks.end(), where[0],
+      [](sampleCount pos, const SeqBlock &block){ return pos < block.start; });
+   if (iter != blocks.begin())
+      --iter;
+   for (size_t ii = 0; ii < len; ++ii) {
+      float theMin = FLT_MAX, theMax = -FLT_MAX, theRms = 0;
+      while (iter != blocks.end() &&
+         iter->start + iter->sb->GetSampleCount() <= where[ii])
+         ++iter;
+      const auto end = std::max(where[ii + 1], where[ii] + 1);
+      for (auto iter2 = iter;
+           iter2 != blocks.end() && iter2->start < end; ++iter2) {
+         const auto results = iter2->sb->GetMinMaxRMS(false);
+         theMin = std::min(theMin, results.min);
+         theMax = std::max(theMax, results.max);
+         theRms = std::max(theRms, results.RMS);
+      }
+      if (theMin > theMax)
+         theMin = theMax = 0;
+      min[ii] = theMin;
+      max[ii] = theMax;
+      rms[ii] = theRms;
+      bl[ii] = -1;
+   }
+}
+
+void RunWaveCacheFill(const std::shared_ptr<WaveCacheFill> &pFill,
+   const std::function<void()> &onReady)
+{
+   auto &fill = *pFill;
+   {
+      std::lock_guard<std::mutex> guard(fill.mutex);
+      if (fill.cancelled)
+         return;
+      fill.running = true;
+   }
+
+   bool success = false;
+   try {
+      success = Sequence::GetWaveDisplay(fill.blocks,
+         fill.numSamples, fill.maxSamples,
+         fill.min.data(), fill.max.data(), fill.rms.data(), fill.bl.data(),
+         fill.bl.size(), fill.where.data());
+   }
+   catch (...) {
+   }
+
+   bool cancelled;
+   {
+      std::lock_guard<std::mutex> guard(fill.mutex);
+      fill.running = false;
+      fill.done = true;
+      fill.success = success;
+      cancelled = fill.cancelled;
+   }
+   fill.finished.notify_all();
+
+   if (!cancelled && onReady && wxTheApp)
+      wxTheApp->CallAfter(onReady);
+}
+
+}
+
 static void ComputeSpectrumUsingRealFFTf
    (float * __restrict buffer, const FFTParam *hFFT,
     const float * __restrict window, size_t len, float * __restrict out)
@@ -209,6 +312,13 @@ WaveClip::WaveClip(const WaveClip& orig,
 
 WaveClip::~WaveClip()
 {
+   if (mWaveCacheFill) {
+      auto &fill = *mWaveCacheFill;
+      std::unique_lock<std::mutex> lock(fill.mutex);
+      fill.cancelled = true;
+      fill.finished.wait(lock, [&]{ return !fill.running; });
+      fill.blocks.clear();
+   }
 }
 
 void WaveClip::SetOffset(double offset)
@@ -221,7 +331,22 @@ void WaveClip::SetOffset(double offset)
 bool WaveClip::GetSamples(samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len, bool mayThrow) const
 {
-   return mSequence->Get(buffer, format, start, len, mayThrow);
+   const auto result = mSequence->Get(buffer, format, start, len, mayThrow);
+
+   if (mSampleEdits) {
+      // Show the samples being edited instead
+      const auto &edits = *mSampleEdits;
+      const auto s0 = std::max(start, edits.start);
+      const auto s1 = std::min(start + len, edits.start + edits.len);
+      if (s0 < s1)
+         CopySamples(
+            (samplePtr)&edits.samples[(s0 - edits.start).as_size_t()],
+            floatSample,
+            buffer + (s0 - start).as_size_t() * SAMPLE_SIZE(format), format,
+            (s1 - s0).as_size_t());
+   }
+
+   return result;
 }
 
 void WaveClip::SetSamples(samplePtr buffer, sampleFormat format,
@@ -232,7 +357,90 @@ void WaveClip::SetSamples(samplePtr buffer, sampleFormat format,
    mSequence->SetSamples(buffer, format, start, len);
 
    // use NOFAIL-GUARANTEE
-   MarkChanged();
+   MarkChanged(start, len, len);
+}
+
+void WaveClip::BeginSampleEdits(sampleCount start, size_t len)
+{
+   auto end = start + len;
+   if (mSampleEdits) {
+      const auto &edits = *mSampleEdits;
+      if (start >= edits.start && end <= edits.start + edits.len)
+         return;
+      start = std::min(start, edits.start);
+      end = std::max(end, edits.start + edits.len);
+   }
+
+   // Read the samples anew, then keep the changes already made
+   auto pWindow = std::make_unique<SampleEditWindow>();
+   auto &window = *pWindow;
+   window.start = start;
+   window.len = (end - start).as_size_t();
+   window.samples.reinit(window.len);
+   mSequence->Get((samplePtr)window.samples.get(), floatSample,
+      start, window.len, true);
+   if (mSampleEdits) {
+      const auto &edits = *mSampleEdits;
+      std::copy(edits.samples.get(), edits.samples.get() + edits.len,
+         &window.samples[(edits.start - start).as_size_t()]);
+      window.changedStart = edits.changedStart;
+      window.changedEnd = edits.changedEnd;
+   }
+   else
+      window.changedStart = window.changedEnd = start;
+
+   mSampleEdits = std::move(pWindow);
+}
+
+void WaveClip::EditSamples(const float *values, sampleCount start, size_t len)
+{
+   if (len == 0)
+      return;
+   BeginSampleEdits(start, len);
+
+   auto &edits = *mSampleEdits;
+   std::copy(values, values + len,
+      &edits.samples[(start - edits.start).as_size_t()]);
+   if (edits.changedStart == edits.changedEnd) {
+      edits.changedStart = start;
+      edits.changedEnd = start + len;
+   }
+   else {
+      edits.changedStart = std::min(edits.changedStart, start);
+      edits.changedEnd = std::max(edits.changedEnd, start + len);
+   }
+
+   // Let display caches update, reading through GetSamples()
+   MarkChanged(start, len, len);
+}
+
+void WaveClip::CommitSampleEdits()
+// STRONG-GUARANTEE
+{
+   if (!mSampleEdits)
+      return;
+
+   const auto &edits = *mSampleEdits;
+   if (edits.changedStart < edits.changedEnd)
+      SetSamples(
+         (samplePtr)&edits.samples[(edits.changedStart - edits.start).as_size_t()],
+         floatSample, edits.changedStart,
+         (edits.changedEnd - edits.changedStart).as_size_t());
+   mSampleEdits.reset();
+}
+
+void WaveClip::DiscardSampleEdits()
+// NOFAIL-GUARANTEE
+{
+   if (!mSampleEdits)
+      return;
+
+   // Display caches showed the edits; show the samples of the sequence again
+   const auto &edits = *mSampleEdits;
+   const auto changed = edits.changedEnd - edits.changedStart;
+   if (changed > 0)
+      MarkChanged(edits.changedStart, changed, changed);
+   mSampleEdits.reset();
 }
 
 BlockArray* WaveClip::GetSequenceBlockArray()
@@ -382,6 +590,23 @@ fillWhere(std::vector<sampleCount> &where, size_t len, double bias, double corre
 
 bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
                                double pixelsPerSecond) const
+{
+   return DoGetWaveDisplay(display, t0, pixelsPerSecond, nullptr, {});
+}
+
+bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
+                               double pixelsPerSecond,
+                               bool &isLoading,
+                               std::function<void()> onReady) const
+{
+   isLoading = false;
+   return DoGetWaveDisplay(display, t0, pixelsPerSecond, &isLoading, onReady);
+}
+
+bool WaveClip::DoGetWaveDisplay(WaveDisplay &display, double t0,
+                                 double pixelsPerSecond,
+                                 bool *pIsLoading,
+                                 const std::function<void()> &onReady) const
 {
    const bool allocated = (display.where != 0);
 
@@ -405,6 +630,9 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
       pWhere = &display.ownWhere;
    }
    else {
+      CollectWaveCacheFill();
+      UpdateWaveCache();
+
       const double tstep = 1.0 / pixelsPerSecond;
       const double samplesPerPixel = mRate * tstep;
 
@@ -425,6 +653,8 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
          mWaveCache->len >= numPixels) {
 
          // Satisfy the request completely from the cache
+         if (!ResolveWaveCache(pIsLoading, onReady))
+            return false;
          display.min = &mWaveCache->min[0];
          display.max = &mWaveCache->max[0];
          display.rms = &mWaveCache->rms[0];
@@ -489,78 +719,15 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
       std::vector<sampleCount> &where = *pWhere;
 
       /* handle values in the append buffer */
-
-      auto numSamples = mSequence->GetNumSamples();
-      auto a = p0;
-
-      // Not all of the required columns might be in the sequence.
-      // Some might be in the append buffer.
-      for (; a < p1; ++a) {
-         if (where[a + 1] > numSamples)
-            break;
-      }
-
-      // Handle the columns that land in the append buffer.
-      //compute the values that are outside the overlap from scratch.
-      if (a < p1) {
-         sampleFormat seqFormat = mSequence->GetSampleFormat();
-         bool didUpdate = false;
-         for(auto i = a; i < p1; i++) {
-            auto left = std::max(sampleCount{ 0 },
-                                 where[i] - numSamples);
-            auto right = std::min(sampleCount{ mAppendBufferLen },
-                                  where[i + 1] - numSamples);
-
-            //wxCriticalSectionLocker locker(mAppendCriticalSection);
-
-            if (right > left) {
-               Floats b;
-               float *pb{};
-               // left is nonnegative and at most mAppendBufferLen:
-               auto sLeft = left.as_size_t();
-               // The difference is at most mAppendBufferLen:
-               size_t len = ( right - left ).as_size_t();
-
-               if (seqFormat == floatSample)
-                  pb = &((float *)mAppendBuffer.ptr())[sLeft];
-               else {
-                  b.reinit(len);
-                  pb = b.get();
-                  CopySamples(mAppendBuffer.ptr() + sLeft * SAMPLE_SIZE(seqFormat),
-                              seqFormat,
-                              (samplePtr)pb, floatSample, len);
-               }
-
-               float theMax, theMin, sumsq;
-               {
-                  const float val = pb[0];
-                  theMax = theMin = val;
-                  sumsq = val * val;
-               }
-               for(decltype(len) j = 1; j < len; j++) {
-                  const float val = pb[j];
-                  theMax = std::max(theMax, val);
-                  theMin = std::min(theMin, val);
-                  sumsq += val * val;
-               }
-
-               min[i] = theMin;
-               max[i] = theMax;
-               rms[i] = (float)sqrt(sumsq / len);
-               bl[i] = 1; //for now just fake it.
-
-               didUpdate=true;
-            }
-         }
-
-         // Shrink the right end of the range to fetch from Sequence
-         if(didUpdate)
-            p1 = a;
-      }
+      p1 = FillFromAppendBuffer(min, max, rms, bl, where.data(), p0, p1);
 
       // Done with append buffer, now fetch the rest of the cache miss
       // from the sequence
-      if (p1 > p0) {
+      if (p1 > p0 && pIsLoading && !allocated)
+         // Leave the reading to ResolveWaveCache
+         FillRoughly(mSequence->GetBlockArray(),
+            &min[p0], &max[p0], &rms[p0], &bl[p0], p1 - p0, &where[p0]);
+      else if (p1 > p0) {
          if (!mSequence->GetWaveDisplay(&min[p0],
                                         &max[p0],
                                         &rms[p0],
@@ -571,9 +738,15 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
             return false;
          }
       }
+
+      FillFromSampleEdits(min, max, rms, bl, where.data(), p0, p1);
    }
 
    if (!allocated) {
+      // Columns copied from the old cache may still have rough values
+      if (!ResolveWaveCache(pIsLoading, onReady))
+         return false;
+
       // Now report the results
       display.min = min;
       display.max = max;
@@ -585,6 +758,347 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
    return true;
 }
 
+namespace {
+// How many edits are remembered for updating display caches
+const size_t MaxEdits = 64;
+}
+
+void WaveClip::MarkChanged(sampleCount start, sampleCount removed,
+                           sampleCount inserted)
+// NOFAIL-GUARANTEE
+{
+   ++mDirty;
+   try {
+      if (mEdits.size() >= MaxEdits)
+         mEdits.erase(mEdits.begin());
+      mEdits.push_back({ mDirty, start, removed, inserted });
+   }
+   catch (...) {
+      // Caches will just be computed again
+      mEdits.clear();
+   }
+}
+
+bool WaveClip::FollowEdits(int dirty, double samplesPerPixel,
+                           sampleCount lead, sampleCount trail,
+                           std::vector<sampleCount> &where, size_t len,
+                           std::vector<int> &sources) const
+{
+   auto iter = std::find_if(mEdits.begin(), mEdits.end(),
+      [=](const SampleEdit &edit){ return edit.dirty == dirty + 1; });
+   if (iter == mEdits.end() || mEdits.back().dirty != mDirty)
+      return false;
+
+   auto newWhere = where;
+   std::vector<int> newSources(len);
+   for (size_t ii = 0; ii < len; ++ii)
+      newSources[ii] = ii;
+   std::vector<char> moved(len);
+
+   for (; iter != mEdits.end(); ++iter) {
+      const auto &edit = *iter;
+      const auto oldEnd = edit.start + edit.removed;
+      const auto delta = edit.inserted - edit.removed;
+      // Move columns by a whole number of them; where is adjusted by
+      // less than a column, as when scrolling
+      const auto shift =
+         (long long)floor(delta.as_double() / samplesPerPixel + 0.5);
+
+      const auto oldWhere = newWhere;
+      const auto oldSources = newSources;
+      for (size_t ii = 0; ii < len; ++ii) {
+         newSources[ii] = -1;
+         moved[ii] = false;
+         if (oldWhere[ii + 1] + trail <= edit.start) {
+            // Before the edit
+            newSources[ii] = oldSources[ii];
+            continue;
+         }
+         const auto jj = (long long)ii - shift;
+         if (jj >= 0 && jj < (long long)len &&
+             oldWhere[jj] - lead >= oldEnd) {
+            // After the edit
+            newSources[ii] = oldSources[jj];
+            newWhere[ii] = oldWhere[jj] + delta;
+            newWhere[ii + 1] = oldWhere[jj + 1] + delta;
+            moved[ii] = true;
+         }
+      }
+
+      // A column before the edit that now abuts one after it may have a
+      // different end
+      for (size_t ii = 0; ii < len; ++ii)
+         if (newSources[ii] >= 0 && !moved[ii] &&
+             newWhere[ii + 1] != oldWhere[ii + 1])
+            newSources[ii] = -1;
+
+      // Keep where nondecreasing
+      for (size_t ii = 1; ii <= len; ++ii)
+         if (newWhere[ii] < newWhere[ii - 1]) {
+            newWhere[ii] = newWhere[ii - 1];
+            newSources[ii - 1] = -1;
+            if (ii < len)
+               newSources[ii] = -1;
+         }
+   }
+
+   where.swap(newWhere);
+   sources.swap(newSources);
+   return true;
+}
+
+void WaveClip::UpdateWaveCache() const
+{
+   if (!(mWaveCache && mWaveCache->len > 0 && mWaveCache->dirty != mDirty &&
+         mWaveCache->rate == mRate))
+      return;
+   auto &cache = *mWaveCache;
+
+   const auto len = cache.len;
+   std::vector<int> sources;
+   if (!FollowEdits(cache.dirty, mRate / cache.pps, 0, 0,
+         cache.where, len, sources))
+      return;
+
+   auto min = cache.min, max = cache.max, rms = cache.rms;
+   auto bl = cache.bl;
+   for (size_t ii = 0; ii < len; ++ii) {
+      const auto jj = sources[ii];
+      if (jj >= 0) {
+         cache.min[ii] = min[jj];
+         cache.max[ii] = max[jj];
+         cache.rms[ii] = rms[jj];
+         cache.bl[ii] = bl[jj];
+      }
+      else {
+         // Give rough values for now; ResolveWaveCache does the rest
+         FillRoughly(mSequence->GetBlockArray(),
+            &cache.min[ii], &cache.max[ii], &cache.rms[ii], &cache.bl[ii],
+            1, &cache.where[ii]);
+         FillFromSampleEdits(&cache.min[0], &cache.max[0], &cache.rms[0],
+            &cache.bl[0], &cache.where[0], ii, ii + 1);
+      }
+   }
+   cache.dirty = mDirty;
+}
+
+size_t WaveClip::FillFromAppendBuffer(
+   float *min, float *max, float *rms, int *bl,
+   const sampleCount *where, size_t p0, size_t p1) const
+{
+   auto numSamples = mSequence->GetNumSamples();
+   auto a = p0;
+
+   // Not all of the required columns might be in the sequence.
+   // Some might be in the append buffer.
+   for (; a < p1; ++a) {
+      if (where[a + 1] > numSamples)
+         break;
+   }
+
+   // Handle the columns that land in the append buffer.
+   //compute the values that are outside the overlap from scratch.
+   if (a < p1) {
+      sampleFormat seqFormat = mSequence->GetSampleFormat();
+      bool didUpdate = false;
+      for(auto i = a; i < p1; i++) {
+         auto left = std::max(sampleCount{ 0 },
+                              where[i] - numSamples);
+         auto right = std::min(sampleCount{ mAppendBufferLen },
+                               where[i + 1] - numSamples);
+
+         //wxCriticalSectionLocker locker(mAppendCriticalSection);
+
+         if (right > left) {
+            Floats b;
+            float *pb{};
+            // left is nonnegative and at most mAppendBufferLen:
+            auto sLeft = left.as_size_t();
+            // The difference is at most mAppendBufferLen:
+            size_t len = ( right - left ).as_size_t();
+
+            if (seqFormat == floatSample)
+               pb = &((float *)mAppendBuffer.ptr())[sLeft];
+            else {
+               b.reinit(len);
+               pb = b.get();
+               CopySamples(mAppendBuffer.ptr() + sLeft * SAMPLE_SIZE(seqFormat),
+                           seqFormat,
+                           (samplePtr)pb, floatSample, len);
+            }
+
+            float theMax, theMin, sumsq;
+            {
+               const float val = pb[0];
+               theMax = theMin = val;
+               sumsq = val * val;
+            }
+            for(decltype(len) j = 1; j < len; j++) {
+               const float val = pb[j];
+               theMax = std::max(theMax, val);
+               theMin = std::min(theMin, val);
+               sumsq += val * val;
+            }
+
+            min[i] = theMin;
+            max[i] = theMax;
+            rms[i] = (float)sqrt(sumsq / len);
+            bl[i] = 1; //for now just fake it.
+
+            didUpdate=true;
+         }
+      }
+
+      // Shrink the right end of the range to fetch from Sequence
+      if(didUpdate)
+         return a;
+   }
+
+   return p1;
+}
+
+void WaveClip::FillFromSampleEdits(
+   float *min, float *max, float *rms, int *bl,
+   const sampleCount *where, size_t p0, size_t p1) const
+{
+   if (!mSampleEdits)
+      return;
+   const auto &edits = *mSampleEdits;
+   const auto numSamples = mSequence->GetNumSamples();
+   if (edits.changedStart >= edits.changedEnd || numSamples == 0)
+      return;
+
+   Floats buffer;
+   size_t bufferLen = 0;
+   for (auto ii = p0; ii < p1; ++ii) {
+      // Every column shows at least one sample, as in
+      // Sequence::GetWaveDisplay()
+      const auto s0 = std::max(sampleCount{ 0 },
+         std::min(numSamples - 1, where[ii]));
+      const auto s1 = std::max(s0 + 1, std::min(numSamples, where[ii + 1]));
+      if (s1 <= edits.changedStart || s0 >= edits.changedEnd)
+         continue;
+
+      // GetSamples() lays the edits over the samples of the sequence
+      const auto len = (s1 - s0).as_size_t();
+      if (len > bufferLen) {
+         buffer.reinit(len);
+         bufferLen = len;
+      }
+      GetSamples((samplePtr)buffer.get(), floatSample, s0, len, false);
+
+      float theMin = buffer[0], theMax = buffer[0];
+      double sumsq = 0;
+      for (size_t jj = 0; jj < len; ++jj) {
+         const float val = buffer[jj];
+         theMin = std::min(theMin, val);
+         theMax = std::max(theMax, val);
+         sumsq += val * val;
+      }
+      min[ii] = theMin;
+      max[ii] = theMax;
+      rms[ii] = (float)sqrt(sumsq / len);
+      // Not rough; only the sign matters
+      bl[ii] = 0;
+   }
+}
+
+void WaveClip::CollectWaveCacheFill() const
+{
+   if (!mWaveCacheFill)
+      return;
+   auto &fill = *mWaveCacheFill;
+   {
+      std::lock_guard<std::mutex> guard(fill.mutex);
+      if (!fill.done)
+         return;
+      fill.blocks.clear();
+   }
+   auto pFill = std::move(mWaveCacheFill);
+
+   // Results are for columns of the cache as it was; keep those that still
+   // describe the same samples, in case of scrolling or edits meanwhile
+   if (!mWaveCache)
+      return;
+   auto &cache = *mWaveCache;
+   if (!(fill.success && cache.len > 0 &&
+         cache.dirty == fill.dirty && cache.pps == fill.pps))
+      return;
+   const auto &where = cache.where;
+   const auto len = fill.bl.size();
+   size_t ii = std::lower_bound(where.begin(), where.begin() + cache.len,
+      fill.where[0]) - where.begin();
+   for (size_t jj = 0; jj < len && ii < cache.len; ++ii, ++jj) {
+      if (where[ii] != fill.where[jj] || where[ii + 1] != fill.where[jj + 1])
+         break;
+      if (cache.bl[ii] < 0) {
+         cache.min[ii] = fill.min[jj];
+         cache.max[ii] = fill.max[jj];
+         cache.rms[ii] = fill.rms[jj];
+         cache.bl[ii] = fill.bl[jj];
+      }
+   }
+}
+
+bool WaveClip::ResolveWaveCache(bool *pIsLoading,
+                                const std::function<void()> &onReady) const
+{
+   auto &cache = *mWaveCache;
+   auto &bl = cache.bl;
+   size_t p0 = 0, p1 = bl.size();
+   while (p0 < p1 && bl[p0] >= 0)
+      ++p0;
+   if (p0 == p1)
+      return true;
+   while (bl[p1 - 1] >= 0)
+      --p1;
+
+   if (mAppendBufferLen > 0) {
+      const auto end = FillFromAppendBuffer(&cache.min[0], &cache.max[0],
+         &cache.rms[0], &bl[0], &cache.where[0], p0, p1);
+      // Columns past all of the samples have nothing to show
+      for (auto ii = end; ii < p1; ++ii)
+         if (bl[ii] < 0) {
+            cache.min[ii] = cache.max[ii] = cache.rms[ii] = 0;
+            bl[ii] = 0;
+         }
+      p1 = end;
+      while (p1 > p0 && bl[p1 - 1] >= 0)
+         --p1;
+      if (p0 == p1)
+         return true;
+   }
+
+   if (!pIsLoading)
+      return mSequence->GetWaveDisplay(&cache.min[p0], &cache.max[p0],
+         &cache.rms[p0], &cache.bl[p0], p1 - p0, &cache.where[p0]);
+
+   *pIsLoading = true;
+   if (mWaveCacheFill)
+      // Another fill is under way; it will call back, and this will be
+      // tried again
+      return true;
+
+   auto pFill = std::make_shared<WaveCacheFill>();
+   auto &fill = *pFill;
+   fill.blocks = mSequence->GetBlockArray();
+   fill.numSamples = mSequence->GetNumSamples();
+   fill.maxSamples = mSequence->GetMaxBlockSize();
+   fill.dirty = cache.dirty;
+   fill.pps = cache.pps;
+   fill.where.assign(cache.where.begin() + p0, cache.where.begin() + p1 + 1);
+   fill.min.resize(p1 - p0);
+   fill.max.resize(p1 - p0);
+   fill.rms.resize(p1 - p0);
+   fill.bl.resize(p1 - p0);
+   mWaveCacheFill = pFill;
+
+   WorkerPool::Get().Schedule([pFill, onReady]{
+      RunWaveCacheFill(pFill, onReady);
+   });
+   return true;
+}
+
 namespace {
 
 void ComputeSpectrogramGainFactors
@@ -669,8 +1183,16 @@ bool SpecCache::CalculateOneSpectrum
    auto nBins = settings.NBins();
 
    if (from < 0 || from >= numSamples) {
-      if (xx >= 0 && xx < (int)len) {
-         // Pixel column is out of bounds of the clip!  Should not happen.
+      // Pixel column is out of bounds of the clip!  Should not happen.
+      // When reassigning, out holds only the columns from lowerBoundX up
+      // to upperBoundX, as for the corrected columns below
+      if (reassignment) {
+         if (xx >= lowerBoundX && xx < upperBoundX) {
+            float *const results = &out[nBins * (xx - lowerBoundX)];
+            std::fill(results, results + nBins, 0.0f);
+         }
+      }
+      else if (xx >= 0 && xx < (int)len) {
          float *const results = &out[nBins * xx];
          std::fill(results, results + nBins, 0.0f);
       }
@@ -818,13 +1340,7 @@ bool SpecCache::CalculateOneSpectrum
                   result = true;
 
                   // This is non-negative, because bin and correctedX are
-                  auto ind = (int)nBins * correctedX + bin;
-#ifdef _OPENMP
-                  // This assignment can race if index reaches into another thread's bins.
-                  // The probability of a race very low, so this carries little overhead,
-                  // about 5% slower vs allowing it to race.
-                  #pragma omp atomic update
-#endif
+                  auto ind = (int)nBins * (correctedX - lowerBoundX) + bin;
                   out[ind] += power;
                }
             }
@@ -877,9 +1393,58 @@ void SpecCache::Grow(size_t len_, const SpectrogramSettings& settings,
    frequencyGain = settings.frequencyGain;
 }
 
+namespace {
+// Fewer columns are not worth another job
+const size_t MinColumnsPerJob = 8;
+// Bound on the memory used for separate sums of reassigned power
+const size_t MaxReassignmentFloats = 16 * 1024 * 1024;
+// Columns whose samples are gathered for one call to STFT::Process
+const size_t BatchColumns = 16;
+
+// Fill dest with windowSize samples of the clip centered at from, which
+// is within the clip, padding with zeroes beyond its ends
+void GetWindowSamples(WaveTrackCache &waveTrackCache,
+   sampleCount from, sampleCount numSamples, double offset, double rate,
+   size_t windowSize, float *dest)
+{
+   auto myLen = windowSize;
+   from -= windowSize >> 1;
+   if (from < 0) {
+      // from is at least -windowSize / 2
+      const auto nZeroes = size_t(-from.as_long_long());
+      std::fill(dest, dest + nZeroes, 0.0f);
+      dest += nZeroes;
+      myLen -= nZeroes;
+      from = 0;
+   }
+
+   if (from + myLen >= numSamples) {
+      // newlen is bounded by myLen:
+      auto newlen = ( numSamples - from ).as_size_t();
+      std::fill(dest + newlen, dest + myLen, 0.0f);
+      myLen = newlen;
+   }
+
+   if (myLen > 0) {
+      auto buffer = (const float*)(waveTrackCache.Get(
+         floatSample, sampleCount(
+            floor(0.5 + from.as_double() + offset * rate)
+         ),
+         myLen,
+         // Don't throw in this drawing operation
+         false)
+      );
+      if (buffer)
+         memcpy(dest, buffer, myLen * sizeof(float));
+      else
+         memset(dest, 0, myLen * sizeof(float));
+   }
+}
+}
+
 void SpecCache::Populate
    (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
-    int copyBegin, int copyEnd, size_t numPixels,
+    const Ranges &ranges,
     sampleCount numSamples,
     double offset, double rate, double pixelsPerSecond)
 {
@@ -908,49 +1473,109 @@ void SpecCache::Populate
    if (!autocorrelation)
       ComputeSpectrogramGainFactors(fftLen, rate, frequencyGainSetting, gainFactors);
 
-   // Loop over the ranges before and after the copied portion and compute anew.
-   // One of the ranges may be empty.
-   for (int jj = 0; jj < 2; ++jj) {
-      const int lowerBoundX = jj == 0 ? 0 : copyEnd;
-      const int upperBoundX = jj == 0 ? copyBegin : numPixels;
-
-#ifdef _OPENMP
-      // Storage for mutable per-thread data.
-      // private clause ensures one copy per thread
-      struct ThreadLocalStorage {
-         ThreadLocalStorage()  { }
-         ~ThreadLocalStorage() { }
-
-         void init(WaveTrackCache &waveTrackCache, size_t scratchSize) {
-            if (!cache) {
-               cache = std::make_unique<WaveTrackCache>(waveTrackCache.GetTrack());
-               scratch.resize(scratchSize);
+   // The plain spectrogram transforms the columns in batches
+   std::unique_ptr<STFT> pSTFT;
+   if (!autocorrelation && !reassignment)
+      pSTFT = std::make_unique<STFT>(fftLen,
+         settings.window.get() + (fftLen - windowSizeSetting) / 2,
+         windowSizeSetting);
+
+   auto &pool = WorkerPool::Get();
+
+   // Loop over the ranges not copied and compute anew.
+   // Some of the ranges may be empty.
+   for (const auto &range : ranges) {
+      const int lowerBoundX = range.first;
+      const int upperBoundX = range.second;
+      if (upperBoundX <= lowerBoundX)
+         continue;
+      const size_t nColumns = upperBoundX - lowerBoundX;
+      const size_t columnFloats = nColumns * nBins;
+
+      // Divide the columns among jobs, each with its own cache of samples
+      // and scratch space.  Reassignment adds the power of a column into
+      // others, so then each job sums into its own buffer, which costs
+      // memory, and the buffers are added together after.
+      size_t nJobs = std::min<size_t>(
+         reassignment ? pool.Concurrency() : 4 * pool.Concurrency(),
+         nColumns / MinColumnsPerJob);
+      if (reassignment)
+         nJobs = std::min(nJobs, MaxReassignmentFloats / columnFloats);
+      nJobs = std::max<size_t>(1, nJobs);
+
+      std::vector< std::vector<float> > partials(reassignment ? nJobs : 0);
+      pool.ParallelFor(nJobs, [&](size_t iJob) {
+         const int x0 = lowerBoundX + nColumns * iJob / nJobs;
+         const int x1 = lowerBoundX + nColumns * (iJob + 1) / nJobs;
+
+         std::unique_ptr<WaveTrackCache> pCache;
+         if (nJobs > 1)
+            pCache =
+               std::make_unique<WaveTrackCache>(waveTrackCache.GetTrack());
+         auto &cache = pCache ? *pCache : waveTrackCache;
+         float *out = &freq[0];
+         if (reassignment) {
+            partials[iJob].resize(columnFloats);
+            out = partials[iJob].data();
+         }
+
+         if (pSTFT) {
+            std::vector<float> frames(BatchColumns * windowSizeSetting);
+            bool inClip[BatchColumns];
+            for (auto xx = x0; xx < x1; xx += BatchColumns) {
+               const size_t nFrames = std::min<size_t>(BatchColumns, x1 - xx);
+               for (size_t ii = 0; ii < nFrames; ++ii) {
+                  const auto from = where[xx + ii];
+                  float *const frame = &frames[ii * windowSizeSetting];
+                  inClip[ii] = (from >= 0 && from < numSamples);
+                  if (inClip[ii])
+                     GetWindowSamples(cache, from, numSamples, offset, rate,
+                        windowSizeSetting, frame);
+                  else
+                     std::fill(frame, frame + windowSizeSetting, 0.0f);
+               }
+
+               float *const results = &freq[nBins * xx];
+               pSTFT->Process(frames.data(), windowSizeSetting, nFrames,
+                  STFT::Output::PowerDB, results);
+
+               for (size_t ii = 0; ii < nFrames; ++ii) {
+                  float *const column = results + nBins * ii;
+                  if (!inClip[ii])
+                     // Pixel column is out of bounds of the clip!  Should not happen.
+                     std::fill(column, column + nBins, 0.0f);
+                  else if (!gainFactors.empty()) {
+                     // Apply a frequency-dependent gain factor
+                     for (size_t jj = 0; jj < nBins; ++jj)
+                        column[jj] += gainFactors[jj];
+                  }
+               }
             }
+            return;
          }
-         std::unique_ptr<WaveTrackCache> cache;
-         std::vector<float> scratch;
-      } tls;
 
-      #pragma omp parallel for private(tls)
-#endif
-      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
-      {
-#ifdef _OPENMP
-         tls.init(waveTrackCache, scratchSize);
-         WaveTrackCache& cache = *tls.cache;
-         float* buffer = &tls.scratch[0];
-#else
-         WaveTrackCache& cache = waveTrackCache;
-         float* buffer = &scratch[0];
-#endif
-         CalculateOneSpectrum(
-            settings, cache, xx, numSamples,
-            offset, rate, pixelsPerSecond,
-            lowerBoundX, upperBoundX,
-            gainFactors, buffer, &freq[0]);
-      }
+         std::vector<float> buffer(scratchSize);
+         for (auto xx = x0; xx < x1; ++xx)
+            CalculateOneSpectrum(
+               settings, cache, xx, numSamples,
+               offset, rate, pixelsPerSecond,
+               lowerBoundX, upperBoundX,
+               gainFactors, buffer.data(), out);
+      });
 
       if (reassignment) {
+         float *const out = &freq[nBins * lowerBoundX];
+
+         // Add the buffers, dividing the columns among jobs again
+         pool.ParallelFor(nJobs, [&](size_t iJob) {
+            const auto begin = columnFloats * iJob / nJobs;
+            const auto end = columnFloats * (iJob + 1) / nJobs;
+            for (const auto &partial : partials)
+               for (auto ii = begin; ii < end; ++ii)
+                  out[ii] += partial[ii];
+         });
+         partials.clear();
+
          // Need to look beyond the edges of the range to accumulate more
          // time reassignments.
          // I'm not sure what's a good stopping criterion?
@@ -964,7 +1589,7 @@ void SpecCache::Populate
                   settings, waveTrackCache, --xx, numSamples,
                   offset, rate, pixelsPerSecond,
                   lowerBoundX, upperBoundX,
-                  gainFactors, &scratch[0], &freq[0]);
+                  gainFactors, &scratch[0], out);
             if (!result)
                break;
          }
@@ -977,35 +1602,180 @@ void SpecCache::Populate
                   settings, waveTrackCache, xx++, numSamples,
                   offset, rate, pixelsPerSecond,
                   lowerBoundX, upperBoundX,
-                  gainFactors, &scratch[0], &freq[0]);
+                  gainFactors, &scratch[0], out);
             if (!result)
                break;
          }
 
          // Now Convert to dB terms.  Do this only after accumulating
          // power values, which may cross columns with the time correction.
-#ifdef _OPENMP
-         #pragma omp parallel for
-#endif
-         for (xx = lowerBoundX; xx < upperBoundX; ++xx) {
-            float *const results = &freq[nBins * xx];
-            for (size_t ii = 0; ii < nBins; ++ii) {
-               float &power = results[ii];
-               if (power <= 0)
-                  power = -160.0;
-               else
-                  power = 10.0*log10f(power);
-            }
-            if (!gainFactors.empty()) {
-               // Apply a frequency-dependent gain factor
-               for (size_t ii = 0; ii < nBins; ++ii)
-                  results[ii] += gainFactors[ii];
+         pool.ParallelFor(nJobs, [&](size_t iJob) {
+            const int x0 = lowerBoundX + nColumns * iJob / nJobs;
+            const int x1 = lowerBoundX + nColumns * (iJob + 1) / nJobs;
+            for (auto xx = x0; xx < x1; ++xx) {
+               float *const results = &freq[nBins * xx];
+               for (size_t ii = 0; ii < nBins; ++ii) {
+                  float &power = results[ii];
+                  if (power <= 0)
+                     power = -160.0;
+                  else
+                     power = 10.0*log10f(power);
+               }
+               if (!gainFactors.empty()) {
+                  // Apply a frequency-dependent gain factor
+                  for (size_t ii = 0; ii < nBins; ++ii)
+                     results[ii] += gainFactors[ii];
+               }
             }
-         }
+         });
       }
    }
 }
 
+namespace {
+
+// Columns of spectrograms are saved in tiles of this many, at positions fixed
+// in the clip
+const int TileColumns = 64;
+
+// The sample that the column of the grid numbered column describes, with
+// the same bias as fillWhere for spectrograms
+inline sampleCount GridWhere(long long column, double samplesPerPixel)
+{
+   return sampleCount( floor(1.0 + column * samplesPerPixel) );
+}
+
+inline long long TileOfColumn(long long column)
+{
+   return column >= 0
+      ? column / TileColumns
+      : -((-column + TileColumns - 1) / TileColumns);
+}
+
+// Identify everything that determines the columns of a tile: the settings,
+// the positions, and the sample blocks under the windows.  Return an empty
+// key if the tile should not be saved.  If pBlocks is not null, it receives
+// the ids of the blocks in the project file.
+SpectrogramTileCache::Key SpectrogramTileKey(const Sequence &sequence,
+   bool appending, const SpectrogramSettings &settings,
+   double rate, double offset, double samplesPerPixel, long long tile,
+   SpectrogramTileCache::BlockIDs *pBlocks = nullptr)
+{
+   if (tile < 0)
+      return {};
+
+   const auto windowSize = settings.WindowSize();
+   const auto s0 =
+      GridWhere(tile * TileColumns, samplesPerPixel) - windowSize / 2;
+   const auto s1 =
+      GridWhere((tile + 1) * TileColumns - 1, samplesPerPixel)
+         - windowSize / 2 + windowSize;
+   const auto numSamples = sequence.GetNumSamples();
+   // Samples in the append buffer are not yet in blocks
+   if (appending && s1 > numSamples)
+      return {};
+
+   SpectrogramTileCache::Key key;
+   const auto add = [&](unsigned long long value) {
+      key.push_back(value);
+   };
+   const auto addDouble = [&](double value) {
+      unsigned long long bits;
+      memcpy(&bits, &value, sizeof(bits));
+      add(bits);
+   };
+
+   add(settings.algorithm);
+   add(settings.windowType);
+   add(windowSize);
+   add(settings.ZeroPaddingFactor());
+   add(settings.frequencyGain);
+   add(settings.NBins());
+   add(TileColumns);
+   add(tile);
+   addDouble(rate);
+   addDouble(samplesPerPixel);
+   // Reading from the track rounds the position in the clip
+   addDouble(offset * rate - floor(offset * rate));
+   // Windows past the end are padded
+   if (s1 > numSamples)
+      add(numSamples.as_long_long());
+
+   const auto &blocks = sequence.GetBlockArray();
+   auto iter = std::upper_bound(blocks.begin(), blocks.end(), s0,
+      [](sampleCount pos, const SeqBlock &block){ return pos < block.start; });
+   if (iter != blocks.begin())
+      --iter;
+   for (; iter != blocks.end() && iter->start < s1; ++iter) {
+      if (iter->start + iter->sb->GetSampleCount() <= s0)
+         continue;
+      const auto id = iter->sb->GetBlockID();
+      add(id);
+      add(iter->start.as_long_long());
+      add(iter->sb->GetSampleCount());
+      // Ids of blocks are reused only if the project rolled back their
+      // creation, and then the summary of the new block very likely differs
+      const auto results = iter->sb->GetMinMaxRMS(false);
+      unsigned int bits[3];
+      memcpy(&bits[0], &results.min, sizeof(bits[0]));
+      memcpy(&bits[1], &results.max, sizeof(bits[1]));
+      memcpy(&bits[2], &results.RMS, sizeof(bits[2]));
+      add(((unsigned long long)bits[0] << 32) | bits[1]);
+      add(bits[2]);
+      // Silent blocks have negative ids and are not in the file
+      if (pBlocks && id > 0)
+         pBlocks->push_back(id);
+   }
+
+   return key;
+}
+
+}
+
+bool WaveClip::UpdateSpecCache(WaveTrackCache &waveTrackCache,
+                               const SpectrogramSettings &settings,
+                               double pixelsPerSecond) const
+{
+   // Time reassignment moves energy between columns, so recomputing some of
+   // them is not enough
+   if (!(mSpecCache && mSpecCache->len > 0 &&
+         mSpecCache->dirty != mDirty &&
+         settings.algorithm != SpectrogramSettings::algReassignment &&
+         mSpecCache->Matches(
+            mSpecCache->dirty, pixelsPerSecond, settings, mRate)))
+      return false;
+   auto &cache = *mSpecCache;
+
+   // Each column depends on a window of samples centered at where
+   const auto len = cache.len;
+   const auto windowSize = settings.WindowSize();
+   std::vector<int> sources;
+   if (!FollowEdits(cache.dirty, mRate / cache.pps,
+         windowSize / 2, windowSize - windowSize / 2,
+         cache.where, len, sources))
+      return false;
+
+   const auto nBins = settings.NBins();
+   const auto freq = cache.freq;
+   SpecCache::Ranges ranges;
+   for (size_t ii = 0; ii < len; ++ii) {
+      const auto jj = sources[ii];
+      if (jj >= 0)
+         std::copy(&freq[nBins * jj], &freq[nBins * (jj + 1)],
+            &cache.freq[nBins * ii]);
+      else if (!ranges.empty() && ranges.back().second == (int)ii)
+         ++ranges.back().second;
+      else
+         ranges.push_back({ (int)ii, (int)ii + 1 });
+   }
+
+   settings.CacheWindows();
+   cache.Populate(settings, waveTrackCache, ranges,
+      mSequence->GetNumSamples(), mOffset, mRate, cache.pps);
+   cache.dirty = mDirty;
+   return true;
+}
+
 bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
                               const float *& spectrogram,
                               const sampleCount *& where,
@@ -1015,6 +1785,9 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
    const WaveTrack *const track = waveTrackCache.GetTrack().get();
    const SpectrogramSettings &settings = track->GetSpectrogramSettings();
 
+   const bool updated =
+      UpdateSpecCache(waveTrackCache, settings, pixelsPerSecond);
+
    bool match =
       mSpecCache &&
       mSpecCache->len > 0 &&
@@ -1027,7 +1800,7 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
       spectrogram = &mSpecCache->freq[0];
       where = &mSpecCache->where[0];
 
-      return false;  //hit cache completely
+      return updated;  //hit cache completely
    }
 
    // Caching is not implemented for reassignment, unless for
@@ -1050,6 +1823,15 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
    const double tstep = 1.0 / pixelsPerSecond;
    const double samplesPerPixel = mRate * tstep;
 
+   // Unless reassigning, place the columns on a grid fixed in the clip, so
+   // that they can be saved in tiles and found again
+   SpectrogramTileCache *pTiles = nullptr;
+   if (settings.algorithm != SpectrogramSettings::algReassignment)
+      if (auto pList = track->GetOwner())
+         if (auto pProject = pList->GetOwner())
+            pTiles = &SpectrogramTileCache::Get(*pProject);
+   const auto gridX0 = (long long)floor(0.5 + t0 * mRate / samplesPerPixel);
+
    int oldX0 = 0;
    double correction = 0.0;
 
@@ -1058,6 +1840,8 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
       findCorrection(mSpecCache->where, mSpecCache->len, numPixels,
          t0, mRate, samplesPerPixel,
          oldX0, correction);
+      if (pTiles && mSpecCache->gridded)
+         oldX0 = gridX0 - mSpecCache->gridX0;
       // Remember our first pixel maps to oldX0 in the old cache,
       // possibly out of bounds.
       // For what range of pixels can data be copied?
@@ -1102,14 +1886,71 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
 
    // purposely offset the display 1/2 sample to the left (as compared
    // to waveform display) to properly center response of the FFT
-   fillWhere(mSpecCache->where, numPixels, 0.5, correction,
-      t0, mRate, samplesPerPixel);
+   if (pTiles) {
+      auto &where = mSpecCache->where;
+      for (size_t x = 0; x < numPixels + 1; ++x)
+         where[x] = GridWhere(gridX0 + x, samplesPerPixel);
+      // Be careful to make the first value non-negative
+      where[0] = std::max(sampleCount{ 0 }, where[0]);
+   }
+   else
+      fillWhere(mSpecCache->where, numPixels, 0.5, correction,
+         t0, mRate, samplesPerPixel);
+   mSpecCache->gridded = (pTiles != nullptr);
+   mSpecCache->gridX0 = gridX0;
+
+   SpecCache::Ranges ranges{ { 0, copyBegin }, { copyEnd, (int)numPixels } };
+   const auto tileKey = [&](long long tile,
+      SpectrogramTileCache::BlockIDs *pBlocks = nullptr) {
+      return SpectrogramTileKey(*mSequence, mAppendBufferLen > 0, settings,
+         mRate, mOffset, samplesPerPixel, tile, pBlocks);
+   };
+
+   if (pTiles) {
+      // Load what columns were saved, and compute only the rest
+      SpecCache::Ranges toCompute;
+      std::vector<float> tile(TileColumns * nBins);
+      for (const auto &range : ranges) {
+         for (auto xx = range.first; xx < range.second;) {
+            const auto iTile = TileOfColumn(gridX0 + xx);
+            const auto tileX0 = (int)(iTile * TileColumns - gridX0);
+            const auto tileEnd = std::min(range.second, tileX0 + TileColumns);
+            const auto key = tileKey(iTile);
+            if (pTiles->Load(key, tile.data(), tile.size()))
+               std::copy(&tile[nBins * (xx - tileX0)],
+                  &tile[nBins * (tileEnd - tileX0)],
+                  &mSpecCache->freq[nBins * xx]);
+            else if (!toCompute.empty() && toCompute.back().second == xx)
+               toCompute.back().second = tileEnd;
+            else
+               toCompute.push_back({ xx, tileEnd });
+            xx = tileEnd;
+         }
+      }
+      ranges.swap(toCompute);
+   }
 
    mSpecCache->Populate
-      (settings, waveTrackCache, copyBegin, copyEnd, numPixels,
+      (settings, waveTrackCache, ranges,
        mSequence->GetNumSamples(),
        mOffset, mRate, pixelsPerSecond);
 
+   if (pTiles) {
+      // Save the tiles that were computed whole
+      for (const auto &range : ranges) {
+         auto iTile = TileOfColumn(gridX0 + range.first);
+         if (iTile * TileColumns < gridX0 + range.first)
+            ++iTile;
+         for (; (iTile + 1) * TileColumns <= gridX0 + range.second; ++iTile) {
+            SpectrogramTileCache::BlockIDs blocks;
+            const auto key = tileKey(iTile, &blocks);
+            pTiles->Store(key, blocks,
+               &mSpecCache->freq[nBins * (iTile * TileColumns - gridX0)],
+               TileColumns * nBins);
+         }
+      }
+   }
+
    mSpecCache->dirty = mDirty;
    spectrogram = &mSpecCache->freq[0];
    where = &mSpecCache->where[0];
@@ -1218,10 +2059,16 @@ bool WaveClip::Append(samplePtr buffer, sampleFormat format,
    if (!mAppendBuffer.ptr())
       mAppendBuffer.Allocate(maxBlockSize, seqFormat);
 
+   // Samples before start are not changed, even when they move from the
+   // append buffer into the sequence
+   const auto start = mSequence->GetNumSamples() + mAppendBufferLen;
+   const auto total = len;
    auto cleanup = finally( [&] {
       // use NOFAIL-GUARANTEE
       UpdateEnvelopeTrackLen();
-      MarkChanged();
+      // len counts what remains to copy, also when an exception escapes
+      // after a prefix of the buffer is appended
+      MarkChanged(start, 0, total - len);
    } );
 
    for(;;) {
@@ -1273,6 +2120,7 @@ void WaveClip::Flush()
 
    if (mAppendBufferLen > 0) {
 
+      bool flushed = false;
       auto cleanup = finally( [&] {
          // Blow away the append buffer even in case of failure.  May lose some
          // data but don't leave the track in an un-flushed state.
@@ -1280,11 +2128,16 @@ void WaveClip::Flush()
          // Use NOFAIL-GUARANTEE of these steps.
          mAppendBufferLen = 0;
          UpdateEnvelopeTrackLen();
-         MarkChanged();
+         if (flushed)
+            // The samples are the same, but moved out of the append buffer
+            MarkChanged(mSequence->GetNumSamples(), 0, 0);
+         else
+            MarkChanged();
       } );
 
       mSequence->Append(mAppendBuffer.ptr(), mSequence->GetSampleFormat(),
          mAppendBufferLen);
+      flushed = true;
    }
 
    //wxLogDebug(wxT("now sample count %lli"), (long long) mSequence->GetNumSamples());
@@ -1413,7 +2266,7 @@ void WaveClip::Paste(double t0, const WaveClip* other)
    mSequence->Paste(s0, pastedClip->mSequence.get());
 
    // Assume NOFAIL-GUARANTEE in the remaining
-   MarkChanged();
+   MarkChanged(s0, 0, pastedClip->GetNumSamples());
    auto sampleTime = 1.0 / GetRate();
    mEnvelope->PasteEnvelope
       (s0.as_double()/mRate + mOffset, pastedClip->mEnvelope.get(), sampleTime);
@@ -1453,7 +2306,7 @@ void WaveClip::InsertSilence( double t, double len, double *pEnvelopeValue )
    else
       pEnvelope->InsertSpace( t, len );
 
-   MarkChanged();
+   MarkChanged(s0, 0, slen);
 }
 
 void WaveClip::AppendSilence( double len, double envelopeValue )
@@ -1521,7 +2374,7 @@ void WaveClip::Clear(double t0, double t1)
    if (t0 < GetStartTime())
       Offset(-(GetStartTime() - t0));
 
-   MarkChanged();
+   MarkChanged(s0, s1 - s0, 0);
 }
 
 void WaveClip::ClearAndAddCutLine(double t0, double t1)
@@ -1574,7 +2427,7 @@ void WaveClip::ClearAndAddCutLine(double t0, double t1)
    if (t0 < GetStartTime())
       Offset(-(GetStartTime() - t0));
 
-   MarkChanged();
+   MarkChanged(s0, s1 - s0, 0);
 
    mCutLines.push_back(std::move(newClip));
 }
@@ -1674,85 +2527,238 @@ void WaveClip::SetRate(int rate)
 void WaveClip::Resample(int rate, ProgressDialog *progress)
 // STRONG-GUARANTEE
 {
-   // Note:  it is not necessary to do this recursively to cutlines.
-   // They get resampled as needed when they are expanded.
+   Resample(std::vector<std::vector<WaveClip*>>{ { this } }, rate, progress);
+}
 
-   if (rate == mRate)
-      return; // Nothing to do
+namespace {
+// Samples converted at each step
+constexpr size_t ResampleStepSize = 65536;
+
+// Input and output of one step of a rate conversion
+struct ResampleStep {
+   ResampleStep(size_t nChannels)
+      : in{ nChannels, ResampleStepSize }, out{ nChannels, ResampleStepSize }
+      , inPtrs{ nChannels }, outPtrs{ nChannels }
+   {
+      for (size_t ii = 0; ii < nChannels; ++ii)
+         inPtrs[ii] = in[ii].get(), outPtrs[ii] = out[ii].get();
+   }
 
-   double factor = (double)rate / (double)mRate;
-   ::Resample resample(true, factor, factor); // constant rate resampling
+   FloatBuffers in, out;
+   ArrayOf<const float *> inPtrs;
+   ArrayOf<float *> outPtrs;
+   size_t inLen{ 0 };
+   size_t outLen{ 0 };
+};
 
-   const size_t bufsize = 65536;
-   Floats inBuffer{ bufsize };
-   Floats outBuffer{ bufsize };
-   sampleCount pos = 0;
-   bool error = false;
-   int outGenerated = 0;
-   auto numSamples = mSequence->GetNumSamples();
+// The conversion of one group of corresponding clips by one converter, in
+// one pass, so the result is what a serial loop gives.  Each step reads and
+// converts on a worker thread, while the calling thread appends the output
+// of the step before, because only it may write sample blocks.  Two steps'
+// buffers alternate.
+class ClipConversion
+{
+public:
+   ClipConversion(const std::vector<WaveClip*> &clips, int rate,
+      unsigned numThreads,
+      std::vector<std::unique_ptr<Sequence>> &newSequences)
+      : mClips{ clips }
+      , mNumSamples{ clips[0]->GetNumSamples() }
+      , mFactor{ (double)rate / clips[0]->GetRate() }
+      // Constant rate resampling
+      , mResample( true, mFactor, mFactor, clips.size(), false, numThreads )
+      , mSteps{ { clips.size() }, { clips.size() } }
+      , mNewSequences{ newSequences }
+   {
+      for (auto pClip : clips) {
+         const auto pSequence = pClip->GetSequence();
+         mNewSequences.push_back(std::make_unique<Sequence>(
+            pSequence->GetFactory(), pSequence->GetSampleFormat()));
+      }
+   }
 
-   auto newSequence =
-      std::make_unique<Sequence>(mSequence->GetFactory(), mSequence->GetSampleFormat());
+   ~ClipConversion()
+   {
+      // Don't destroy the buffers or the converter under the worker
+      if (mPending.valid())
+         mPending.wait();
+   }
 
    /**
     * We want to keep going as long as we have something to feed the resampler
     * with OR as long as the resampler spews out samples (which could continue
     * for a few iterations after we stop feeding it)
     */
-   while (pos < numSamples || outGenerated > 0)
+   bool Busy() const { return mPos < mNumSamples || mOutGenerated > 0; }
+
+   sampleCount Position() const { return mPos; }
+
+   // Convert the next step on a worker thread
+   void Schedule()
    {
-      const auto inLen = limitSampleBufferSize( bufsize, numSamples - pos );
+      auto pPromise =
+         std::make_shared< std::promise< std::pair<size_t, size_t> > >();
+      mPending = pPromise->get_future();
+      WorkerPool::Get().Schedule( [this, pPromise]{
+         try {
+            pPromise->set_value(Convert(mSteps[mCurrent]));
+         }
+         catch (...) {
+            pPromise->set_exception(std::current_exception());
+         }
+      } );
+   }
 
-      bool isLast = ((pos + inLen) == numSamples);
+   // Append the output of the step before the scheduled one, then wait for
+   // that one
+   void Finish()
+   {
+      Append(mSteps[1 - mCurrent]);
+      const auto results = mPending.get();
+      mPos += results.first;
+      mOutGenerated = results.second;
+      mSteps[mCurrent].outLen = mOutGenerated;
+      mCurrent = 1 - mCurrent;
+   }
 
-      if (!mSequence->Get((samplePtr)inBuffer.get(), floatSample, pos, inLen, true))
-      {
-         error = true;
-         break;
-      }
+   // Append the output of the last step
+   void Flush() { Append(mSteps[1 - mCurrent]); }
 
-      const auto results = resample.Process(factor, inBuffer.get(), inLen, isLast,
-                                            outBuffer.get(), bufsize);
-      outGenerated = results.second;
+private:
+   // Called on a worker thread; the converter may not have taken all of the
+   // last input, so read from the position it reached
+   std::pair<size_t, size_t> Convert(ResampleStep &step)
+   {
+      const auto nChannels = mClips.size();
+      step.inLen = limitSampleBufferSize( ResampleStepSize, mNumSamples - mPos );
+      for (size_t ii = 0; ii < nChannels; ++ii)
+         if (!mClips[ii]->GetSequence()->Get(
+            (samplePtr)step.in[ii].get(), floatSample, mPos, step.inLen, true))
+            throw SimpleMessageBoxException{
+               XO("Resampling failed.")
+            };
+      const bool isLast = ((mPos + step.inLen) == mNumSamples);
+      return mResample.Process(mFactor,
+         step.inPtrs.get(), step.inLen, isLast,
+         step.outPtrs.get(), ResampleStepSize);
+   }
 
-      pos += results.first;
+   void Append(ResampleStep &step)
+   {
+      for (size_t ii = 0; ii < mClips.size(); ++ii)
+         mNewSequences[ii]->Append((samplePtr)step.out[ii].get(),
+            floatSample, step.outLen);
+      step.outLen = 0;
+   }
 
-      if (outGenerated < 0)
-      {
-         error = true;
-         break;
+   const std::vector<WaveClip*> &mClips;
+   const sampleCount mNumSamples;
+   const double mFactor;
+   ::Resample mResample;
+   ResampleStep mSteps[2];
+   std::vector<std::unique_ptr<Sequence>> &mNewSequences;
+   std::future< std::pair<size_t, size_t> > mPending;
+   sampleCount mPos{ 0 };
+   size_t mOutGenerated{ 0 };
+   unsigned mCurrent{ 0 };
+};
+}
+
+void WaveClip::Resample(const std::vector<std::vector<WaveClip*>> &groups,
+   int rate, ProgressDialog *progress)
+// STRONG-GUARANTEE
+{
+   // Note:  it is not necessary to do this recursively to cutlines.
+   // They get resampled as needed when they are expanded.
+
+   // Groups that need conversion, and the work of all of them
+   std::vector<const std::vector<WaveClip*>*> todo;
+   double total = 0;
+   for (const auto &clips : groups) {
+      if (clips.empty())
+         continue;
+      const auto pFirst = clips[0];
+      if (rate == pFirst->mRate)
+         continue; // Nothing to do
+      for (auto pClip : clips) {
+         wxASSERT(pClip->mRate == pFirst->mRate);
+         wxASSERT(pClip->mSequence->GetNumSamples() ==
+            pFirst->mSequence->GetNumSamples());
+      }
+      todo.push_back(&clips);
+      total += pFirst->mSequence->GetNumSamples().as_double() * clips.size();
+   }
+   if (todo.empty())
+      return;
+
+   // Convert as many groups at once as there are threads, keeping buffers
+   // only for those.  If there are threads to spare, let the converters
+   // filter channels on them.
+   const size_t nThreads = WorkerPool::Get().Concurrency();
+   const auto nActive = std::min(todo.size(), nThreads);
+   std::vector<std::vector<std::unique_ptr<Sequence>>> newSequences(
+      todo.size());
+   std::vector<std::unique_ptr<ClipConversion>> active;
+   // Which groups are active, and the work of those finished
+   std::vector<size_t> indices;
+   double done = 0;
+
+   size_t next = 0;
+   while (next < todo.size() || !active.empty()) {
+      while (active.size() < nActive && next < todo.size()) {
+         const auto &clips = *todo[next];
+         const unsigned numThreads =
+            clips.size() * nActive <= nThreads ? clips.size() : 1;
+         auto pConversion = std::make_unique<ClipConversion>(
+            clips, rate, numThreads, newSequences[next]);
+         if (pConversion->Busy()) {
+            pConversion->Schedule();
+            active.push_back(std::move(pConversion));
+            indices.push_back(next);
+         }
+         ++next;
       }
 
-      newSequence->Append((samplePtr)outBuffer.get(), floatSample,
-                          outGenerated);
+      double current = 0;
+      for (size_t ii = 0; ii < active.size();) {
+         auto &conversion = *active[ii];
+         const auto nChannels = todo[indices[ii]]->size();
+         conversion.Finish();
+         if (conversion.Busy()) {
+            conversion.Schedule();
+            current += conversion.Position().as_double() * nChannels;
+            ++ii;
+         }
+         else {
+            conversion.Flush();
+            done += conversion.Position().as_double() * nChannels;
+            active.erase(active.begin() + ii);
+            indices.erase(indices.begin() + ii);
+         }
+      }
 
       if (progress)
       {
-         auto updateResult = progress->Update(
-            pos.as_long_long(),
-            numSamples.as_long_long()
-         );
-         error = (updateResult != ProgressResult::Success);
-         if (error)
+         auto updateResult = progress->Update(done + current, total);
+         if (updateResult != ProgressResult::Success)
             throw UserException{};
       }
    }
 
-   if (error)
-      throw SimpleMessageBoxException{
-         XO("Resampling failed.")
-      };
-   else
-   {
-      // Use NOFAIL-GUARANTEE in these steps
+   // Use NOFAIL-GUARANTEE in these steps
+   for (size_t jj = 0; jj < todo.size(); ++jj) {
+      const auto &clips = *todo[jj];
+      for (size_t ii = 0; ii < clips.size(); ++ii) {
+         const auto pClip = clips[ii];
 
-      // Invalidate wave display cache
-      mWaveCache = std::make_unique<WaveCache>();
-      // Invalidate the spectrum display cache
-      mSpecCache = std::make_unique<SpecCache>();
+         // Invalidate wave display cache
+         pClip->mWaveCache = std::make_unique<WaveCache>();
+         // Invalidate the spectrum display cache
+         pClip->mSpecCache = std::make_unique<SpecCache>();
 
-      mSequence = std::move(newSequence);
-      mRate = rate;
+         pClip->mSequence = std::move(newSequences[jj][ii]);
+         pClip->mRate = rate;
+      }
    }
 }
 
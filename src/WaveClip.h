@@ -21,6 +21,7 @@
 
 #include <wx/longlong.h>
 
+#include <functional>
 #include <vector>
 
 class BlockArray;
@@ -33,6 +34,7 @@ using SampleBlockFactoryPtr = std::shared_ptr<SampleBlockFactory>;
 class Sequence;
 class SpectrogramSettings;
 class WaveCache;
+struct WaveCacheFill;
 class WaveTrackCache;
 class wxFileNameWrapper;
 
@@ -72,10 +74,13 @@ public:
    void Grow(size_t len_, const SpectrogramSettings& settings,
                double pixelsPerSecond, double start_);
 
-   // Calculate the dirty columns at the begin and end of the cache
+   // Half-open ranges of columns
+   using Ranges = std::vector< std::pair<int, int> >;
+
+   // Calculate the dirty columns, which may be anywhere in the cache
    void Populate
       (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
-       int copyBegin, int copyEnd, size_t numPixels,
+       const Ranges &ranges,
        sampleCount numSamples,
        double offset, double rate, double pixelsPerSecond);
 
@@ -91,6 +96,11 @@ public:
    std::vector<sampleCount> where;
 
    int          dirty;
+
+   // Whether where follows a grid fixed in the clip, and the number in the
+   // grid of the first column
+   bool         gridded { false };
+   long long    gridX0 { 0 };
 };
 
 class SpecPxCache {
@@ -214,6 +224,12 @@ public:
    // the length of the clip
    void Resample(int rate, ProgressDialog *progress = NULL);
 
+   // Resample groups of clips of corresponding channels.  The clips of a
+   // group must have equal rates and lengths, and are converted together
+   // with one multichannel converter; groups are converted concurrently
+   static void Resample(const std::vector<std::vector<WaveClip*>> &groups,
+      int rate, ProgressDialog *progress = NULL);
+
    void SetColourIndex( int index ){ mColourIndex = index;};
    int GetColourIndex( ) const { return mColourIndex;};
    void SetOffset(double offset);
@@ -239,6 +255,20 @@ public:
    void SetSamples(samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
 
+   /** Interactive editing, as with the Draw tool, changes a copy of some
+    * samples held in memory, so that each mouse event does not go to the
+    * sample blocks.  GetSamples() and GetWaveDisplay() see the changes at
+    * once, and CommitSampleEdits() writes all of them with one
+    * SetSamples().  The clip must not be changed otherwise in the
+    * meantime. */
+   //! Make the copy cover at least [start, start + len), reading as needed
+   void BeginSampleEdits(sampleCount start, size_t len);
+   //! Change samples in the copy, extending it as needed
+   void EditSamples(const float *values, sampleCount start, size_t len);
+   bool IsEditingSamples() const { return mSampleEdits != nullptr; }
+   void CommitSampleEdits(); // STRONG-GUARANTEE
+   void DiscardSampleEdits(); // NOFAIL-GUARANTEE
+
    Envelope* GetEnvelope() { return mEnvelope.get(); }
    const Envelope* GetEnvelope() const { return mEnvelope.get(); }
    BlockArray* GetSequenceBlockArray();
@@ -254,12 +284,27 @@ public:
     * called automatically when WaveClip has a chance to know that something
     * has changed, like when member functions SetSamples() etc. are called. */
    void MarkChanged() // NOFAIL-GUARANTEE
-      { mDirty++; }
+      { mDirty++; mEdits.clear(); }
+   /** The same, when it is known that only the samples from start up to
+    * start + removed were replaced with inserted new ones.  Then display
+    * caches recompute only the columns for those samples, and move the
+    * rest. */
+   void MarkChanged(sampleCount start, sampleCount removed,
+                    sampleCount inserted); // NOFAIL-GUARANTEE
 
    /** Getting high-level data for screen display and clipping
     * calculations and Contrast */
    bool GetWaveDisplay(WaveDisplay &display,
                        double t0, double pixelsPerSecond) const;
+   /** The same, but columns that need sample blocks to be read are computed
+    * on a worker thread.  Meanwhile they get rough values from the summaries
+    * of whole blocks, with negative bl, and isLoading is set.  onReady is
+    * called later on the main thread, when calling again gives better
+    * values; it may be destroyed on another thread, so it should capture
+    * nothing that must be released on the main thread. */
+   bool GetWaveDisplay(WaveDisplay &display,
+                       double t0, double pixelsPerSecond,
+                       bool &isLoading, std::function<void()> onReady) const;
    bool GetSpectrogram(WaveTrackCache &cache,
                        const float *& spectrogram,
                        const sampleCount *& where,
@@ -351,6 +396,44 @@ public:
    // used by commands which interact with clips using the keyboard
    bool SharesBoundaryWithNextClip(const WaveClip* next) const;
 
+private:
+   bool DoGetWaveDisplay(WaveDisplay &display,
+                         double t0, double pixelsPerSecond,
+                         bool *pIsLoading,
+                         const std::function<void()> &onReady) const;
+   // Move finished results of the worker into mWaveCache
+   void CollectWaveCacheFill() const;
+   // Compute the columns of mWaveCache that have only rough values, now or
+   // on a worker thread
+   bool ResolveWaveCache(bool *pIsLoading,
+                         const std::function<void()> &onReady) const;
+   // Compute the columns in [p0, p1) that land in the append buffer; return
+   // the end of the range that remains for the Sequence
+   size_t FillFromAppendBuffer(float *min, float *max, float *rms, int *bl,
+                               const sampleCount *where,
+                               size_t p0, size_t p1) const;
+   // Compute again the columns in [p0, p1) that show samples changed by
+   // EditSamples(), which the Sequence does not have yet
+   void FillFromSampleEdits(float *min, float *max, float *rms, int *bl,
+                            const sampleCount *where,
+                            size_t p0, size_t p1) const;
+
+   // Follow the edits made since a cache was filled at dirty.  Columns,
+   // which depend on the samples from where[ii] - lead up to
+   // where[ii + 1] + trail, move with the samples, and where is changed to
+   // match.  sources receives, for each column, the column that held its
+   // values, or -1 if they must be computed again.  Return false if the
+   // edits are not all known, and then change nothing.
+   bool FollowEdits(int dirty, double samplesPerPixel,
+                    sampleCount lead, sampleCount trail,
+                    std::vector<sampleCount> &where, size_t len,
+                    std::vector<int> &sources) const;
+   // Do that for mWaveCache and mSpecCache
+   void UpdateWaveCache() const;
+   bool UpdateSpecCache(WaveTrackCache &waveTrackCache,
+                        const SpectrogramSettings &settings,
+                        double pixelsPerSecond) const;
+
 public:
    // Cache of values to colour pixels of Spectrogram - used by TrackArtist
    mutable std::unique_ptr<SpecPxCache> mSpecPxCache;
@@ -361,12 +444,31 @@ protected:
    double mOffset { 0 };
    int mRate;
    int mDirty { 0 };
+   // Ranges of samples changed by the most recent edits, which increased
+   // mDirty by one each, up to its present value
+   struct SampleEdit {
+      int dirty;
+      sampleCount start, removed, inserted;
+   };
+   std::vector<SampleEdit> mEdits;
    int mColourIndex;
 
+   // The copy of samples being edited interactively, and the range of
+   // those changed in it
+   struct SampleEditWindow {
+      sampleCount start;
+      size_t len;
+      Floats samples;
+      sampleCount changedStart, changedEnd;
+   };
+   std::unique_ptr<SampleEditWindow> mSampleEdits;
+
    std::unique_ptr<Sequence> mSequence;
    std::unique_ptr<Envelope> mEnvelope;
 
    mutable std::unique_ptr<WaveCache> mWaveCache;
+   // Work in progress on a worker thread for mWaveCache, if any
+   mutable std::shared_ptr<WaveCacheFill> mWaveCacheFill;
    mutable std::unique_ptr<SpecCache> mSpecCache;
    SampleBuffer  mAppendBuffer {};
    size_t        mAppendBufferLen { 0 };
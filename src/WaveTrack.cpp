@@ -44,6 +44,7 @@ Track classes.
 #include "float_cast.h"
 
 #include "Envelope.h"
+#include "SampleBlock.h"
 #include "Sequence.h"
 #include "Spectrum.h"
 
@@ -1308,7 +1309,7 @@ void WaveTrack::Silence(double t0, double t1)
          }
 
          clip->GetSequence()->SetSilence(inclipDelta, samplesToCopy);
-         clip->MarkChanged();
+         clip->MarkChanged(inclipDelta, samplesToCopy, samplesToCopy);
       }
    }
 }
@@ -1955,11 +1956,59 @@ void WaveTrack::Set(samplePtr buffer, sampleFormat format,
                            startDelta.as_size_t() *
                            SAMPLE_SIZE(format)),
                           format, inclipDelta, samplesToCopy.as_size_t() );
-         clip->MarkChanged();
       }
    }
 }
 
+namespace {
+// Call f(clip, start in the clip, offset in the range, length) for each part
+// of [start, start + len) that is in a clip
+template< typename Function >
+void ForEachClipRange(const WaveClipHolders &clips,
+   sampleCount start, size_t len, const Function &f)
+{
+   for (const auto &clip : clips) {
+      const auto clipStart = clip->GetStartSample();
+      const auto s0 = std::max(start, clipStart);
+      const auto s1 =
+         std::min(start + len, clipStart + clip->GetNumSamples());
+      if (s0 < s1)
+         f(*clip, s0 - clipStart,
+           (s0 - start).as_size_t(), (s1 - s0).as_size_t());
+   }
+}
+}
+
+void WaveTrack::BeginSampleEdits(sampleCount start, size_t len)
+{
+   ForEachClipRange(mClips, start, len,
+      [](WaveClip &clip, sampleCount inClip, size_t, size_t count){
+         clip.BeginSampleEdits(inClip, count);
+      });
+}
+
+void WaveTrack::EditSamples(const float *buffer, sampleCount start, size_t len)
+{
+   ForEachClipRange(mClips, start, len,
+      [buffer](WaveClip &clip, sampleCount inClip, size_t offset, size_t count){
+         clip.EditSamples(buffer + offset, inClip, count);
+      });
+}
+
+void WaveTrack::CommitSampleEdits()
+// WEAK-GUARANTEE
+{
+   for (const auto &clip : mClips)
+      clip->CommitSampleEdits();
+}
+
+void WaveTrack::DiscardSampleEdits()
+// NOFAIL-GUARANTEE
+{
+   for (const auto &clip : mClips)
+      clip->DiscardSampleEdits();
+}
+
 void WaveTrack::GetEnvelopeValues(double *buffer, size_t bufferLen,
                                   double t0) const
 {
@@ -2421,12 +2470,65 @@ void WaveTrack::Resample(int rate, ProgressDialog *progress)
 // WEAK-GUARANTEE
 // Partial completion may leave clips at differing sample rates!
 {
+   // The clips are independent, and converted concurrently
+   std::vector<std::vector<WaveClip*>> groups;
    for (const auto &clip : mClips)
-      clip->Resample(rate, progress);
+      groups.push_back({ clip.get() });
+   WaveClip::Resample(groups, rate, progress);
 
    mRate = rate;
 }
 
+void WaveTrack::Resample(const std::vector<std::vector<WaveTrack*>> &tracks,
+   int rate, ProgressDialog *progress)
+// STRONG-GUARANTEE
+{
+   std::vector<std::vector<WaveClip*>> groups;
+   for (const auto &channels : tracks) {
+      if (channels.empty())
+         continue;
+
+      // Clips not matched in every other channel are resampled alone
+      std::vector<WaveClip*> unmatched;
+      for (auto pChannel : channels)
+         for (const auto &clip : pChannel->mClips)
+            unmatched.push_back(clip.get());
+
+      for (const auto &clip : channels[0]->mClips) {
+         std::vector<WaveClip*> group{ clip.get() };
+         for (size_t ii = 1; ii < channels.size(); ++ii) {
+            for (const auto &other : channels[ii]->mClips) {
+               if (other->GetOffset() == clip->GetOffset() &&
+                   other->GetRate() == clip->GetRate() &&
+                   other->GetNumSamples() == clip->GetNumSamples()) {
+                  group.push_back(other.get());
+                  break;
+               }
+            }
+         }
+         if (group.size() < channels.size())
+            continue;
+
+         for (auto pClip : group)
+            unmatched.erase(
+               std::find(unmatched.begin(), unmatched.end(), pClip));
+         groups.push_back(std::move(group));
+      }
+
+      for (auto pClip : unmatched)
+         groups.push_back({ pClip });
+   }
+
+   // All groups of all tracks are converted concurrently, and nothing
+   // changes unless all succeed
+   WaveClip::Resample(groups, rate, progress);
+
+   // Use NOFAIL-GUARANTEE in these steps
+   for (const auto &channels : tracks)
+      for (auto pChannel : channels)
+         pChannel->mRate = rate;
+}
+
 namespace {
    template < typename Cont1, typename Cont2 >
    Cont1 FillSortedClipArray(const Cont2& mClips)
@@ -2451,6 +2553,30 @@ WaveClipConstPointers WaveTrack::SortedClipArray() const
    return FillSortedClipArray<WaveClipConstPointers>(mClips);
 }
 
+auto WaveTrack::GetBlockPieces(sampleCount start, sampleCount end) const
+   -> BlockPieces
+{
+   BlockPieces pieces;
+   for (const auto pClip : SortedClipArray()) {
+      const auto clipStart = pClip->GetStartSample();
+      if (pClip->GetEndSample() <= start || clipStart >= end)
+         continue;
+      for (const auto &block : *pClip->GetSequenceBlockArray()) {
+         const auto blockStart = clipStart + block.start;
+         const auto blockEnd = blockStart + block.sb->GetSampleCount();
+         if (blockStart >= end)
+            break;
+         if (blockEnd <= start)
+            continue;
+         const auto from = std::max(start, blockStart);
+         const auto to = std::min(end, blockEnd);
+         pieces.push_back({ block.sb, (from - blockStart).as_size_t(),
+            (to - from).as_size_t(), from });
+      }
+   }
+   return pieces;
+}
+
 ///Deletes all clips' wavecaches.  Careful, This may not be threadsafe.
 void WaveTrack::ClearWaveCaches()
 {
@@ -20,6 +20,7 @@
 
 class ProgressDialog;
 
+class SampleBlock;
 class SampleBlockFactory;
 class SpectrogramSettings;
 class WaveformSettings;
@@ -252,6 +253,13 @@ private:
    void Set(samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
 
+   // Like Set(), but changing copies of the samples held in memory by the
+   // clips, until CommitSampleEdits(); see WaveClip::BeginSampleEdits()
+   void BeginSampleEdits(sampleCount start, size_t len);
+   void EditSamples(const float *buffer, sampleCount start, size_t len);
+   void CommitSampleEdits(); // WEAK-GUARANTEE
+   void DiscardSampleEdits(); // NOFAIL-GUARANTEE
+
    // Fetch envelope values corresponding to uniformly separated sample times
    // starting at the given time.
    void GetEnvelopeValues(double *buffer, size_t bufferLen,
@@ -289,6 +297,26 @@ private:
    size_t GetMaxBlockSize() const;
    size_t GetIdealBlockSize();
 
+   //! The part of one sample block that lies within a range of the track
+   struct BlockPiece
+   {
+      std::shared_ptr<SampleBlock> pBlock;
+      //! First sample of the piece within the block
+      size_t offset;
+      size_t len;
+      //! Position of the first sample in the track
+      sampleCount start;
+   };
+   using BlockPieces = std::vector<BlockPiece>;
+
+   //! The pieces of the blocks of all clips that hold samples from start
+   //! to end, in order
+   /*!
+    Blocks are never modified, only replaced, so the pieces may be read on
+    other threads, even while the track changes
+    */
+   BlockPieces GetBlockPieces(sampleCount start, sampleCount end) const;
+
    //
    // XMLTagHandler callback methods for loading and saving
    //
@@ -501,6 +529,12 @@ private:
    // Resample track (i.e. all clips in the track)
    void Resample(int rate, ProgressDialog *progress = NULL);
 
+   // Resample all channels of several tracks, converting clips that
+   // correspond across the channels of a track together, and the clips of
+   // all the tracks concurrently
+   static void Resample(const std::vector<std::vector<WaveTrack*>> &tracks,
+      int rate, ProgressDialog *progress = NULL);
+
    int GetLastScaleType() const { return mLastScaleType; }
    void SetLastScaleType() const;
 
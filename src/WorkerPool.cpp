@@ -0,0 +1,168 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WorkerPool.cpp
+
+*******************************************************************//**
+
+\class WorkerPool
+\brief Runs independent, CPU bound jobs on a fixed set of threads,
+sized to the number of processors.
+
+*//*******************************************************************/
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace {
+
+// Jobs per thread in each round of ParallelForInRounds()
+constexpr size_t JobsPerRound = 8;
+
+}
+
+WorkerPool &WorkerPool::Get()
+{
+   static WorkerPool instance;
+   return instance;
+}
+
+WorkerPool::WorkerPool()
+{
+   // The thread that dispatches jobs also runs some, so leave one
+   // processor for it
+   const auto nProcessors = std::max(1u, std::thread::hardware_concurrency());
+   for (unsigned ii = 1; ii < nProcessors; ++ii)
+      mThreads.emplace_back([this]{ Run(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+   {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mStopping = true;
+   }
+   mCondition.notify_all();
+   for (auto &thread : mThreads)
+      thread.join();
+}
+
+void WorkerPool::Run()
+{
+   while (true) {
+      Job job;
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mCondition.wait(lock, [this]{ return mStopping || !mQueue.empty(); });
+         if (mStopping)
+            return;
+         job = std::move(mQueue.front());
+         mQueue.pop_front();
+      }
+      try { job(); }
+      catch (...) {}
+   }
+}
+
+void WorkerPool::Schedule(Job job)
+{
+   if (mThreads.empty()) {
+      try { job(); }
+      catch (...) {}
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mQueue.push_back(std::move(job));
+   }
+   mCondition.notify_one();
+}
+
+void WorkerPool::ParallelFor(size_t count, const IndexedJob &job)
+{
+   if (count == 0)
+      return;
+   if (count == 1 || mThreads.empty()) {
+      for (size_t ii = 0; ii < count; ++ii)
+         job(ii);
+      return;
+   }
+
+   // Shared with helpers that may start only after this call returns,
+   // when there is nothing left for them to do
+   struct State {
+      std::atomic<size_t> next{ 0 };
+      std::atomic<bool> failed{ false };
+      size_t count;
+      const IndexedJob *pJob;
+      std::mutex mutex;
+      std::condition_variable done;
+      size_t running{ 0 };
+      std::exception_ptr exception;
+   };
+   auto pState = std::make_shared<State>();
+   pState->count = count;
+   pState->pJob = &job;
+
+   // Returns after failing to claim an index
+   auto work = [](State &state) {
+      {
+         std::lock_guard<std::mutex> guard(state.mutex);
+         ++state.running;
+      }
+      while (!state.failed) {
+         const auto ii = state.next++;
+         if (ii >= state.count)
+            break;
+         try { (*state.pJob)(ii); }
+         catch (...) {
+            std::lock_guard<std::mutex> guard(state.mutex);
+            if (!state.exception)
+               state.exception = std::current_exception();
+            state.failed = true;
+         }
+      }
+      bool last;
+      {
+         std::lock_guard<std::mutex> guard(state.mutex);
+         last = (--state.running == 0);
+      }
+      if (last)
+         state.done.notify_all();
+   };
+
+   const auto nHelpers = std::min(count - 1, mThreads.size());
+   for (size_t ii = 0; ii < nHelpers; ++ii)
+      Schedule([pState, work]{
+         // Don't enter once all indices are claimed, because pJob may
+         // no longer be valid
+         if (pState->next < pState->count && !pState->failed)
+            work(*pState);
+      });
+
+   work(*pState);
+
+   // Wait for helpers still running the last jobs
+   std::unique_lock<std::mutex> lock(pState->mutex);
+   pState->done.wait(lock, [&]{ return pState->running == 0; });
+   if (pState->exception)
+      std::rethrow_exception(pState->exception);
+}
+
+bool WorkerPool::ParallelForInRounds(size_t count, const IndexedJob &job,
+   const std::function< bool(size_t) > &progress)
+{
+   const size_t roundSize = JobsPerRound * Concurrency();
+   for (size_t first = 0; first < count; first += roundSize) {
+      if (!progress(first))
+         return false;
+      ParallelFor(std::min(roundSize, count - first),
+         [&](size_t ii){ job(first + ii); });
+   }
+   return true;
+}
@@ -0,0 +1,81 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WorkerPool.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_WORKER_POOL__
+#define __AUDACITY_WORKER_POOL__
+
+#include "Audacity.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///\brief A process-wide pool of threads for CPU bound work that can be
+/// divided into independent jobs
+/**
+ Jobs must not touch the GUI, preferences, or the project database; do that
+ on the calling thread before or after dispatching them.  The exception is
+ reading samples of blocks that the main thread keeps alive; see
+ SqliteSampleBlock::GetBlob().
+ */
+class AUDACITY_DLL_API WorkerPool final
+{
+public:
+   using Job = std::function< void() >;
+   using IndexedJob = std::function< void(size_t) >;
+
+   static WorkerPool &Get();
+
+   WorkerPool(const WorkerPool&) = delete;
+   WorkerPool &operator=(const WorkerPool&) = delete;
+   ~WorkerPool();
+
+   //! How many jobs may run at once, counting the calling thread
+   unsigned Concurrency() const { return mThreads.size() + 1; }
+
+   //! Call job(0) ... job(count - 1) and return when all are done
+   /*!
+    The calling thread takes jobs too, so nested calls from within jobs
+    cannot deadlock.  Jobs are handed out one index at a time to whichever
+    thread is free, so they may be of uneven cost.  If any job throws, jobs
+    not yet started are skipped, and the first exception is rethrown here
+    after the running ones finish.
+    */
+   void ParallelFor(size_t count, const IndexedJob &job);
+
+   //! Call job(0) ... job(count - 1) as ParallelFor() does, but a few jobs
+   //! per thread at a time, calling progress(done) before each round with
+   //! the number of jobs done so far
+   /*!
+    @return false, leaving later jobs undone, if progress returned false
+    */
+   bool ParallelForInRounds(size_t count, const IndexedJob &job,
+      const std::function< bool(size_t) > &progress);
+
+   //! Queue a job to run later on some worker thread
+   /*!
+    There is no notification of completion; the job must arrange its own.
+    Exceptions escaping the job are swallowed.
+    */
+   void Schedule(Job job);
+
+private:
+   WorkerPool();
+   void Run();
+
+   std::vector<std::thread> mThreads;
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque<Job> mQueue;
+   bool mStopping{ false };
+};
+
+#endif
@@ -0,0 +1,141 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2020 Audacity Team
+   License: wxwidgets
+
+******************************************************************//**
+
+\file MeasureLoudnessCommand.cpp
+\brief Contains definitions for MeasureLoudnessCommand class
+
+\class MeasureLoudnessCommand
+\brief Reports the integrated loudness, loudness range and true peak of
+the selected audio, without changing it
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "MeasureLoudnessCommand.h"
+
+#include "LoadCommands.h"
+#include "../ViewInfo.h"
+#include "../WaveTrack.h"
+#include "../effects/EBUR128.h"
+
+#include <vector>
+
+#include "../Shuttle.h"
+#include "../ShuttleGui.h"
+#include "CommandContext.h"
+
+const ComponentInterfaceSymbol MeasureLoudnessCommand::Symbol
+{ XO("Measure Loudness") };
+
+namespace{ BuiltinCommandsModule::Registration< MeasureLoudnessCommand > reg; }
+
+bool MeasureLoudnessCommand::DefineParams( ShuttleParams & S ){
+   S.Define( mStereoInd, wxT("StereoIndependent"), false );
+   return true;
+}
+
+void MeasureLoudnessCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieCheckBox(XXO("Measure stereo channels independently"), mStereoInd);
+   }
+   S.EndMultiColumn();
+}
+
+bool MeasureLoudnessCommand::Apply(const CommandContext & context)
+{
+   auto &selectedRegion = ViewInfo::Get( context.project ).selectedRegion;
+   const double t0 = selectedRegion.t0();
+   const double t1 = selectedRegion.t1();
+   if (t0 >= t1)
+   {
+      context.Error(wxT("There is no selection!"));
+      return false;
+   }
+
+   // Channels measured together
+   std::vector< std::vector< const WaveTrack * > > groups;
+   double total = 0;
+   for (auto track :
+        TrackList::Get( context.project ).SelectedLeaders< const WaveTrack >())
+   {
+      auto channels = TrackList::Channels(track);
+      for (auto channel : channels)
+      {
+         if (mStereoInd || channel == track)
+            groups.emplace_back();
+         groups.back().push_back(channel);
+      }
+      total += channels.size() * (track->TimeToLongSamples(t1) -
+         track->TimeToLongSamples(t0)).as_double();
+   }
+   if (groups.empty())
+   {
+      context.Error(wxT("No tracks selected!"));
+      return false;
+   }
+
+   context.StartArray();
+   double done = 0;
+   for (const auto &group : groups)
+   {
+      const auto first = group[0];
+      const auto nChannels = group.size();
+      EBUR128 meter{ first->GetRate(), nChannels };
+      meter.Initialize();
+
+      const auto buffSize = first->GetMaxBlockSize();
+      ArrayOf<Floats> buffers{ nChannels };
+      std::vector< const float * > pointers;
+      for (size_t ii = 0; ii < nChannels; ++ii)
+      {
+         buffers[ii].reinit(buffSize);
+         pointers.push_back(buffers[ii].get());
+      }
+
+      const auto start = first->TimeToLongSamples(t0);
+      const auto end = first->TimeToLongSamples(t1);
+      for (auto position = start; position < end;)
+      {
+         auto block = limitSampleBufferSize(
+            first->GetBestBlockSize(position), end - position);
+         for (size_t ii = 0; ii < nChannels; ++ii)
+            group[ii]->Get(
+               (samplePtr)buffers[ii].get(), floatSample, position, block);
+         meter.ProcessSamples(pointers.data(), block);
+
+         position += block;
+         done += double(block) * nChannels;
+         context.Progress(done / total);
+      }
+
+      context.StartStruct();
+      context.AddItem(first->GetName(), "track");
+      if (mStereoInd)
+         context.AddItem(
+            first->GetChannel() == Track::RightChannel ? "right" :
+            first->GetChannel() == Track::LeftChannel ? "left" : "mono",
+            "channel");
+      // Integrated loudness and true peak are left out for silence
+      const auto loudness = meter.IntegrativeLoudness();
+      if (loudness > 0)
+         context.AddItem(meter.IntegrativeLoudnessToLUFS(loudness),
+            "integrated");
+      context.AddItem(meter.LoudnessRange(), "range");
+      const auto peak = meter.TruePeak();
+      if (peak > 0)
+         context.AddItem(LINEAR_TO_DB(peak), "truepeak");
+      context.EndStruct();
+   }
+   context.EndArray();
+
+   return true;
+}
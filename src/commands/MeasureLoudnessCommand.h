@@ -0,0 +1,39 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2020 Audacity Team
+   License: wxwidgets
+
+******************************************************************//**
+
+\file MeasureLoudnessCommand.h
+\brief Declaration of MeasureLoudnessCommand class
+
+*//*******************************************************************/
+
+#ifndef __MEASURELOUDNESSCOMMAND__
+#define __MEASURELOUDNESSCOMMAND__
+
+#include "Command.h"
+#include "CommandType.h"
+
+class MeasureLoudnessCommand final : public AudacityCommand
+{
+public:
+   static const ComponentInterfaceSymbol Symbol;
+
+   // ComponentInterface overrides
+   ComponentInterfaceSymbol GetSymbol() override {return Symbol;}
+   TranslatableString GetDescription() override {return XO("Measures the EBU R128 loudness of the selected tracks.");};
+   bool DefineParams( ShuttleParams & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+
+   // AudacityCommand overrides
+   wxString ManualPage() override {return wxT("Extra_Menu:_Scriptables_II#measure_loudness");};
+   bool Apply(const CommandContext &context) override;
+
+private:
+   bool mStereoInd;
+};
+
+#endif /* End of include guard: __MEASURELOUDNESSCOMMAND__ */
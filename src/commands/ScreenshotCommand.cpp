@@ -569,6 +569,7 @@ void ScreenshotCommand::CaptureScriptables(
       "SaveProject2",
       "Drag",
       "CompareAudio",
+      "MeasureLoudness",
       "Screenshot",
    } );
 
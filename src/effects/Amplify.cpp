@@ -203,6 +203,17 @@ bool EffectAmplify::Init()
    return true;
 }
 
+int EffectAmplify::GetSegmentHistory()
+{
+   return 0;
+}
+
+size_t EffectAmplify::ProcessSegment(sampleCount WXUNUSED(offset),
+   size_t WXUNUSED(history), float **inBlock, float **outBlock, size_t blockLen)
+{
+   return ProcessBlock(inBlock, outBlock, blockLen);
+}
+
 void EffectAmplify::Preview(bool dryOnly)
 {
    auto cleanup1 = valueRestorer( mRatio );
@@ -54,6 +54,9 @@ public:
    // Effect implementation
 
    bool Init() override;
+   int GetSegmentHistory() override;
+   size_t ProcessSegment(sampleCount offset, size_t history,
+      float **inBlock, float **outBlock, size_t blockLen) override;
    void Preview(bool dryOnly) override;
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
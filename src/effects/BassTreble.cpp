@@ -59,6 +59,17 @@ enum kShelfType
    kTreble
 };
 
+// Divide the coefficients by a0, as Biquad expects
+static void SetSection(Biquad &section,
+   double a0, double a1, double a2, double b0, double b1, double b2)
+{
+   section.fNumerCoeffs[Biquad::B0] = b0 / a0;
+   section.fNumerCoeffs[Biquad::B1] = b1 / a0;
+   section.fNumerCoeffs[Biquad::B2] = b2 / a0;
+   section.fDenomCoeffs[Biquad::A1] = a1 / a0;
+   section.fDenomCoeffs[Biquad::A2] = a2 / a0;
+}
+
 const ComponentInterfaceSymbol EffectBassTreble::Symbol
 { XO("Bass and Treble") };
 
@@ -161,7 +172,7 @@ bool EffectBassTreble::RealtimeAddProcessor(unsigned WXUNUSED(numChannels), floa
 
    InstanceInit(slave, sampleRate);
 
-   mSlaves.push_back(slave);
+   mSlaves.push_back(std::move(slave));
 
    return true;
 }
@@ -221,6 +232,12 @@ bool EffectBassTreble::CheckWhetherSkipEffect()
 
 // Effect implementation
 
+bool EffectBassTreble::ProcessesChannelsInParallel()
+{
+   // Each processor has its own state and only reads the parameters
+   return true;
+}
+
 void EffectBassTreble::PopulateOrExchange(ShuttleGui & S)
 {
    S.SetBorder(5);
@@ -324,29 +341,8 @@ void EffectBassTreble::InstanceInit(EffectBassTrebleState & data, float sampleRa
    data.hzBass = 250.0f;   // could be tunable in a more advanced version
    data.hzTreble = 4000.0f;   // could be tunable in a more advanced version
 
-   data.a0Bass = 1;
-   data.a1Bass = 0;
-   data.a2Bass = 0;
-   data.b0Bass = 0;
-   data.b1Bass = 0;
-   data.b2Bass = 0;
-
-   data.a0Treble = 1;
-   data.a1Treble = 0;
-   data.a2Treble = 0;
-   data.b0Treble = 0;
-   data.b1Treble = 0;
-   data.b2Treble = 0;
-
-   data.xn1Bass = 0;
-   data.xn2Bass = 0;
-   data.yn1Bass = 0;
-   data.yn2Bass = 0;
-
-   data.xn1Treble = 0;
-   data.xn2Treble = 0;
-   data.yn1Treble = 0;
-   data.yn2Treble = 0;
+   data.sections[0] = data.sections[1] = Biquad{};
+   data.filters = BiquadCascade{ data.sections, 2, 1 };
 
    data.bass = -1;
    data.treble = -1;
@@ -372,20 +368,28 @@ size_t EffectBassTreble::InstanceProcess(EffectBassTrebleState & data,
 
    data.gain = DB_TO_LINEAR(mGain);
 
+   double a0, a1, a2, b0, b1, b2;
+
    // Compute coefficients of the low shelf biquand IIR filter
    if (data.bass != oldBass)
+   {
       Coefficents(data.hzBass, data.slope, mBass, data.samplerate, kBass,
-                  data.a0Bass, data.a1Bass, data.a2Bass,
-                  data.b0Bass, data.b1Bass, data.b2Bass);
+                  a0, a1, a2, b0, b1, b2);
+      SetSection(data.sections[0], a0, a1, a2, b0, b1, b2);
+   }
 
    // Compute coefficients of the high shelf biquand IIR filter
    if (data.treble != oldTreble)
+   {
       Coefficents(data.hzTreble, data.slope, mTreble, data.samplerate, kTreble,
-                  data.a0Treble, data.a1Treble, data.a2Treble,
-                  data.b0Treble, data.b1Treble, data.b2Treble);
+                  a0, a1, a2, b0, b1, b2);
+      SetSection(data.sections[1], a0, a1, a2, b0, b1, b2);
+   }
 
+   data.filters.SetSections(data.sections);
+   data.filters.Process(&ibuf, &obuf, blockLen);
    for (decltype(blockLen) i = 0; i < blockLen; i++) {
-      obuf[i] = DoFilter(data, ibuf[i]) * data.gain;
+      obuf[i] *= data.gain;
    }
 
    return blockLen;
@@ -424,29 +428,6 @@ void EffectBassTreble::Coefficents(double hz, double slope, double gain, double
    }
 }
 
-float EffectBassTreble::DoFilter(EffectBassTrebleState & data, float in)
-{
-   // Bass filter
-   float out = (data.b0Bass * in + data.b1Bass * data.xn1Bass + data.b2Bass * data.xn2Bass -
-         data.a1Bass * data.yn1Bass - data.a2Bass * data.yn2Bass) / data.a0Bass;
-   data.xn2Bass = data.xn1Bass;
-   data.xn1Bass = in;
-   data.yn2Bass = data.yn1Bass;
-   data.yn1Bass = out;
-
-   // Treble filter
-   in = out;
-   out = (data.b0Treble * in + data.b1Treble * data.xn1Treble + data.b2Treble * data.xn2Treble -
-         data.a1Treble * data.yn1Treble - data.a2Treble * data.yn2Treble) / data.a0Treble;
-   data.xn2Treble = data.xn1Treble;
-   data.xn1Treble = in;
-   data.yn2Treble = data.yn1Treble;
-   data.yn1Treble = out;
-
-   return out;
-}
-
-
 void EffectBassTreble::OnBassText(wxCommandEvent & WXUNUSED(evt))
 {
    double oldBass = mBass;
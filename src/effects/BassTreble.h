@@ -13,6 +13,7 @@
 #define __AUDACITY_EFFECT_BASS_TREBLE__
 
 #include "Effect.h"
+#include "Biquad.h"
 
 class wxSlider;
 class wxCheckBox;
@@ -27,10 +28,9 @@ public:
    double bass;
    double gain;
    double slope, hzBass, hzTreble;
-   double a0Bass, a1Bass, a2Bass, b0Bass, b1Bass, b2Bass;
-   double a0Treble, a1Treble, a2Treble, b0Treble, b1Treble, b2Treble;
-   double xn1Bass, xn2Bass, yn1Bass, yn2Bass;
-   double xn1Treble, xn2Treble, yn1Treble, yn2Treble;
+   // The low shelf, then the high shelf
+   Biquad sections[2];
+   BiquadCascade filters;
 };
 
 class EffectBassTreble final : public Effect
@@ -72,6 +72,7 @@ public:
 
    // Effect Implementation
 
+   bool ProcessesChannelsInParallel() override;
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
@@ -86,7 +87,6 @@ private:
 
    void Coefficents(double hz, double slope, double gain, double samplerate, int type,
                     double& a0, double& a1, double& a2, double& b0, double& b1, double& b2);
-   float DoFilter(EffectBassTrebleState & data, float in);
 
    void OnBassText(wxCommandEvent & evt);
    void OnTrebleText(wxCommandEvent & evt);
@@ -11,8 +11,15 @@ Max Maisel
 
 #include "Biquad.h"
 #include "Audacity.h"
+#include <algorithm>
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BIQUAD_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #define square(a) ((a)*(a))
 #define PI M_PI
 
@@ -40,6 +47,152 @@ void Biquad::Process(float* pfIn, float* pfOut, int iNumSamples)
       *pfOut++ = ProcessOne(*pfIn++);
 }
 
+BiquadCascade::BiquadCascade(
+   const Biquad *sections, size_t nSections, size_t nChannels)
+   : mnSections{ nSections }
+   , mnChannels{ nChannels }
+   , mCoeffs{ 5 * nSections }
+   , mState{ 4 * nSections * nChannels }
+{
+   SetSections(sections);
+   Reset();
+}
+
+void BiquadCascade::SetSections(const Biquad *sections)
+{
+   for (size_t ii = 0; ii < mnSections; ++ii)
+   {
+      auto coeffs = &mCoeffs[5 * ii];
+      coeffs[0] = sections[ii].fNumerCoeffs[Biquad::B0];
+      coeffs[1] = sections[ii].fNumerCoeffs[Biquad::B1];
+      coeffs[2] = sections[ii].fNumerCoeffs[Biquad::B2];
+      coeffs[3] = sections[ii].fDenomCoeffs[Biquad::A1];
+      coeffs[4] = sections[ii].fDenomCoeffs[Biquad::A2];
+   }
+}
+
+void BiquadCascade::Reset()
+{
+   std::fill(mState.get(), mState.get() + 4 * mnSections * mnChannels, 0.0);
+}
+
+void BiquadCascade::Process(
+   const float *const *in, float *const *out, size_t len)
+{
+   size_t channel = 0;
+#ifdef BIQUAD_USE_SSE2
+   for (; channel + 1 < mnChannels; channel += 2)
+      ProcessPair(channel,
+         in[channel], in[channel + 1], out[channel], out[channel + 1], len);
+#endif
+   for (; channel < mnChannels; ++channel)
+      ProcessChannel(channel, in[channel], out[channel], len);
+}
+
+namespace {
+// Samples held in double between sections; small enough for the stack
+constexpr size_t CascadeChunk = 256;
+}
+
+void BiquadCascade::ProcessChannel(
+   size_t channel, const float *in, float *out, size_t len)
+{
+   double work[CascadeChunk];
+   const auto stride = mnChannels;
+   for (size_t offset = 0; offset < len; offset += CascadeChunk)
+   {
+      const auto count = std::min(CascadeChunk, len - offset);
+      std::copy(in + offset, in + offset + count, work);
+
+      // Run each section over the chunk, keeping its state in registers
+      for (size_t ii = 0; ii < mnSections; ++ii)
+      {
+         const auto coeffs = &mCoeffs[5 * ii];
+         const auto b0 = coeffs[0], b1 = coeffs[1], b2 = coeffs[2],
+            a1 = coeffs[3], a2 = coeffs[4];
+         const auto state = &mState[4 * ii * stride + channel];
+         auto x1 = state[0], x2 = state[stride],
+            y1 = state[2 * stride], y2 = state[3 * stride];
+         for (size_t jj = 0; jj < count; ++jj)
+         {
+            // Same order of operations as Biquad::ProcessOne
+            const auto x = work[jj];
+            const auto y = x * b0 + x1 * b1 + x2 * b2 - y1 * a1 - y2 * a2;
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            work[jj] = y;
+         }
+         state[0] = x1;
+         state[stride] = x2;
+         state[2 * stride] = y1;
+         state[3 * stride] = y2;
+      }
+
+      std::copy(work, work + count, out + offset);
+   }
+}
+
+#ifdef BIQUAD_USE_SSE2
+void BiquadCascade::ProcessPair(size_t channel,
+   const float *in0, const float *in1, float *out0, float *out1, size_t len)
+{
+   __m128d work[CascadeChunk];
+   const auto stride = mnChannels;
+   for (size_t offset = 0; offset < len; offset += CascadeChunk)
+   {
+      const auto count = std::min(CascadeChunk, len - offset);
+      for (size_t jj = 0; jj < count; ++jj)
+         work[jj] = _mm_set_pd(in1[offset + jj], in0[offset + jj]);
+
+      for (size_t ii = 0; ii < mnSections; ++ii)
+      {
+         const auto coeffs = &mCoeffs[5 * ii];
+         const auto b0 = _mm_set1_pd(coeffs[0]), b1 = _mm_set1_pd(coeffs[1]),
+            b2 = _mm_set1_pd(coeffs[2]), a1 = _mm_set1_pd(coeffs[3]),
+            a2 = _mm_set1_pd(coeffs[4]);
+         const auto state = &mState[4 * ii * stride + channel];
+         auto x1 = _mm_loadu_pd(state), x2 = _mm_loadu_pd(state + stride),
+            y1 = _mm_loadu_pd(state + 2 * stride),
+            y2 = _mm_loadu_pd(state + 3 * stride);
+         for (size_t jj = 0; jj < count; ++jj)
+         {
+            const auto x = work[jj];
+            const auto y = _mm_sub_pd(_mm_sub_pd(
+               _mm_add_pd(_mm_add_pd(
+                  _mm_mul_pd(x, b0), _mm_mul_pd(x1, b1)), _mm_mul_pd(x2, b2)),
+               _mm_mul_pd(y1, a1)), _mm_mul_pd(y2, a2));
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            work[jj] = y;
+         }
+         _mm_storeu_pd(state, x1);
+         _mm_storeu_pd(state + stride, x2);
+         _mm_storeu_pd(state + 2 * stride, y1);
+         _mm_storeu_pd(state + 3 * stride, y2);
+      }
+
+      for (size_t jj = 0; jj < count; ++jj)
+      {
+         double pair[2];
+         _mm_storeu_pd(pair, work[jj]);
+         out0[offset + jj] = pair[0];
+         out1[offset + jj] = pair[1];
+      }
+   }
+}
+#else
+void BiquadCascade::ProcessPair(size_t channel,
+   const float *in0, const float *in1, float *out0, float *out1, size_t len)
+{
+   ProcessChannel(channel, in0, out0, len);
+   ProcessChannel(channel + 1, in1, out1, len);
+}
+#endif
+
 const double Biquad::s_fChebyCoeffs[MAX_Order][MAX_Order + 1] =
 {
    // For Chebyshev polynomials of the first kind (see http://en.wikipedia.org/wiki/Chebyshev_polynomial)
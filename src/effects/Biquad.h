@@ -76,4 +76,43 @@ struct Biquad
    static double ChebyPoly(int Order, double NormFreq);
 };
 
+/// \brief A chain of biquads applied to each of several channels, a block
+/// at a time
+/**
+ The sections' coefficients are shared, and each channel has its own state.
+ The output of each section passes to the next in double precision.  Where
+ SSE2 is available, channels are filtered in pairs, one in each lane.
+ */
+class BiquadCascade
+{
+public:
+   BiquadCascade() = default;
+   //! Copy the coefficients of sections, and start in silence
+   BiquadCascade(const Biquad *sections, size_t nSections, size_t nChannels);
+
+   size_t GetChannels() const { return mnChannels; }
+
+   //! Change the coefficients but not the state, which must be compatible
+   void SetSections(const Biquad *sections);
+   void Reset();
+
+   //! Filter len samples of each channel; in and out may be the same
+   void Process(const float *const *in, float *const *out, size_t len);
+
+private:
+   void ProcessChannel(size_t channel,
+      const float *in, float *out, size_t len);
+   void ProcessPair(size_t channel,
+      const float *in0, const float *in1, float *out0, float *out1,
+      size_t len);
+
+   size_t mnSections{ 0 };
+   size_t mnChannels{ 0 };
+   //! B0, B1, B2, A1, A2 of each section
+   Doubles mCoeffs;
+   //! Previous inputs and outputs, x1, x2, y1, y2 of each section, with the
+   //! channels of each of those adjacent
+   Doubles mState;
+};
+
 #endif
@@ -10,30 +10,60 @@ Max Maisel
 
 #include "EBUR128.h"
 
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EBUR128_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 EBUR128::EBUR128(double rate, size_t channels)
    : mChannelCount(channels)
    , mRate(rate)
 {
-   mBlockSize = ceil(0.4 * mRate); // 400 ms blocks
-   mBlockOverlap = ceil(0.1 * mRate); // 100 ms overlap
+   mHopSize = ceil(0.1 * mRate); // 100 ms hops
    mLoudnessHist.reinit(HIST_BIN_COUNT, false);
-   mBlockRingBuffer.reinit(mBlockSize);
-   mWeightingFilter.reinit(mChannelCount, false);
+   mShortTermHist.reinit(HIST_BIN_COUNT, false);
+   mHopPower.reinit(SHORT_TERM_HOPS);
+   mWeightingFilter = BiquadCascade{
+      CalcWeightingFilter(mRate).get(), 2, mChannelCount };
+   mWeighted.reinit(mChannelCount);
+   mWeightedPtrs.reinit(mChannelCount);
+   mInputPtrs.reinit(mChannelCount);
+   mPeakHistory.reinit(mChannelCount);
    for(size_t channel = 0; channel < mChannelCount; ++channel)
-      mWeightingFilter[channel] = CalcWeightingFilter(mRate);
+   {
+      mWeighted[channel].reinit(CHUNK_SIZE);
+      mWeightedPtrs[channel] = mWeighted[channel].get();
+      mPeakHistory[channel].reinit(PEAK_TAPS - 1 + CHUNK_SIZE);
+   }
+
+   // Hann windowed sinc for four times oversampling.  Its center is the
+   // middle tap of phase 0, which therefore passes the samples unchanged.
+   const size_t length = 4 * PEAK_TAPS;
+   mPeakCoeffs.reinit(length);
+   for(size_t n = 0; n < length; ++n)
+   {
+      const double x = (double(n) - length / 2) / 4;
+      const double sinc = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+      const double window = 0.5 * (1 - cos(2 * M_PI * n / length));
+      mPeakCoeffs[n] = sinc * window;
+   }
 }
 
 void EBUR128::Initialize()
 {
-   mSampleCount = 0;
-   mBlockRingPos = 0;
-   mBlockRingSize = 0;
+   mHopCount = 0;
+   mPartialPower = 0;
+   mPartialLen = 0;
    memset(mLoudnessHist.get(), 0, HIST_BIN_COUNT*sizeof(long int));
+   memset(mShortTermHist.get(), 0, HIST_BIN_COUNT*sizeof(long int));
+   mWeightingFilter.Reset();
    for(size_t channel = 0; channel < mChannelCount; ++channel)
-   {
-      mWeightingFilter[channel][0].Reset();
-      mWeightingFilter[channel][1].Reset();
-   }
+      std::fill(mPeakHistory[channel].get(),
+         mPeakHistory[channel].get() + PEAK_TAPS - 1, 0.0f);
+   mTruePeak = 0;
 }
 
 // fs: sample rate
@@ -85,38 +115,126 @@ ArrayOf<Biquad> EBUR128::CalcWeightingFilter(double fs)
    return std::move(pBiquad);
 }
 
-void EBUR128::ProcessSampleFromChannel(float x_in, size_t channel)
+namespace {
+double SumOfSquares(const float *values, size_t len)
 {
-   double value;
-   value = mWeightingFilter[channel][0].ProcessOne(x_in);
-   value = mWeightingFilter[channel][1].ProcessOne(value);
-   if(channel == 0)
-      mBlockRingBuffer[mBlockRingPos] = value * value;
-   else
+   size_t i = 0;
+   double sum = 0;
+#ifdef EBUR128_USE_SSE2
+   __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+   for(; i + 4 <= len; i += 4)
    {
+      const auto v = _mm_loadu_ps(values + i);
+      const auto lo = _mm_cvtps_pd(v);
+      const auto hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+      sum0 = _mm_add_pd(sum0, _mm_mul_pd(lo, lo));
+      sum1 = _mm_add_pd(sum1, _mm_mul_pd(hi, hi));
+   }
+   double partial[2];
+   _mm_storeu_pd(partial, _mm_add_pd(sum0, sum1));
+   sum = partial[0] + partial[1];
+#endif
+   for(; i < len; ++i)
+      sum += double(values[i]) * values[i];
+   return sum;
+}
+}
+
+void EBUR128::ProcessSamples(const float *const *channels, size_t len)
+{
+   for(size_t offset = 0; offset < len; offset += CHUNK_SIZE)
+   {
+      const auto count = std::min(len - offset, size_t(CHUNK_SIZE));
+      for(size_t channel = 0; channel < mChannelCount; ++channel)
+         mInputPtrs[channel] = channels[channel] + offset;
+      UpdateTruePeak(count);
+      mWeightingFilter.Process(
+         mInputPtrs.get(), mWeightedPtrs.get(), count);
+
       // Add the power of additional channels to the power of first channel.
       // As a result, stereo tracks appear about 3 LUFS louder, as specified.
-      mBlockRingBuffer[mBlockRingPos] += value * value;
+      for(size_t pos = 0; pos < count;)
+      {
+         const auto n = std::min(count - pos, mHopSize - mPartialLen);
+         for(size_t channel = 0; channel < mChannelCount; ++channel)
+            mPartialPower += SumOfSquares(mWeighted[channel].get() + pos, n);
+         mPartialLen += n;
+         pos += n;
+         if(mPartialLen == mHopSize)
+            AddHop();
+      }
    }
 }
 
-void EBUR128::NextSample()
+void EBUR128::UpdateTruePeak(size_t len)
 {
-   ++mBlockRingPos;
-   ++mBlockRingSize;
-
-   if(mBlockRingPos % mBlockOverlap == 0)
+   const auto coeffs = mPeakCoeffs.get();
+   for(size_t channel = 0; channel < mChannelCount; ++channel)
    {
-      // A new full block of samples was submitted.
-      if(mBlockRingSize >= mBlockSize)
-         AddBlockToHistogram(mBlockSize);
+      // The history, then the new samples
+      const auto work = mPeakHistory[channel].get();
+      const auto samples = work + PEAK_TAPS - 1;
+      std::copy(mInputPtrs[channel], mInputPtrs[channel] + len, samples);
+
+      // Interpolate four points after each sample, one per phase; phase p
+      // of sample i is the sum over taps k of samples[i - k] * coeffs[4k + p],
+      // reaching back into the history
+      float peak = 0;
+#ifdef EBUR128_USE_SSE2
+      const auto signMask = _mm_set1_ps(-0.0f);
+      auto peaks = _mm_setzero_ps();
+      for(size_t i = 0; i < len; ++i)
+      {
+         auto sum = _mm_setzero_ps();
+         for(size_t k = 0; k < PEAK_TAPS; ++k)
+            sum = _mm_add_ps(sum, _mm_mul_ps(
+               _mm_set1_ps(work[PEAK_TAPS - 1 + i - k]), _mm_loadu_ps(coeffs + 4 * k)));
+         peaks = _mm_max_ps(peaks, _mm_andnot_ps(signMask, sum));
+      }
+      float lanes[4];
+      _mm_storeu_ps(lanes, peaks);
+      peak = *std::max_element(lanes, lanes + 4);
+#else
+      for(size_t i = 0; i < len; ++i)
+         for(size_t p = 0; p < 4; ++p)
+         {
+            float sum = 0;
+            for(size_t k = 0; k < PEAK_TAPS; ++k)
+               sum += work[PEAK_TAPS - 1 + i - k] * coeffs[4 * k + p];
+            peak = std::max(peak, std::fabs(sum));
+         }
+#endif
+      // The interpolation lags, so include the samples themselves, lest the
+      // last few be missed
+      for(size_t i = 0; i < len; ++i)
+         peak = std::max(peak, std::fabs(samples[i]));
+      mTruePeak = std::max<double>(mTruePeak, peak);
+
+      std::copy(samples + len - (PEAK_TAPS - 1), samples + len, work);
    }
-   // Close the ring.
-   if(mBlockRingPos == mBlockSize)
-      mBlockRingPos = 0;
-   ++mSampleCount;
 }
 
+void EBUR128::AddHop()
+{
+   mHopPower[mHopCount % SHORT_TERM_HOPS] = mPartialPower;
+   ++mHopCount;
+   mPartialPower = 0;
+   mPartialLen = 0;
+
+   // A new full block of samples was submitted.
+   if(mHopCount >= MOMENTARY_HOPS)
+      AddBlockToHistogram(mLoudnessHist, RecentPower(MOMENTARY_HOPS));
+   if(mHopCount >= SHORT_TERM_HOPS)
+      AddBlockToHistogram(mShortTermHist, RecentPower(SHORT_TERM_HOPS));
+}
+
+double EBUR128::RecentPower(size_t hops) const
+{
+   double power = 0;
+   for(size_t i = 1; i <= hops; ++i)
+      power += mHopPower[(mHopCount - i) % SHORT_TERM_HOPS];
+   return power / double(hops * mHopSize);
+}
 double EBUR128::IntegrativeLoudness()
 {
    // EBU R128: z_i = mean square without root
@@ -124,13 +242,23 @@ double EBUR128::IntegrativeLoudness()
    // Calculate Gamma_R from histogram.
    double sum_v;
    long int sum_c;
-   HistogramSums(0, sum_v, sum_c);
+   HistogramSums(mLoudnessHist, 0, sum_v, sum_c);
 
    // Handle incomplete block if no non-zero block was found.
    if(sum_c == 0)
    {
-      AddBlockToHistogram(mBlockRingSize);
-      HistogramSums(0, sum_v, sum_c);
+      // Take the unfinished hop and up to one block of samples before it
+      const auto hops = std::min(mHopCount, MOMENTARY_HOPS - 1);
+      double power = mPartialPower;
+      for(size_t i = 1; i <= hops; ++i)
+         power += mHopPower[(mHopCount - i) % SHORT_TERM_HOPS];
+      const auto len = hops * mHopSize + mPartialLen;
+      if(len > 0)
+         AddBlockToHistogram(mLoudnessHist, power / double(len));
+      HistogramSums(mLoudnessHist, 0, sum_v, sum_c);
+      if(sum_c == 0)
+         // Silence was processed.
+         return 0;
    }
 
    // Histogram values are simplified log(x^2) immediate values
@@ -142,7 +270,7 @@ double EBUR128::IntegrativeLoudness()
    size_t idx_R = round((Gamma_R - GAMMA_A) * double(HIST_BIN_COUNT) / -GAMMA_A - 1);
 
    // Apply Gamma_R threshold and calculate gated loudness (extent).
-   HistogramSums(idx_R+1, sum_v, sum_c);
+   HistogramSums(mLoudnessHist, idx_R+1, sum_v, sum_c);
    if(sum_c == 0)
       // Silence was processed.
       return 0;
@@ -150,7 +278,53 @@ double EBUR128::IntegrativeLoudness()
    return 0.8529037031 * sum_v / sum_c;
 }
 
-void EBUR128::HistogramSums(size_t start_idx, double& sum_v, long int& sum_c)
+double EBUR128::LoudnessRange()
+{
+   double sum_v;
+   long int sum_c;
+   HistogramSums(mShortTermHist, 0, sum_v, sum_c);
+   if(sum_c == 0)
+      return 0;
+
+   // EBU Tech 3342 gates short-term loudness 20 LU below its mean, in the
+   // same units as in IntegrativeLoudness()
+   double Gamma_R = log10(sum_v/sum_c) - 2;
+   const double pos_R =
+      round((Gamma_R - GAMMA_A) * double(HIST_BIN_COUNT) / -GAMMA_A - 1);
+   const size_t start_idx = pos_R < 0 ? 0 : size_t(pos_R) + 1;
+
+   long int total = 0;
+   for(size_t i = start_idx; i < HIST_BIN_COUNT; ++i)
+      total += mShortTermHist[i];
+   if(total == 0)
+      return 0;
+
+   // The range is between the 10th and the 95th percentiles
+   const auto lowCount = 0.10 * total, highCount = 0.95 * total;
+   size_t low = HIST_BIN_COUNT - 1, high = HIST_BIN_COUNT - 1;
+   long int count = 0;
+   bool foundLow = false;
+   for(size_t i = start_idx; i < HIST_BIN_COUNT; ++i)
+   {
+      count += mShortTermHist[i];
+      if(!foundLow && count >= lowCount)
+      {
+         low = i;
+         foundLow = true;
+      }
+      if(count >= highCount)
+      {
+         high = i;
+         break;
+      }
+   }
+
+   // Bins are log10() values, so scale by 10 for LU
+   return 10 * -GAMMA_A / double(HIST_BIN_COUNT) * (high - low);
+}
+
+void EBUR128::HistogramSums(const ArrayOf<long int> &hist,
+   size_t start_idx, double& sum_v, long int& sum_c)
 {
     double val;
     sum_v = 0;
@@ -158,38 +332,25 @@ void EBUR128::HistogramSums(size_t start_idx, double& sum_v, long int& sum_c)
     for(size_t i = start_idx; i < HIST_BIN_COUNT; ++i)
     {
        val = -GAMMA_A / double(HIST_BIN_COUNT) * (i+1) + GAMMA_A;
-       sum_v += pow(10, val) * mLoudnessHist[i];
-       sum_c += mLoudnessHist[i];
+       sum_v += pow(10, val) * hist[i];
+       sum_c += hist[i];
     }
 }
 
-/// Process new full block. Incomplete blocks shall be discarded
-/// according to the EBU R128 specification there is usually no need
-/// to call this on the last block.
-/// However, allow to override the block size if the audio to be
-/// processed is shorter than one block.
-void EBUR128::AddBlockToHistogram(size_t validLen)
+/// Count one block, of the given mean power, in hist.
+void EBUR128::AddBlockToHistogram(ArrayOf<long int> &hist, double power)
 {
-   // Reset mBlockRingSize to full state to avoid overflow.
-   // The actual value of mBlockRingSize does not matter
-   // since this is only used to detect if blocks are complete (>= mBlockSize).
-   mBlockRingSize = mBlockSize;
-
-   size_t idx;
-   double blockVal = 0;
-   for(size_t i = 0; i < validLen; ++i)
-      blockVal += mBlockRingBuffer[i];
-
    // Histogram values are simplified log10() immediate values
    // without -0.691 + 10*(...) to safe computing power. This is
    // possible because these constant cancel out anyway during the
    // following processing steps.
-   blockVal = log10(blockVal/double(validLen));
+   const double blockVal = log10(power);
    // log(blockVal) is within ]-inf, 1]
-   idx = round((blockVal - GAMMA_A) * double(HIST_BIN_COUNT) / -GAMMA_A - 1);
+   const double pos =
+      round((blockVal - GAMMA_A) * double(HIST_BIN_COUNT) / -GAMMA_A - 1);
 
-   // idx is within ]-inf, HIST_BIN_COUNT-1], discard indices below 0
+   // pos is within ]-inf, HIST_BIN_COUNT-1], discard indices below 0
    // as they are below the EBU R128 absolute threshold anyway.
-   if(idx < HIST_BIN_COUNT)
-      ++mLoudnessHist[idx];
+   if(pos >= 0 && pos < HIST_BIN_COUNT)
+      ++hist[size_t(pos)];
 }
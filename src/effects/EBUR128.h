@@ -16,6 +16,11 @@ Max Maisel
 #include "SampleFormat.h"
 
 /// \brief Implements EBU-R128 loudness measurement.
+/**
+ The weighted power of each 100 ms hop is summed once.  Momentary blocks of
+ 400 ms, gated for the integrated loudness, and short-term blocks of 3 s,
+ gated for the loudness range, are sums of the latest hops.
+ */
 class EBUR128
 {
 public:
@@ -26,34 +31,57 @@ public:
 
    static ArrayOf<Biquad> CalcWeightingFilter(double fs);
    void Initialize();
-   void ProcessSampleFromChannel(float x_in, size_t channel);
-   void NextSample();
+   //! Weight and measure len samples of each channel
+   void ProcessSamples(const float *const *channels, size_t len);
    double IntegrativeLoudness();
    inline double IntegrativeLoudnessToLUFS(double loudness)
       { return 10 * log10(loudness); }
+   //! Loudness range in LU per EBU Tech 3342, or 0 if too short or quiet
+   double LoudnessRange();
+   //! Largest magnitude of any channel, oversampled four times as in
+   //! ITU-R BS.1770 Annex 2; not in dB
+   double TruePeak() const { return mTruePeak; }
 
 private:
-   void HistogramSums(size_t start_idx, double& sum_v, long int& sum_c);
-   void AddBlockToHistogram(size_t validLen);
+   void AddHop();
+   //! Mean weighted power of the latest hops
+   double RecentPower(size_t hops) const;
+   void HistogramSums(const ArrayOf<long int> &hist,
+      size_t start_idx, double& sum_v, long int& sum_c);
+   void AddBlockToHistogram(ArrayOf<long int> &hist, double power);
+   void UpdateTruePeak(size_t len);
 
    static const size_t HIST_BIN_COUNT = 65536;
+   static const size_t CHUNK_SIZE = 4096;
+   static const size_t MOMENTARY_HOPS = 4;
+   static const size_t SHORT_TERM_HOPS = 30;
+   /// Taps of each phase of the true peak interpolator
+   static const size_t PEAK_TAPS = 12;
    /// EBU R128 absolute threshold
    static constexpr double GAMMA_A = (-70.0 + 0.691) / 10.0;
    ArrayOf<long int> mLoudnessHist;
-   Doubles mBlockRingBuffer;
-   size_t mSampleCount;
-   size_t mBlockRingPos;
-   size_t mBlockRingSize;
-   size_t mBlockSize;
-   size_t mBlockOverlap;
+   ArrayOf<long int> mShortTermHist;
+   /// Weighted power of the latest hops, a ring of SHORT_TERM_HOPS
+   Doubles mHopPower;
+   size_t mHopCount;
+   double mPartialPower;
+   size_t mPartialLen;
+   size_t mHopSize;
    size_t mChannelCount;
    double mRate;
 
-   /// This is be an array of arrays of the type
-   /// mWeightingFilter[CHANNEL][FILTER] with
-   /// CHANNEL = LEFT/RIGHT (0/1) and
-   /// FILTER  = HSF/HPF    (0/1)
-   ArrayOf<ArrayOf<Biquad>> mWeightingFilter;
+   /// The HSF and HPF filters for every channel
+   BiquadCascade mWeightingFilter;
+   /// Weighted samples of each channel, a chunk at a time
+   ArrayOf<Floats> mWeighted;
+   ArrayOf<float *> mWeightedPtrs;
+   ArrayOf<const float *> mInputPtrs;
+
+   /// Coefficient 4 * tap + phase of the interpolator
+   Floats mPeakCoeffs;
+   /// The last PEAK_TAPS - 1 samples of each channel, then room for a chunk
+   ArrayOf<Floats> mPeakHistory;
+   double mTruePeak;
 };
 
 #endif
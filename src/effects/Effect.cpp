@@ -21,6 +21,7 @@
 #include "../Experimental.h"
 
 #include <algorithm>
+#include <atomic>
 
 #include <wx/defs.h>
 #include <wx/sizer.h>
@@ -37,6 +38,7 @@
 #include "../Shuttle.h"
 #include "../ViewInfo.h"
 #include "../WaveTrack.h"
+#include "../WorkerPool.h"
 #include "../wxFileNameWrapper.h"
 #include "../widgets/ProgressDialog.h"
 #include "../tracks/playabletrack/wavetrack/ui/WaveTrackView.h"
@@ -44,6 +46,7 @@
 #include "../widgets/NumericTextCtrl.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/ErrorDialog.h"
+#include "RealtimeEffectManager.h"
 
 #include <unordered_map>
 
@@ -374,6 +377,13 @@ bool Effect::ProcessInitialize(sampleCount totalLen, ChannelNames chanMap)
    return true;
 }
 
+size_t Effect::ProcessSegment(sampleCount WXUNUSED(offset),
+   size_t WXUNUSED(history), float **WXUNUSED(inBlock), float **WXUNUSED(outBlock),
+   size_t WXUNUSED(blockLen))
+{
+   return 0;
+}
+
 bool Effect::ProcessFinalize()
 {
    if (mClient)
@@ -1409,6 +1419,33 @@ bool Effect::ProcessPass()
    int count = 0;
    bool clear = false;
 
+   // The realtime processors of the effect may be in use for playback
+   if (GetType() == EffectTypeProcess &&
+       mNumAudioIn == 1 && mNumAudioOut == 1 &&
+       ProcessesChannelsInParallel() &&
+       WorkerPool::Get().Concurrency() > 1 &&
+       !RealtimeEffectManager::Get().RealtimeIsActive())
+   {
+      std::vector< WaveTrack * > channels;
+      for (auto channel : mOutputTracks->Selected< WaveTrack >())
+         channels.push_back(channel);
+      if (channels.size() > 1)
+      {
+         bGoodResult = ProcessChannelsInParallel(channels);
+         if (bGoodResult)
+            for (auto t : mOutputTracks->Any())
+               if (!(track_cast< WaveTrack * >(t) && t->GetSelected()) &&
+                   t->IsSyncLockSelected())
+                  t->SyncLockAdjust(mT1, mT0 + mDuration);
+         return bGoodResult;
+      }
+   }
+
+   const auto history = GetSegmentHistory();
+   const bool segmented = GetType() == EffectTypeProcess &&
+      mNumAudioIn == 1 && mNumAudioOut == 1 && history >= 0 &&
+      WorkerPool::Get().Concurrency() > 1;
+
    const bool multichannel = mNumAudioIn > 1;
    auto range = multichannel
       ? mOutputTracks->Leaders()
@@ -1466,6 +1503,16 @@ bool Effect::ProcessPass()
          auto max = left->GetMaxBlockSize() * 2;
          mBlockSize = SetBlockSize(max);
 
+         // A channel longer than one buffer may be divided among threads
+         if (segmented && !right && len > max)
+         {
+            bGoodResult = ProcessTrackInSegments(
+               count, map, left, start, len, history);
+            if (bGoodResult)
+               count++;
+            return;
+         }
+
          // Calculate the buffer size to be at least the max rounded up to the clients
          // selected block size.
          const auto prevBufferSize = mBufferSize;
@@ -1541,6 +1588,195 @@ bool Effect::ProcessPass()
    return bGoodResult;
 }
 
+bool Effect::ProcessChannelsInParallel(
+   const std::vector< WaveTrack * > &channels)
+{
+   struct Channel {
+      WaveTrack *track;
+      sampleCount pos, end;
+      size_t count;
+      Floats inBuffer, outBuffer;
+   };
+   std::vector< Channel > states;
+   states.reserve(channels.size());
+
+   RealtimeInitialize();
+   auto cleanup = finally( [&] { RealtimeFinalize(); } );
+
+   sampleCount total = 0, done = 0;
+   for (auto track : channels)
+   {
+      sampleCount start, len;
+      GetBounds(*track, nullptr, &start, &len);
+      // Name the channel as ProcessPass does
+      ChannelName map[2]{ ChannelNameMono, ChannelNameEOL };
+      if (track->GetChannel() == Track::LeftChannel)
+         map[0] = ChannelNameFrontLeft;
+      else if (track->GetChannel() == Track::RightChannel)
+         map[0] = ChannelNameFrontRight;
+      if (!RealtimeAddProcessor(1, track->GetRate()) ||
+          !InitializeParallelProcessor(states.size(), map))
+         return false;
+      const auto size = track->GetMaxBlockSize();
+      states.push_back(
+         { track, start, start + len, 0, Floats{ size }, Floats{ size } });
+      total += len;
+   }
+   const auto blockSize = std::max< size_t >(1, GetBlockSize());
+
+   // Each round reads and writes a buffer of every unfinished channel on this
+   // thread, which alone may use the project database, and processes them
+   // on the worker pool in between.  So results are committed in track order,
+   // and progress covers all channels together.
+   std::vector< size_t > active;
+   while (true)
+   {
+      active.clear();
+      for (size_t ii = 0; ii < states.size(); ++ii)
+      {
+         auto &state = states[ii];
+         if (state.pos >= state.end)
+            continue;
+         state.count = limitSampleBufferSize(
+            state.track->GetMaxBlockSize(), state.end - state.pos);
+         state.track->Get((samplePtr) state.inBuffer.get(), floatSample,
+            state.pos, state.count);
+         active.push_back(ii);
+      }
+      if (active.empty())
+         break;
+
+      if (!RealtimeProcessStart())
+         return false;
+      try
+      {
+         WorkerPool::Get().ParallelFor(active.size(), [&](size_t jj) {
+            // The group number of a processor is its position in channels
+            const auto group = active[jj];
+            auto &state = states[group];
+            for (size_t offset = 0; offset < state.count; offset += blockSize)
+            {
+               float *in = state.inBuffer.get() + offset;
+               float *out = state.outBuffer.get() + offset;
+               RealtimeProcess(group, &in, &out,
+                  std::min(blockSize, state.count - offset));
+            }
+         });
+      }
+      catch( const AudacityException & WXUNUSED(e) )
+      {
+         throw;
+      }
+      catch(...)
+      {
+         // As in ProcessTrack, for exceptions from third-party code
+         return false;
+      }
+      if (!RealtimeProcessEnd())
+         return false;
+
+      for (auto ii : active)
+      {
+         auto &state = states[ii];
+         state.track->Set((samplePtr) state.outBuffer.get(), floatSample,
+            state.pos, state.count);
+         state.pos += state.count;
+         done += state.count;
+      }
+
+      if (TotalProgress(done.as_double() / total.as_double()))
+         return false;
+   }
+
+   return true;
+}
+
+bool Effect::ProcessTrackInSegments(int count,
+                                    ChannelNames map,
+                                    WaveTrack *track,
+                                    sampleCount start,
+                                    sampleCount len,
+                                    size_t history)
+{
+   bool rc = true;
+
+   if (!ProcessInitialize(len, map))
+   {
+      return false;
+   }
+
+   { // Start scope for cleanup
+   auto cleanup = finally( [&] {
+      if (!ProcessFinalize())
+      {
+         rc = false;
+      }
+   } );
+
+   // Each round reads a segment per thread, preceded by history, on this
+   // thread, which alone may use the project database; processes the
+   // segments concurrently; and writes the output back here
+   auto &pool = WorkerPool::Get();
+   const auto segmentLen = track->GetMaxBlockSize() * 2;
+   const auto nSegments = pool.Concurrency();
+   Floats inBuffer{ history + nSegments * segmentLen };
+   Floats outBuffer{ nSegments * segmentLen };
+
+   auto pos = start;
+   const auto end = start + len;
+   while (pos < end)
+   {
+      // Input before pos that the first segment may read
+      const auto preroll =
+         limitSampleBufferSize(history, pos - start);
+      const auto roundLen =
+         limitSampleBufferSize(nSegments * segmentLen, end - pos);
+      track->Get((samplePtr) inBuffer.get(), floatSample,
+         pos - preroll, preroll + roundLen);
+
+      const auto roundSegments = (roundLen + segmentLen - 1) / segmentLen;
+      std::atomic< bool > incomplete{ false };
+      try
+      {
+         pool.ParallelFor(roundSegments, [&](size_t ii) {
+            const auto first = ii * segmentLen;
+            float *in = inBuffer.get() + preroll + first;
+            float *out = outBuffer.get() + first;
+            const auto blockLen = std::min(segmentLen, roundLen - first);
+            const auto processed = ProcessSegment(
+               pos - start + first, std::min(history, preroll + first),
+               &in, &out, blockLen);
+            if (processed != blockLen)
+               incomplete = true;
+         });
+      }
+      catch( const AudacityException & WXUNUSED(e) )
+      {
+         throw;
+      }
+      catch(...)
+      {
+         // As in ProcessTrack, for exceptions from third-party code
+         return false;
+      }
+      if (incomplete)
+      {
+         return false;
+      }
+
+      track->Set((samplePtr) outBuffer.get(), floatSample, pos, roundLen);
+      pos += roundLen;
+
+      if (TrackProgress(count, (pos - start).as_double() / len.as_double()))
+      {
+         return false;
+      }
+   }
+
+   } // End scope for cleanup
+   return rc;
+}
+
 bool Effect::ProcessTrack(int count,
                           ChannelNames map,
                           WaveTrack *left,
@@ -300,6 +300,28 @@ protected:
    // Actually do the effect here.
    virtual bool Process();
    virtual bool ProcessPass();
+   // Return true only if the processors made by RealtimeAddProcessor are
+   // independent of each other and of the master, add no latency, and may run
+   // on different threads at once.  Then ProcessPass may process several
+   // channels at a time with them.
+   virtual bool ProcessesChannelsInParallel() { return false; }
+   // Called then after RealtimeAddProcessor for each channel, with the
+   // names that ProcessInitialize would be given for it, so the processor
+   // can be set up as the master would be for that channel
+   virtual bool InitializeParallelProcessor(
+      int WXUNUSED(group), ChannelNames WXUNUSED(chanMap)) { return true; }
+   // Return a number of samples only if each output sample depends on no
+   // more than the input sample, that many samples before it, and its
+   // position in the selection.  Then ProcessPass may divide a long channel
+   // into segments and pass them to ProcessSegment concurrently.  The
+   // default, -1, means there is no such bound.
+   virtual int GetSegmentHistory() { return -1; }
+   // Process blockLen samples starting offset samples into the selection.
+   // The history samples of input before inBlock[0] may be read too; that
+   // is GetSegmentHistory(), or less near the start of the selection.  Must
+   // not depend on other calls, which may run on other threads at once.
+   virtual size_t ProcessSegment(sampleCount offset, size_t history,
+      float **inBlock, float **outBlock, size_t blockLen);
    virtual bool InitPass1();
    virtual bool InitPass2();
    virtual int GetPass();
@@ -495,6 +517,15 @@ protected:
                      FloatBuffers &outBuffer,
                      ArrayOf< float * > &inBufPos,
                      ArrayOf< float *> &outBufPos);
+   // Driver for ProcessesChannelsInParallel()
+   bool ProcessChannelsInParallel(const std::vector< WaveTrack * > &channels);
+   // Driver for GetSegmentHistory()
+   bool ProcessTrackInSegments(int count,
+                               ChannelNames map,
+                               WaveTrack *track,
+                               sampleCount start,
+                               sampleCount len,
+                               size_t history);
 
  //
  // private data
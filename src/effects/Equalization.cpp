@@ -55,6 +55,7 @@
 #include "../Audacity.h"
 #include "Equalization.h"
 #include "LoadEffects.h"
+#include "PartitionedConvolver.h"
 
 #include "../Experimental.h"
 
@@ -115,10 +116,6 @@
 
 #include "../widgets/FileDialog/FileDialog.h"
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-#include "Equalization48x.h"
-#endif
-
 
 enum
 {
@@ -136,14 +133,6 @@ enum
    ID_Curve,
    ID_Manage,
    ID_Delete,
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   ID_DefaultMath,
-   ID_SSE,
-   ID_SSEThreaded,
-   ID_AVX,
-   ID_AVXThreaded,
-   ID_Bench,
-#endif
    ID_Slider,   // needs to come last
 };
 
@@ -232,19 +221,10 @@ BEGIN_EVENT_TABLE(EffectEqualization, wxEvtHandler)
    EVT_CHECKBOX(ID_Linear, EffectEqualization::OnLinFreq)
    EVT_CHECKBOX(ID_Grid, EffectEqualization::OnGridOnOff)
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   EVT_RADIOBUTTON(ID_DefaultMath, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_SSE, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_SSEThreaded, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_AVX, EffectEqualization::OnProcessingRadio)
-   EVT_RADIOBUTTON(ID_AVXThreaded, EffectEqualization::OnProcessingRadio)
-   EVT_BUTTON(ID_Bench, EffectEqualization::OnBench)
-#endif
 END_EVENT_TABLE()
 
 EffectEqualization::EffectEqualization(int Options)
-   : mFFTBuffer{ windowSize }
-   , mFilterFuncR{ windowSize }
+   : mFilterFuncR{ windowSize }
    , mFilterFuncI{ windowSize }
 {
    mOptions = Options;
@@ -254,8 +234,6 @@ EffectEqualization::EffectEqualization(int Options)
    mPanel = NULL;
    mMSlider = NULL;
 
-   hFFT = GetFFT(windowSize);
-
    SetLinearEffectFlag(true);
 
    mM = DEF_FilterLength;
@@ -301,16 +279,6 @@ EffectEqualization::EffectEqualization(int Options)
    mWhenSliders[NUMBER_OF_BANDS] = 1.;
    mEQVals[NUMBER_OF_BANDS] = 0.;
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   bool useSSE;
-   GetPrivateConfig(GetCurrentSettingsGroup(), wxT("/SSE/GUI"), useSSE, false);
-   if(useSSE && !mEffectEqualization48x)
-      mEffectEqualization48x = std::make_unique<EffectEqualization48x>();
-   else if(!useSSE)
-      mEffectEqualization48x.reset();
-   mBench=false;
-#endif
-
    // We expect these Hi and Lo frequences to be overridden by Init().
    // Don't use inputTracks().  See bug 2321.
 #if 0
@@ -708,40 +676,54 @@ bool EffectEqualization::Init()
 
 bool EffectEqualization::Process()
 {
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   if(mEffectEqualization48x) {
-      if(mBench) {
-         mBench=false;
-         return mEffectEqualization48x->Benchmark(this);
-      }
-      else
-         return mEffectEqualization48x->Process(this);
-   }
-#endif
    this->CopyInputTracks(); // Set up mOutputTracks.
    CalcFilter();
    bool bGoodResult = true;
 
    int count = 0;
-   for( auto track : mOutputTracks->Selected< WaveTrack >() ) {
-      double trackStart = track->GetStartTime();
-      double trackEnd = track->GetEndTime();
-      double t0 = mT0 < trackStart? trackStart: mT0;
-      double t1 = mT1 > trackEnd? trackEnd: mT1;
-
-      if (t1 > t0) {
-         auto start = track->TimeToLongSamples(t0);
-         auto end = track->TimeToLongSamples(t1);
-         auto len = end - start;
-
-         if (!ProcessOne(count, track, start, len))
-         {
-            bGoodResult = false;
-            break;
+   for( auto leader : mOutputTracks->SelectedLeaders< WaveTrack >() ) {
+      // Channels with the same extent are filtered together
+      std::vector< WaveTrack * > batch;
+      sampleCount batchStart, batchLen;
+      auto processBatch = [&]{
+         if (batch.empty())
+            return true;
+         bool result = ProcessOne(count, batch, batchStart, batchLen);
+         count += batch.size();
+         batch.clear();
+         return result;
+      };
+
+      for( auto track : TrackList::Channels( leader ) ) {
+         double trackStart = track->GetStartTime();
+         double trackEnd = track->GetEndTime();
+         double t0 = mT0 < trackStart? trackStart: mT0;
+         double t1 = mT1 > trackEnd? trackEnd: mT1;
+
+         if (t1 > t0) {
+            auto start = track->TimeToLongSamples(t0);
+            auto end = track->TimeToLongSamples(t1);
+            auto len = end - start;
+
+            if (!batch.empty() && (start != batchStart || len != batchLen)
+                && !processBatch())
+            {
+               bGoodResult = false;
+               break;
+            }
+            batch.push_back(track);
+            batchStart = start;
+            batchLen = len;
          }
+         else
+            count++;
       }
 
-      count++;
+      if (!bGoodResult || !processBatch())
+      {
+         bGoodResult = false;
+         break;
+      }
    }
 
    this->ReplaceProcessedTracks(bGoodResult);
@@ -1084,63 +1066,6 @@ void EffectEqualization::PopulateOrExchange(ShuttleGui & S)
    }
    S.EndMultiColumn();
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   if (mEffectEqualization48x)
-   {
-      // -------------------------------------------------------------------
-      // ROW 6: Processing routine selection
-      // -------------------------------------------------------------------
-
-      // Column 1 is blank
-      S.AddSpace(1, 1);
-
-      S.StartHorizontalLay();
-      {
-         S.AddUnits(XO("&Processing: "));
-
-         // update the control state
-         int mathPath = EffectEqualization48x::GetMathPath();
-         int value =
-            (mathPath & MATH_FUNCTION_SSE)
-            ? (mathPath & MATH_FUNCTION_THREADED)
-               ? 2
-               : 1
-            : false // (mathPath & MATH_FUNCTION_AVX) // not implemented
-               ? (mathPath & MATH_FUNCTION_THREADED)
-                  ? 4
-                  : 3
-               : 0;
-
-         mMathProcessingType[0] = S.Id(ID_DefaultMath)
-            .AddRadioButton(XXO("D&efault"),
-                            0, value);
-         mMathProcessingType[1] = S.Id(ID_SSE)
-            .Disable(!EffectEqualization48x::GetMathCaps()->SSE)
-            .AddRadioButtonToGroup(XXO("&SSE"),
-                                   1, value);
-         mMathProcessingType[2] = S.Id(ID_SSEThreaded)
-            .Disable(!EffectEqualization48x::GetMathCaps()->SSE)
-            .AddRadioButtonToGroup(XXO("SSE &Threaded"),
-                                   2, value);
-         mMathProcessingType[3] = S.Id(ID_AVX)
-            // not implemented
-            .Disable(true /* !EffectEqualization48x::GetMathCaps()->AVX */)
-            .AddRadioButtonToGroup(XXO("A&VX"),
-                                   3, value);
-         mMathProcessingType[4] = S.Id(ID_AVXThreaded)
-            // not implemented
-            .Disable(true /* !EffectEqualization48x::GetMathCaps()->AVX */)
-            .AddRadioButtonToGroup(XXO("AV&X Threaded"),
-                                   4, value);
-         S.Id(ID_Bench).AddButton(XXO("&Bench"));
-      }
-      S.EndHorizontalLay();
-
-      // Column 3 is blank
-      S.AddSpace(1, 1);
-   }
-#endif
-
    mUIParent->SetAutoLayout(false);
    if( mOptions != kEqOptionGraphic)
       mUIParent->Layout();
@@ -1285,149 +1210,142 @@ bool EffectEqualization::TransferDataFromWindow()
 
 // EffectEqualization implementation
 
-bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
-                                    sampleCount start, sampleCount len)
+bool EffectEqualization::ProcessOne(int count,
+   const std::vector< WaveTrack * > &channels,
+   sampleCount start, sampleCount len)
 {
-   // create a NEW WaveTrack to hold all of the output, including 'tails' each end
-   auto output = t->EmptyCopy();
-   t->ConvertToSampleFormat( floatSample );
+   const auto nChannels = channels.size();
 
-   wxASSERT(mM - 1 < windowSize);
-   size_t L = windowSize - (mM - 1);   //Process L samples at a go
-   auto s = start;
-   auto idealBlockLen = t->GetMaxBlockSize() * 4;
-   if (idealBlockLen % L != 0)
-      idealBlockLen += (L - (idealBlockLen % L));
+   // create NEW WaveTracks to hold all of the output, including 'tails' each end
+   std::vector< std::shared_ptr< WaveTrack > > outputs;
+   for (auto t : channels) {
+      outputs.push_back(t->EmptyCopy());
+      t->ConvertToSampleFormat( floatSample );
+   }
 
-   Floats buffer{ idealBlockLen };
+   // All the channels share the filter, and each may run on its own thread
+   PartitionedConvolver convolver{ mFilterTaps.get(), mM, nChannels };
+   auto s = start;
+   auto idealBlockLen = channels[0]->GetMaxBlockSize() * 4;
 
-   Floats window1{ windowSize };
-   Floats window2{ windowSize };
-   float *thisWindow = window1.get();
-   float *lastWindow = window2.get();
+   ArraysOf<float> buffers{ nChannels, idealBlockLen };
+   std::vector< float * > pointers;
+   for (size_t i = 0; i < nChannels; i++)
+      pointers.push_back(buffers[i].get());
 
    auto originalLen = len;
 
-   for(size_t i = 0; i < windowSize; i++)
-      lastWindow[i] = 0;
+   // Output is the whole convolution, with mM - 1 samples of 'tail', but
+   // the convolver delays it
+   sampleCount remaining = len + (mM - 1);
+   size_t toSkip = convolver.GetLatency();
 
    TrackProgress(count, 0.);
    bool bLoopSuccess = true;
-   size_t wcopy = 0;
-   int offset = (mM - 1) / 2;
 
-   while (len != 0)
+   while (remaining > 0)
    {
-      auto block = limitSampleBufferSize( idealBlockLen, len );
-
-      t->Get((samplePtr)buffer.get(), floatSample, s, block);
-
-      for(size_t i = 0; i < block; i += L)   //go through block in lumps of length L
-      {
-         wcopy = std::min <size_t> (L, block - i);
-         for(size_t j = 0; j < wcopy; j++)
-            thisWindow[j] = buffer[i+j];   //copy the L (or remaining) samples
-         for(auto j = wcopy; j < windowSize; j++)
-            thisWindow[j] = 0;   //this includes the padding
-
-         Filter(windowSize, thisWindow);
+      size_t block;
+      if (len > 0) {
+         block = limitSampleBufferSize( idealBlockLen, len );
+         for (size_t i = 0; i < nChannels; i++)
+            channels[i]->Get((samplePtr)pointers[i], floatSample, s, block);
+      }
+      else {
+         // Input is exhausted; push the tail out with silence
+         block = limitSampleBufferSize( idealBlockLen, remaining + toSkip );
+         for (size_t i = 0; i < nChannels; i++)
+            std::fill(pointers[i], pointers[i] + block, 0.0f);
+      }
 
-         // Overlap - Add
-         for(size_t j = 0; (j < mM - 1) && (j < wcopy); j++)
-            buffer[i+j] = thisWindow[j] + lastWindow[L + j];
-         for(size_t j = mM - 1; j < wcopy; j++)
-            buffer[i+j] = thisWindow[j];
+      convolver.Process(pointers.data(), pointers.data(), block, true);
 
-         std::swap( thisWindow, lastWindow );
-      }  //next i, lump of this block
+      const auto skip = std::min(toSkip, block);
+      toSkip -= skip;
+      const auto produced = limitSampleBufferSize( block - skip, remaining );
+      for (size_t i = 0; i < nChannels; i++)
+         outputs[i]->Append(
+            (samplePtr)(pointers[i] + skip), floatSample, produced);
+      remaining -= produced;
 
-      output->Append((samplePtr)buffer.get(), floatSample, block);
-      len -= block;
-      s += block;
+      if (len > 0) {
+         len -= block;
+         s += block;
 
-      if (TrackProgress(count, ( s - start ).as_double() /
-                        originalLen.as_double()))
-      {
-         bLoopSuccess = false;
-         break;
+         if (TrackProgress(count, nChannels * ( s - start ).as_double() /
+                           originalLen.as_double()))
+         {
+            bLoopSuccess = false;
+            break;
+         }
       }
    }
 
    if(bLoopSuccess)
    {
-      // mM-1 samples of 'tail' left in lastWindow, get them now
-      if(wcopy < (mM - 1)) {
-         // Still have some overlap left to process
-         // (note that lastWindow and thisWindow have been exchanged at this point
-         //  so that 'thisWindow' is really the window prior to 'lastWindow')
-         size_t j = 0;
-         for(; j < mM - 1 - wcopy; j++)
-            buffer[j] = lastWindow[wcopy + j] + thisWindow[L + wcopy + j];
-         // And fill in the remainder after the overlap
-         for( ; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      } else {
-         for(size_t j = 0; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      }
-      output->Append((samplePtr)buffer.get(), floatSample, mM - 1);
-      output->Flush();
-
-      // now move the appropriate bit of the output back to the track
-      // (this could be enhanced in the future to use the tails)
-      double offsetT0 = t->LongSamplesToTime(offset);
-      double lenT = t->LongSamplesToTime(originalLen);
-      // 'start' is the sample offset in 't', the passed in track
-      // 'startT' is the equivalent time value
-      // 'output' starts at zero
-      double startT = t->LongSamplesToTime(start);
-
-      //output has one waveclip for the total length, even though
-      //t might have whitespace separating multiple clips
-      //we want to maintain the original clip structure, so
-      //only paste the intersections of the NEW clip.
-
-      //Find the bits of clips that need replacing
-      std::vector<std::pair<double, double> > clipStartEndTimes;
-      std::vector<std::pair<double, double> > clipRealStartEndTimes; //the above may be truncated due to a clip being partially selected
-      for (const auto &clip : t->GetClips())
+      int offset = (mM - 1) / 2;
+      for (size_t iChannel = 0; iChannel < nChannels; iChannel++)
       {
-         double clipStartT;
-         double clipEndT;
-
-         clipStartT = clip->GetStartTime();
-         clipEndT = clip->GetEndTime();
-         if( clipEndT <= startT )
-            continue;   // clip is not within selection
-         if( clipStartT >= startT + lenT )
-            continue;   // clip is not within selection
-
-         //save the actual clip start/end so that we can rejoin them after we paste.
-         clipRealStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
-
-         if( clipStartT < startT )  // does selection cover the whole clip?
-            clipStartT = startT; // don't copy all the NEW clip
-         if( clipEndT > startT + lenT )  // does selection cover the whole clip?
-            clipEndT = startT + lenT; // don't copy all the NEW clip
-
-         //save them
-         clipStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
-      }
-      //now go thru and replace the old clips with NEW
-      for(unsigned int i = 0; i < clipStartEndTimes.size(); i++)
-      {
-         //remove the old audio and get the NEW
-         t->Clear(clipStartEndTimes[i].first,clipStartEndTimes[i].second);
-         auto toClipOutput = output->Copy(clipStartEndTimes[i].first-startT+offsetT0,clipStartEndTimes[i].second-startT+offsetT0);
-         //put the processed audio in
-         t->Paste(clipStartEndTimes[i].first, toClipOutput.get());
-         //if the clip was only partially selected, the Paste will have created a split line.  Join is needed to take care of this
-         //This is not true when the selection is fully contained within one clip (second half of conditional)
-         if( (clipRealStartEndTimes[i].first  != clipStartEndTimes[i].first ||
-            clipRealStartEndTimes[i].second != clipStartEndTimes[i].second) &&
-            !(clipRealStartEndTimes[i].first <= startT &&
-            clipRealStartEndTimes[i].second >= startT+lenT) )
-            t->Join(clipRealStartEndTimes[i].first,clipRealStartEndTimes[i].second);
+         auto t = channels[iChannel];
+         auto &output = outputs[iChannel];
+         output->Flush();
+
+         // now move the appropriate bit of the output back to the track
+         // (this could be enhanced in the future to use the tails)
+         double offsetT0 = t->LongSamplesToTime(offset);
+         double lenT = t->LongSamplesToTime(originalLen);
+         // 'start' is the sample offset in 't', the passed in track
+         // 'startT' is the equivalent time value
+         // 'output' starts at zero
+         double startT = t->LongSamplesToTime(start);
+
+         //output has one waveclip for the total length, even though
+         //t might have whitespace separating multiple clips
+         //we want to maintain the original clip structure, so
+         //only paste the intersections of the NEW clip.
+
+         //Find the bits of clips that need replacing
+         std::vector<std::pair<double, double> > clipStartEndTimes;
+         std::vector<std::pair<double, double> > clipRealStartEndTimes; //the above may be truncated due to a clip being partially selected
+         for (const auto &clip : t->GetClips())
+         {
+            double clipStartT;
+            double clipEndT;
+
+            clipStartT = clip->GetStartTime();
+            clipEndT = clip->GetEndTime();
+            if( clipEndT <= startT )
+               continue;   // clip is not within selection
+            if( clipStartT >= startT + lenT )
+               continue;   // clip is not within selection
+
+            //save the actual clip start/end so that we can rejoin them after we paste.
+            clipRealStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
+
+            if( clipStartT < startT )  // does selection cover the whole clip?
+               clipStartT = startT; // don't copy all the NEW clip
+            if( clipEndT > startT + lenT )  // does selection cover the whole clip?
+               clipEndT = startT + lenT; // don't copy all the NEW clip
+
+            //save them
+            clipStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
+         }
+         //now go thru and replace the old clips with NEW
+         for(unsigned int i = 0; i < clipStartEndTimes.size(); i++)
+         {
+            //remove the old audio and get the NEW
+            t->Clear(clipStartEndTimes[i].first,clipStartEndTimes[i].second);
+            auto toClipOutput = output->Copy(clipStartEndTimes[i].first-startT+offsetT0,clipStartEndTimes[i].second-startT+offsetT0);
+            //put the processed audio in
+            t->Paste(clipStartEndTimes[i].first, toClipOutput.get());
+            //if the clip was only partially selected, the Paste will have created a split line.  Join is needed to take care of this
+            //This is not true when the selection is fully contained within one clip (second half of conditional)
+            if( (clipRealStartEndTimes[i].first  != clipStartEndTimes[i].first ||
+               clipRealStartEndTimes[i].second != clipStartEndTimes[i].second) &&
+               !(clipRealStartEndTimes[i].first <= startT &&
+               clipRealStartEndTimes[i].second >= startT+lenT) )
+               t->Join(clipRealStartEndTimes[i].first,clipRealStartEndTimes[i].second);
+         }
       }
    }
 
@@ -1541,37 +1459,16 @@ bool EffectEqualization::CalcFilter()
       outr[i]=0.;
    }
 
+   //keep the taps for the convolver
+   mFilterTaps.reinit(mM);
+   std::copy(outr.get(), outr.get() + mM, mFilterTaps.get());
+
    //Back to the frequency domain so we can use it
    RealFFT(mWindowSize, outr.get(), mFilterFuncR.get(), mFilterFuncI.get());
 
    return TRUE;
 }
 
-void EffectEqualization::Filter(size_t len, float *buffer)
-{
-   float re,im;
-   // Apply FFT
-   RealFFTf(buffer, hFFT.get());
-   //FFT(len, false, inr, NULL, outr, outi);
-
-   // Apply filter
-   // DC component is purely real
-   mFFTBuffer[0] = buffer[0] * mFilterFuncR[0];
-   for(size_t i = 1; i < (len / 2); i++)
-   {
-      re=buffer[hFFT->BitReversed[i]  ];
-      im=buffer[hFFT->BitReversed[i]+1];
-      mFFTBuffer[2*i  ] = re*mFilterFuncR[i] - im*mFilterFuncI[i];
-      mFFTBuffer[2*i+1] = re*mFilterFuncI[i] + im*mFilterFuncR[i];
-   }
-   // Fs/2 component is purely real
-   mFFTBuffer[1] = buffer[1] * mFilterFuncR[len/2];
-
-   // Inverse FFT and normalization
-   InverseRealFFTf(mFFTBuffer.get(), hFFT.get());
-   ReorderToTime(hFFT.get(), mFFTBuffer.get(), buffer);
-}
-
 //
 // Load external curves with fallback to default, then message
 //
@@ -3017,35 +2914,6 @@ void EffectEqualization::OnLinFreq(wxCommandEvent & WXUNUSED(event))
    ForceRecalc();
 }
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-
-void EffectEqualization::OnProcessingRadio(wxCommandEvent & event)
-{
-   int testEvent=event.GetId();
-   switch(testEvent)
-   {
-   case ID_DefaultMath: EffectEqualization48x::SetMathPath(MATH_FUNCTION_ORIGINAL);
-      break;
-   case ID_SSE: EffectEqualization48x::SetMathPath(MATH_FUNCTION_SSE);
-      break;
-   case ID_SSEThreaded: EffectEqualization48x::SetMathPath(MATH_FUNCTION_THREADED | MATH_FUNCTION_SSE);
-      break;
-   case ID_AVX: testEvent = 2;
-      break;
-   case ID_AVXThreaded: testEvent = 2;
-      break;
-   }
-
-};
-
-void EffectEqualization::OnBench( wxCommandEvent & event)
-{
-   mBench=true;
-   // OnOk(event);
-}
-
-#endif
-
 //----------------------------------------------------------------------------
 // EqualizationPanel
 //----------------------------------------------------------------------------
@@ -87,10 +87,6 @@ public:
 
 using EQCurveArray = std::vector<EQCurve>;
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-class EffectEqualization48x;
-#endif
-
 class EffectEqualization : public Effect,
                            public XMLTagHandler
 {
@@ -147,10 +143,9 @@ private:
    // low range of human hearing
    enum {loFreqI=20};
 
-   bool ProcessOne(int count, WaveTrack * t,
+   bool ProcessOne(int count, const std::vector< WaveTrack * > &channels,
                    sampleCount start, sampleCount len);
    bool CalcFilter();
-   void Filter(size_t len, float *buffer);
    
    void Flatten();
    void ForceRecalc();
@@ -200,15 +195,11 @@ private:
    void OnInvert( wxCommandEvent & event );
    void OnGridOnOff( wxCommandEvent & event );
    void OnLinFreq( wxCommandEvent & event );
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   void OnProcessingRadio( wxCommandEvent & event );
-   void OnBench( wxCommandEvent & event );
-#endif
 
 private:
    int mOptions;
-   HFFT hFFT;
-   Floats mFFTBuffer, mFilterFuncR, mFilterFuncI;
+   Floats mFilterFuncR, mFilterFuncI;
+   Floats mFilterTaps;
    size_t mM;
    wxString mCurveName;
    bool mLin;
@@ -237,12 +228,6 @@ private:
    std::unique_ptr<Envelope> mLogEnvelope, mLinEnvelope;
    Envelope *mEnvelope;
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   bool mBench;
-   std::unique_ptr<EffectEqualization48x> mEffectEqualization48x;
-   friend class EffectEqualization48x;
-#endif
-
    wxSizer *szrC;
    wxSizer *szrG;
    wxSizer *szrV;
@@ -272,11 +257,6 @@ private:
    wxSlider *mdBMaxSlider;
    wxSlider *mSliders[NUMBER_OF_BANDS];
 
-#ifdef EXPERIMENTAL_EQ_SSE_THREADED
-   wxRadioButton *mMathProcessingType[5]; // default, sse, sse threaded, AVX, AVX threaded (note AVX is not implemented yet
-   wxBoxSizer *szrM;
-#endif
-
    DECLARE_EVENT_TABLE()
 
    friend class EqualizationPanel;
@@ -87,16 +87,33 @@ bool EffectFade::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames
 }
 
 size_t EffectFade::ProcessBlock(float **inBlock, float **outBlock, size_t blockLen)
+{
+   ProcessSegment(mSample, 0, inBlock, outBlock, blockLen);
+   mSample += blockLen;
+
+   return blockLen;
+}
+
+// Effect implementation
+
+int EffectFade::GetSegmentHistory()
+{
+   return 0;
+}
+
+size_t EffectFade::ProcessSegment(sampleCount offset,
+   size_t WXUNUSED(history), float **inBlock, float **outBlock, size_t blockLen)
 {
    float *ibuf = inBlock[0];
    float *obuf = outBlock[0];
+   auto sample = offset;
 
    if (mFadeIn)
    {
       for (decltype(blockLen) i = 0; i < blockLen; i++)
       {
          obuf[i] =
-            (ibuf[i] * ( mSample++ ).as_float()) /
+            (ibuf[i] * ( sample++ ).as_float()) /
             mSampleCnt.as_float();
       }
    }
@@ -105,7 +122,7 @@ size_t EffectFade::ProcessBlock(float **inBlock, float **outBlock, size_t blockL
       for (decltype(blockLen) i = 0; i < blockLen; i++)
       {
          obuf[i] = (ibuf[i] *
-                    ( mSampleCnt - 1 - mSample++ ).as_float()) /
+                    ( mSampleCnt - 1 - sample++ ).as_float()) /
             mSampleCnt.as_float();
       }
    }
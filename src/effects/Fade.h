@@ -36,6 +36,12 @@ public:
    bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
 
+   // Effect implementation
+
+   int GetSegmentHistory() override;
+   size_t ProcessSegment(sampleCount offset, size_t history,
+      float **inBlock, float **outBlock, size_t blockLen) override;
+
 private:
    // EffectFade implementation
 
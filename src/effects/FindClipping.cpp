@@ -23,7 +23,10 @@
 #include "FindClipping.h"
 #include "LoadEffects.h"
 
+#include <algorithm>
+#include <cmath>
 #include <math.h>
+#include <vector>
 
 #include <wx/intl.h>
 
@@ -33,7 +36,10 @@
 #include "../widgets/AudacityMessageBox.h"
 
 #include "../LabelTrack.h"
+#include "../MagnitudeRuns.h"
+#include "../SampleBlock.h"
 #include "../WaveTrack.h"
+#include "../WorkerPool.h"
 
 // Define keys, defaults, minimums, and maximums for the effect parameters
 //
@@ -41,6 +47,81 @@
 Param( Start,  int,  wxT("Duty Cycle Start"), 3,    1,    INT_MAX, 1   );
 Param( Stop,   int,  wxT("Duty Cycle End"),   3,    1,    INT_MAX, 1   );
 
+namespace {
+
+// Samples summarized by each frame of SampleBlock::GetSummary256()
+constexpr size_t SummaryFrame = 256;
+
+// Consecutive clipped samples of a channel, [start, end)
+struct ClippedRun
+{
+   sampleCount start, end;
+};
+
+using ClippedRuns = std::vector<ClippedRun>;
+
+// A sample x is clipped when fabs(x) >= MAX_AUDIO.  The threshold here is
+// from MagnitudeRuns::RoundUp(), so that comparisons of floats with it agree
+// exactly with MAX_AUDIO.
+inline bool MayClip(float min, float max, float threshold)
+{
+   return max >= threshold || min <= -threshold;
+}
+
+// Find the clipped runs of the piece, reading samples only if the summaries
+// of the block do not rule clipping out.  This runs on worker threads.
+void FindClippedRuns(const WaveTrack::BlockPiece &piece, ClippedRuns &runs,
+   float threshold)
+{
+   const auto &pBlock = piece.pBlock;
+
+   // Most blocks are cleared by their extremes, which are in memory
+   const auto extremes = pBlock->GetMinMaxRMS();
+   if (!MayClip(extremes.min, extremes.max, threshold))
+      return;
+
+   // Else by those of the frames of the summary; read the samples once if
+   // some frame may clip, and scan only such frames
+   const auto pieceEnd = piece.offset + piece.len;
+   const auto firstFrame = piece.offset / SummaryFrame;
+   const auto nFrames =
+      (pieceEnd + SummaryFrame - 1) / SummaryFrame - firstFrame;
+   Floats summary{ 3 * nFrames };
+   const bool haveSummary =
+      pBlock->GetSummary256(summary.get(), firstFrame, nFrames);
+   Floats samples;
+   for (size_t ii = 0; ii < nFrames; ++ii) {
+      if (haveSummary &&
+          !MayClip(summary[3 * ii], summary[3 * ii + 1], threshold))
+         continue;
+      if (!samples) {
+         samples.reinit(piece.len);
+         pBlock->GetSamples((samplePtr)samples.get(), floatSample,
+            piece.offset, piece.len);
+      }
+      const auto frameStart = (firstFrame + ii) * SummaryFrame;
+      const auto from = std::max(piece.offset, frameStart) - piece.offset;
+      const auto to =
+         std::min(pieceEnd, frameStart + SummaryFrame) - piece.offset;
+      for (auto jj = from; jj < to;) {
+         bool clipped;
+         const auto count = MagnitudeRuns::RunLength(
+            samples.get() + jj, to - jj, threshold, clipped);
+         if (clipped) {
+            const auto runStart = piece.start + jj;
+            const auto runEnd = runStart + count;
+            if (!runs.empty() && runs.back().end == runStart)
+               runs.back().end = runEnd;
+            else
+               runs.push_back({ runStart, runEnd });
+         }
+         jj += count;
+      }
+   }
+}
+
+}
+
 const ComponentInterfaceSymbol EffectFindClipping::Symbol
 { XO("Find Clipping") };
 
@@ -160,84 +241,82 @@ bool EffectFindClipping::ProcessOne(LabelTrack * lt,
                                     sampleCount start,
                                     sampleCount len)
 {
-   bool bGoodResult = true;
-   size_t blockSize = (mStart * 1000);
-
    if (len < mStart) {
       return true;
    }
 
-   Floats buffer;
-   try {
-      // mStart should be positive.
-      // if we are throwing bad_alloc and mStart is negative, find out why.
-      if (mStart < 0 || (int)blockSize < mStart)
-         // overflow
-         throw std::bad_alloc{};
-      buffer.reinit(blockSize);
-   }
-   catch( const std::bad_alloc & ) {
-      Effect::MessageBox( XO("Requested value exceeds memory capacity.") );
+   const auto threshold = MagnitudeRuns::RoundUp(MAX_AUDIO);
+
+   // Search the pieces of blocks within the range on the worker threads
+   const auto end = start + len;
+   const auto pieces = wt->GetBlockPieces(start, end);
+   // Found by FindClippedRuns() for each piece
+   std::vector<ClippedRuns> runs(pieces.size());
+   double done = 0;
+   size_t nDone = 0;
+   if (!WorkerPool::Get().ParallelForInRounds(pieces.size(),
+      [&](size_t ii){
+         FindClippedRuns(pieces[ii], runs[ii], threshold);
+      },
+      [&](size_t nPieces){
+         for (; nDone < nPieces; ++nDone)
+            done += pieces[nDone].len;
+         return !TrackProgress(count, done / len.as_double());
+      }))
       return false;
-   }
 
-   float *ptr = buffer.get();
-
-   decltype(len) s = 0, startrun = 0, stoprun = 0, samps = 0;
-   decltype(blockSize) block = 0;
+   // Apply the duty cycle to the runs in order.  All other samples, including
+   // those between clips, are not clipped, and change nothing unless a run
+   // is under way.
+   decltype(len) startrun = 0, stoprun = 0, samps = 0;
    double startTime = -1.0;
 
-   while (s < len) {
-      if (block == 0) {
-         if (TrackProgress(count,
-                           s.as_double() /
-                           len.as_double() )) {
-            bGoodResult = false;
-            break;
-         }
-
-         block = limitSampleBufferSize( blockSize, len - s );
-
-         wt->Get((samplePtr)buffer.get(), floatSample, start + s, block);
-         ptr = buffer.get();
+   // n clipped samples from s
+   const auto clipped = [&](sampleCount s, sampleCount n) {
+      if (startrun == 0) {
+         startTime = wt->LongSamplesToTime(s);
+         samps = 0;
       }
-
-      float v = fabs(*ptr++);
-      if (v >= MAX_AUDIO) {
-         if (startrun == 0) {
-            startTime = wt->LongSamplesToTime(start + s);
-            samps = 0;
-         }
-         else {
-            stoprun = 0;
-         }
-         startrun++;
-         samps++;
+      stoprun = 0;
+      startrun += n;
+      samps += n;
+   };
+
+   // n samples from s that are not clipped
+   const auto unclipped = [&](sampleCount s, sampleCount n) {
+      if (n == 0)
+         return;
+      if (startrun < mStart) {
+         startrun = 0;
+         return;
       }
-      else {
-         if (startrun >= mStart) {
-            stoprun++;
-            samps++;
-
-            if (stoprun >= mStop) {
-               lt->AddLabel(SelectedRegion(startTime,
-                                          wt->LongSamplesToTime(start + s - mStop)),
-                           wxString::Format(wxT("%lld of %lld"), startrun.as_long_long(), (samps - mStop).as_long_long()));
-               startrun = 0;
-               stoprun = 0;
-               samps = 0;
-            }
-         }
-         else {
-            startrun = 0;
-         }
+      const auto needed = mStop - stoprun;
+      if (n < needed) {
+         stoprun += n;
+         samps += n;
+         return;
+      }
+      // The run ends at the sample s + needed - 1
+      samps += needed;
+      lt->AddLabel(SelectedRegion(startTime,
+                                 wt->LongSamplesToTime(s + needed - 1 - mStop)),
+                  wxString::Format(wxT("%lld of %lld"), startrun.as_long_long(), (samps - mStop).as_long_long()));
+      startrun = 0;
+      stoprun = 0;
+      samps = 0;
+   };
+
+   auto s = start;
+   for (const auto &pieceRuns : runs) {
+      for (const auto &run : pieceRuns) {
+         unclipped(s, run.start - s);
+         clipped(run.start, run.end - run.start);
+         s = run.end;
       }
-
-      s++;
-      block--;
    }
+   unclipped(s, end - s);
 
-   return bGoodResult;
+   return true;
 }
 
 void EffectFindClipping::PopulateOrExchange(ShuttleGui & S)
@@ -82,3 +82,16 @@ size_t EffectInvert::ProcessBlock(float **inBlock, float **outBlock, size_t bloc
 
    return blockLen;
 }
+
+// Effect implementation
+
+int EffectInvert::GetSegmentHistory()
+{
+   return 0;
+}
+
+size_t EffectInvert::ProcessSegment(sampleCount WXUNUSED(offset),
+   size_t WXUNUSED(history), float **inBlock, float **outBlock, size_t blockLen)
+{
+   return ProcessBlock(inBlock, outBlock, blockLen);
+}
@@ -38,6 +38,12 @@ public:
    unsigned GetAudioInCount() override;
    unsigned GetAudioOutCount() override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
+
+   // Effect implementation
+
+   int GetSegmentHistory() override;
+   size_t ProcessSegment(sampleCount offset, size_t history,
+      float **inBlock, float **outBlock, size_t blockLen) override;
 };
 
 #endif
@@ -23,6 +23,7 @@
 #include <wx/simplebook.h>
 #include <wx/valgen.h>
 
+#include "../AnalysisCache.h"
 #include "../Internat.h"
 #include "../Prefs.h"
 #include "../ProjectFileManager.h"
@@ -216,16 +217,31 @@ bool EffectLoudness::Process()
 
       mProcStereo = range.size() > 1;
 
+      // Calculate normalization values the analysis results
+      float extent;
       if(mNormalizeTo == kLoudness)
       {
-         mLoudnessProcessor.reset(safenew EBUR128(mCurRate, range.size()));
-         mLoudnessProcessor->Initialize();
-         if(!ProcessOne(range, true))
+         // The loudness of unchanged audio may be known from an earlier run
+         const auto key = AnalysisCache::MakeKey("EBU R128 Integrated",
+            std::vector<const WaveTrack*>( range.begin(), range.end() ),
+            mCurT0, mCurT1);
+         std::vector<double> results;
+         if(AnalysisCache::Get().Find(key, results))
+            mSteps = 1;
+         else
          {
-            // Processing failed -> abort
-            bGoodResult = false;
-            break;
+            mLoudnessProcessor.reset(safenew EBUR128(mCurRate, range.size()));
+            mLoudnessProcessor->Initialize();
+            if(!ProcessOne(range, true))
+            {
+               // Processing failed -> abort
+               bGoodResult = false;
+               break;
+            }
+            results = { mLoudnessProcessor->IntegrativeLoudness() };
+            AnalysisCache::Get().Store(key, results);
          }
+         extent = results[0];
       }
       else // RMS
       {
@@ -240,14 +256,7 @@ bool EffectLoudness::Process()
             ++idx;
          }
          mSteps = 1;
-      }
 
-      // Calculate normalization values the analysis results
-      float extent;
-      if(mNormalizeTo == kLoudness)
-         extent = mLoudnessProcessor->IntegrativeLoudness();
-      else // RMS
-      {
          extent = mRMS[0];
          if(mProcStereo)
             // RMS: use average RMS, average must be calculated in quadratic domain.
@@ -525,13 +534,8 @@ void EffectLoudness::LoadBufferBlock(TrackIterRange<WaveTrack> range,
 /// (for loudness).
 bool EffectLoudness::AnalyseBufferBlock()
 {
-   for(size_t i = 0; i < mTrackBufferLen; i++)
-   {
-      mLoudnessProcessor->ProcessSampleFromChannel(mTrackBuffer[0][i], 0);
-      if(mProcStereo)
-         mLoudnessProcessor->ProcessSampleFromChannel(mTrackBuffer[1][i], 1);
-      mLoudnessProcessor->NextSample();
-   }
+   const float *channels[] = { mTrackBuffer[0].get(), mTrackBuffer[1].get() };
+   mLoudnessProcessor->ProcessSamples(channels, mTrackBufferLen);
 
    if(!UpdateProgress())
       return false;
@@ -38,6 +38,7 @@
 
 #include "../Audacity.h"
 #include "NoiseReduction.h"
+#include "NoiseReductionBands.h"
 
 #include "../Experimental.h"
 
@@ -49,14 +50,17 @@
 #include "../widgets/HelpSystem.h"
 #include "../Prefs.h"
 #include "../RealFFTf.h"
+#include "../WorkerPool.h"
 
 #include "../WaveTrack.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/valnum.h"
 
 #include <algorithm>
+#include <functional>
 #include <vector>
 #include <math.h>
+#include <cmath>
 
 #if defined(__WXMSW__) && !defined(__CYGWIN__)
 #include <float.h>
@@ -115,6 +119,10 @@ const struct DiscriminationMethodInfo {
 // and the old discrimination
 const float minSignalTime = 0.05f;
 
+// Noise reduction of a long track is divided into segments of about so many
+// samples, reduced on several threads
+const size_t segmentSize = 1 << 19;
+
 enum WindowTypes {
    WT_RECTANGULAR_HANN = 0, // 2.0.6 behavior, requires 1/2 step
    WT_HANN_RECTANGULAR, // requires 1/2 step
@@ -271,27 +279,59 @@ public:
                 Statistics &statistics, TrackFactory &factory,
                 TrackList &tracks, double mT0, double mT1);
 
+   // Reads samples of one channel, at most len from start, which counts
+   // from the beginning of the processed range; returns how many, at least
+   // one
+   using Reader =
+      std::function< size_t(sampleCount start, float *buffer, size_t len) >;
+   // Takes the output in order
+   using Writer = std::function< void(const float *buffer, size_t len) >;
+   // Given the fraction done, returns false to stop
+   using Progress = std::function< bool(double fraction) >;
+
+   // Profile or reduce noise in len samples in one pass, reading at most
+   // bufferSize at a time.  The output may run on past len.
+   bool ProcessSerially(Statistics &statistics, sampleCount len,
+                   size_t bufferSize, const Reader &read,
+                   const Writer &write, const Progress &progress);
+   // Reduce noise in len samples in segments on the WorkerPool, with the
+   // same output, but exactly len of it
+   bool ProcessSegments(Statistics &statistics, sampleCount len,
+                   const Reader &read, const Writer &write,
+                   const Progress &progress);
+
 private:
    bool ProcessOne(EffectNoiseReduction &effect,
                    Statistics &statistics,
                    TrackFactory &factory,
                    int count, WaveTrack *track,
                    sampleCount start, sampleCount len);
+   void ProcessSegment(Statistics &statistics,
+                   const float *buffer, size_t len, bool atEnd);
 
    void StartNewTrack();
    void ProcessSamples(Statistics &statistics,
-      WaveTrack *outputTrack, size_t len, float *buffer);
+      size_t len, const float *buffer);
    void FillFirstHistoryWindow();
    void ApplyFreqSmoothing(FloatVector &gains);
    void GatherStatistics(Statistics &statistics);
+   void ComputeThresholds(const Statistics &statistics);
    inline bool Classify(const Statistics &statistics, int band);
-   void ReduceNoise(const Statistics &statistics, WaveTrack *outputTrack);
+   void ClassifyBands(const Statistics &statistics, float *gains);
+   void ReduceNoise(const Statistics &statistics);
    void RotateHistoryWindows();
    void FinishTrackStatistics(Statistics &statistics);
-   void FinishTrack(Statistics &statistics, WaveTrack *outputTrack);
+   void FinishTrack(Statistics &statistics);
+   void FlushOutput(const Writer &write);
 
 private:
 
+   // Kept to make more workers for segments of one track
+   const Settings mSettings;
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+   const double mF0, mF1;
+#endif
+
    const bool mDoProfile;
 
    const double mSampleRate;
@@ -332,6 +372,14 @@ private:
    unsigned  mNWindowsToExamine;
    unsigned  mCenter;
    unsigned  mHistoryLen;
+   unsigned  mReleaseBlocks;
+
+   // For each band, the greatest float not more than the threshold of
+   // power for noise, so that float comparisons agree with Classify()
+   FloatVector mThresholds;
+
+   // Samples reduced but not yet taken by the caller
+   FloatVector mOutput;
 
    struct Record
    {
@@ -349,6 +397,9 @@ private:
       FloatVector mImagFFTs;
    };
    std::vector<std::unique_ptr<Record>> mQueue;
+
+   // Spectrums of the windows that ClassifyBands() examines
+   std::vector<const float*> mSpectrumPointers;
 };
 
 /****************************************************************//**
@@ -664,6 +715,55 @@ bool EffectNoiseReduction::Process()
    return bGoodResult;
 }
 
+std::vector<float> EffectNoiseReduction::Reduce(double rate,
+   const std::vector<float> &noise, const std::vector<float> &samples,
+   bool segmented)
+{
+   Settings settings;
+   Statistics statistics{
+      1 + settings.WindowSize() / 2, rate, settings.mWindowTypes };
+
+   // Read in pieces of about the size of track blocks
+   const size_t bufferSize = 1 << 18;
+   const auto reader = [](const std::vector<float> &source) {
+      return [&source](sampleCount start, float *buffer, size_t len) {
+         std::copy_n(&source[start.as_size_t()], len, buffer);
+         return len;
+      };
+   };
+   std::vector<float> output;
+   const auto write = [&](const float *buffer, size_t len) {
+      output.insert(output.end(), buffer, buffer + len);
+   };
+   const auto progress = [](double) { return true; };
+
+   settings.mDoProfile = true;
+   Worker profiler{ settings, rate
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+      , -1.0, -1.0
+#endif
+   };
+   profiler.ProcessSerially(statistics, noise.size(), bufferSize,
+      reader(noise), write, progress);
+
+   settings.mDoProfile = false;
+   Worker worker{ settings, rate
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+      , -1.0, -1.0
+#endif
+   };
+   if (segmented)
+      worker.ProcessSegments(statistics, samples.size(),
+         reader(samples), write, progress);
+   else
+      worker.ProcessSerially(statistics, samples.size(), bufferSize,
+         reader(samples), write, progress);
+
+   // Drop the tail, as ProcessOne does
+   output.resize(samples.size());
+   return output;
+}
+
 EffectNoiseReduction::Worker::~Worker()
 {
 }
@@ -750,7 +850,11 @@ EffectNoiseReduction::Worker::Worker
 , double f0, double f1
 #endif
 )
-: mDoProfile(settings.mDoProfile)
+: mSettings(settings)
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+, mF0(f0), mF1(f1)
+#endif
+, mDoProfile(settings.mDoProfile)
 
 , mSampleRate(sampleRate)
 
@@ -798,6 +902,7 @@ EffectNoiseReduction::Worker::Worker
    // Apply to gain factors which apply to amplitudes, divide by 20:
    mOneBlockAttack = DB_TO_LINEAR(noiseGain / nAttackBlocks);
    mOneBlockRelease = DB_TO_LINEAR(noiseGain / nReleaseBlocks);
+   mReleaseBlocks = nReleaseBlocks;
    // Applies to power, divide by 10:
    mOldSensitivityFactor = pow(10.0, settings.mOldSensitivity / 10.0);
 
@@ -938,8 +1043,7 @@ void EffectNoiseReduction::Worker::StartNewTrack()
 }
 
 void EffectNoiseReduction::Worker::ProcessSamples
-(Statistics &statistics, WaveTrack *outputTrack,
- size_t len, float *buffer)
+(Statistics &statistics, size_t len, const float *buffer)
 {
    while (len && mOutStepCount * mStepSize < mInSampleCount) {
       auto avail = std::min(len, mWindowSize - mInWavePos);
@@ -953,7 +1057,7 @@ void EffectNoiseReduction::Worker::ProcessSamples
          if (mDoProfile)
             GatherStatistics(statistics);
          else
-            ReduceNoise(statistics, outputTrack);
+            ReduceNoise(statistics);
          ++mOutStepCount;
          RotateHistoryWindows();
 
@@ -1036,8 +1140,7 @@ void EffectNoiseReduction::Worker::FinishTrackStatistics(Statistics &statistics)
    statistics.mTotalWindows = denom;
 }
 
-void EffectNoiseReduction::Worker::FinishTrack
-(Statistics &statistics, WaveTrack *outputTrack)
+void EffectNoiseReduction::Worker::FinishTrack(Statistics &statistics)
 {
    // Keep flushing empty input buffers through the history
    // windows until we've output exactly as many samples as
@@ -1049,7 +1152,7 @@ void EffectNoiseReduction::Worker::FinishTrack
    FloatVector empty(mStepSize);
 
    while (mOutStepCount * mStepSize < mInSampleCount) {
-      ProcessSamples(statistics, outputTrack, mStepSize, &empty[0]);
+      ProcessSamples(statistics, mStepSize, &empty[0]);
    }
 }
 
@@ -1159,35 +1262,58 @@ bool EffectNoiseReduction::Worker::Classify(const Statistics &statistics, int ba
    }
 }
 
-void EffectNoiseReduction::Worker::ReduceNoise
-(const Statistics &statistics, WaveTrack *outputTrack)
+void EffectNoiseReduction::Worker::ComputeThresholds(const Statistics &statistics)
+{
+   mThresholds.resize(mSpectrumSize);
+   for (size_t ii = 0; ii < mSpectrumSize; ++ii)
+      // Classify() compares in double
+      mThresholds[ii] = NoiseReductionBands::RoundDown(
+         mNewSensitivity * statistics.mMeans[ii]);
+}
+
+// Set gains of the "center" window in the selected frequency range, as
+// Classify() decides for each band, but four bands at a time where possible
+void EffectNoiseReduction::Worker::ClassifyBands
+(const Statistics &statistics, float *gains)
+{
+   const bool isolate = (mNoiseReductionChoice == NRC_ISOLATE_NOISE);
+
+   // The methods that find the second or third greatest power
+   const bool third =
+      (mMethod == DM_MEDIAN && mNWindowsToExamine == 5);
+   const bool second = (mMethod == DM_SECOND_GREATEST ||
+      (mMethod == DM_MEDIAN && mNWindowsToExamine == 3));
+   if (third || second) {
+      mSpectrumPointers.resize(mNWindowsToExamine);
+      for (unsigned ii = 0; ii < mNWindowsToExamine; ++ii)
+         mSpectrumPointers[ii] = mQueue[ii]->mSpectrums.data();
+      NoiseReductionBands::Classify(mSpectrumPointers.data(),
+         mNWindowsToExamine, third, mThresholds.data(), isolate,
+         mBinLow, mBinHigh, gains);
+      return;
+   }
+
+   for (int jj = mBinLow; jj < mBinHigh; ++jj) {
+      const bool isNoise = Classify(statistics, jj);
+      if (isolate)
+         gains[jj] = isNoise ? 1.0 : 0.0;
+      else if (!isNoise)
+         gains[jj] = 1.0;
+   }
+}
+
+void EffectNoiseReduction::Worker::ReduceNoise(const Statistics &statistics)
 {
    // Raise the gain for elements in the center of the sliding history
    // or, if isolating noise, zero out the non-noise
    {
       float *pGain = &mQueue[mCenter]->mGains[0];
-      if (mNoiseReductionChoice == NRC_ISOLATE_NOISE) {
-         // All above or below the selected frequency range is non-noise
-         std::fill(pGain, pGain + mBinLow, 0.0f);
-         std::fill(pGain + mBinHigh, pGain + mSpectrumSize, 0.0f);
-         pGain += mBinLow;
-         for (int jj = mBinLow; jj < mBinHigh; ++jj) {
-               const bool isNoise = Classify(statistics, jj);
-            *pGain++ = isNoise ? 1.0 : 0.0;
-         }
-      }
-      else {
-         // All above or below the selected frequency range is non-noise
-         std::fill(pGain, pGain + mBinLow, 1.0f);
-         std::fill(pGain + mBinHigh, pGain + mSpectrumSize, 1.0f);
-         pGain += mBinLow;
-         for (int jj = mBinLow; jj < mBinHigh; ++jj) {
-            const bool isNoise = Classify(statistics, jj);
-            if (!isNoise) 
-               *pGain = 1.0;
-            ++pGain;
-         }
-      }
+      // All above or below the selected frequency range is non-noise
+      const float outside =
+         (mNoiseReductionChoice == NRC_ISOLATE_NOISE) ? 0.0f : 1.0f;
+      std::fill(pGain, pGain + mBinLow, outside);
+      std::fill(pGain + mBinHigh, pGain + mSpectrumSize, outside);
+      ClassifyBands(statistics, pGain);
    }
 
    if (mNoiseReductionChoice != NRC_ISOLATE_NOISE)
@@ -1297,7 +1423,7 @@ void EffectNoiseReduction::Worker::ReduceNoise
       float *buffer = &mOutOverlapBuffer[0];
       if (mOutStepCount >= 0) {
          // Output the first portion of the overlap buffer, they're done
-         outputTrack->Append((samplePtr)buffer, floatSample, mStepSize);
+         mOutput.insert(mOutput.end(), buffer, buffer + mStepSize);
       }
 
       // Shift the remainder over.
@@ -1306,6 +1432,14 @@ void EffectNoiseReduction::Worker::ReduceNoise
    }
 }
 
+void EffectNoiseReduction::Worker::FlushOutput(const Writer &write)
+{
+   if (!mOutput.empty()) {
+      write(&mOutput[0], mOutput.size());
+      mOutput.clear();
+   }
+}
+
 bool EffectNoiseReduction::Worker::ProcessOne
 (EffectNoiseReduction &effect,  Statistics &statistics, TrackFactory &factory,
  int count, WaveTrack * track, sampleCount start, sampleCount len)
@@ -1313,44 +1447,34 @@ bool EffectNoiseReduction::Worker::ProcessOne
    if (track == NULL)
       return false;
 
-   StartNewTrack();
-
    WaveTrack::Holder outputTrack;
    if(!mDoProfile)
       outputTrack = track->EmptyCopy();
 
-   auto bufferSize = track->GetMaxBlockSize();
-   FloatVector buffer(bufferSize);
-
-   bool bLoopSuccess = true;
-   auto samplePos = start;
-   while (bLoopSuccess && samplePos < start + len) {
+   const Reader read =
+   [&](sampleCount pos, float *buffer, size_t maxLen) {
       //Get a blockSize of samples (smaller than the size of the buffer)
       const auto blockSize = limitSampleBufferSize(
-         track->GetBestBlockSize(samplePos),
-         start + len - samplePos
-      );
+         track->GetBestBlockSize(start + pos), maxLen);
 
       //Get the samples from the track and put them in the buffer
-      track->Get((samplePtr)&buffer[0], floatSample, samplePos, blockSize);
-      samplePos += blockSize;
-
-      mInSampleCount += blockSize;
-      ProcessSamples(statistics, outputTrack.get(), blockSize, &buffer[0]);
-
+      track->Get((samplePtr)buffer, floatSample, start + pos, blockSize);
+      return blockSize;
+   };
+   const Writer write = [&](const float *buffer, size_t len) {
+      outputTrack->Append((samplePtr)buffer, floatSample, len);
+   };
+   const Progress progress = [&](double fraction) {
       // Update the Progress meter, let user cancel
-      bLoopSuccess = 
-         !effect.TrackProgress(count,
-                               ( samplePos - start ).as_double() /
-                               len.as_double() );
-   }
+      return !effect.TrackProgress(count, fraction);
+   };
 
-   if (bLoopSuccess) {
-      if (mDoProfile)
-         FinishTrackStatistics(statistics);
-      else
-         FinishTrack(statistics, &*outputTrack);
-   }
+   const bool bLoopSuccess =
+      (!mDoProfile && WorkerPool::Get().Concurrency() > 1 &&
+       len > 2 * segmentSize)
+      ? ProcessSegments(statistics, len, read, write, progress)
+      : ProcessSerially(statistics, len, track->GetMaxBlockSize(),
+         read, write, progress);
 
    if (bLoopSuccess && !mDoProfile) {
       // Flush the output WaveTrack (since it's buffered)
@@ -1368,6 +1492,129 @@ bool EffectNoiseReduction::Worker::ProcessOne
    return bLoopSuccess;
 }
 
+bool EffectNoiseReduction::Worker::ProcessSerially
+(Statistics &statistics, sampleCount len, size_t bufferSize,
+ const Reader &read, const Writer &write, const Progress &progress)
+{
+   // Profiling sums statistics in order, so it is never divided
+   if (!mDoProfile)
+      ComputeThresholds(statistics);
+   StartNewTrack();
+
+   FloatVector buffer(bufferSize);
+
+   sampleCount samplePos = 0;
+   while (samplePos < len) {
+      const auto blockSize = read(samplePos, &buffer[0],
+         limitSampleBufferSize(bufferSize, len - samplePos));
+      samplePos += blockSize;
+
+      mInSampleCount += blockSize;
+      ProcessSamples(statistics, blockSize, &buffer[0]);
+      FlushOutput(write);
+
+      if (!progress(samplePos.as_double() / len.as_double()))
+         return false;
+   }
+
+   if (mDoProfile)
+      FinishTrackStatistics(statistics);
+   else {
+      FinishTrack(statistics);
+      FlushOutput(write);
+   }
+
+   return true;
+}
+
+// Reduce noise in segments of the track on the WorkerPool, each by a new
+// Worker, and write the results in order.
+//
+// A Worker started partway into the track sees zeroes before it, but the
+// gains of any window depend only on the few windows around it, and on the
+// release from earlier windows, which falls to the floor of
+// mNoiseAttenFactor after mReleaseBlocks.  So each Worker first reduces
+// enough of the preceding samples that the output of its segment is
+// exactly what one Worker reducing the whole track would make; and it reads
+// on past the segment far enough to finish the last windows that overlap it.
+bool EffectNoiseReduction::Worker::ProcessSegments
+(Statistics &statistics, sampleCount len,
+ const Reader &read, const Writer &write, const Progress &progress)
+{
+   const sampleCount preRoll = (2 * mStepsPerWindow + mNWindowsToExamine
+      + mReleaseBlocks + 2) * mStepSize;
+   const sampleCount postRoll =
+      (mHistoryLen + mStepsPerWindow + 1) * mStepSize + mWindowSize;
+   // Segments begin at multiples of the step, as the windows do
+   const sampleCount size =
+      std::max<size_t>(1, segmentSize / mStepSize) * mStepSize;
+
+   struct Segment {
+      FloatVector samples;
+      // Where the output of the segment begins within samples
+      size_t offset;
+      size_t len;
+      bool atEnd;
+   };
+
+   auto &pool = WorkerPool::Get();
+   sampleCount segmentStart = 0;
+   while (segmentStart < len) {
+      // Read as many segments as can be reduced at once
+      std::vector<Segment> segments;
+      while (segments.size() < pool.Concurrency() && segmentStart < len) {
+         const auto segmentEnd = std::min(len, segmentStart + size);
+         const auto inputStart =
+            std::max<sampleCount>(0, segmentStart - preRoll);
+         const auto inputEnd = std::min(len, segmentEnd + postRoll);
+
+         Segment segment;
+         segment.samples.resize((inputEnd - inputStart).as_size_t());
+         segment.offset = (segmentStart - inputStart).as_size_t();
+         segment.len = (segmentEnd - segmentStart).as_size_t();
+         segment.atEnd = (inputEnd == len);
+         for (size_t done = 0; done < segment.samples.size();)
+            done += read(inputStart + done, &segment.samples[done],
+               segment.samples.size() - done);
+         segments.push_back(std::move(segment));
+
+         segmentStart = segmentEnd;
+      }
+
+      // Noise reduction only reads the statistics
+      pool.ParallelFor(segments.size(), [&](size_t ii){
+         auto &segment = segments[ii];
+         Worker worker{ mSettings, mSampleRate
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+            , mF0, mF1
+#endif
+         };
+         worker.ComputeThresholds(statistics);
+         worker.ProcessSegment(statistics,
+            &segment.samples[0], segment.samples.size(), segment.atEnd);
+         segment.samples.swap(worker.mOutput);
+      });
+
+      for (const auto &segment : segments)
+         write(&segment.samples[segment.offset], segment.len);
+
+      if (!progress(segmentStart.as_double() / len.as_double()))
+         return false;
+   }
+
+   return true;
+}
+
+void EffectNoiseReduction::Worker::ProcessSegment
+(Statistics &statistics, const float *buffer, size_t len, bool atEnd)
+{
+   StartNewTrack();
+   mInSampleCount = len;
+   ProcessSamples(statistics, len, buffer);
+   if (atEnd)
+      FinishTrack(statistics);
+}
+
 //----------------------------------------------------------------------------
 // EffectNoiseReduction::Dialog
 //----------------------------------------------------------------------------
@@ -44,6 +44,14 @@ public:
    bool CheckWhetherSkipEffect() override;
    bool Process() override;
 
+   // Take a profile of noise, then reduce noise in samples with it, at rate
+   // and with the saved settings, as Process does for one channel.  If
+   // segmented, samples are divided among threads as for a long track,
+   // else reduced in one pass.  The result is as long as samples.
+   static std::vector<float> Reduce(double rate,
+      const std::vector<float> &noise, const std::vector<float> &samples,
+      bool segmented);
+
    class Settings;
    class Statistics;
    class Dialog;
@@ -0,0 +1,89 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  NoiseReductionBands.cpp
+
+*******************************************************************//**
+
+\namespace NoiseReductionBands
+\brief Decides which frequency bands are noise, several at a time.
+
+*//*******************************************************************/
+
+#include "NoiseReductionBands.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NOISE_REDUCTION_BANDS_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace NoiseReductionBands {
+
+float RoundDown(double threshold)
+{
+   float rounded = threshold;
+   if (rounded > threshold)
+      rounded = std::nextafter(rounded, -HUGE_VALF);
+   return rounded;
+}
+
+void Classify(const float *const *spectrums, size_t nWindows, bool third,
+   const float *thresholds, bool isolate, size_t begin, size_t end,
+   float *gains)
+{
+   size_t jj = begin;
+
+#ifdef NOISE_REDUCTION_BANDS_USE_SSE2
+   const __m128 one = _mm_set1_ps(1.0f);
+   for (; jj + 4 <= end; jj += 4) {
+      // Keep the greatest powers without branching; ties and order come out
+      // as in the loop below
+      __m128 greatest = _mm_setzero_ps();
+      __m128 secondGreatest = _mm_setzero_ps();
+      __m128 thirdGreatest = _mm_setzero_ps();
+      for (size_t ii = 0; ii < nWindows; ++ii) {
+         const __m128 power = _mm_loadu_ps(spectrums[ii] + jj);
+         thirdGreatest = _mm_max_ps(thirdGreatest,
+            _mm_min_ps(secondGreatest, power));
+         secondGreatest = _mm_max_ps(secondGreatest,
+            _mm_min_ps(greatest, power));
+         greatest = _mm_max_ps(greatest, power);
+      }
+      const __m128 isNoise = _mm_cmple_ps(
+         third ? thirdGreatest : secondGreatest,
+         _mm_loadu_ps(thresholds + jj));
+      __m128 gain;
+      if (isolate)
+         gain = _mm_and_ps(isNoise, one);
+      else
+         gain = _mm_or_ps(_mm_and_ps(isNoise, _mm_loadu_ps(gains + jj)),
+            _mm_andnot_ps(isNoise, one));
+      _mm_storeu_ps(gains + jj, gain);
+   }
+#endif
+
+   for (; jj < end; ++jj) {
+      float greatest = 0.0, second = 0.0, thirdGreatest = 0.0;
+      for (size_t ii = 0; ii < nWindows; ++ii) {
+         const float power = spectrums[ii][jj];
+         if (power >= greatest)
+            thirdGreatest = second, second = greatest, greatest = power;
+         else if (power >= second)
+            thirdGreatest = second, second = power;
+         else if (power >= thirdGreatest)
+            thirdGreatest = power;
+      }
+      const bool isNoise =
+         (third ? thirdGreatest : second) <= thresholds[jj];
+      if (isolate)
+         gains[jj] = isNoise ? 1.0 : 0.0;
+      else if (!isNoise)
+         gains[jj] = 1.0;
+   }
+}
+
+}
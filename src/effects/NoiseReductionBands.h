@@ -0,0 +1,40 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  NoiseReductionBands.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_NOISE_REDUCTION_BANDS__
+#define __AUDACITY_NOISE_REDUCTION_BANDS__
+
+#include <cstddef>
+
+//! Classification of frequency bands as noise for EffectNoiseReduction
+namespace NoiseReductionBands {
+
+//! The greatest float not more than threshold, so that comparing a float
+//! with it agrees with comparing the float with threshold in double
+float RoundDown(double threshold);
+
+//! Decide which bands of the center window are noise, and set their gains
+/*!
+ A band is noise if the second greatest of its powers in the windows, or the
+ third greatest if third is true, is not more than its threshold.  Four bands
+ are decided at a time where SSE2 is available, with the same results as one
+ at a time.
+
+ @param spectrums powers of bands in each of nWindows windows
+ @param thresholds for each band, as from RoundDown()
+ @param isolate if true, gains of noise become 1 and the others 0; if false,
+ gains of bands that are not noise become 1 and the others are unchanged
+ @param begin,end the range of bands to decide
+ */
+void Classify(const float *const *spectrums, size_t nWindows, bool third,
+   const float *thresholds, bool isolate, size_t begin, size_t end,
+   float *gains);
+
+}
+
+#endif
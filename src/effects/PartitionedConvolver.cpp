@@ -0,0 +1,197 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PartitionedConvolver.cpp
+
+*******************************************************************//**
+
+\class PartitionedConvolver
+\brief Uniformly partitioned overlap-save convolution of several channels
+with one impulse response.
+
+*//*******************************************************************/
+
+#include "PartitionedConvolver.h"
+
+#include "../WorkerPool.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONVOLVER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Smallest partition, below which the transforms cost more than they save
+constexpr size_t MinBlockSize = 64;
+
+// acc += a * b, for spectra of len values in the order RealFFTf leaves them:
+// the purely real DC and Nyquist terms first, then complex pairs
+void MultiplyAdd(const float *a, const float *b, float *acc, size_t len)
+{
+   acc[0] += a[0] * b[0];
+   acc[1] += a[1] * b[1];
+   size_t ii = 2;
+#ifdef CONVOLVER_USE_SSE2
+   // Two complex products at a time
+   const __m128 sign = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+   for (; ii + 4 <= len; ii += 4) {
+      const __m128 va = _mm_loadu_ps(a + ii);
+      const __m128 vb = _mm_loadu_ps(b + ii);
+      const __m128 re = _mm_shuffle_ps(va, va, _MM_SHUFFLE(2, 2, 0, 0));
+      const __m128 im = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 3, 1, 1));
+      const __m128 swapped = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1));
+      const __m128 sum = _mm_add_ps(_mm_mul_ps(re, vb),
+         _mm_mul_ps(_mm_mul_ps(im, swapped), sign));
+      _mm_storeu_ps(acc + ii, _mm_add_ps(_mm_loadu_ps(acc + ii), sum));
+   }
+#endif
+   for (; ii < len; ii += 2) {
+      acc[ii] += a[ii] * b[ii] - a[ii + 1] * b[ii + 1];
+      acc[ii + 1] += a[ii] * b[ii + 1] + a[ii + 1] * b[ii];
+   }
+}
+
+size_t RoundUpToPowerOfTwo(size_t n)
+{
+   size_t result = 1;
+   while (result < n)
+      result <<= 1;
+   return result;
+}
+
+}
+
+PartitionedConvolver::PartitionedConvolver()
+{
+}
+
+PartitionedConvolver::PartitionedConvolver(const float *response,
+   size_t responseLen, size_t nChannels, size_t blockSize)
+{
+   SetResponse(response, responseLen, nChannels, blockSize);
+}
+
+void PartitionedConvolver::SetResponse(const float *response,
+   size_t responseLen, size_t nChannels, size_t blockSize)
+{
+   if (blockSize == 0)
+      blockSize = RoundUpToPowerOfTwo(responseLen);
+   mBlockSize = std::max(MinBlockSize, RoundUpToPowerOfTwo(blockSize));
+   mPartitions = std::max<size_t>(1,
+      (responseLen + mBlockSize - 1) / mBlockSize);
+
+   const auto fftLen = 2 * mBlockSize;
+   hFFT = GetFFT(fftLen);
+
+   mResponse.reinit(mPartitions * fftLen, true);
+   for (size_t ii = 0; ii < mPartitions; ++ii) {
+      const auto spectrum = mResponse.get() + ii * fftLen;
+      const auto offset = ii * mBlockSize;
+      const auto count = std::min(mBlockSize, responseLen - offset);
+      for (size_t jj = 0; jj < count; ++jj)
+         spectrum[jj] = response[offset + jj];
+      RealFFTf(spectrum, hFFT.get());
+   }
+
+   mChannels.clear();
+   mChannels.resize(nChannels);
+   for (auto &channel : mChannels) {
+      channel.input.reinit(fftLen);
+      channel.spectra.reinit(mPartitions * fftLen);
+      channel.output.reinit(mBlockSize);
+      channel.scratch.reinit(2 * fftLen);
+   }
+   Reset();
+}
+
+void PartitionedConvolver::Reset()
+{
+   const auto fftLen = 2 * mBlockSize;
+   for (auto &channel : mChannels) {
+      std::fill(channel.input.get(), channel.input.get() + fftLen, 0.0f);
+      std::fill(channel.spectra.get(),
+         channel.spectra.get() + mPartitions * fftLen, 0.0f);
+      std::fill(channel.output.get(), channel.output.get() + mBlockSize, 0.0f);
+      channel.newest = 0;
+      channel.fill = 0;
+   }
+}
+
+void PartitionedConvolver::Process(const float *const *in, float *const *out,
+   size_t len, bool parallel)
+{
+   const auto nChannels = mChannels.size();
+   if (parallel && nChannels > 1)
+      WorkerPool::Get().ParallelFor(nChannels, [&](size_t ii){
+         ProcessChannel(mChannels[ii], in[ii], out[ii], len);
+      });
+   else
+      for (size_t ii = 0; ii < nChannels; ++ii)
+         ProcessChannel(mChannels[ii], in[ii], out[ii], len);
+}
+
+void PartitionedConvolver::ProcessChannel(Channel &channel,
+   const float *in, float *out, size_t len)
+{
+   const auto input = channel.input.get() + mBlockSize;
+   const auto output = channel.output.get();
+   while (len > 0) {
+      const auto fill = channel.fill;
+      const auto count = std::min(len, mBlockSize - fill);
+      // Read all input before writing output, which may be the same buffer
+      std::copy(in, in + count, input + fill);
+      std::copy(output + fill, output + fill + count, out);
+      in += count, out += count, len -= count;
+      channel.fill += count;
+      if (channel.fill == mBlockSize) {
+         ProcessBlock(channel);
+         channel.fill = 0;
+      }
+   }
+}
+
+void PartitionedConvolver::ProcessBlock(Channel &channel)
+{
+   const auto fftLen = 2 * mBlockSize;
+
+   // Transform the previous and the current blocks of input
+   channel.newest = (channel.newest + 1) % mPartitions;
+   const auto spectra = channel.spectra.get();
+   const auto newest = spectra + channel.newest * fftLen;
+   std::copy(channel.input.get(), channel.input.get() + fftLen, newest);
+   RealFFTf(newest, hFFT.get());
+
+   // The k-th partition of the response meets the input k blocks ago
+   const auto sum = channel.scratch.get();
+   std::fill(sum, sum + fftLen, 0.0f);
+   for (size_t kk = 0; kk < mPartitions; ++kk) {
+      const auto iSpectrum =
+         (channel.newest + mPartitions - kk) % mPartitions;
+      MultiplyAdd(mResponse.get() + kk * fftLen,
+         spectra + iSpectrum * fftLen, sum, fftLen);
+   }
+
+   // InverseRealFFTf wants the bins in natural order
+   const auto ordered = sum + fftLen;
+   ordered[0] = sum[0];
+   ordered[1] = sum[1];
+   for (size_t ii = 1; ii < mBlockSize; ++ii) {
+      const auto index = hFFT->BitReversed[ii];
+      ordered[2 * ii] = sum[index];
+      ordered[2 * ii + 1] = sum[index + 1];
+   }
+   InverseRealFFTf(ordered, hFFT.get());
+   ReorderToTime(hFFT.get(), ordered, sum);
+
+   // The first half wrapped around; the second is the new output
+   std::copy(sum + mBlockSize, sum + fftLen, channel.output.get());
+
+   // The current block becomes the previous one
+   std::copy(channel.input.get() + mBlockSize, channel.input.get() + fftLen,
+      channel.input.get());
+}
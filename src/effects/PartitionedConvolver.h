@@ -0,0 +1,87 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PartitionedConvolver.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_PARTITIONED_CONVOLVER__
+#define __AUDACITY_PARTITIONED_CONVOLVER__
+
+#include "../RealFFTf.h"
+#include "../SampleFormat.h"
+
+#include <vector>
+
+///\brief Applies a long FIR filter to several channels by uniformly
+/// partitioned FFT convolution
+/**
+ The impulse response is cut into partitions of the block size, and the
+ spectrum of each is kept.  Each block of input is transformed once, and its
+ spectrum is multiplied by those of all the partitions as it ages, so the
+ cost per sample grows only slowly with the length of the response, and the
+ latency is one block whatever that length.
+
+ All channels share the response; each keeps its own history.
+ */
+class PartitionedConvolver final
+{
+public:
+   PartitionedConvolver();
+   //! See SetResponse()
+   PartitionedConvolver(const float *response, size_t responseLen,
+      size_t nChannels, size_t blockSize = 0);
+   PartitionedConvolver(PartitionedConvolver&&) = default;
+   PartitionedConvolver &operator=(PartitionedConvolver&&) = default;
+
+   //! Use a new impulse response and clear the history
+   /*!
+    @param blockSize a power of two; if zero, one partition holds the whole
+    response, which costs least when latency does not matter
+    */
+   void SetResponse(const float *response, size_t responseLen,
+      size_t nChannels, size_t blockSize = 0);
+
+   size_t GetChannels() const { return mChannels.size(); }
+   size_t GetBlockSize() const { return mBlockSize; }
+   //! Output lags input by this many samples
+   size_t GetLatency() const { return mBlockSize; }
+
+   //! Clear the history of all channels
+   void Reset();
+
+   //! Filter len samples of each channel, in place or not
+   /*!
+    @param parallel whether to spread the channels over the WorkerPool
+    */
+   void Process(const float *const *in, float *const *out, size_t len,
+      bool parallel = false);
+
+private:
+   struct Channel {
+      // The previous block of input, then the one being filled
+      Floats input;
+      // Ring of the spectra of the latest blocks, newest at index newest
+      Floats spectra;
+      size_t newest{ 0 };
+      // Output for the block being filled
+      Floats output;
+      size_t fill{ 0 };
+      Floats scratch;
+   };
+
+   void ProcessChannel(Channel &channel, const float *in, float *out,
+      size_t len);
+   void ProcessBlock(Channel &channel);
+
+   HFFT hFFT;
+   size_t mBlockSize{ 0 };
+   size_t mPartitions{ 0 };
+   // Spectra of the partitions, each of 2 * mBlockSize values in the order
+   // RealFFTf leaves them
+   Floats mResponse;
+   std::vector<Channel> mChannels;
+};
+
+#endif
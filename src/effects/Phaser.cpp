@@ -253,6 +253,23 @@ bool EffectPhaser::SetAutomationParameters(CommandParameters & parms)
 
 // Effect implementation
 
+bool EffectPhaser::ProcessesChannelsInParallel()
+{
+   // Each processor has its own state and only reads the parameters
+   return true;
+}
+
+bool EffectPhaser::InitializeParallelProcessor(int group, ChannelNames chanMap)
+{
+   // As in ProcessInitialize
+   if (chanMap[0] == ChannelNameFrontRight)
+   {
+      mSlaves[group].phase += M_PI;
+   }
+
+   return true;
+}
+
 void EffectPhaser::PopulateOrExchange(ShuttleGui & S)
 {
    S.SetBorder(5);
@@ -20,20 +20,24 @@
 #include "LoadEffects.h"
 
 #include <algorithm>
-#include <list>
+#include <cmath>
 #include <limits>
 #include <math.h>
+#include <vector>
 
 #include <wx/checkbox.h>
 #include <wx/choice.h>
 #include <wx/valgen.h>
 
+#include "../MagnitudeRuns.h"
 #include "../Prefs.h"
 #include "../Project.h"
 #include "../ProjectSettings.h"
+#include "../SampleBlock.h"
 #include "../Shuttle.h"
 #include "../ShuttleGui.h"
 #include "../WaveTrack.h"
+#include "../WorkerPool.h"
 #include "../widgets/valnum.h"
 #include "../widgets/AudacityMessageBox.h"
 
@@ -68,7 +72,7 @@ static inline double enumToDB( int val ) { return -( 5.0 * val + 20.0 ); }
 const size_t Enums::NumDbChoices = WXSIZEOF(Enums::DbChoices);
 
 // Declaration of RegionList
-class RegionList : public std::list < Region > {};
+class RegionList : public std::vector < Region > {};
 
 enum kActions
 {
@@ -120,6 +124,145 @@ static const double DEF_MinTruncMs = 0.001;
 // Typical fraction of total time taken by detection (better to guess low)
 const double detectFrac = 0.4;
 
+namespace {
+
+// Samples summarized by each frame of SampleBlock::GetSummary256()
+constexpr size_t SummaryFrame = 256;
+
+// Silent samples of a channel, [start, end)
+struct SilentRun
+{
+   sampleCount start, end;
+};
+
+using SilentRuns = std::vector<SilentRun>;
+
+// A sample x is silent when fabs(x) < threshold.  The threshold here is
+// from MagnitudeRuns::RoundUp(), so that comparisons of floats with it agree
+// exactly with the one in double.
+inline bool IsSilent(float min, float max, float threshold)
+{
+   return max < threshold && min > -threshold;
+}
+
+inline bool IsLoud(float min, float max, float threshold)
+{
+   return min >= threshold || max <= -threshold;
+}
+
+// Collects the silent runs of a piece, given the silence of its samples in
+// order.  Runs touching either end of the piece are kept whatever their
+// length, because they may continue in the neighbouring pieces.
+class RunBuilder
+{
+public:
+   RunBuilder(const WaveTrack::BlockPiece &piece, SilentRuns &runs,
+      sampleCount minLen)
+      : mPiece{ piece }, mRuns{ runs }, mMinLen{ minLen }
+      , mPosition{ piece.start }
+   {}
+
+   void Silent(size_t len)
+   {
+      if (!mInRun) {
+         mInRun = true;
+         mRunStart = mPosition;
+      }
+      mPosition += len;
+   }
+
+   void Loud(size_t len)
+   {
+      End(false);
+      mPosition += len;
+   }
+
+   void Finish()
+   {
+      End(true);
+   }
+
+private:
+   void End(bool atEnd)
+   {
+      if (!mInRun)
+         return;
+      mInRun = false;
+      if (atEnd || mRunStart == mPiece.start ||
+          mPosition - mRunStart >= mMinLen)
+         mRuns.push_back({ mRunStart, mPosition });
+   }
+
+   const WaveTrack::BlockPiece &mPiece;
+   SilentRuns &mRuns;
+   const sampleCount mMinLen;
+   sampleCount mPosition;
+   sampleCount mRunStart{ 0 };
+   bool mInRun{ false };
+};
+
+// Find the silent runs of the piece, reading as few samples as the
+// summaries of the block allow.  This runs on worker threads.
+void FindSilentRuns(const WaveTrack::BlockPiece &piece, SilentRuns &runs,
+   float threshold, sampleCount minLen)
+{
+   RunBuilder builder{ piece, runs, minLen };
+   const auto &pBlock = piece.pBlock;
+
+   // The extremes of the whole block may settle the piece at once
+   const auto extremes = pBlock->GetMinMaxRMS();
+   if (IsLoud(extremes.min, extremes.max, threshold))
+      return;
+   if (IsSilent(extremes.min, extremes.max, threshold)) {
+      builder.Silent(piece.len);
+      builder.Finish();
+      return;
+   }
+
+   // Else those of the frames of the summary, and read samples only if
+   // some frame is mixed
+   const auto pieceEnd = piece.offset + piece.len;
+   const auto firstFrame = piece.offset / SummaryFrame;
+   const auto nFrames =
+      (pieceEnd + SummaryFrame - 1) / SummaryFrame - firstFrame;
+   Floats summary{ 3 * nFrames };
+   const bool haveSummary =
+      pBlock->GetSummary256(summary.get(), firstFrame, nFrames);
+   Floats samples;
+   for (size_t ii = 0; ii < nFrames; ++ii) {
+      const auto frameStart = (firstFrame + ii) * SummaryFrame;
+      const auto from = std::max(piece.offset, frameStart);
+      const auto to = std::min(pieceEnd, frameStart + SummaryFrame);
+      const auto min = summary[3 * ii], max = summary[3 * ii + 1];
+      if (haveSummary && IsLoud(min, max, threshold))
+         builder.Loud(to - from);
+      else if (haveSummary && IsSilent(min, max, threshold))
+         builder.Silent(to - from);
+      else {
+         if (!samples) {
+            samples.reinit(piece.len);
+            pBlock->GetSamples((samplePtr)samples.get(), floatSample,
+               piece.offset, piece.len);
+         }
+         const auto frame = samples.get() + (from - piece.offset);
+         const auto len = to - from;
+         for (size_t jj = 0; jj < len;) {
+            bool loud;
+            const auto count = MagnitudeRuns::RunLength(
+               frame + jj, len - jj, threshold, loud);
+            if (loud)
+               builder.Loud(count);
+            else
+               builder.Silent(count);
+            jj += count;
+         }
+      }
+   }
+   builder.Finish();
+}
+
+}
+
 const ComponentInterfaceSymbol EffectTruncSilence::Symbol
 { XO("Truncate Silence") };
 
@@ -432,49 +575,115 @@ bool EffectTruncSilence::FindSilences
    (RegionList &silences, const TrackList *list,
     const Track *firstTrack, const Track *lastTrack)
 {
-   // Start with the whole selection silent
-   silences.push_back(Region(mT0, mT1));
+   auto range = list->Selected< const WaveTrack >()
+      .StartingWith( firstTrack ).EndingAfter( lastTrack );
+   std::vector< const WaveTrack * > channels{ range.begin(), range.end() };
 
-   // Remove non-silent regions in each track
-   int whichTrack = 0;
-   for (auto wt :
-           list->Selected< const WaveTrack >()
-               .StartingWith( firstTrack ).EndingAfter( lastTrack ) )
+   // Detect silences in all the tracks at once
+   std::vector< RegionList > trackSilences;
+   if (!DetectSilences(channels, trackSilences))
    {
-      // Smallest silent region to detect in frames
-      auto minSilenceFrames =
-         sampleCount(std::max(mInitialAllowedSilence, DEF_MinTruncMs) * wt->GetRate());
-
-      //
-      // Scan the track for silences
-      //
-      RegionList trackSilences;
+      ReplaceProcessedTracks(false);
+      return false;
+   }
 
-      auto index = wt->TimeToLongSamples(mT0);
-      sampleCount silentFrame = 0;
+   // Start with the whole selection silent, and keep what is silent in
+   // every track
+   trackSilences.emplace_back();
+   trackSilences.back().push_back(Region(mT0, mT1));
+   Intersect(silences, trackSilences);
 
-      // Detect silences
-      bool cancelled = !(Analyze(silences, trackSilences, wt, &silentFrame, &index, whichTrack));
+   return true;
+}
 
-      // Buffer has been freed, so we're OK to return if cancelled
-      if (cancelled)
-      {
-         ReplaceProcessedTracks(false);
-         return false;
+bool EffectTruncSilence::DetectSilences
+   (const std::vector< const WaveTrack * > &channels,
+    std::vector< RegionList > &trackSilences)
+{
+   const auto threshold =
+      MagnitudeRuns::RoundUp(DB_TO_LINEAR( mThresholdDB ));
+
+   // Gather the pieces of blocks within the selection, in order, for all
+   // channels
+   WaveTrack::BlockPieces pieces;
+   // Channel of each piece
+   std::vector< size_t > owners;
+   std::vector< size_t > firstPieces;
+   std::vector< sampleCount > minLengths;
+   double total = 0;
+   for (size_t ii = 0; ii < channels.size(); ++ii) {
+      const auto wt = channels[ii];
+      firstPieces.push_back(pieces.size());
+      // Smallest silent region to detect in frames
+      minLengths.push_back(std::max< sampleCount >(1,
+         sampleCount(std::max(mInitialAllowedSilence, DEF_MinTruncMs) *
+            wt->GetRate())));
+      for (auto &piece : wt->GetBlockPieces(
+            wt->TimeToLongSamples(mT0), wt->TimeToLongSamples(mT1))) {
+         total += piece.len;
+         pieces.push_back(std::move(piece));
+         owners.push_back(ii);
       }
+   }
+   firstPieces.push_back(pieces.size());
+   // Found by FindSilentRuns() for each piece
+   std::vector< SilentRuns > runs(pieces.size());
+
+   // Search the pieces on the worker threads
+   double done = 0;
+   size_t nDone = 0;
+   if (!WorkerPool::Get().ParallelForInRounds(pieces.size(),
+      [&](size_t ii){
+         FindSilentRuns(pieces[ii], runs[ii], threshold,
+            minLengths[owners[ii]]);
+      },
+      [&](size_t count){
+         for (; nDone < count; ++nDone)
+            done += pieces[nDone].len;
+         return !TotalProgress(detectFrac * done / total);
+      }))
+      return false;
 
-      if (silentFrame >= minSilenceFrames)
-      {
-         // Track ended in silence -- record region
-         trackSilences.push_back(Region(
-            wt->LongSamplesToTime(index - silentFrame),
-            wt->LongSamplesToTime(index)
-         ));
+   // Join runs across the ends of pieces, and through the gaps between
+   // clips, which read as zero
+   trackSilences.clear();
+   trackSilences.resize(channels.size());
+   for (size_t ii = 0; ii < channels.size(); ++ii) {
+      const auto wt = channels[ii];
+      auto &regions = trackSilences[ii];
+      const auto minLength = minLengths[ii];
+      sampleCount runStart = 0, runEnd = 0;
+      bool inRun = false;
+      const auto endRun = [&]{
+         if (inRun && runEnd - runStart >= minLength)
+            regions.push_back(Region(
+               wt->LongSamplesToTime(runStart),
+               wt->LongSamplesToTime(runEnd)
+            ));
+      };
+      const auto addRun = [&](sampleCount start, sampleCount end){
+         if (inRun && start == runEnd)
+            runEnd = end;
+         else {
+            endRun();
+            inRun = true;
+            runStart = start, runEnd = end;
+         }
+      };
+
+      auto position = wt->TimeToLongSamples(mT0);
+      for (auto jj = firstPieces[ii]; jj < firstPieces[ii + 1]; ++jj) {
+         const auto &piece = pieces[jj];
+         if (piece.start > position)
+            addRun(position, piece.start);
+         for (const auto &run : runs[jj])
+            addRun(run.start, run.end);
+         position = piece.start + piece.len;
       }
-
-      // Intersect with the overall silent region list
-      Intersect(silences, trackSilences);
-      whichTrack++;
+      const auto end = wt->TimeToLongSamples(mT1);
+      if (end > position)
+         addRun(position, end);
+      endRun();
    }
 
    return true;
@@ -857,132 +1066,39 @@ bool EffectTruncSilence::TransferDataFromWindow()
 // EffectTruncSilence implementation
 
 // Finds the intersection of the ordered region lists, stores in dest
-void EffectTruncSilence::Intersect(RegionList &dest, const RegionList &src)
+void EffectTruncSilence::Intersect
+   (RegionList &dest, const std::vector< RegionList > &srcs)
 {
-   RegionList::iterator destIter;
-   destIter = dest.begin();
-   // Any time we reach the end of the dest list we're finished
-   if (destIter == dest.end())
+   dest.clear();
+   if (srcs.empty())
       return;
-   RegionList::iterator curDest = destIter;
-
-   // Operation: find non-silent regions in src, remove them from dest.
-   double nsStart = curDest->start;
-   double nsEnd;
-   bool lastRun = false; // must run the loop one extra time
 
-   RegionList::const_iterator srcIter = src.begin();
-
-   // This logic, causing the loop to run once after end of src, must occur
-   // each time srcIter is updated
-   if (srcIter == src.end())
+   // Walk all the lists at once.  The latest of the current starts and the
+   // earliest of the current ends bound a region common to all, if they are
+   // in order; then step past the region that ends first.
+   std::vector< size_t > positions(srcs.size(), 0);
+   while (true)
    {
-      lastRun = true;
-   }
-
-   while (srcIter != src.end() || lastRun)
-   {
-      // Don't use curSrc unless lastRun is false!
-      RegionList::const_iterator curSrc;
-
-      if (lastRun)
+      double start = -std::numeric_limits<double>::infinity();
+      double end = std::numeric_limits<double>::infinity();
+      size_t earliest = 0;
+      for (size_t ii = 0; ii < srcs.size(); ++ii)
       {
-         // The last non-silent region extends as far as possible
-         nsEnd = std::numeric_limits<double>::max();
-      }
-      else
-      {
-         curSrc = srcIter;
-         nsEnd = curSrc->start;
-      }
-
-      if (nsEnd > nsStart)
-      {
-         // Increment through dest until we have a region that could be affected
-         while (curDest->end <= nsStart)
+         // Any time we reach the end of a list we're finished
+         if (positions[ii] == srcs[ii].size())
+            return;
+         const Region &region = srcs[ii][positions[ii]];
+         start = std::max(start, region.start);
+         if (region.end < end)
          {
-            ++destIter;
-            if (destIter == dest.end())
-            {
-               return;
-            }
-            curDest = destIter;
-         }
-
-         // Check for splitting dest region in two
-         if (nsStart > curDest->start && nsEnd < curDest->end)
-         {
-            // The second region
-            Region r(nsEnd, curDest->end);
-
-            // The first region
-            curDest->end = nsStart;
-
-            // Insert second region after first
-            RegionList::iterator nextIt(destIter);
-            ++nextIt;
-
-            // This should just read: destIter = dest.insert(nextIt, r); but we
-            // work around two two wxList::insert() bugs. First, in some
-            // versions it returns the wrong value. Second, in some versions,
-            // it crashes when you insert at list end.
-            if (nextIt == dest.end())
-               dest.push_back(r);
-            else
-               dest.insert(nextIt, r);
-            ++destIter;          // (now points at the newly-inserted region)
-
-            curDest = destIter;
-         }
-
-         // Check for truncating the end of dest region
-         if (nsStart > curDest->start && nsStart < curDest->end &&
-               nsEnd >= curDest->end)
-         {
-            curDest->end = nsStart;
-
-            ++destIter;
-            if (destIter == dest.end())
-            {
-               return;
-            }
-            curDest = destIter;
-         }
-
-         // Check for all dest regions that need to be removed completely
-         while (nsStart <= curDest->start && nsEnd >= curDest->end)
-         {
-            destIter = dest.erase(destIter);
-            if (destIter == dest.end())
-            {
-               return;
-            }
-            curDest = destIter;
-         }
-
-         // Check for truncating the beginning of dest region
-         if (nsStart <= curDest->start &&
-               nsEnd > curDest->start && nsEnd < curDest->end)
-         {
-            curDest->start = nsEnd;
+            end = region.end;
+            earliest = ii;
          }
       }
 
-      if (lastRun)
-      {
-         // done
-         lastRun = false;
-      }
-      else
-      {
-         // Next non-silent region starts at the end of this silent region
-         nsStart = curSrc->end;
-         ++srcIter;
-         if (srcIter == src.end())
-         {
-            lastRun = true;
-         }
-      }
+      if (start < end)
+         dest.push_back(Region(start, end));
+      ++positions[earliest];
    }
 }
 
@@ -19,6 +19,8 @@
 
 #include "Effect.h"
 
+#include <vector>
+
 class ShuttleGui;
 class wxChoice;
 class wxTextCtrl;
@@ -77,7 +79,8 @@ private:
 
    //ToDo ... put BlendFrames in Effects, Project, or other class
    // void BlendFrames(float* buffer, int leftIndex, int rightIndex, int blendFrameCount);
-   void Intersect(RegionList &dest, const RegionList & src);
+   static void Intersect
+      (RegionList &dest, const std::vector< RegionList > &srcs);
 
    void OnControlChange(wxCommandEvent & evt);
    void UpdateUI();
@@ -87,6 +90,11 @@ private:
    bool FindSilences
       (RegionList &silences, const TrackList *list,
        const Track *firstTrack, const Track *lastTrack);
+   // Find silences of all the channels on the WorkerPool, reading samples
+   // only where the summaries of the blocks leave the answer in doubt
+   bool DetectSilences
+      (const std::vector< const WaveTrack * > &channels,
+       std::vector< RegionList > &trackSilences);
    bool DoRemoval
       (const RegionList &silences, unsigned iGroup, unsigned nGroups, Track *firstTrack, Track *lastTrack,
        double &totalCutLen);
@@ -237,6 +237,23 @@ bool EffectWahwah::SetAutomationParameters(CommandParameters & parms)
 
 // Effect implementation
 
+bool EffectWahwah::ProcessesChannelsInParallel()
+{
+   // Each processor has its own state and only reads the parameters
+   return true;
+}
+
+bool EffectWahwah::InitializeParallelProcessor(int group, ChannelNames chanMap)
+{
+   // As in ProcessInitialize
+   if (chanMap[0] == ChannelNameFrontRight)
+   {
+      mSlaves[group].phase += M_PI;
+   }
+
+   return true;
+}
+
 void EffectWahwah::PopulateOrExchange(ShuttleGui & S)
 {
    S.SetBorder(5);
@@ -74,6 +74,8 @@ public:
 
    // Effect implementation
 
+   bool ProcessesChannelsInParallel() override;
+   bool InitializeParallelProcessor(int group, ChannelNames chanMap) override;
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
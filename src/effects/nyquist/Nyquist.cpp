@@ -88,9 +88,33 @@ effects from this one class.
 #include <ostream>
 #include <sstream>
 #include <float.h>
+#include <chrono>
 
 int NyquistEffect::mReentryCount = 0;
 
+namespace {
+
+// Adds the duration of its scope, in seconds, to a total
+class ScopedTimer
+{
+public:
+   explicit ScopedTimer(double &total)
+      : mTotal{ total }
+      , mStart{ Clock::now() }
+   {}
+   ~ScopedTimer()
+   {
+      mTotal += std::chrono::duration<double>(Clock::now() - mStart).count();
+   }
+
+private:
+   using Clock = std::chrono::steady_clock;
+   double &mTotal;
+   const Clock::time_point mStart;
+};
+
+}
+
 enum
 {
    ID_Editor = 10000,
@@ -138,8 +162,6 @@ END_EVENT_TABLE()
 
 NyquistEffect::NyquistEffect(const wxString &fName)
 {
-   mOutputTrack[0] = mOutputTrack[1] = nullptr;
-
    mAction = XO("Applying Nyquist Effect...");
    mIsPrompt = false;
    mExternal = false;
@@ -664,6 +686,8 @@ bool NyquistEffect::Process()
    mProgressOut = 0;
    mProgressTot = 0;
    mScale = (GetType() == EffectTypeProcess ? 0.5 : 1.0) / GetNumWaveGroups();
+   mEvaluationTime = 0;
+   mTransferTime = 0;
 
    mStop = false;
    mBreak = false;
@@ -967,6 +991,9 @@ bool NyquistEffect::Process()
 
 finish:
 
+   wxLogInfo(wxT("Nyquist effect '%s': %.3f s evaluating Lisp, %.3f s transferring audio"),
+      GetSymbol().Internal(), mEvaluationTime - mTransferTime, mTransferTime);
+
    // Show debug window if trace set in plug-in header and something to show.
    mDebug = (mTrace && !mDebugOutput.Translation().empty())? true : mDebug;
 
@@ -1303,6 +1330,8 @@ bool NyquistEffect::ProcessOne()
       nyx_set_input_audio(StaticGetCallback, (void *)this,
                           (int)mCurNumChannels,
                           curLen, mCurTrack[0]->GetRate());
+      for (size_t i = 0; i < mCurNumChannels; i++)
+         mReaders[i].Start(*mCurTrack[i], mCurStart[i], mCurLen);
    }
 
    // Restore the Nyquist sixteenth note symbol for Generate plug-ins.
@@ -1389,19 +1418,18 @@ bool NyquistEffect::ProcessOne()
       cmd += mCmd;
    }
 
-   // Put the fetch buffers in a clean initial state
-   for (size_t i = 0; i < mCurNumChannels; i++)
-      mCurBuffer[i].Free();
-
-   // Guarantee release of memory when done
+   // Guarantee that the readers release the sample blocks when done
    auto cleanup = finally( [&] {
       for (size_t i = 0; i < mCurNumChannels; i++)
-         mCurBuffer[i].Free();
+         mReaders[i].Stop();
    } );
 
    // Evaluate the expression, which may invoke the get callback, but often does
    // not, leaving that to delayed evaluation of the output sound
-   rval = nyx_eval_expression(cmd.mb_str(wxConvUTF8));
+   {
+      ScopedTimer timer{ mEvaluationTime };
+      rval = nyx_eval_expression(cmd.mb_str(wxConvUTF8));
+   }
 
    // If we're not showing debug window, log errors and warnings:
    const auto output = mDebugOutput.Translation();
@@ -1553,18 +1581,25 @@ bool NyquistEffect::ProcessOne()
 
       outputTrack[i] = mCurTrack[i]->EmptyCopy();
       outputTrack[i]->SetRate( rate );
-
-      // Clean the initial buffer states again for the get callbacks
-      // -- is this really needed?
-      mCurBuffer[i].Free();
    }
 
    // Now fully evaluate the sound
    int success;
    {
-      auto vr0 = valueRestorer( mOutputTrack[0], outputTrack[0].get() );
-      auto vr1 = valueRestorer( mOutputTrack[1], outputTrack[1].get() );
-      success = nyx_get_audio(StaticPutCallback, (void *)this);
+      for (int i = 0; i < outChannels; i++)
+         mWriters[i].Start(*outputTrack[i]);
+      auto cleanup = finally( [&] {
+         for (int i = 0; i < outChannels; i++)
+            mWriters[i].Stop();
+      } );
+
+      {
+         ScopedTimer timer{ mEvaluationTime };
+         success = nyx_get_audio(StaticPutCallback, (void *)this);
+      }
+      if (success)
+         for (int i = 0; i < outChannels; i++)
+            mWriters[i].Finish();
    }
 
    // See if GetCallback found read errors
@@ -2415,46 +2450,16 @@ int NyquistEffect::StaticGetCallback(float *buffer, int channel,
 int NyquistEffect::GetCallback(float *buffer, int ch,
                                long start, long len, long WXUNUSED(totlen))
 {
-   if (mCurBuffer[ch].ptr()) {
-      if ((mCurStart[ch] + start) < mCurBufferStart[ch] ||
-          (mCurStart[ch] + start)+len >
-          mCurBufferStart[ch]+mCurBufferLen[ch]) {
-         mCurBuffer[ch].Free();
-      }
+   try {
+      ScopedTimer timer{ mTransferTime };
+      mReaders[ch].Read(buffer, start, len);
    }
-
-   if (!mCurBuffer[ch].ptr()) {
-      mCurBufferStart[ch] = (mCurStart[ch] + start);
-      mCurBufferLen[ch] = mCurTrack[ch]->GetBestBlockSize(mCurBufferStart[ch]);
-
-      if (mCurBufferLen[ch] < (size_t) len) {
-         mCurBufferLen[ch] = mCurTrack[ch]->GetIdealBlockSize();
-      }
-
-      mCurBufferLen[ch] =
-         limitSampleBufferSize( mCurBufferLen[ch],
-                                mCurStart[ch] + mCurLen - mCurBufferStart[ch] );
-
-      mCurBuffer[ch].Allocate(mCurBufferLen[ch], floatSample);
-      try {
-         mCurTrack[ch]->Get(
-            mCurBuffer[ch].ptr(), floatSample,
-            mCurBufferStart[ch], mCurBufferLen[ch]);
-      }
-      catch ( ... ) {
-         // Save the exception object for re-throw when out of the library
-         mpException = std::current_exception();
-         return -1;
-      }
+   catch ( ... ) {
+      // Save the exception object for re-throw when out of the library
+      mpException = std::current_exception();
+      return -1;
    }
 
-   // We have guaranteed above that this is nonnegative and bounded by
-   // mCurBufferLen[ch]:
-   auto offset = ( mCurStart[ch] + start - mCurBufferStart[ch] ).as_size_t();
-   CopySamples(mCurBuffer[ch].ptr() + offset*SAMPLE_SIZE(floatSample), floatSample,
-               (samplePtr)buffer, floatSample,
-               len);
-
    if (ch == 0) {
       double progress = mScale *
          ( (start+len)/ mCurLen.as_double() );
@@ -2496,7 +2501,8 @@ int NyquistEffect::PutCallback(float *buffer, int channel,
          }
       }
 
-      mOutputTrack[channel]->Append((samplePtr)buffer, floatSample, len);
+      ScopedTimer timer{ mTransferTime };
+      mWriters[channel].Write(buffer, len);
 
       return 0; // success
    }, MakeSimpleGuard( -1 ) ); // translate all exceptions into failure
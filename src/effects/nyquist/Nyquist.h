@@ -13,6 +13,7 @@
 
 #include "../Effect.h"
 #include "../../FileNames.h"
+#include "NyquistAudio.h"
 
 #include "nyx.h"
 
@@ -267,11 +268,13 @@ private:
    double            mProgressTot;
    double            mScale;
 
-   SampleBuffer      mCurBuffer[2];
-   sampleCount       mCurBufferStart[2];
-   size_t            mCurBufferLen[2];
+   NyquistAudioReader mReaders[2];
+   NyquistAudioWriter mWriters[2];
 
-   WaveTrack        *mOutputTrack[2];
+   // Seconds spent in nyx_eval_expression() and nyx_get_audio(), and the
+   // part of that spent in the callbacks reading and writing samples
+   double            mEvaluationTime;
+   double            mTransferTime;
 
    wxArrayString     mCategories;
 
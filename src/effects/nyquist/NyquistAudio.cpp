@@ -0,0 +1,216 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  NyquistAudio.cpp
+
+*******************************************************************//**
+
+\class NyquistAudioReader
+\brief Reads a range of a channel ahead of Nyquist's requests.
+
+*//****************************************************************//**
+
+\class NyquistAudioWriter
+\brief Appends Nyquist's output to a track in whole blocks.
+
+*//*******************************************************************/
+
+#include "NyquistAudio.h"
+
+#include <algorithm>
+
+#include "../../SampleBlock.h"
+#include "../../WaveTrack.h"
+#include "../../WorkerPool.h"
+
+namespace {
+
+// Samples read ahead at a time
+constexpr size_t ChunkSize = 1 << 18;
+
+}
+
+NyquistAudioReader::NyquistAudioReader()
+{
+}
+
+NyquistAudioReader::~NyquistAudioReader()
+{
+   Stop();
+}
+
+void NyquistAudioReader::Start(
+   const WaveTrack &channel, sampleCount start, sampleCount len)
+{
+   Stop();
+
+   // Take the blocks now, so that the worker thread need not visit clips
+   mPieces = channel.GetBlockPieces(start, start + len);
+   mStart = start;
+   mLen = len;
+
+   for (auto &chunk : mChunks) {
+      if (!chunk.samples)
+         chunk.samples.reinit(ChunkSize);
+      chunk.start = 0;
+      chunk.len = 0;
+   }
+   mCurrent = 0;
+   Prefetch(mChunks[1], 0);
+}
+
+void NyquistAudioReader::Read(float *buffer, sampleCount offset, size_t len)
+{
+   while (len > 0) {
+      auto &current = mChunks[mCurrent];
+      if (offset >= mLen) {
+         std::fill(buffer, buffer + len, 0.0f);
+         return;
+      }
+      if (!Contains(current, offset)) {
+         auto &next = mChunks[1 - mCurrent];
+         Wait(next);
+         if (Contains(next, offset))
+            mCurrent = 1 - mCurrent;
+         else {
+            // Out of order; read here, and read ahead from there
+            current.start = offset;
+            current.len = limitSampleBufferSize(ChunkSize, mLen - offset);
+            Fill(current);
+         }
+         const auto &chunk = mChunks[mCurrent];
+         Prefetch(mChunks[1 - mCurrent], chunk.start + chunk.len);
+         continue;
+      }
+
+      const auto from = (offset - current.start).as_size_t();
+      const auto count = std::min(len, current.len - from);
+      std::copy(current.samples.get() + from,
+         current.samples.get() + from + count, buffer);
+      buffer += count, offset += count, len -= count;
+   }
+}
+
+void NyquistAudioReader::Stop()
+{
+   for (auto &chunk : mChunks) {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mFilled.wait(lock, [&]{ return !chunk.pending; });
+      chunk.pException = {};
+      chunk.len = 0;
+   }
+   mPieces.clear();
+   mLen = 0;
+}
+
+bool NyquistAudioReader::Contains(const Chunk &chunk, sampleCount offset) const
+{
+   return offset >= chunk.start && offset < chunk.start + chunk.len;
+}
+
+void NyquistAudioReader::Fill(Chunk &chunk) const
+{
+   const auto buffer = chunk.samples.get();
+   std::fill(buffer, buffer + chunk.len, 0.0f);
+
+   // Positions in the channel
+   const auto start = mStart + chunk.start;
+   const auto end = start + chunk.len;
+   // First piece ending after the start of the chunk
+   auto iter = std::upper_bound(mPieces.begin(), mPieces.end(), start,
+      [](sampleCount position, const WaveTrack::BlockPiece &piece){
+         return position < piece.start + piece.len; });
+   for (; iter != mPieces.end() && iter->start < end; ++iter) {
+      const auto from = std::max(start, iter->start);
+      const auto to = std::min(end, iter->start + iter->len);
+      iter->pBlock->GetSamples(
+         (samplePtr)(buffer + (from - start).as_size_t()), floatSample,
+         iter->offset + (from - iter->start).as_size_t(),
+         (to - from).as_size_t());
+   }
+}
+
+void NyquistAudioReader::Prefetch(Chunk &chunk, sampleCount start)
+{
+   chunk.start = start;
+   chunk.len = limitSampleBufferSize(ChunkSize, mLen - start);
+   if (chunk.len == 0)
+      return;
+
+   {
+      std::lock_guard<std::mutex> guard(mMutex);
+      chunk.pending = true;
+   }
+   WorkerPool::Get().Schedule([this, &chunk]{
+      std::exception_ptr pException;
+      try {
+         Fill(chunk);
+      }
+      catch (...) {
+         pException = std::current_exception();
+      }
+      // Notify under the lock, because a waiter in Stop() may then
+      // destroy this
+      std::lock_guard<std::mutex> guard(mMutex);
+      chunk.pException = pException;
+      chunk.pending = false;
+      mFilled.notify_all();
+   });
+}
+
+void NyquistAudioReader::Wait(Chunk &chunk)
+{
+   std::unique_lock<std::mutex> lock(mMutex);
+   mFilled.wait(lock, [&]{ return !chunk.pending; });
+   if (auto pException = chunk.pException) {
+      chunk.pException = {};
+      chunk.len = 0;
+      std::rethrow_exception(pException);
+   }
+}
+
+NyquistAudioWriter::NyquistAudioWriter()
+{
+}
+
+NyquistAudioWriter::~NyquistAudioWriter()
+{
+}
+
+void NyquistAudioWriter::Start(WaveTrack &track)
+{
+   mpTrack = &track;
+   mBlockSize = track.GetMaxBlockSize();
+   if (mBufferSize < mBlockSize)
+      mBuffer.reinit(mBufferSize = mBlockSize);
+   mLen = 0;
+}
+
+void NyquistAudioWriter::Write(const float *buffer, size_t len)
+{
+   while (len > 0) {
+      const auto count = std::min(len, mBlockSize - mLen);
+      std::copy(buffer, buffer + count, mBuffer.get() + mLen);
+      buffer += count, len -= count;
+      mLen += count;
+      if (mLen == mBlockSize) {
+         mpTrack->Append((samplePtr)mBuffer.get(), floatSample, mLen);
+         mLen = 0;
+      }
+   }
+}
+
+void NyquistAudioWriter::Finish()
+{
+   if (mLen > 0) {
+      mpTrack->Append((samplePtr)mBuffer.get(), floatSample, mLen);
+      mLen = 0;
+   }
+}
+
+void NyquistAudioWriter::Stop()
+{
+   mpTrack = nullptr;
+   mLen = 0;
+}
@@ -0,0 +1,108 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  NyquistAudio.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_EFFECT_NYQUIST_AUDIO__
+#define __AUDACITY_EFFECT_NYQUIST_AUDIO__
+
+#include "../../SampleFormat.h"
+#include "../../WaveTrack.h"
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+///\brief Supplies the samples of a range of one channel to Nyquist, reading
+/// ahead on the WorkerPool
+/**
+ Nyquist asks for input in short pieces, mostly in order.  The reader keeps
+ two chunks: the one being copied from, and the one after it, which a worker
+ thread fills meanwhile from the sample blocks of the channel.  Requests out
+ of order are satisfied by reading on the calling thread.
+
+ The buffers are kept from one range to the next.
+ */
+class NyquistAudioReader final
+{
+public:
+   NyquistAudioReader();
+   ~NyquistAudioReader();
+
+   //! Begin reading len samples of channel from start
+   /*!
+    The channel must not change until Stop(); samples outside its clips
+    read as zero
+    */
+   void Start(const WaveTrack &channel, sampleCount start, sampleCount len);
+
+   //! Copy len samples, offset from the start of the range, into buffer
+   /*!
+    May throw for errors reading the blocks
+    */
+   void Read(float *buffer, sampleCount offset, size_t len);
+
+   //! Wait for any read ahead, and release the blocks
+   void Stop();
+
+private:
+   struct Chunk {
+      Floats samples;
+      // Offset from the start of the range
+      sampleCount start{ 0 };
+      size_t len{ 0 };
+      bool pending{ false };
+      std::exception_ptr pException;
+   };
+
+   bool Contains(const Chunk &chunk, sampleCount offset) const;
+   void Fill(Chunk &chunk) const;
+   void Prefetch(Chunk &chunk, sampleCount start);
+   void Wait(Chunk &chunk);
+
+   WaveTrack::BlockPieces mPieces;
+   // Position of the range in the channel
+   sampleCount mStart{ 0 };
+   sampleCount mLen{ 0 };
+
+   Chunk mChunks[2];
+   // Index of the chunk read from; the other is the next or pending
+   unsigned mCurrent{ 0 };
+
+   std::mutex mMutex;
+   std::condition_variable mFilled;
+};
+
+///\brief Gathers the output of Nyquist and appends it to a track a whole
+/// block at a time
+class NyquistAudioWriter final
+{
+public:
+   NyquistAudioWriter();
+   ~NyquistAudioWriter();
+
+   void Start(WaveTrack &track);
+
+   //! May throw
+   void Write(const float *buffer, size_t len);
+
+   //! Append what remains; may throw
+   void Finish();
+
+   //! Forget the track, discarding any samples not yet appended
+   void Stop();
+
+private:
+   WaveTrack *mpTrack{ nullptr };
+   size_t mBlockSize{ 0 };
+   Floats mBuffer;
+   size_t mBufferSize{ 0 };
+   size_t mLen{ 0 };
+};
+
+#endif
@@ -50,6 +50,7 @@
 
 #include "../widgets/FileDialog/FileDialog.h"
 
+#include "../Envelope.h"
 #include "../FileFormats.h"
 #include "../Mix.h"
 #include "../Prefs.h"
@@ -61,6 +62,8 @@
 #include "../ShuttleGui.h"
 #include "../Tags.h"
 #include "../TimeTrack.h"
+#include "../TrackFreeze.h"
+#include "../WaveClip.h"
 #include "../WaveTrack.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/Warning.h"
@@ -216,13 +219,9 @@ void ExportPlugin::OptionsCreate(ShuttleGui &S, int WXUNUSED(format))
    S.EndHorizontalLay();
 }
 
-//Create a mixer by computing the time warp factor
-std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
-         bool selectionOnly,
-         double startTime, double stopTime,
-         unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
-         double outRate, sampleFormat outFormat,
-         bool highQuality, MixerSpec *mixerSpec)
+// The tracks that are audible in the export
+static WaveTrackConstArray GetInputTracks(const TrackList &tracks,
+         bool selectionOnly)
 {
    WaveTrackConstArray inputTracks;
 
@@ -234,6 +233,26 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
    for (auto pTrack: range)
       inputTracks.push_back(
          pTrack->SharedPointer< const WaveTrack >() );
+   return inputTracks;
+}
+
+//Create a mixer by computing the time warp factor
+std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
+         bool selectionOnly,
+         double startTime, double stopTime,
+         unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
+         double outRate, sampleFormat outFormat,
+         bool highQuality, MixerSpec *mixerSpec)
+{
+   // Bring frozen tracks up to date at the rate this exporter mixes to,
+   // which need not be the project rate.  The renderings only cache the
+   // tracks, so the list is not really modified.  If that fails, export
+   // still proceeds, reading the tracks themselves.
+   GuardedCall( [&]{
+      TrackFreeze::RefreshAll( const_cast<TrackList&>(tracks), outRate );
+   } );
+
+   auto inputTracks = GetInputTracks(tracks, selectionOnly);
    const auto timeTrack = *tracks.Any<const TimeTrack>().begin();
    auto envelope = timeTrack ? timeTrack->GetEnvelope() : nullptr;
    // MB: the stop time should not be warped, this was a bug.
@@ -247,6 +266,54 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
                   highQuality, mixerSpec);
 }
 
+WaveTrackConstArray ExportPlugin::GetPassThroughChannels(
+         const TrackList &tracks,
+         bool selectionOnly,
+         unsigned numOutChannels, double outRate, sampleFormat outFormat,
+         MixerSpec *mixerSpec)
+{
+   if (*tracks.Any<const TimeTrack>().begin())
+      return {};
+
+   auto channels = GetInputTracks(tracks, selectionOnly);
+   if (channels.empty() || channels.size() != numOutChannels ||
+       TrackList::Channels(channels[0].get()).size() != channels.size())
+      return {};
+
+   if (mixerSpec) {
+      if (mixerSpec->GetNumTracks() != numOutChannels ||
+          mixerSpec->GetNumChannels() != numOutChannels)
+         return {};
+      for (unsigned ii = 0; ii < numOutChannels; ++ii)
+         for (unsigned jj = 0; jj < numOutChannels; ++jj)
+            if (mixerSpec->mMap[ii][jj] != (ii == jj))
+               return {};
+   }
+
+   for (const auto &pChannel : channels) {
+      if (pChannel->GetRate() != outRate ||
+          pChannel->GetSampleFormat() != outFormat)
+         return {};
+      for (unsigned c = 0; c < numOutChannels; ++c)
+         if (pChannel->GetChannelGain(c) != 1.0)
+            return {};
+      for (const auto &pClip : pChannel->GetClips()) {
+         const auto &envelope = *pClip->GetEnvelope();
+         if (envelope.GetNumberOfPoints() != 0 ||
+             envelope.GetValue(pClip->GetOffset()) != 1.0)
+            return {};
+      }
+   }
+
+   // Mixer puts the channels of a stereo track left and right, in order
+   if (numOutChannels == 2 &&
+       !(channels[0]->GetChannel() == Track::LeftChannel &&
+         channels[1]->GetChannel() == Track::RightChannel))
+      return {};
+
+   return channels;
+}
+
 void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
    const TranslatableString &title, const TranslatableString &message)
 {
@@ -141,6 +141,19 @@ protected:
          double outRate, sampleFormat outFormat,
          bool highQuality = true, MixerSpec *mixerSpec = NULL);
 
+   //! The channels of the one track that CreateMixer() would mix, when the
+   //! mix would equal them sample for sample; else empty
+   /*!
+    That requires one track with as many channels as the output, at the
+    output rate and in the output format, with unity gain, centered pan,
+    no clip envelopes, no time warping, and no rearrangement of channels.
+    Then its samples may be copied from the sample blocks as stored.
+    */
+   static WaveTrackConstArray GetPassThroughChannels(const TrackList &tracks,
+         bool selectionOnly,
+         unsigned numOutChannels, double outRate, sampleFormat outFormat,
+         MixerSpec *mixerSpec = NULL);
+
    // Create or recycle a dialog.
    static void InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
          const TranslatableString &title, const TranslatableString &message);
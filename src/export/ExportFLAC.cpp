@@ -24,6 +24,9 @@ and libvorbis examples, Monty <monty@xiph.org>
 
 #include "Export.h"
 
+#include <array>
+#include <vector>
+
 #include <wx/ffile.h>
 #include <wx/log.h>
 
@@ -37,11 +40,23 @@ and libvorbis examples, Monty <monty@xiph.org>
 
 #include "../Tags.h"
 #include "../Track.h"
+#include "../WorkerPool.h"
 
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/ProgressDialog.h"
 #include "../wxFileNameWrapper.h"
 
+/* FLACPP_API_VERSION_CURRENT is 6 for libFLAC++ from flac-1.1.3 (see <FLAC++/export.h>) */
+#if !defined FLACPP_API_VERSION_CURRENT || FLACPP_API_VERSION_CURRENT < 6
+#define LEGACY_FLAC
+#else
+#undef LEGACY_FLAC
+#endif
+
+#ifndef LEGACY_FLAC
+#include "FLACChunks.h"
+#endif
+
 //----------------------------------------------------------------------------
 // ExportFLACOptions Class
 //----------------------------------------------------------------------------
@@ -128,6 +143,11 @@ void ExportFLACOptions::PopulateOrExchange(ShuttleGui & S)
          {
             S.TieChoice( XXO("Level:"), FLACLevel);
             S.TieChoice( XXO("Bit depth:"), FLACBitDepth);
+#ifndef LEGACY_FLAC
+            S.AddFixedText( {} );
+            S.TieCheckBox( XXO("Encode in parallel (experimental)"),
+               { wxT("/FileFormats/FLACParallel"), false } );
+#endif
          }
          S.EndMultiColumn();
       }
@@ -163,13 +183,6 @@ bool ExportFLACOptions::TransferDataFromWindow()
 
 #define SAMPLES_PER_RUN 8192u
 
-/* FLACPP_API_VERSION_CURRENT is 6 for libFLAC++ from flac-1.1.3 (see <FLAC++/export.h>) */
-#if !defined FLACPP_API_VERSION_CURRENT || FLACPP_API_VERSION_CURRENT < 6
-#define LEGACY_FLAC
-#else
-#undef LEGACY_FLAC
-#endif
-
 static struct
 {
    bool        do_exhaustive_model_search;
@@ -195,6 +208,51 @@ static struct
 
 //----------------------------------------------------------------------------
 
+// Apply the settings common to the whole-file and the chunk encoders
+static bool ConfigureEncoder(FLAC::Encoder::Stream &encoder,
+   unsigned numChannels, double rate, unsigned bitsPerSample, long level)
+{
+   bool success =
+   encoder.set_channels(numChannels) &&
+   encoder.set_sample_rate(lrint(rate)) &&
+   encoder.set_bits_per_sample(bitsPerSample) &&
+   encoder.set_do_exhaustive_model_search(flacLevels[level].do_exhaustive_model_search) &&
+   encoder.set_do_escape_coding(flacLevels[level].do_escape_coding);
+
+   if (numChannels != 2) {
+      success = success &&
+      encoder.set_do_mid_side_stereo(false) &&
+      encoder.set_loose_mid_side_stereo(false);
+   }
+   else {
+      success = success &&
+      encoder.set_do_mid_side_stereo(flacLevels[level].do_mid_side_stereo) &&
+      encoder.set_loose_mid_side_stereo(flacLevels[level].loose_mid_side_stereo);
+   }
+
+   return success &&
+   encoder.set_qlp_coeff_precision(flacLevels[level].qlp_coeff_precision) &&
+   encoder.set_min_residual_partition_order(flacLevels[level].min_residual_partition_order) &&
+   encoder.set_max_residual_partition_order(flacLevels[level].max_residual_partition_order) &&
+   encoder.set_rice_parameter_search_dist(flacLevels[level].rice_parameter_search_dist) &&
+   encoder.set_max_lpc_order(flacLevels[level].max_lpc_order);
+}
+
+#ifndef LEGACY_FLAC
+
+namespace {
+
+// Each chunk but the last must be a whole number of blocks
+constexpr size_t ChunkLength = 64 * FLACChunks::BlockSize;
+static_assert(ChunkLength % SAMPLES_PER_RUN == 0,
+   "chunks must be whole numbers of mixer runs");
+
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
 struct FLAC__StreamMetadataDeleter {
    void operator () (FLAC__StreamMetadata *p) const
    { if (p) ::FLAC__metadata_object_delete(p); }
@@ -227,6 +285,21 @@ private:
 
    bool GetMetadata(AudacityProject *project, const Tags *tags);
 
+#ifndef LEGACY_FLAC
+   //! Encode stretches of the mix in parallel and stitch the frames together
+   ProgressResult ExportInChunks(std::unique_ptr<ProgressDialog> &pDialog,
+               unsigned numChannels,
+               const wxFileNameWrapper &fName,
+               bool selectedOnly,
+               double t0,
+               double t1,
+               MixerSpec *mixerSpec,
+               const TrackList &tracks,
+               double rate,
+               sampleFormat format,
+               long level);
+#endif
+
    // Should this be a stack variable instead in Export?
    FLAC__StreamMetadataHandle mMetadata;
 };
@@ -270,12 +343,10 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    FLAC::Encoder::File encoder;
 
    bool success = true;
-   success = success &&
 #ifdef LEGACY_FLAC
-   encoder.set_filename(OSOUTPUT(fName)) &&
+   success = success &&
+   encoder.set_filename(OSOUTPUT(fName));
 #endif
-   encoder.set_channels(numChannels) &&
-   encoder.set_sample_rate(lrint(rate));
 
    // See note in GetMetadata() about a bug in libflac++ 1.1.2
    if (success && !GetMetadata(project, metadata)) {
@@ -296,40 +367,21 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    } );
 
    sampleFormat format;
+   unsigned bitsPerSample;
    if (bitDepthPref == wxT("24")) {
       format = int24Sample;
-      success = success && encoder.set_bits_per_sample(24);
+      bitsPerSample = 24;
    } else { //convert float to 16 bits
       format = int16Sample;
-      success = success && encoder.set_bits_per_sample(16);
+      bitsPerSample = 16;
    }
 
-
    // Duplicate the flac command line compression levels
    if (levelPref < 0 || levelPref > 8) {
       levelPref = 5;
    }
    success = success &&
-   encoder.set_do_exhaustive_model_search(flacLevels[levelPref].do_exhaustive_model_search) &&
-   encoder.set_do_escape_coding(flacLevels[levelPref].do_escape_coding);
-
-   if (numChannels != 2) {
-      success = success &&
-      encoder.set_do_mid_side_stereo(false) &&
-      encoder.set_loose_mid_side_stereo(false);
-   }
-   else {
-      success = success &&
-      encoder.set_do_mid_side_stereo(flacLevels[levelPref].do_mid_side_stereo) &&
-      encoder.set_loose_mid_side_stereo(flacLevels[levelPref].loose_mid_side_stereo);
-   }
-
-   success = success &&
-   encoder.set_qlp_coeff_precision(flacLevels[levelPref].qlp_coeff_precision) &&
-   encoder.set_min_residual_partition_order(flacLevels[levelPref].min_residual_partition_order) &&
-   encoder.set_max_residual_partition_order(flacLevels[levelPref].max_residual_partition_order) &&
-   encoder.set_rice_parameter_search_dist(flacLevels[levelPref].rice_parameter_search_dist) &&
-   encoder.set_max_lpc_order(flacLevels[levelPref].max_lpc_order);
+      ConfigureEncoder(encoder, numChannels, rate, bitsPerSample, levelPref);
 
    if (!success) {
       // TODO: more precise message
@@ -337,6 +389,14 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
       return ProgressResult::Cancelled;
    }
 
+#ifndef LEGACY_FLAC
+   bool parallel = false;
+   gPrefs->Read(wxT("/FileFormats/FLACParallel"), &parallel, false);
+   if (parallel && WorkerPool::Get().Concurrency() > 1)
+      return ExportInChunks(pDialog, numChannels, fName, selectionOnly,
+         t0, t1, mixerSpec, tracks, rate, format, levelPref);
+#endif
+
 #ifdef LEGACY_FLAC
    encoder.init();
 #else
@@ -434,6 +494,172 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    return updateResult;
 }
 
+#ifndef LEGACY_FLAC
+ProgressResult ExportFLAC::ExportInChunks(
+                        std::unique_ptr<ProgressDialog> &pDialog,
+                        unsigned numChannels,
+                        const wxFileNameWrapper &fName,
+                        bool selectionOnly,
+                        double t0,
+                        double t1,
+                        MixerSpec *mixerSpec,
+                        const TrackList &tracks,
+                        double rate,
+                        sampleFormat format,
+                        long level)
+{
+   auto updateResult = ProgressResult::Success;
+   const unsigned bitsPerSample = (format == int24Sample) ? 24 : 16;
+   const unsigned bytesPerSample = bitsPerSample / 8;
+
+   wxFFile f;     // will be closed when it goes out of scope
+   const auto path = fName.GetFullPath();
+   if (!f.Open(path, wxT("wb"))) {
+      AudacityMessageBox( XO("FLAC export couldn't open %s").Format( path ) );
+      return ProgressResult::Cancelled;
+   }
+
+   // Reserve room for the header; its size does not depend on the contents
+   // of STREAMINFO, which are known only at the end
+   std::array<FLAC__byte, 16> md5{};
+   auto header = FLACChunks::MakeStreamHeader(mMetadata.get(),
+      numChannels, lrint(rate), bitsPerSample, 0, 0, 0, md5);
+   if (f.Write(header.data(), header.size()) != header.size())
+      return ProgressResult::Failed;
+
+   // The whole mix comes from one mixer, in order, on this thread:  the
+   // mixer reads the project database, and its resampler and dither
+   // carry state from each run to the next
+   auto mixer = CreateMixer(tracks, selectionOnly,
+                            t0, t1,
+                            numChannels, SAMPLES_PER_RUN, false,
+                            rate, format, true, mixerSpec);
+
+   InitProgress( pDialog, fName,
+      selectionOnly
+         ? XO("Exporting the selected audio as FLAC")
+         : XO("Exporting the audio as FLAC") );
+   auto &progress = *pDialog;
+
+   struct Chunk {
+      ArraysOf<FLAC__int32> samples;
+      size_t length{ 0 };
+      FLACChunks::ChunkEncoder encoder;
+      bool success{ false };
+   };
+   auto &pool = WorkerPool::Get();
+   const size_t nChunks = 2 * pool.Concurrency();
+   ArrayOf<Chunk> chunks{ nChunks };
+   for (size_t ii = 0; ii < nChunks; ++ii)
+      chunks[ii].samples.reinit(numChannels, ChunkLength);
+
+   FLACChunks::MD5 digest;
+   ArrayOf<FLAC__byte> digestBuffer{
+      SAMPLES_PER_RUN * numChannels * bytesPerSample };
+   FLAC__uint64 totalSamples = 0;
+   FLAC__uint32 frameNumber = 0;
+   size_t minFrameSize = 0, maxFrameSize = 0;
+   std::vector<FLAC__byte> stitched;
+
+   bool exhausted = false;
+   while (!exhausted && updateResult == ProgressResult::Success) {
+      // Mix a wave of chunks
+      size_t nFilled = 0;
+      for (; nFilled < nChunks && !exhausted &&
+             updateResult == ProgressResult::Success; ++nFilled) {
+         auto &chunk = chunks[nFilled];
+         chunk.length = 0;
+         while (chunk.length < ChunkLength) {
+            auto samplesThisRun = mixer->Process(
+               std::min<size_t>(SAMPLES_PER_RUN, ChunkLength - chunk.length));
+            if (samplesThisRun == 0) {
+               exhausted = true;
+               break;
+            }
+
+            auto pDigest = digestBuffer.get();
+            for (size_t i = 0; i < numChannels; i++) {
+               samplePtr mixed = mixer->GetBuffer(i);
+               auto dest = chunk.samples[i].get() + chunk.length;
+               if (format == int24Sample) {
+                  for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++)
+                     dest[j] = ((int *)mixed)[j];
+               }
+               else {
+                  for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++)
+                     dest[j] = ((short *)mixed)[j];
+               }
+            }
+            // The digest is of interleaved little endian samples
+            for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++)
+               for (size_t i = 0; i < numChannels; i++) {
+                  auto value = chunk.samples[i][chunk.length + j];
+                  for (unsigned k = 0; k < bytesPerSample; ++k)
+                     *pDigest++ = (value >> (8 * k)) & 0xFF;
+               }
+            digest.Append(digestBuffer.get(), pDigest - digestBuffer.get());
+
+            chunk.length += samplesThisRun;
+            updateResult =
+               progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+            if (updateResult != ProgressResult::Success)
+               break;
+         }
+         if (chunk.length == 0)
+            break;
+      }
+
+      if (!(updateResult == ProgressResult::Success ||
+            updateResult == ProgressResult::Stopped))
+         return updateResult;
+
+      // Encode the wave
+      pool.ParallelFor(nFilled, [&](size_t ii){
+         auto &chunk = chunks[ii];
+         auto &encoder = chunk.encoder;
+         chunk.success =
+            ConfigureEncoder(encoder, numChannels, rate, bitsPerSample, level) &&
+            encoder.Encode(
+               reinterpret_cast<FLAC__int32**>( chunk.samples.get() ),
+               chunk.length);
+      });
+
+      // Renumber and write the frames in order
+      for (size_t ii = 0; ii < nFilled; ++ii) {
+         auto &chunk = chunks[ii];
+         if (!chunk.success) {
+            // TODO: more precise message
+            AudacityMessageBox( XO("Unable to export") );
+            return ProgressResult::Cancelled;
+         }
+         stitched.clear();
+         size_t frameStart = 0;
+         for (auto frameEnd : chunk.encoder.mFrameEnds) {
+            auto size = FLACChunks::AppendFrame(stitched,
+               chunk.encoder.mBytes.data() + frameStart,
+               frameEnd - frameStart, frameNumber++);
+            minFrameSize = minFrameSize ? std::min(minFrameSize, size) : size;
+            maxFrameSize = std::max(maxFrameSize, size);
+            frameStart = frameEnd;
+         }
+         if (f.Write(stitched.data(), stitched.size()) != stitched.size())
+            return ProgressResult::Failed;
+         totalSamples += chunk.length;
+      }
+   }
+
+   header = FLACChunks::MakeStreamHeader(mMetadata.get(),
+      numChannels, lrint(rate), bitsPerSample,
+      totalSamples, minFrameSize, maxFrameSize, digest.Finish());
+   if (!f.Seek(0) ||
+       f.Write(header.data(), header.size()) != header.size() ||
+       !f.Flush() || !f.Close())
+      return ProgressResult::Failed;
+
+   return updateResult;
+}
+#endif
+
 void ExportFLAC::OptionsCreate(ShuttleGui &S, int format)
 {
    S.AddWindow( safenew ExportFLACOptions{ S.GetParent(), format } );
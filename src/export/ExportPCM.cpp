@@ -21,6 +21,8 @@
 #include <wx/textctrl.h>
 #include <wx/window.h>
 
+#include <future>
+
 #include "sndfile.h"
 
 #include "../FileFormats.h"
@@ -30,6 +32,8 @@
 #include "../ShuttleGui.h"
 #include "../Tags.h"
 #include "../Track.h"
+#include "../WaveTrack.h"
+#include "../WorkerPool.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/ErrorDialog.h"
 #include "../widgets/ProgressDialog.h"
@@ -610,10 +614,27 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
 
       {
          wxASSERT(info.channels >= 0);
-         auto mixer = CreateMixer(tracks, selectionOnly,
-                                  t0, t1,
-                                  info.channels, maxBlockLen, true,
-                                  rate, format, true, mixerSpec);
+
+         // An untouched track at the project rate and in the export format
+         // can be copied from its sample blocks as stored, skipping the
+         // conversions to and from float in the mixer
+         const auto channels = GetPassThroughChannels(tracks, selectionOnly,
+            info.channels, rate, format, mixerSpec);
+         std::unique_ptr<Mixer> mixer;
+         sampleCount pos, end;
+         SampleBuffer planar;
+         if (channels.empty())
+            mixer = CreateMixer(tracks, selectionOnly,
+                                t0, t1,
+                                info.channels, maxBlockLen, true,
+                                rate, format, true, mixerSpec);
+         else {
+            // Mixer would start and stop at the same samples
+            pos = channels[0]->TimeToLongSamples(t0);
+            end = channels[0]->TimeToLongSamples(t1);
+            if (channels.size() > 1)
+               planar.Allocate(maxBlockLen, format);
+         }
 
          InitProgress( pDialog, fName,
             (selectionOnly
@@ -622,36 +643,107 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
                .Format( formatStr ) );
          auto &progress = *pDialog;
 
-         while (updateResult == ProgressResult::Success) {
-            sf_count_t samplesWritten;
-            size_t numSamples = mixer->Process(maxBlockLen);
+         // Write each block on a worker thread while the next one is made.
+         // Reading and mixing stay here, because they use the project
+         // database, and writes stay in order, one at a time, because
+         // libsndfile encodes and updates the header sequentially.
+         const auto frameBytes = info.channels * SAMPLE_SIZE(format);
+         SampleBuffer buffers[2]{
+            { maxBlockLen * info.channels, format },
+            { maxBlockLen * info.channels, format },
+         };
+         std::future<sf_count_t> pending;
+         size_t pendingSamples = 0;
+         auto cleanup = finally( [&] {
+            // Don't destroy the buffers or the file under the writer
+            if (pending.valid())
+               pending.wait();
+         } );
+
+         // Fill dest with the next block, returning its length
+         auto fetch = [&](samplePtr dest) -> size_t {
+            if (mixer) {
+               // The mixer reuses its buffer, so give the writer a copy
+               auto numSamples = mixer->Process(maxBlockLen);
+               memcpy(dest, mixer->GetBuffer(), numSamples * frameBytes);
+               return numSamples;
+            }
+            auto numSamples = limitSampleBufferSize(maxBlockLen, end - pos);
+            if (channels.size() == 1)
+               channels[0]->Get(dest, format, pos, numSamples);
+            else {
+               for (size_t c = 0; c < channels.size(); ++c) {
+                  channels[c]->Get(planar.ptr(), format, pos, numSamples);
+                  CopySamples(planar.ptr(), format,
+                     dest + c * SAMPLE_SIZE(format), format,
+                     numSamples, false, 1, info.channels);
+               }
+            }
+            pos += numSamples;
+            return numSamples;
+         };
+         auto currentTime = [&]{
+            return mixer
+               ? mixer->MixGetCurrentTime()
+               : channels[0]->LongSamplesToTime(pos);
+         };
+
+         // Returns false, after reporting, if the previous write failed
+         auto finishWrite = [&]{
+            if (!pending.valid())
+               return true;
+            auto samplesWritten = pending.get();
+            if (static_cast<size_t>(samplesWritten) == pendingSamples)
+               return true;
+            char buffer2[1000];
+            sf_error_str(sf.get(), buffer2, 1000);
+            AudacityMessageBox(
+               XO(
+               /* i18n-hint: %s will be the error message from libsndfile, which
+                * is usually something unhelpful (and untranslated) like "system
+                * error" */
+"Error while writing %s file (disk full?).\nLibsndfile says \"%s\"")
+                  .Format( formatStr, wxString::FromAscii(buffer2) ));
+            return false;
+         };
 
-            if (numSamples == 0)
-               break;
+         for (int iBuffer = 0; updateResult == ProgressResult::Success;
+              iBuffer = 1 - iBuffer) {
+            samplePtr mixed = buffers[iBuffer].ptr();
+            size_t numSamples = fetch(mixed);
 
-            samplePtr mixed = mixer->GetBuffer();
-
-            if (format == int16Sample)
-               samplesWritten = SFCall<sf_count_t>(sf_writef_short, sf.get(), (short *)mixed, numSamples);
-            else
-               samplesWritten = SFCall<sf_count_t>(sf_writef_float, sf.get(), (float *)mixed, numSamples);
-
-            if (static_cast<size_t>(samplesWritten) != numSamples) {
-               char buffer2[1000];
-               sf_error_str(sf.get(), buffer2, 1000);
-               AudacityMessageBox(
-                  XO(
-                  /* i18n-hint: %s will be the error message from libsndfile, which
-                   * is usually something unhelpful (and untranslated) like "system
-                   * error" */
-"Error while writing %s file (disk full?).\nLibsndfile says \"%s\"")
-                     .Format( formatStr, wxString::FromAscii(buffer2) ));
+            if (!finishWrite()) {
                updateResult = ProgressResult::Cancelled;
                break;
             }
-            
-            updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+
+            if (numSamples == 0)
+               break;
+
+            auto pPromise = std::make_shared< std::promise<sf_count_t> >();
+            pending = pPromise->get_future();
+            pendingSamples = numSamples;
+            WorkerPool::Get().Schedule(
+               [pPromise, mixed, numSamples, format, pSf = sf.get()]{
+                  try {
+                     if (format == int16Sample)
+                        pPromise->set_value(SFCall<sf_count_t>(
+                           sf_writef_short, pSf, (short *)mixed, numSamples));
+                     else
+                        pPromise->set_value(SFCall<sf_count_t>(
+                           sf_writef_float, pSf, (float *)mixed, numSamples));
+                  }
+                  catch (...) {
+                     pPromise->set_exception(std::current_exception());
+                  }
+               } );
+
+            updateResult = progress.Update(currentTime() - t0, t1 - t0);
          }
+
+         // Complete the last write even if stopped
+         if (!finishWrite() && updateResult != ProgressResult::Cancelled)
+            updateResult = ProgressResult::Cancelled;
       }
       
       // Install the WAV metata in a "LIST" chunk at the end of the file
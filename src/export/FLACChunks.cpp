@@ -0,0 +1,259 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FLACChunks.cpp
+
+*******************************************************************//**
+
+\file FLACChunks.cpp
+\brief Renumbering and concatenation of FLAC frames from separate encoders,
+with the STREAMINFO for the whole.
+
+*//*******************************************************************/
+
+#include "FLACChunks.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace FLACChunks {
+
+namespace {
+
+FLAC__byte Crc8(const FLAC__byte *data, size_t len)
+{
+   // Polynomial x^8 + x^2 + x + 1, as for frame headers
+   unsigned crc = 0;
+   while (len--) {
+      crc ^= *data++;
+      for (int ii = 0; ii < 8; ++ii)
+         crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+      crc &= 0xFF;
+   }
+   return crc;
+}
+
+unsigned Crc16(const FLAC__byte *data, size_t len)
+{
+   // Polynomial x^16 + x^15 + x^2 + 1, as for whole frames
+   static const auto table = []{
+      std::array<unsigned short, 256> result;
+      for (unsigned ii = 0; ii < 256; ++ii) {
+         unsigned crc = ii << 8;
+         for (int jj = 0; jj < 8; ++jj)
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) : (crc << 1);
+         result[ii] = crc & 0xFFFF;
+      }
+      return result;
+   }();
+   unsigned crc = 0;
+   while (len--)
+      crc = ((crc << 8) ^ table[(crc >> 8) ^ *data++]) & 0xFFFF;
+   return crc;
+}
+
+}
+
+void MD5::Append(const FLAC__byte *data, size_t len)
+{
+   mLength += len;
+   while (len > 0) {
+      const auto count = std::min(len, mBuffer.size() - mFill);
+      memcpy(mBuffer.data() + mFill, data, count);
+      mFill += count, data += count, len -= count;
+      if (mFill == mBuffer.size()) {
+         Transform(mBuffer.data());
+         mFill = 0;
+      }
+   }
+}
+
+std::array<FLAC__byte, 16> MD5::Finish()
+{
+   const auto bits = mLength * 8;
+   const FLAC__byte pad = 0x80;
+   Append(&pad, 1);
+   const FLAC__byte zero = 0;
+   while (mFill != 56)
+      Append(&zero, 1);
+   FLAC__byte length[8];
+   for (int ii = 0; ii < 8; ++ii)
+      length[ii] = (bits >> (8 * ii)) & 0xFF;
+   Append(length, 8);
+
+   std::array<FLAC__byte, 16> result;
+   for (int ii = 0; ii < 16; ++ii)
+      result[ii] = (mState[ii / 4] >> (8 * (ii % 4))) & 0xFF;
+   return result;
+}
+
+void MD5::Transform(const FLAC__byte *block)
+{
+   static const FLAC__uint32 K[64] = {
+      0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+      0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+      0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+      0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+      0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+      0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+      0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+      0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+      0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+      0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+      0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+      0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+      0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+      0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+      0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+      0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+   };
+   static const int S[16] = {
+      7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21
+   };
+
+   FLAC__uint32 M[16];
+   for (int ii = 0; ii < 16; ++ii)
+      M[ii] = block[4 * ii] | (block[4 * ii + 1] << 8) |
+         (block[4 * ii + 2] << 16) |
+         (FLAC__uint32(block[4 * ii + 3]) << 24);
+
+   auto a = mState[0], b = mState[1], c = mState[2], d = mState[3];
+   for (int ii = 0; ii < 64; ++ii) {
+      FLAC__uint32 f;
+      int g;
+      switch (ii / 16) {
+      case 0: f = (b & c) | (~b & d); g = ii; break;
+      case 1: f = (d & b) | (~d & c); g = (5 * ii + 1) % 16; break;
+      case 2: f = b ^ c ^ d; g = (3 * ii + 5) % 16; break;
+      default: f = c ^ (b | ~d); g = (7 * ii) % 16; break;
+      }
+      const auto s = S[4 * (ii / 16) + ii % 4];
+      const auto sum = a + f + K[ii] + M[g];
+      a = d, d = c, c = b;
+      b += (sum << s) | (sum >> (32 - s));
+   }
+   mState[0] += a, mState[1] += b, mState[2] += c, mState[3] += d;
+}
+
+bool ChunkEncoder::Encode(const FLAC__int32 *const samples[], size_t length)
+{
+   mBytes.clear();
+   mFrameEnds.clear();
+   return set_blocksize(BlockSize) &&
+      set_verify(true) &&
+      init() == FLAC__STREAM_ENCODER_INIT_STATUS_OK &&
+      process(samples, length) &&
+      finish();
+}
+
+::FLAC__StreamEncoderWriteStatus ChunkEncoder::write_callback(
+   const FLAC__byte buffer[], size_t bytes,
+   unsigned samples, unsigned)
+{
+   // libFLAC passes each frame whole; samples is zero only for the
+   // metadata, which is written separately for the stitched stream
+   if (samples > 0) {
+      mBytes.insert(mBytes.end(), buffer, buffer + bytes);
+      mFrameEnds.push_back(mBytes.size());
+   }
+   return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+size_t AppendFrame(std::vector<FLAC__byte> &out,
+   const FLAC__byte *frame, size_t size, FLAC__uint32 number)
+{
+   // Skip the sync code and the fixed fields to find the coded frame number,
+   // which is "UTF-8" style: the leading ones of the first byte count the
+   // bytes, if more than one
+   size_t codedLength = 1;
+   if (frame[4] & 0x80) {
+      codedLength = 0;
+      for (auto byte = frame[4]; byte & 0x80; byte <<= 1)
+         ++codedLength;
+   }
+   // Block size and sample rate may follow if they have no short code
+   const auto blockSizeCode = frame[2] >> 4;
+   const auto rateCode = frame[2] & 0x0F;
+   const size_t extraLength =
+      (blockSizeCode == 6 ? 1 : blockSizeCode == 7 ? 2 : 0) +
+      (rateCode == 12 ? 1 : (rateCode == 13 || rateCode == 14) ? 2 : 0);
+   const auto oldHeaderLength = 4 + codedLength + extraLength + 1;
+
+   const auto start = out.size();
+   out.insert(out.end(), frame, frame + 4);
+   static const FLAC__uint32 limits[] =
+      { 0x80, 0x800, 0x10000, 0x200000, 0x4000000 };
+   size_t newLength = 1;
+   while (newLength < 6 && number >= limits[newLength - 1])
+      ++newLength;
+   if (newLength == 1)
+      out.push_back(number);
+   else {
+      out.push_back(((0xFF00 >> newLength) & 0xFF) |
+         (number >> (6 * (newLength - 1))));
+      for (auto ii = newLength - 1; ii-- > 0;)
+         out.push_back(0x80 | ((number >> (6 * ii)) & 0x3F));
+   }
+   out.insert(out.end(), frame + 4 + codedLength,
+      frame + 4 + codedLength + extraLength);
+   out.push_back(Crc8(&out[start], out.size() - start));
+
+   out.insert(out.end(), frame + oldHeaderLength, frame + size - 2);
+   const auto crc = Crc16(&out[start], out.size() - start);
+   out.push_back(crc >> 8);
+   out.push_back(crc & 0xFF);
+   return out.size() - start;
+}
+
+std::vector<FLAC__byte> MakeStreamHeader(
+   const FLAC__StreamMetadata *pComments,
+   unsigned numChannels, unsigned rate, unsigned bitsPerSample,
+   FLAC__uint64 totalSamples, size_t minFrameSize, size_t maxFrameSize,
+   const std::array<FLAC__byte, 16> &md5)
+{
+   std::vector<FLAC__byte> result{ 'f', 'L', 'a', 'C' };
+   auto putBigEndian = [&](FLAC__uint64 value, int nBytes) {
+      while (nBytes--)
+         result.push_back((value >> (8 * nBytes)) & 0xFF);
+   };
+   auto putLittleEndian = [&](FLAC__uint32 value) {
+      for (int ii = 0; ii < 4; ++ii)
+         result.push_back((value >> (8 * ii)) & 0xFF);
+   };
+
+   // STREAMINFO
+   result.push_back(pComments ? 0x00 : 0x80);
+   putBigEndian(FLAC__STREAM_METADATA_STREAMINFO_LENGTH, 3);
+   putBigEndian(BlockSize, 2);
+   putBigEndian(BlockSize, 2);
+   putBigEndian(minFrameSize, 3);
+   putBigEndian(maxFrameSize, 3);
+   putBigEndian((FLAC__uint64(rate) << 44) |
+      (FLAC__uint64(numChannels - 1) << 41) |
+      (FLAC__uint64(bitsPerSample - 1) << 36) |
+      (totalSamples & 0xFFFFFFFFFull), 8);
+   result.insert(result.end(), md5.begin(), md5.end());
+
+   // VORBIS_COMMENT
+   if (pComments) {
+      const auto &comments = pComments->data.vorbis_comment;
+      FLAC__uint32 length = 4 + comments.vendor_string.length + 4;
+      for (FLAC__uint32 ii = 0; ii < comments.num_comments; ++ii)
+         length += 4 + comments.comments[ii].length;
+      result.push_back(0x80 | FLAC__METADATA_TYPE_VORBIS_COMMENT);
+      putBigEndian(length, 3);
+      auto putEntry = [&](const FLAC__StreamMetadata_VorbisComment_Entry &entry) {
+         putLittleEndian(entry.length);
+         result.insert(result.end(), entry.entry, entry.entry + entry.length);
+      };
+      putEntry(comments.vendor_string);
+      putLittleEndian(comments.num_comments);
+      for (FLAC__uint32 ii = 0; ii < comments.num_comments; ++ii)
+         putEntry(comments.comments[ii]);
+   }
+
+   return result;
+}
+
+}
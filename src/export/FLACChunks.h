@@ -0,0 +1,83 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FLACChunks.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_FLAC_CHUNKS__
+#define __AUDACITY_FLAC_CHUNKS__
+
+#include <array>
+#include <vector>
+
+#include "FLAC++/encoder.h"
+
+//! Encoding of FLAC streams in independent chunks
+/*!
+ FLAC frames do not depend on each other, so disjoint stretches of audio can
+ be given to separate encoders, perhaps on separate threads.  The frames they
+ produce are then renumbered and concatenated, and the STREAMINFO block that
+ the separate encoders cannot know is made from the whole.
+ */
+namespace FLACChunks {
+
+//! Block size of every chunk encoder, which libFLAC also chooses by default
+/*! Each chunk but the last must be a whole number of blocks, so that no short
+ frame appears in the middle of the stitched stream */
+constexpr unsigned BlockSize = 4096u;
+
+/// RFC 1321 message digest, which STREAMINFO holds for the decoded samples
+/*! Append interleaved little endian samples of the width in the stream */
+class MD5
+{
+public:
+   void Append(const FLAC__byte *data, size_t len);
+   std::array<FLAC__byte, 16> Finish();
+
+private:
+   void Transform(const FLAC__byte *block);
+
+   FLAC__uint32 mState[4]{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+   std::array<FLAC__byte, 64> mBuffer;
+   size_t mFill{ 0 };
+   FLAC__uint64 mLength{ 0 };
+};
+
+/// Collects the frames of one chunk in memory
+class ChunkEncoder final : public FLAC::Encoder::Stream
+{
+public:
+   //! Encode length samples of each channel, as frames of BlockSize
+   /*! Channels, rate, bits and compression must be set already.  libFLAC's
+    verification is enabled, so every frame is decoded again and compared with
+    the input before it is accepted */
+   bool Encode(const FLAC__int32 *const samples[], size_t length);
+
+   std::vector<FLAC__byte> mBytes;
+   std::vector<size_t> mFrameEnds;
+
+protected:
+   ::FLAC__StreamEncoderWriteStatus write_callback(
+      const FLAC__byte buffer[], size_t bytes,
+      unsigned samples, unsigned) override;
+};
+
+//! Copy a frame to out, giving it a new number in the header
+/*! Both checksums are recomputed; returns the new size of the frame */
+size_t AppendFrame(std::vector<FLAC__byte> &out,
+   const FLAC__byte *frame, size_t size, FLAC__uint32 number);
+
+//! The stream marker and the metadata blocks that precede the frames
+/*! The size does not depend on the STREAMINFO values, so a placeholder may be
+ written first and overwritten when the stream is complete */
+std::vector<FLAC__byte> MakeStreamHeader(
+   const FLAC__StreamMetadata *pComments,
+   unsigned numChannels, unsigned rate, unsigned bitsPerSample,
+   FLAC__uint64 totalSamples, size_t minFrameSize, size_t maxFrameSize,
+   const std::array<FLAC__byte, 16> &md5);
+
+}
+
+#endif
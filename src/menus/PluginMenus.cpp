@@ -1021,6 +1021,9 @@ BaseItemSharedPtr ExtraScriptablesIIMenu()
       Command( wxT("CompareAudio"), XXO("Compare Audio..."),
          FN(OnAudacityCommand),
          AudioIONotBusyFlag() ),
+      Command( wxT("MeasureLoudness"), XXO("Measure Loudness..."),
+         FN(OnAudacityCommand),
+         AudioIONotBusyFlag() ),
       // i18n-hint: Screenshot in the help menu has a much bigger dialog.
       Command( wxT("Screenshot"), XXO("Screenshot (short format)..."),
          FN(OnAudacityCommand),
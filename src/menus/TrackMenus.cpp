@@ -17,6 +17,7 @@
 #include "../SelectUtilities.h"
 #include "../ShuttleGui.h"
 #include "../TimeTrack.h"
+#include "../TrackFreeze.h"
 #include "../TrackPanelAx.h"
 #include "../TrackPanel.h"
 #include "../TrackUtilities.h"
@@ -727,7 +728,6 @@ void OnResample(const CommandContext &context)
    const auto &settings = ProjectSettings::Get( project );
    auto projectRate = settings.GetRate();
    auto &tracks = TrackList::Get( project );
-   auto &undoManager = UndoManager::Get( project );
    auto &window = ProjectWindow::Get( project );
 
    int newRate;
@@ -798,36 +798,53 @@ void OnResample(const CommandContext &context)
          &window);
    }
 
-   int ndx = 0;
-   auto flags = UndoPush::NONE;
-   for (auto wt : tracks.Selected< WaveTrack >())
+   // The channels of each track are resampled together, and all tracks
+   // at once
+   std::vector<std::vector<WaveTrack*>> selected;
+   for (auto wt : tracks.SelectedLeaders< WaveTrack >())
    {
-      auto msg = XO("Resampling track %d").Format( ++ndx );
-
-      ProgressDialog progress(XO("Resample"), msg);
-
-      // The resampling of a track may be stopped by the user.  This might
-      // leave a track with multiple clips in a partially resampled state.
-      // But the thrown exception will cause rollback in the application
-      // level handler.
+      auto range = TrackList::Channels( wt );
+      selected.emplace_back( range.begin(), range.end() );
+   }
 
-       wt->Resample(newRate, &progress);
+   if (!selected.empty())
+   {
+      ProgressDialog progress(XO("Resample"),
+         XO("Resampling %d track(s)").Format( (int)selected.size() ));
 
-      // Each time a track is successfully, completely resampled,
-      // commit that to the undo stack.  The second and later times,
-      // consolidate.
+      // The resampling may be stopped by the user.  Then no track changes.
+      WaveTrack::Resample( selected, newRate, &progress );
 
       ProjectHistory::Get( project ).PushState(
-         XO("Resampled audio track(s)"), XO("Resample Track"), flags);
-      flags = flags | UndoPush::CONSOLIDATE;
+         XO("Resampled audio track(s)"), XO("Resample Track"));
    }
 
-   undoManager.StopConsolidating();
-
    // Need to reset
    window.FinishAutoScroll();
 }
 
+void OnFreezeTracks(const CommandContext &context)
+{
+   auto &project = context.project;
+   const auto &settings = ProjectSettings::Get( project );
+   auto &tracks = TrackList::Get( project );
+
+   for (auto wt : tracks.Selected< WaveTrack >())
+      TrackFreeze::Get( *wt ).SetEnabled( true );
+
+   // Render now, rather than delay the next playback
+   TrackFreeze::RefreshAll( tracks, settings.GetRate() );
+}
+
+void OnUnfreezeTracks(const CommandContext &context)
+{
+   auto &project = context.project;
+   auto &tracks = TrackList::Get( project );
+
+   for (auto wt : tracks.Selected< WaveTrack >())
+      TrackFreeze::Get( *wt ).SetEnabled( false );
+}
+
 void OnRemoveTracks(const CommandContext &context)
 {
    TrackUtilities::DoRemoveTracks( context.project );
@@ -1343,7 +1360,16 @@ BaseItemSharedPtr TracksMenu()
          ),
 
          Command( wxT("Resample"), XXO("&Resample..."), FN(OnResample),
-            AudioIONotBusyFlag() | WaveTracksSelectedFlag() )
+            AudioIONotBusyFlag() | WaveTracksSelectedFlag() ),
+
+         Menu( wxT("Freeze"), XXO("&Freeze"),
+            Command( wxT("FreezeTracks"), XXO("&Freeze Tracks"),
+               FN(OnFreezeTracks),
+               AudioIONotBusyFlag() | WaveTracksSelectedFlag() ),
+            Command( wxT("UnfreezeTracks"), XXO("&Unfreeze Tracks"),
+               FN(OnUnfreezeTracks),
+               AudioIONotBusyFlag() | WaveTracksSelectedFlag() )
+         )
       ),
 
       Section( "",
@@ -355,10 +355,23 @@ void LabelTrackView::ComputeTextPosition(const wxRect & r, int index) const
    labelStruct.xText = xText;
 }
 
+namespace {
+
+// Give a label a position where it is neither drawn nor hit
+void ForgetPosition(const LabelStruct &labelStruct)
+{
+   labelStruct.x = labelStruct.x1 = labelStruct.xText = INT_MIN / 2;
+   labelStruct.y = -1;
+}
+
+}
+
 /// ComputeLayout determines which row each label
 /// should be placed on, and reserves space for it.
+/// Only labels near r are laid out; others are given no position.
 /// Function assumes that the labels are sorted.
-void LabelTrackView::ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) const
+void LabelTrackView::ComputeLayout(
+   wxDC & dc, const wxRect & r, const ZoomInfo &zoomInfo) const
 {
    int xUsed[MAX_NUM_ROWS];
 
@@ -391,7 +404,38 @@ void LabelTrackView::ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) c
    const auto pTrack = FindLabelTrack();
    const auto &mLabels = pTrack->GetLabels();
 
-   { int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+   // Forget the positions from the last layout, or of all labels if they
+   // have changed since
+   const auto generation = pTrack->GetIndexGeneration();
+   if (generation != mLayoutGeneration) {
+      mLayoutGeneration = generation;
+      mLayoutBegin = 0;
+      mLayoutEnd = mLabels.size();
+   }
+   for (auto i = mLayoutBegin; i < std::min(mLayoutEnd, mLabels.size()); ++i)
+      ForgetPosition(mLabels[i]);
+
+   // Visit only the labels that may show, allowing a screen width to the
+   // left for text of labels that end there.  If there are more of them
+   // than columns, they can't be told apart, so lay out none.
+   const auto range = pTrack->FindLabels(
+      zoomInfo.PositionToTime(r.x - r.width, r.x),
+      zoomInfo.PositionToTime(r.x + r.width, r.x));
+   mLayoutCrowded = range.second - range.first > (size_t)std::max(0, r.width);
+   mLayoutBegin = range.first;
+   mLayoutEnd = mLayoutCrowded ? range.first : range.second;
+
+   // Get the text widths.
+   // TODO: Make more efficient by only re-computing when a
+   // text label title changes.
+   wxCoord textWidth, textHeight;
+   for (auto i = mLayoutBegin; i < mLayoutEnd; ++i) {
+      dc.GetTextExtent(mLabels[i].title, &textWidth, &textHeight);
+      mLabels[i].width = textWidth;
+   }
+
+   for (int i = mLayoutBegin; i < (int)mLayoutEnd; ++i) {
+      const auto &labelStruct = mLabels[i];
       const int x = zoomInfo.TimeToPosition(labelStruct.getT0(), r.x);
       const int x1 = zoomInfo.TimeToPosition(labelStruct.getT1(), r.x);
       int y = r.y;
@@ -444,7 +488,7 @@ void LabelTrackView::ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) c
          if( xUsed[iRow] < x1 ) xUsed[iRow]=x1;
          ComputeTextPosition( r, i );
       }
-   }}
+   }
 }
 
 /// Draw vertical lines that go exactly through the position
@@ -733,14 +777,6 @@ void LabelTrackView::Draw
 
    wxCoord textWidth, textHeight;
 
-   // Get the text widths.
-   // TODO: Make more efficient by only re-computing when a
-   // text label title changes.
-   for (const auto &labelStruct : mLabels) {
-      dc.GetTextExtent(labelStruct.title, &textWidth, &textHeight);
-      labelStruct.width = textWidth;
-   }
-
    // TODO: And this only needs to be done once, but we
    // do need the dc to do it.
    // We need to set mTextHeight to something sensible,
@@ -749,22 +785,39 @@ void LabelTrackView::Draw
    // happens with a NEW label track.
    dc.GetTextExtent(wxT("Demo Text x^y"), &textWidth, &textHeight);
    mTextHeight = (int)textHeight;
-   ComputeLayout( r, zoomInfo );
+   ComputeLayout( dc, r, zoomInfo );
    dc.SetTextForeground(theTheme.Colour( clrLabelTrackText));
    dc.SetBackgroundMode(wxTRANSPARENT);
    dc.SetBrush(AColor::labelTextNormalBrush);
    dc.SetPen(AColor::labelSurroundPen);
    int GlyphLeft;
    int GlyphRight;
+
+   // Only the labels laid out are drawn
+   const int begin = std::min(mLayoutBegin, mLabels.size());
+   const int end = std::min(mLayoutEnd, mLabels.size());
+   const auto laidOut = [&](int i){ return begin <= i && i < end; };
+
    // Now we draw the various items in this order,
    // so that the correct things overpaint each other.
 
    // Draw vertical lines that show where the end positions are.
-   for (const auto &labelStruct : mLabels)
-      DrawLines( dc, labelStruct, r );
+   for (int i = begin; i < end; ++i)
+      DrawLines( dc, mLabels[i], r );
+
+   // Too crowded to lay out, draw a line in each column where any label
+   // starts or ends, at a cost that depends on the columns only
+   if (mLayoutCrowded) {
+      for (int x = r.x; x < r.x + r.width; ++x) {
+         if (pTrack->CountEdges(zoomInfo.PositionToTime(x, r.x),
+                                zoomInfo.PositionToTime(x + 1, r.x)))
+            AColor::Line(dc, x, r.y, x, r.y + r.height);
+      }
+   }
 
    // Draw the end glyphs.
-   { int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+   for (int i = begin; i < end; ++i) {
+      const auto &labelStruct = mLabels[i];
       GlyphLeft=0;
       GlyphRight=1;
       if( pHit && i == pHit->mMouseOverLabelLeft )
@@ -772,7 +825,7 @@ void LabelTrackView::Draw
       if( pHit && i == pHit->mMouseOverLabelRight )
          GlyphRight = (pHit->mEdge & 4) ? 7:4;
       DrawGlyphs( dc, labelStruct, r, GlyphLeft, GlyphRight );
-   }}
+   }
 
    auto &project = *artist->parent->GetProject();
 
@@ -783,7 +836,8 @@ void LabelTrackView::Draw
       auto target = dynamic_cast<LabelTextHandle*>(context.target.get());
       highlightTrack = target && target->GetTrack().get() == this;
 #endif
-      int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+      for (int i = begin; i < end; ++i) {
+         const auto &labelStruct = mLabels[i];
          bool highlight = false;
 #ifdef EXPERIMENTAL_TRACK_PANEL_HIGHLIGHTING
          highlight = highlightTrack && target->GetLabelNum() == i;
@@ -802,7 +856,8 @@ void LabelTrackView::Draw
    }
 
    // Draw highlights
-   if ( (mInitialCursorPos != mCurrentCursorPos) && HasSelection( project ) )
+   if ( (mInitialCursorPos != mCurrentCursorPos) && HasSelection( project ) &&
+       laidOut( mSelIndex ) )
    {
       int xpos1, xpos2;
       CalcHighlightXs(&xpos1, &xpos2);
@@ -811,16 +866,17 @@ void LabelTrackView::Draw
    }
 
    // Draw the text and the label boxes.
-   { int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+   for (int i = begin; i < end; ++i) {
+      const auto &labelStruct = mLabels[i];
       if( GetSelectedIndex( project ) == i )
          dc.SetBrush(AColor::labelTextEditBrush);
       DrawText( dc, labelStruct, r );
       if( GetSelectedIndex( project ) == i )
          dc.SetBrush(AColor::labelTextNormalBrush);
-   }}
+   }
 
    // Draw the cursor, if there is one.
-   if( mDrawCursor && HasSelection( project ) )
+   if( mDrawCursor && HasSelection( project ) && laidOut( mSelIndex ) )
    {
       const auto &labelStruct = mLabels[mSelIndex];
       int xPos = labelStruct.xText;
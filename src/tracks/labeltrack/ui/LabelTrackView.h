@@ -169,6 +169,14 @@ private:
    void OnContextMenu( AudacityProject &project, wxCommandEvent & evt);
 
    mutable int mSelIndex{-1};  /// Keeps track of the currently selected label
+
+   // Only labels from mLayoutBegin to mLayoutEnd have positions from the
+   // last layout, which was of the labels of mLayoutGeneration
+   mutable size_t mLayoutBegin{ 0 };
+   mutable size_t mLayoutEnd{ 0 };
+   mutable unsigned long long mLayoutGeneration{ 0 };
+   // Whether there were too many labels on screen to lay out
+   mutable bool mLayoutCrowded{ false };
    
    static int mIconHeight;
    static int mIconWidth;
@@ -187,7 +195,8 @@ private:
                                                   /// when done editing
 
    void ComputeTextPosition(const wxRect & r, int index) const;
-   void ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) const;
+   void ComputeLayout(
+      wxDC & dc, const wxRect & r, const ZoomInfo &zoomInfo) const;
    static void DrawLines( wxDC & dc, const LabelStruct &ls, const wxRect & r);
    static void DrawGlyphs( wxDC & dc, const LabelStruct &ls, const wxRect & r,
       int GlyphLeft, int GlyphRight);
@@ -345,6 +345,10 @@ void DrawNoteBackground(TrackPanelDrawingContext &context,
    }
 }
 
+// When there are more notes than this to each column on screen, draw only
+// which pitches sound in each column
+constexpr int NotesPerColumn = 4;
+
 /* DrawNoteTrack:
 Draws a piano-roll style display of sequence data with added
 graphics. Since there may be notes outside of the display region,
@@ -465,16 +469,108 @@ void DrawNoteTrack(TrackPanelDrawingContext &context,
    // We want to draw in seconds, so we need to convert to seconds
    seq->convert_to_seconds();
 
-   Alg_iterator iterator(seq, false);
-   iterator.begin();
-   //for every event
-   Alg_event_ptr evt;
-   while (0 != (evt = iterator.next())) {
-      if (evt->get_type() == 'n') { // 'n' means a note
-         Alg_note_ptr note = (Alg_note_ptr) evt;
+   // Draw a note, or a run of columns in which a pitch sounds, clipped to
+   // the track, or as a black mark in a margin if the pitch is out of view
+   auto drawNote = [&](wxRect nr, int channel /* 1 - 16 */) {
+      if (nr.x + nr.width >= rect.x && nr.x < rect.x + rect.width) {
+         if (nr.x < rect.x) {
+            nr.width -= (rect.x - nr.x);
+            nr.x = rect.x;
+         }
+         if (nr.x + nr.width > rect.x + rect.width) // clip on right
+            nr.width = rect.x + rect.width - nr.x;
+
+         if (nr.y + nr.height < rect.y + marg + 3) {
+             // too high for window
+             nr.y = rect.y;
+             nr.height = marg;
+             dc.SetBrush(*wxBLACK_BRUSH);
+             dc.SetPen(*wxBLACK_PEN);
+             dc.DrawRectangle(nr);
+         } else if (nr.y >= rect.y + rect.height - marg - 1) {
+             // too low for window
+             nr.y = rect.y + rect.height - marg;
+             nr.height = marg;
+             dc.SetBrush(*wxBLACK_BRUSH);
+             dc.SetPen(*wxBLACK_PEN);
+             dc.DrawRectangle(nr);
+         } else {
+            if (nr.y + nr.height > rect.y + rect.height - marg)
+               nr.height = rect.y + rect.height - nr.y;
+            if (nr.y < rect.y + marg) {
+               int offset = rect.y + marg - nr.y;
+               nr.height -= offset;
+               nr.y += offset;
+            }
+            // nr.y += rect.y;
+            if (muted)
+               AColor::LightMIDIChannel(&dc, channel);
+            else
+               AColor::MIDIChannel(&dc, channel);
+            dc.DrawRectangle(nr);
+            if (data.GetPitchHeight(1) > 2) {
+               AColor::LightMIDIChannel(&dc, channel);
+               AColor::Line(dc, nr.x, nr.y, nr.x + nr.width-2, nr.y);
+               AColor::Line(dc, nr.x, nr.y, nr.x, nr.y + nr.height-2);
+               AColor::DarkMIDIChannel(&dc, channel);
+               AColor::Line(dc, nr.x+nr.width-1, nr.y,
+                     nr.x+nr.width-1, nr.y+nr.height-1);
+               AColor::Line(dc, nr.x, nr.y+nr.height-1,
+                     nr.x+nr.width-1, nr.y+nr.height-1);
+            }
+         }
+      }
+   };
+
+   const auto offset = track->GetOffset();
+   const auto notes = track->FindNotes(h - offset, h1 - offset);
+
+   // Zoomed out so far that there are several notes to each column, draw
+   // only which pitches sound in each column, found in bins that cost the
+   // same however many notes there are
+   bool dense = false;
+   std::vector<NoteTrack::PitchMask> pitches;
+   std::vector<unsigned> channels;
+   if (rect.width > 0 &&
+       notes.second - notes.first > NotesPerColumn * rect.width) {
+      pitches.resize(rect.width);
+      channels.resize(rect.width);
+      dense = track->FindNoteDensity(h - offset, (h1 - h) / rect.width,
+         rect.width, pitches.data(), channels.data());
+   }
+
+   if (dense) {
+      // Colour a column as its channel if only one sounds there
+      std::vector<int> colours(rect.width);
+      for (int ii = 0; ii < rect.width; ++ii)
+         for (int chan = 0; chan < NUM_CHANNELS; ++chan)
+            if (channels[ii] == (unsigned)CHANNEL_BIT(chan))
+               colours[ii] = chan + 1;
+
+      for (int pitch = 0; pitch < 128; ++pitch) {
+         const auto word = pitch / 64;
+         const uint64_t bit = uint64_t(1) << (pitch % 64);
+         for (int ii = 0; ii < rect.width;) {
+            if (!(pitches[ii][word] & bit)) {
+               ++ii;
+               continue;
+            }
+            auto jj = ii + 1;
+            while (jj < rect.width && (pitches[jj][word] & bit) &&
+                   colours[jj] == colours[ii])
+               ++jj;
+            drawNote({ rect.x + ii, data.IPitchToY(pitch),
+               jj - ii, data.GetPitchHeight(1) }, colours[ii]);
+            ii = jj;
+         }
+      }
+   } else {
+      //for every note that may be visible
+      for (auto pNote = notes.first; pNote != notes.second; ++pNote) {
+         Alg_note_ptr note = *pNote;
          // if the note's channel is visible
-         if (track->IsVisibleChan(evt->chan)) {
-            double xx = note->time + track->GetOffset();
+         if (track->IsVisibleChan(note->chan)) {
+            double xx = note->time + offset;
             double x1 = xx + note->dur;
             if (xx < h1 && x1 > h) { // omit if outside box
                const char *shape = NULL;
@@ -486,55 +582,7 @@ void DrawNoteTrack(TrackPanelDrawingContext &context,
                   nr.x = TIME_TO_X(xx);
                   nr.width = TIME_TO_X(x1) - nr.x;
 
-                  if (nr.x + nr.width >= rect.x && nr.x < rect.x + rect.width) {
-                     if (nr.x < rect.x) {
-                        nr.width -= (rect.x - nr.x);
-                        nr.x = rect.x;
-                     }
-                     if (nr.x + nr.width > rect.x + rect.width) // clip on right
-                        nr.width = rect.x + rect.width - nr.x;
-
-                     if (nr.y + nr.height < rect.y + marg + 3) {
-                         // too high for window
-                         nr.y = rect.y;
-                         nr.height = marg;
-                         dc.SetBrush(*wxBLACK_BRUSH);
-                         dc.SetPen(*wxBLACK_PEN);
-                         dc.DrawRectangle(nr);
-                     } else if (nr.y >= rect.y + rect.height - marg - 1) {
-                         // too low for window
-                         nr.y = rect.y + rect.height - marg;
-                         nr.height = marg;
-                         dc.SetBrush(*wxBLACK_BRUSH);
-                         dc.SetPen(*wxBLACK_PEN);
-                         dc.DrawRectangle(nr);
-                     } else {
-                        if (nr.y + nr.height > rect.y + rect.height - marg)
-                           nr.height = rect.y + rect.height - nr.y;
-                        if (nr.y < rect.y + marg) {
-                           int offset = rect.y + marg - nr.y;
-                           nr.height -= offset;
-                           nr.y += offset;
-                        }
-                        // nr.y += rect.y;
-                        if (muted)
-                           AColor::LightMIDIChannel(&dc, note->chan + 1);
-                        else
-                           AColor::MIDIChannel(&dc, note->chan + 1);
-                        dc.DrawRectangle(nr);
-                        if (data.GetPitchHeight(1) > 2) {
-                           AColor::LightMIDIChannel(&dc, note->chan + 1);
-                           AColor::Line(dc, nr.x, nr.y, nr.x + nr.width-2, nr.y);
-                           AColor::Line(dc, nr.x, nr.y, nr.x, nr.y + nr.height-2);
-                           AColor::DarkMIDIChannel(&dc, note->chan + 1);
-                           AColor::Line(dc, nr.x+nr.width-1, nr.y,
-                                 nr.x+nr.width-1, nr.y+nr.height-1);
-                           AColor::Line(dc, nr.x, nr.y+nr.height-1,
-                                 nr.x+nr.width-1, nr.y+nr.height-1);
-                        }
-//                        }
-                     }
-                  }
+                  drawNote(nr, note->chan + 1);
                } else if (shape) {
                   // draw a shape according to attributes
                   // add 0.5 to pitch because pitches are plotted with
@@ -695,7 +743,6 @@ void DrawNoteTrack(TrackPanelDrawingContext &context,
          }
       }
    }
-   iterator.end();
    // draw black line between top/bottom margins and the track
    dc.SetPen(*wxBLACK_PEN);
    AColor::Line(dc, rect.x, rect.y + marg, rect.x + rect.width, rect.y + marg);
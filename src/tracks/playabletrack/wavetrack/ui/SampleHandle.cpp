@@ -209,6 +209,17 @@ UIHandle::Result SampleHandle::Click
    /// We're in a track view and zoomed enough to see the samples.
    mRect = rect;
 
+   // Read the visible samples, and a margin for the smoothing kernel, just
+   // once.  Edits change them in memory until release.
+   {
+      const auto margin = SMOOTHING_KERNEL_RADIUS + SMOOTHING_BRUSH_RADIUS;
+      const auto s0 = mClickedTrack->TimeToLongSamples(
+         viewInfo.PositionToTime(rect.x, rect.x)) - margin;
+      const auto s1 = mClickedTrack->TimeToLongSamples(
+         viewInfo.PositionToTime(rect.x + rect.width, rect.x)) + margin + 1;
+      mClickedTrack->BeginSampleEdits(s0, (s1 - s0).as_size_t());
+   }
+
    //If we are still around, we are drawing in earnest.  Set some member data structures up:
    //First, calculate the starting sample.  To get this, we need the time
    const double t0 =
@@ -289,7 +300,7 @@ UIHandle::Result SampleHandle::Click
                (1 - prob);
       }
       //Set the sample to the point of the mouse event
-      mClickedTrack->Set((samplePtr)newSampleRegion.get(), floatSample,
+      mClickedTrack->EditSamples(newSampleRegion.get(),
          mClickedStartSample - SMOOTHING_BRUSH_RADIUS, 1 + 2 * SMOOTHING_BRUSH_RADIUS);
 
       // mLastDragSampleValue will not be used
@@ -305,7 +316,7 @@ UIHandle::Result SampleHandle::Click
       const float newLevel = FindSampleEditingLevel(event, viewInfo, t0);
 
       //Set the sample to the point of the mouse event
-      mClickedTrack->Set((samplePtr)&newLevel, floatSample, mClickedStartSample, 1);
+      mClickedTrack->EditSamples(&newLevel, mClickedStartSample, 1);
 
       mLastDragSampleValue = newLevel;
    }
@@ -378,7 +389,7 @@ UIHandle::Result SampleHandle::Drag
    // overflow size_t:
    const auto size = ( end - start + 1 ).as_size_t();
    if (size == 1) {
-      mClickedTrack->Set((samplePtr)&newLevel, floatSample, start, size);
+      mClickedTrack->EditSamples(&newLevel, start, size);
    }
    else {
       std::vector<float> values(size);
@@ -390,7 +401,7 @@ UIHandle::Result SampleHandle::Drag
             (ii - mLastDragSample).as_float() /
              (s0 - mLastDragSample).as_float();
       }
-      mClickedTrack->Set((samplePtr)&values[0], floatSample, start, size);
+      mClickedTrack->EditSamples(&values[0], start, size);
    }
 
    //Update the member data structures.
@@ -418,7 +429,8 @@ UIHandle::Result SampleHandle::Release
    //*************************************************
    //***    UP-CLICK  (Finish drawing)             ***
    //*************************************************
-   //On up-click, send the state to the undo stack
+   //On up-click, write the edits, and send the state to the undo stack
+   mClickedTrack->CommitSampleEdits();
    mClickedTrack.reset();       //Set this to NULL so it will catch improper drag events.
    ProjectHistory::Get( *pProject ).PushState(XO("Moved Samples"),
       XO("Sample Edit"),
@@ -430,6 +442,8 @@ UIHandle::Result SampleHandle::Release
 
 UIHandle::Result SampleHandle::Cancel(AudacityProject *pProject)
 {
+   if (mClickedTrack)
+      mClickedTrack->DiscardSampleEdits();
    mClickedTrack.reset();
    ProjectHistory::Get( *pProject ).RollbackState();
    return RefreshCode::RefreshCell;
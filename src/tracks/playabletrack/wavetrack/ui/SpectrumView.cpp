@@ -25,11 +25,18 @@ Paul Licameli split from WaveTrackView.cpp
 #include "../../../../ViewInfo.h"
 #include "../../../../WaveClip.h"
 #include "../../../../WaveTrack.h"
+#include "../../../../WorkerPool.h"
 #include "../../../../prefs/SpectrogramSettings.h"
 
 #include <wx/dcmemory.h>
 #include <wx/graphics.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPECTRUM_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 static WaveTrackSubView::Type sType{
    WaveTrackViewConstants::Spectrum,
    { wxT("Spectrogram"), XXO("&Spectrogram") }
@@ -93,37 +100,17 @@ std::shared_ptr<TrackVRulerControls> SpectrumView::DoGetVRulerControls()
 namespace
 {
 
-static inline float findValue
-(const float *spectrum, float bin0, float bin1, unsigned nBins,
- bool autocorrelation, int gain, int range)
-{
-   float value;
-
-
-#if 0
-   // Averaging method
-   if ((int)(bin1) == (int)(bin0)) {
-      value = spectrum[(int)(bin0)];
-   } else {
-      float binwidth= bin1 - bin0;
-      value = spectrum[(int)(bin0)] * (1.f - bin0 + (int)bin0);
-
-      bin0 = 1 + (int)(bin0);
-      while (bin0 < (int)(bin1)) {
-         value += spectrum[(int)(bin0)];
-         bin0 += 1.0;
-      }
-      // Do not reference past end of freq array.
-      if ((int)(bin1) >= (int)nBins) {
-         bin1 -= 1.0;
-      }
+// Range of fft bins [index, limitIndex) shown in one pixel row
+struct RowBins {
+   int index;
+   int limitIndex;
+};
 
-      value += spectrum[(int)(bin1)] * (bin1 - (int)(bin1));
-      value /= binwidth;
-   }
-#else
-   // Maximum method, and no apportionment of any single bins over multiple pixel rows
-   // See Bug971
+// Maximum method, and no apportionment of any single bins over multiple pixel rows
+// See Bug971
+static inline RowBins findRowBins
+(float bin0, float bin1, unsigned nBins, bool autocorrelation)
+{
    int index, limitIndex;
    if (autocorrelation) {
       // bin = 2 * nBins / (nBins - 1 - array_index);
@@ -139,10 +126,16 @@ static inline float findValue
       index = std::min<int>(nBins - 1, (int)(floor(0.5 + bin0)));
       limitIndex = std::min<int>(nBins, (int)(floor(0.5 + bin1)));
    }
-   value = spectrum[index];
-   while (++index < limitIndex)
+   return { index, limitIndex };
+}
+
+static inline float findValue
+(const float *spectrum, RowBins row, bool autocorrelation, int gain, int range)
+{
+   int index = row.index;
+   float value = spectrum[index];
+   while (++index < row.limitIndex)
       value = std::max(value, spectrum[index]);
-#endif
    if (!autocorrelation) {
       // Last step converts dB to a 0.0-1.0 range
       value = (value + range + gain) / (double)range;
@@ -151,6 +144,54 @@ static inline float findValue
    return value;
 }
 
+// Fill values[0 .. height) for one column of the spectrum
+static void findColumnValues
+(const float *spectrum, const RowBins *rows, int height,
+ bool autocorrelation, int gain, int range, float *values)
+{
+   // Take the maxima first, then scale and clamp in a separate loop that
+   // the compiler can vectorize
+   for (int yy = 0; yy < height; ++yy) {
+      int index = rows[yy].index;
+      const int limitIndex = rows[yy].limitIndex;
+      float value = spectrum[index];
+      while (++index < limitIndex)
+         value = std::max(value, spectrum[index]);
+      values[yy] = value;
+   }
+   const float offset = autocorrelation ? 0.0f : float(range + gain);
+   const float scale = autocorrelation ? 1.0f : 1.0f / range;
+   for (int yy = 0; yy < height; ++yy)
+      values[yy] =
+         std::min(1.0f, std::max(0.0f, (values[yy] + offset) * scale));
+}
+
+// Convert values in 0.0-1.0 to indices into AColor::gradient_pre, as
+// GetColorGradient() does
+static void findGradientIndices
+(const float *values, int count, unsigned short *indices)
+{
+   const float steps = AColor::gradientSteps - 1;
+   int ii = 0;
+#ifdef SPECTRUM_USE_SSE2
+   const __m128 vSteps = _mm_set1_ps(steps);
+   for (; ii + 8 <= count; ii += 8) {
+      const __m128i lo =
+         _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(values + ii), vSteps));
+      const __m128i hi =
+         _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(values + ii + 4), vSteps));
+      // Values are already clamped, so signed saturation loses nothing
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + ii),
+         _mm_packs_epi32(lo, hi));
+   }
+#endif
+   for (; ii < count; ++ii)
+      indices[ii] = (unsigned short)(int)(values[ii] * steps);
+}
+
+// Columns of the image computed by one job of the worker pool
+constexpr int ColumnsPerJob = 32;
+
 // dashCount counts both dashes and the spaces between them.
 inline AColor::ColorGradientChoice
 ChooseColorSet( float bin0, float bin1, float selBinLo,
@@ -287,6 +328,11 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
       bins[yy] = nextBin;
    }
 
+   // fft bins shown in each pixel row, the same for all columns
+   ArrayOf<RowBins> rowBins{ size_t(hiddenMid.height) };
+   for (int yy = 0; yy < hiddenMid.height; ++yy)
+      rowBins[yy] = findRowBins(bins[yy], bins[yy + 1], nBins, autocorrelation);
+
 #ifdef EXPERIMENTAL_FFT_Y_GRID
    const float
       log2 = logf(2.0f),
@@ -353,8 +399,6 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
 #endif //EXPERIMENTAL_FIND_NOTES
 
 #ifdef EXPERIMENTAL_FIND_NOTES
-      int maxima[128];
-      float maxima0[128], maxima1[128];
       const float
          f2bin = half / (rate / 2.0f),
          bin2f = 1.0f / f2bin,
@@ -363,92 +407,89 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
          i1 = expf(scale + lmin) / binUnit,
          minColor = 0.0f;
       const size_t maxTableSize = 1024;
-      ArrayOf<int> indexes{ maxTableSize };
 #endif //EXPERIMENTAL_FIND_NOTES
 
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-      for (int xx = 0; xx < hiddenMid.width; ++xx) {
+      // Columns are independent, so give slices of them to the worker pool
+      const int height = hiddenMid.height;
+      float *const values = clip->mSpecPxCache->values.get();
+      const size_t nJobs =
+         (hiddenMid.width + ColumnsPerJob - 1) / ColumnsPerJob;
+      WorkerPool::Get().ParallelFor(nJobs, [&](size_t job) {
 #ifdef EXPERIMENTAL_FIND_NOTES
-         int maximas = 0;
-         const int x0 = nBins * xx;
-         if (fftFindNotes) {
-            for (int i = maxTableSize - 1; i >= 0; i--)
-               indexes[i] = -1;
-
-            // Build a table of (most) values, put the index in it.
-            for (int i = (int)(i0); i < (int)(i1); i++) {
-               float freqi = freq[x0 + (int)(i)];
-               int value = (int)((freqi + gain + range) / range*(maxTableSize - 1));
-               if (value < 0)
-                  value = 0;
-               if (value >= maxTableSize)
-                  value = maxTableSize - 1;
-               indexes[value] = i;
-            }
-            // Build from the indices an array of maxima.
-            for (int i = maxTableSize - 1; i >= 0; i--) {
-               int index = indexes[i];
-               if (index >= 0) {
-                  float freqi = freq[x0 + index];
-                  if (freqi < findNotesMinA)
-                     break;
-
-                  bool ok = true;
-                  for (int m = 0; m < maximas; m++) {
-                     // Avoid to store very close maxima.
-                     float maxm = maxima[m];
-                     if (maxm / index < minDistance && index / maxm < minDistance) {
-                        ok = false;
+         int maxima[128];
+         float maxima0[128], maxima1[128];
+         ArrayOf<int> indexes{ maxTableSize };
+#endif //EXPERIMENTAL_FIND_NOTES
+
+         const int xBegin = job * ColumnsPerJob;
+         const int xEnd = std::min(hiddenMid.width, xBegin + ColumnsPerJob);
+         for (int xx = xBegin; xx < xEnd; ++xx) {
+            float *const column = values + xx * height;
+#ifdef EXPERIMENTAL_FIND_NOTES
+            if (fftFindNotes &&
+                settings.scaleType == SpectrogramSettings::stLogarithmic) {
+               int maximas = 0;
+               const int x0 = nBins * xx;
+               for (int i = maxTableSize - 1; i >= 0; i--)
+                  indexes[i] = -1;
+
+               // Build a table of (most) values, put the index in it.
+               for (int i = (int)(i0); i < (int)(i1); i++) {
+                  float freqi = freq[x0 + (int)(i)];
+                  int value = (int)((freqi + gain + range) / range*(maxTableSize - 1));
+                  if (value < 0)
+                     value = 0;
+                  if (value >= maxTableSize)
+                     value = maxTableSize - 1;
+                  indexes[value] = i;
+               }
+               // Build from the indices an array of maxima.
+               for (int i = maxTableSize - 1; i >= 0; i--) {
+                  int index = indexes[i];
+                  if (index >= 0) {
+                     float freqi = freq[x0 + index];
+                     if (freqi < findNotesMinA)
                         break;
+
+                     bool ok = true;
+                     for (int m = 0; m < maximas; m++) {
+                        // Avoid to store very close maxima.
+                        float maxm = maxima[m];
+                        if (maxm / index < minDistance && index / maxm < minDistance) {
+                           ok = false;
+                           break;
+                        }
+                     }
+                     if (ok) {
+                        maxima[maximas++] = index;
+                        if (maximas >= numberOfMaxima)
+                           break;
                      }
-                  }
-                  if (ok) {
-                     maxima[maximas++] = index;
-                     if (maximas >= numberOfMaxima)
-                        break;
                   }
                }
-            }
 
 // The f2pix helper macro converts a frequency into a pixel coordinate.
 #define f2pix(f) (logf(f)-lmins)/(lmaxs-lmins)*hiddenMid.height
 
-            // Possibly quantize the maxima frequencies and create the pixel block limits.
-            for (int i = 0; i < maximas; i++) {
-               int index = maxima[i];
-               float f = float(index)*bin2f;
-               if (findNotesQuantize)
-               {
-                  f = expf((int)(log(f / 440) / log2 * 12 - 0.5) / 12.0f*log2) * 440;
-                  maxima[i] = f*f2bin;
+               // Possibly quantize the maxima frequencies and create the pixel block limits.
+               for (int i = 0; i < maximas; i++) {
+                  int index = maxima[i];
+                  float f = float(index)*bin2f;
+                  if (findNotesQuantize)
+                  {
+                     f = expf((int)(log(f / 440) / log2 * 12 - 0.5) / 12.0f*log2) * 440;
+                     maxima[i] = f*f2bin;
+                  }
+                  float f0 = expf((log(f / 440) / log2 * 24 - 1) / 24.0f*log2) * 440;
+                  maxima0[i] = f2pix(f0);
+                  float f1 = expf((log(f / 440) / log2 * 24 + 1) / 24.0f*log2) * 440;
+                  maxima1[i] = f2pix(f1);
                }
-               float f0 = expf((log(f / 440) / log2 * 24 - 1) / 24.0f*log2) * 440;
-               maxima0[i] = f2pix(f0);
-               float f1 = expf((log(f / 440) / log2 * 24 + 1) / 24.0f*log2) * 440;
-               maxima1[i] = f2pix(f1);
-            }
-         }
-
-         int it = 0;
-         bool inMaximum = false;
-#endif //EXPERIMENTAL_FIND_NOTES
-
-         for (int yy = 0; yy < hiddenMid.height; ++yy) {
-            const float bin     = bins[yy];
-            const float nextBin = bins[yy+1];
 
-            if (settings.scaleType != SpectrogramSettings::stLogarithmic) {
-               const float value = findValue
-                  (freq + nBins * xx, bin, nextBin, nBins, autocorrelation, gain, range);
-               clip->mSpecPxCache->values[xx * hiddenMid.height + yy] = value;
-            }
-            else {
-               float value;
-
-#ifdef EXPERIMENTAL_FIND_NOTES
-               if (fftFindNotes) {
+               int it = 0;
+               bool inMaximum = false;
+               for (int yy = 0; yy < height; ++yy) {
+                  float value;
                   if (it < maximas) {
                      float i0 = maxima0[it];
                      if (yy >= i0)
@@ -457,7 +498,7 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
                      if (inMaximum) {
                         float i1 = maxima1[it];
                         if (yy + 1 <= i1) {
-                           value = findValue(freq + x0, bin, nextBin, nBins, autocorrelation, gain, range);
+                           value = findValue(freq + x0, rowBins[yy], autocorrelation, gain, range);
                            if (value < findNotesMinA)
                               value = minColor;
                         }
@@ -473,17 +514,16 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
                   }
                   else
                      value = minColor;
+                  column[yy] = value;
                }
-               else
+               continue;
+            }
 #endif //EXPERIMENTAL_FIND_NOTES
-               {
-                  value = findValue
-                     (freq + nBins * xx, bin, nextBin, nBins, autocorrelation, gain, range);
-               }
-               clip->mSpecPxCache->values[xx * hiddenMid.height + yy] = value;
-            } // logF
-         } // each yy
-      } // each xx
+
+            findColumnValues(freq + nBins * xx, rowBins.get(), height,
+               autocorrelation, gain, range, column);
+         } // each xx
+      } );
    } // updating cache
 
    float selBinLo = settings.findBin( freqLo, binUnit);
@@ -514,7 +554,7 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
       }
       specCache.Populate
          (settings, waveTrackCache,
-          0, 0, numPixels,
+          SpecCache::Ranges{ { 0, (int)numPixels } },
           clip->GetNumSamples(),
           tOffset, rate,
           0 // FIXME: PRL -- make reassignment work with fisheye
@@ -531,78 +571,111 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    // Bug 2389 - always draw at least one pixel of selection.
    int selectedX = zoomInfo.TimeToPosition(selectedRegion.t0(), -leftOffset);
 
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-   for (int xx = 0; xx < mid.width; ++xx) {
-
-      int correctedX = xx + leftOffset - hiddenLeftOffset;
-
-      // in fisheye mode the time scale has changed, so the row values aren't cached
-      // in the loop above, and must be fetched from fft cache
-      float* uncached;
-      if (!zoomInfo.InFisheye(xx, -leftOffset)) {
-          uncached = 0;
-      }
-      else {
-          int specIndex = (xx - fisheyeLeft) * nBins;
-          wxASSERT(specIndex >= 0 && specIndex < (int)specCache.freq.size());
-          uncached = &specCache.freq[specIndex];
-      }
+   // The colour table of each row for each kind of column: outside the
+   // time selection, or inside it on a dash or on a space between dashes.
+   // Choosing one per column replaces testing the selection for each pixel.
+   enum { ColumnUnselected, ColumnDash, ColumnSpace, ColumnKinds };
+   const int height = hiddenMid.height;
+   ArrayOf<const unsigned char *> rowTables{ size_t(ColumnKinds * height) };
+   for (int yy = 0; yy < height; ++yy) {
+      const float bin     = bins[yy];
+      const float nextBin = bins[yy+1];
+      rowTables[ColumnUnselected * height + yy] = AColor::gradient_pre
+         [AColor::ColorGradientUnselected][isGrayscale][0];
+      for (int dashCount : { 0, 1 })
+         rowTables[(ColumnDash + dashCount) * height + yy] =
+            AColor::gradient_pre[
+               ChooseColorSet(bin, nextBin, selBinLo, selBinCenter, selBinHi,
+                  dashCount, isSpectral)][isGrayscale][0];
+   }
 
-      // zoomInfo must be queried for each column since with fisheye enabled
-      // time between columns is variable
-      auto w0 = sampleCount(0.5 + rate *
-                   (zoomInfo.PositionToTime(xx, -leftOffset) - tOffset));
+   const size_t nJobs = (mid.width + ColumnsPerJob - 1) / ColumnsPerJob;
+   WorkerPool::Get().ParallelFor(nJobs, [&](size_t job) {
+      const int xBegin = job * ColumnsPerJob;
+      const int xEnd = std::min(mid.width, xBegin + ColumnsPerJob);
+      const int nColumns = xEnd - xBegin;
+
+      // Gradient indices for the columns of this slice, and the colour
+      // tables of their rows
+      ArrayOf<unsigned short> indices{ size_t(nColumns * height) };
+      const unsigned char *const *tables[ColumnsPerJob];
+      const float *columnValues[ColumnsPerJob];
+      Floats uncached;
+
+      for (int xx = xBegin; xx < xEnd; ++xx) {
+         const int column = xx - xBegin;
+
+         // in fisheye mode the time scale has changed, so the row values aren't cached
+         // in the loop above, and must be fetched from fft cache
+         const float *values;
+         if (!zoomInfo.InFisheye(xx, -leftOffset)) {
+            int correctedX = xx + leftOffset - hiddenLeftOffset;
+            values = &clip->mSpecPxCache->values[correctedX * height];
+         }
+         else {
+            int specIndex = (xx - fisheyeLeft) * nBins;
+            wxASSERT(specIndex >= 0 && specIndex < (int)specCache.freq.size());
+            if (!uncached)
+               uncached.reinit(size_t(nColumns * height));
+            float *const pColumn = &uncached[column * height];
+            findColumnValues(&specCache.freq[specIndex], rowBins.get(), height,
+               autocorrelation, gain, range, pColumn);
+            values = pColumn;
+         }
+         columnValues[column] = values;
+         findGradientIndices(values, height, &indices[column * height]);
 
-      auto w1 = sampleCount(0.5 + rate *
-                    (zoomInfo.PositionToTime(xx+1, -leftOffset) - tOffset));
+         // zoomInfo must be queried for each column since with fisheye enabled
+         // time between columns is variable
+         auto w0 = sampleCount(0.5 + rate *
+                      (zoomInfo.PositionToTime(xx, -leftOffset) - tOffset));
 
-      bool maybeSelected = ssel0 <= w0 && w1 < ssel1;
-      maybeSelected = maybeSelected || (xx == selectedX);
+         auto w1 = sampleCount(0.5 + rate *
+                       (zoomInfo.PositionToTime(xx+1, -leftOffset) - tOffset));
 
-      for (int yy = 0; yy < hiddenMid.height; ++yy) {
-         const float bin     = bins[yy];
-         const float nextBin = bins[yy+1];
+         bool maybeSelected = ssel0 <= w0 && w1 < ssel1;
+         maybeSelected = maybeSelected || (xx == selectedX);
 
          // For spectral selection, determine what colour
          // set to use.  We use a darker selection if
          // in both spectral range and time range.
+         int kind = ColumnUnselected;
+         if (maybeSelected) {
+            const int dashCount =
+               (xx + leftOffset - hiddenLeftOffset) / DASH_LENGTH;
+            kind = (0 == dashCount % 2) ? ColumnDash : ColumnSpace;
+         }
+         tables[column] = &rowTables[kind * height];
+      } // each xx
 
-         AColor::ColorGradientChoice selected = AColor::ColorGradientUnselected;
-
-         // If we are in the time selected range, then we may use a different color set.
-         if (maybeSelected)
-            selected =
-               ChooseColorSet(bin, nextBin, selBinLo, selBinCenter, selBinHi,
-                  (xx + leftOffset - hiddenLeftOffset) / DASH_LENGTH, isSpectral);
-
-         const float value = uncached
-            ? findValue(uncached, bin, nextBin, nBins, autocorrelation, gain, range)
-            : clip->mSpecPxCache->values[correctedX * hiddenMid.height + yy];
-
-         unsigned char rv, gv, bv;
-         GetColorGradient(value, selected, isGrayscale, &rv, &gv, &bv);
+      // Store row by row, so that writes to the image are contiguous
+      for (int yy = 0; yy < height; ++yy) {
+         int px = ((mid.height - 1 - yy) * mid.width + xBegin);
+         unsigned char *pixel = data + 3 * px;
+         for (int column = 0; column < nColumns; ++column, pixel += 3) {
+            const unsigned char *rgb =
+               tables[column][yy] + 3 * indices[column * height + yy];
+            unsigned char rv = rgb[0], gv = rgb[1], bv = rgb[2];
 
 #ifdef EXPERIMENTAL_FFT_Y_GRID
-         if (fftYGrid && yGrid[yy]) {
-            rv /= 1.1f;
-            gv /= 1.1f;
-            bv /= 1.1f;
-         }
+            if (fftYGrid && yGrid[yy]) {
+               rv /= 1.1f;
+               gv /= 1.1f;
+               bv /= 1.1f;
+            }
 #endif //EXPERIMENTAL_FFT_Y_GRID
 
-         int px = ((mid.height - 1 - yy) * mid.width + xx);
 #ifdef EXPERIMENTAL_SPECTROGRAM_OVERLAY
-         // More transparent the closer to zero intensity.
-         alpha[px]= wxMin( 200, (value+0.3) * 500) ;
+            // More transparent the closer to zero intensity.
+            alpha[px + column] =
+               wxMin( 200, (columnValues[column][yy]+0.3) * 500) ;
 #endif
-         px *=3;
-         data[px++] = rv;
-         data[px++] = gv;
-         data[px] = bv;
+            pixel[0] = rv;
+            pixel[1] = gv;
+            pixel[2] = bv;
+         } // each column
       } // each yy
-   } // each xx
+   } );
 
    wxBitmap converted = wxBitmap(image);
 
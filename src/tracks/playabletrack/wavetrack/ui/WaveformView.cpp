@@ -23,9 +23,11 @@ Paul Licameli split from WaveTrackView.cpp
 #include "../../../../AColor.h"
 #include "../../../../Envelope.h"
 #include "../../../../EnvelopeEditor.h"
+#include "../../../../Project.h"
 #include "../../../../ProjectSettings.h"
 #include "../../../../SelectedRegion.h"
 #include "../../../../TrackArtist.h"
+#include "../../../../TrackPanel.h"
 #include "../../../../TrackPanelDrawingContext.h"
 #include "../../../../TrackPanelMouseEvent.h"
 #include "../../../../ViewInfo.h"
@@ -346,12 +348,6 @@ void DrawMinMaxRMS(
       clipped.reinit( size_t(rect.width) );
    }
 
-   long pixAnimOffset = (long)fabs((double)(wxDateTime::Now().GetTicks() * -10)) +
-      wxDateTime::Now().GetMillisecond() / 100; //10 pixels a second
-
-   bool drawStripes = true;
-   bool drawWaveform = true;
-
    const auto &muteSamplePen = artist->muteSamplePen;
    const auto &samplePen = artist->samplePen;
 
@@ -408,31 +404,9 @@ void DrawMinMaxRMS(
       }
 
       if (bl[x0] <= -1) {
-         if (drawStripes) {
-            // TODO:unify with buffer drawing.
-            dc.SetPen((bl[x0] % 2) ? muteSamplePen : samplePen);
-            for (int yy = 0; yy < rect.height / 25 + 1; ++yy) {
-               // we are drawing over the buffer, but I think DrawLine takes care of this.
-               AColor::Line(dc,
-                            xx,
-                            rect.y + 25 * yy + (x0 /*+pixAnimOffset*/) % 25,
-                            xx,
-                            rect.y + 25 * yy + (x0 /*+pixAnimOffset*/) % 25 + 6); //take the min so we don't draw past the edge
-            }
-         }
-
-         // draw a dummy waveform - some kind of sinusoid.  We want to animate it so the user knows it's a dummy.  Use the second's unit of a get time function.
-         // Lets use a triangle wave for now since it's easier - I don't want to use sin() or make a wavetable just for this.
-         if (drawWaveform) {
-            int triX;
-            dc.SetPen(samplePen);
-            triX = fabs((double)((x0 + pixAnimOffset) % (2 * rect.height)) - rect.height) + rect.height;
-            for (int yy = 0; yy < rect.height; ++yy) {
-               if ((yy + triX) % rect.height == 0) {
-                  dc.DrawPoint(xx, rect.y + yy);
-               }
-            }
-         }
+         // Rough values, until the samples are read; draw them faintly
+         dc.SetPen(muteSamplePen);
+         AColor::Line(dc, xx, rect.y + h2, xx, rect.y + h1);
 
          // Restore the pen for remaining pixel columns!
          dc.SetPen(muted ? muteSamplePen : samplePen);
@@ -499,6 +473,8 @@ void DrawIndividualSamples(TrackPanelDrawingContext &context,
    if (slen <= 0)
       return;
 
+   // This includes the copies in memory of samples being edited by
+   // SampleHandle, so dragging does not write to the sample blocks
    Floats buffer{ size_t(slen) };
    clip->GetSamples((samplePtr)buffer.get(), floatSample, s0, slen,
                     // Suppress exceptions in this drawing operation:
@@ -787,7 +763,18 @@ void DrawClipWaveform(TrackPanelDrawingContext &context,
          // fisheye moves over the background, there is then less to do when
          // redrawing.
 
-         if (!clip->GetWaveDisplay(display,t0, pps))
+         // Columns not yet computed are done on another thread, then the
+         // panel is painted again.
+         bool isLoading = false;
+         std::weak_ptr<AudacityProject> wProject;
+         if (auto pList = track->GetOwner())
+            if (auto pProject = pList->GetOwner())
+               wProject = pProject->shared_from_this();
+         auto onReady = [wProject]{
+            if (auto pProject = wProject.lock())
+               TrackPanel::Get( *pProject ).Refresh(false);
+         };
+         if (!clip->GetWaveDisplay(display, t0, pps, isLoading, onReady))
             return;
       }
    }
@@ -0,0 +1,169 @@
+
+#include "effects/Biquad.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+class BiquadCascadeTest
+{
+   ArrayOf<Biquad> mSections;
+   size_t mnSections;
+   std::vector<std::vector<float>> mInput;
+
+public:
+   BiquadCascadeTest()
+   {
+      std::cout << "==> Testing BiquadCascade\n";
+      srand(time(NULL));
+   }
+
+   void SetUp(ArrayOf<Biquad> sections, size_t nSections,
+      size_t nChannels, size_t len)
+   {
+      mSections = std::move(sections);
+      mnSections = nSections;
+      mInput.assign(nChannels, std::vector<float>(len));
+      for (auto &channel : mInput)
+         for (auto &value : channel)
+            value = (rand() % 20001 - 10000) / 10000.0f;
+   }
+
+   void TearDown()
+   {
+      mSections.reset();
+      mInput.clear();
+   }
+
+   // Each channel through copies of the sections, one sample at a time, as
+   // Biquad::ProcessOne does, but passing double between sections as the
+   // cascade does
+   std::vector<std::vector<float>> Reference(size_t len)
+   {
+      std::vector<std::vector<float>> result;
+      for (const auto &channel : mInput) {
+         std::vector<Biquad> sections(
+            mSections.get(), mSections.get() + mnSections);
+         std::vector<float> output(len);
+         for (size_t ii = 0; ii < len; ++ii) {
+            double value = channel[ii];
+            for (auto &section : sections) {
+               const double out = value * section.fNumerCoeffs[Biquad::B0] +
+                  section.fPrevIn * section.fNumerCoeffs[Biquad::B1] +
+                  section.fPrevPrevIn * section.fNumerCoeffs[Biquad::B2] -
+                  section.fPrevOut * section.fDenomCoeffs[Biquad::A1] -
+                  section.fPrevPrevOut * section.fDenomCoeffs[Biquad::A2];
+               section.fPrevPrevIn = section.fPrevIn;
+               section.fPrevIn = value;
+               section.fPrevPrevOut = section.fPrevOut;
+               section.fPrevOut = out;
+               value = out;
+            }
+            output[ii] = value;
+         }
+         result.push_back(output);
+      }
+      return result;
+   }
+
+   // Paired SSE2 lanes do the scalar operations in the same order, so
+   // results are identical, unless the compiler fuses the scalar
+   // multiplies and adds
+   static bool Same(const std::vector<float> &a, const std::vector<float> &b)
+   {
+#ifdef __FMA__
+      for (size_t ii = 0; ii < a.size(); ++ii)
+         if (fabs(a[ii] - b[ii]) > 1e-5 * (1 + fabs(b[ii])))
+            return false;
+      return true;
+#else
+      return a == b;
+#endif
+   }
+
+   // Process in calls of the given lengths, in place
+   void TestAgainstScalar(const std::vector<size_t> &lengths)
+   {
+      const auto nChannels = mInput.size();
+      const auto len = mInput[0].size();
+      BiquadCascade cascade{ mSections.get(), mnSections, nChannels };
+      assert(cascade.GetChannels() == nChannels);
+
+      auto output = mInput;
+      std::vector<float*> pointers;
+      for (auto &channel : output)
+         pointers.push_back(channel.data());
+      size_t done = 0;
+      for (auto length : lengths) {
+         length = std::min(length, len - done);
+         cascade.Process(pointers.data(), pointers.data(), length);
+         for (auto &pointer : pointers)
+            pointer += length;
+         done += length;
+      }
+      assert(done == len);
+
+      const auto reference = Reference(len);
+      for (size_t channel = 0; channel < nChannels; ++channel)
+         assert(Same(output[channel], reference[channel]));
+
+      // After Reset, the same input gives the same output again, into
+      // separate buffers
+      cascade.Reset();
+      std::vector<std::vector<float>> output2(
+         nChannels, std::vector<float>(len));
+      std::vector<const float*> in;
+      std::vector<float*> out;
+      for (size_t channel = 0; channel < nChannels; ++channel) {
+         in.push_back(mInput[channel].data());
+         out.push_back(output2[channel].data());
+      }
+      cascade.Process(in.data(), out.data(), len);
+      assert(output2 == output);
+   }
+};
+
+int main()
+{
+   BiquadCascadeTest tester;
+
+   // Odd and even numbers of channels, so that some are filtered in pairs
+   // and one alone; lengths crossing the chunks of the cascade
+   const std::vector<size_t> oneCall{ 5000 };
+   const std::vector<size_t> severalCalls{ 1, 255, 256, 257, 1000, 3231 };
+   for (size_t nChannels : { 1, 2, 3, 5 }) {
+      tester.SetUp(Biquad::CalcButterworthFilter(
+            7, 22050, 1000, Biquad::kLowPass), 4, nChannels, 5000);
+      tester.TestAgainstScalar(oneCall);
+      tester.TestAgainstScalar(severalCalls);
+      tester.TearDown();
+
+      tester.SetUp(Biquad::CalcChebyshevType1Filter(
+            8, 22050, 300, 1.0, Biquad::kHighPass), 4, nChannels, 5000);
+      tester.TestAgainstScalar(severalCalls);
+      tester.TearDown();
+
+      tester.SetUp(Biquad::CalcChebyshevType2Filter(
+            3, 22050, 5000, 40.0, Biquad::kLowPass), 2, nChannels, 5000);
+      tester.TestAgainstScalar(severalCalls);
+      tester.TearDown();
+
+      std::cout << "    " << nChannels << " channels: ok\n";
+   }
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
@@ -0,0 +1,231 @@
+
+#include "effects/EBUR128.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+class EBUR128Test
+{
+   double mRate;
+   std::vector<std::vector<float>> mInput;
+
+public:
+   EBUR128Test()
+   {
+      std::cout << "==> Testing EBUR128\n";
+      srand(time(NULL));
+   }
+
+   //! Noise in every channel, at levels in dB relative to full scale that
+   //! change every segmentLen seconds
+   void SetUp(double rate, size_t nChannels, double segmentLen,
+      const std::vector<double> &levels)
+   {
+      mRate = rate;
+      const size_t segment = segmentLen * rate;
+      mInput.assign(nChannels, std::vector<float>(segment * levels.size()));
+      for (auto &channel : mInput)
+         for (size_t ii = 0; ii < channel.size(); ++ii)
+            channel[ii] = pow(10.0, levels[ii / segment] / 20) *
+               (rand() % 20001 - 10000) / 10000.0;
+   }
+
+   void TearDown()
+   {
+      mInput.clear();
+   }
+
+   // Measure, giving the samples in pieces of the given length
+   void Measure(EBUR128 &meter, size_t piece)
+   {
+      const auto len = mInput[0].size();
+      std::vector<const float*> pointers;
+      meter.Initialize();
+      for (size_t offset = 0; offset < len; offset += piece) {
+         pointers.clear();
+         for (const auto &channel : mInput)
+            pointers.push_back(channel.data() + offset);
+         meter.ProcessSamples(pointers.data(), std::min(piece, len - offset));
+      }
+   }
+
+   // Loudness of each block of blockHops hops of 100 ms, starting every
+   // hop, computed one sample at a time as in ITU-R BS.1770
+   std::vector<double> BlockLoudness(size_t blockHops)
+   {
+      const size_t hop = ceil(0.1 * mRate);
+      const auto len = mInput[0].size();
+      std::vector<double> hopPower(len / hop);
+      for (const auto &channel : mInput) {
+         auto filter = EBUR128::CalcWeightingFilter(mRate);
+         for (size_t ii = 0; ii < hopPower.size() * hop; ++ii) {
+            const double value =
+               filter[1].ProcessOne(filter[0].ProcessOne(channel[ii]));
+            hopPower[ii / hop] += value * value;
+         }
+      }
+      std::vector<double> result;
+      for (size_t ii = 0; ii + blockHops <= hopPower.size(); ++ii) {
+         double power = 0;
+         for (size_t jj = 0; jj < blockHops; ++jj)
+            power += hopPower[ii + jj];
+         result.push_back(
+            -0.691 + 10 * log10(power / (blockHops * hop)));
+      }
+      return result;
+   }
+
+   static double MeanPowerLoudness(const std::vector<double> &loudness)
+   {
+      double sum = 0;
+      for (auto value : loudness)
+         sum += pow(10, (value + 0.691) / 10);
+      return -0.691 + 10 * log10(sum / loudness.size());
+   }
+
+   // Blocks above the absolute gate and gap LU below their mean
+   static std::vector<double> Gated(
+      const std::vector<double> &loudness, double gap)
+   {
+      std::vector<double> result;
+      std::copy_if(loudness.begin(), loudness.end(),
+         std::back_inserter(result), [](double value){ return value > -70; });
+      const auto threshold = MeanPowerLoudness(result) - gap;
+      result.erase(std::remove_if(result.begin(), result.end(),
+         [=](double value){ return value <= threshold; }), result.end());
+      return result;
+   }
+
+   void TestIntegratedLoudness()
+   {
+      const auto expected = MeanPowerLoudness(Gated(BlockLoudness(4), 10));
+
+      for (size_t piece : { size_t(1000000), size_t(4096), size_t(777) }) {
+         EBUR128 meter{ mRate, mInput.size() };
+         Measure(meter, piece);
+         const auto lufs =
+            meter.IntegrativeLoudnessToLUFS(meter.IntegrativeLoudness());
+         assert(fabs(lufs - expected) < 0.01);
+      }
+   }
+
+   void TestLoudnessRange()
+   {
+      // EBU Tech 3342: short-term loudness of 3 s blocks, gated 20 LU below
+      // their mean; the range between the 10th and 95th percentiles
+      auto loudness = Gated(BlockLoudness(30), 20);
+      std::sort(loudness.begin(), loudness.end());
+      const auto percentile = [&](double fraction) {
+         const size_t rank = ceil(fraction * loudness.size());
+         return loudness[std::max<size_t>(rank, 1) - 1];
+      };
+      const auto expected = percentile(0.95) - percentile(0.10);
+
+      EBUR128 meter{ mRate, mInput.size() };
+      Measure(meter, 10000);
+      assert(fabs(meter.LoudnessRange() - expected) < 0.05);
+   }
+
+   // The interpolator of EBUR128, one point at a time
+   static double ScalarTruePeak(const std::vector<float> &samples)
+   {
+      const size_t taps = 12, length = 4 * taps;
+      std::vector<float> coeffs(length);
+      for (size_t n = 0; n < length; ++n) {
+         const double x = (double(n) - length / 2) / 4;
+         const double sinc = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+         const double window = 0.5 * (1 - cos(2 * M_PI * n / length));
+         coeffs[n] = sinc * window;
+      }
+      float peak = 0;
+      for (size_t ii = 0; ii < samples.size(); ++ii) {
+         peak = std::max(peak, std::fabs(samples[ii]));
+         for (size_t phase = 0; phase < 4; ++phase) {
+            float sum = 0;
+            for (size_t tap = 0; tap < taps && tap <= ii; ++tap)
+               sum += samples[ii - tap] * coeffs[4 * tap + phase];
+            peak = std::max(peak, std::fabs(sum));
+         }
+      }
+      return peak;
+   }
+
+   void TestTruePeak()
+   {
+      double expected = 0;
+      for (const auto &channel : mInput)
+         expected = std::max(expected, ScalarTruePeak(channel));
+
+      for (size_t piece : { size_t(1000000), size_t(4096), size_t(5) }) {
+         EBUR128 meter{ mRate, mInput.size() };
+         Measure(meter, piece);
+         assert(fabs(meter.TruePeak() - expected) <= 1e-5 * expected);
+      }
+   }
+
+   void TestTruePeakOfTone()
+   {
+      // A quarter of the rate, with samples at 45 degrees from the peaks,
+      // so no sample exceeds 0.71 but the signal reaches 1
+      mInput.assign(1, std::vector<float>(48000));
+      for (size_t ii = 0; ii < mInput[0].size(); ++ii)
+         mInput[0][ii] = sin(M_PI / 2 * ii + M_PI / 4);
+      EBUR128 meter{ mRate, 1 };
+      Measure(meter, 4096);
+      assert(fabs(meter.TruePeak() - 1) < 0.02);
+   }
+};
+
+int main()
+{
+   EBUR128Test tester;
+
+   // Steady, then changing levels, including a quiet stretch below the
+   // relative gate and silence below the absolute gate
+   tester.SetUp(48000, 2, 5, { -20, -20, -20, -20 });
+   tester.TestIntegratedLoudness();
+   tester.TestTruePeak();
+   tester.TearDown();
+   std::cout << "    steady stereo: ok\n";
+
+   tester.SetUp(44100, 1, 4,
+      { -18, -24, -30, -60, -200, -12, -21, -27, -15, -33 });
+   tester.TestIntegratedLoudness();
+   tester.TestLoudnessRange();
+   tester.TestTruePeak();
+   tester.TearDown();
+   std::cout << "    changing mono: ok\n";
+
+   tester.SetUp(48000, 3, 6, { -10, -26, -16, -36, -20, -23 });
+   tester.TestIntegratedLoudness();
+   tester.TestLoudnessRange();
+   tester.TestTruePeak();
+   tester.TearDown();
+   std::cout << "    changing three channels: ok\n";
+
+   tester.SetUp(48000, 1, 1, { 0 });
+   tester.TestTruePeakOfTone();
+   tester.TearDown();
+   std::cout << "    true peak between samples: ok\n";
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
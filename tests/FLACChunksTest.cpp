@@ -0,0 +1,312 @@
+
+#include "export/FLACChunks.h"
+
+#include "FLAC++/decoder.h"
+#include "FLAC++/metadata.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Encodes a whole stream in memory, as the serial exporter does to a file
+class WholeEncoder final : public FLAC::Encoder::Stream
+{
+public:
+   std::vector<FLAC__byte> mBytes;
+   std::vector<FLAC__byte> mMD5;
+
+protected:
+   ::FLAC__StreamEncoderWriteStatus write_callback(
+      const FLAC__byte buffer[], size_t bytes, unsigned, unsigned) override
+   {
+      mBytes.insert(mBytes.end(), buffer, buffer + bytes);
+      return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+   }
+
+   void metadata_callback(const ::FLAC__StreamMetadata *metadata) override
+   {
+      // Called at the end with the completed STREAMINFO
+      const auto &md5 = metadata->data.stream_info.md5sum;
+      mMD5.assign(md5, md5 + 16);
+   }
+};
+
+// Decodes a stream from memory, checking its MD5
+class MemoryDecoder final : public FLAC::Decoder::Stream
+{
+public:
+   explicit MemoryDecoder(const std::vector<FLAC__byte> &bytes)
+      : mBytes{ bytes }
+   {}
+
+   std::vector<std::vector<FLAC__int32>> mSamples;
+   FLAC__StreamMetadata_StreamInfo mInfo{};
+   std::vector<std::string> mComments;
+   std::vector<FLAC__uint64> mFrameStarts;
+   bool mErrors{ false };
+
+protected:
+   ::FLAC__StreamDecoderReadStatus read_callback(
+      FLAC__byte buffer[], size_t *bytes) override
+   {
+      *bytes = std::min(*bytes, mBytes.size() - mPos);
+      if (*bytes == 0)
+         return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+      memcpy(buffer, mBytes.data() + mPos, *bytes);
+      mPos += *bytes;
+      return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+   }
+
+   ::FLAC__StreamDecoderWriteStatus write_callback(
+      const ::FLAC__Frame *frame, const FLAC__int32 *const buffer[]) override
+   {
+      // Frame numbers are replaced by sample numbers in fixed block size
+      // streams, so sequential numbering shows as contiguous starts
+      mFrameStarts.push_back(frame->header.number.sample_number);
+      mSamples.resize(frame->header.channels);
+      for (unsigned ii = 0; ii < frame->header.channels; ++ii)
+         mSamples[ii].insert(mSamples[ii].end(),
+            buffer[ii], buffer[ii] + frame->header.blocksize);
+      return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+   }
+
+   void metadata_callback(const ::FLAC__StreamMetadata *metadata) override
+   {
+      if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO)
+         mInfo = metadata->data.stream_info;
+      else if (metadata->type == FLAC__METADATA_TYPE_VORBIS_COMMENT) {
+         const auto &comments = metadata->data.vorbis_comment;
+         for (FLAC__uint32 ii = 0; ii < comments.num_comments; ++ii)
+            mComments.emplace_back(
+               reinterpret_cast<const char*>(comments.comments[ii].entry),
+               comments.comments[ii].length);
+      }
+   }
+
+   void error_callback(::FLAC__StreamDecoderErrorStatus) override
+   {
+      mErrors = true;
+   }
+
+private:
+   const std::vector<FLAC__byte> &mBytes;
+   size_t mPos{ 0 };
+};
+
+class FLACChunksTest
+{
+   unsigned mChannels;
+   unsigned mBits;
+   size_t mChunkLength;
+   std::vector<std::vector<FLAC__int32>> mInput;
+
+public:
+   FLACChunksTest()
+   {
+      std::cout << "==> Testing FLAC chunk stitching\n";
+      srand(time(NULL));
+   }
+
+   void SetUp(unsigned channels, unsigned bits, size_t nChunks, size_t extra)
+   {
+      mChannels = channels;
+      mBits = bits;
+      mChunkLength = 3 * FLACChunks::BlockSize;
+
+      // Tones with a little noise, so that predictors and partitions vary
+      const auto length = nChunks * mChunkLength + extra;
+      const FLAC__int32 limit = (1 << (bits - 1)) - 1;
+      mInput.assign(channels, std::vector<FLAC__int32>(length));
+      for (unsigned ii = 0; ii < channels; ++ii)
+         for (size_t jj = 0; jj < length; ++jj) {
+            auto value = 0.6 * limit * sin(0.01 * (ii + 1) * jj) +
+               (rand() % 2001 - 1000) * (limit / 32768.0);
+            mInput[ii][jj] = std::max(-limit - 1,
+               std::min<FLAC__int32>(limit, value));
+         }
+   }
+
+   void TearDown()
+   {
+      mInput.clear();
+   }
+
+   void Configure(FLAC::Encoder::Stream &encoder)
+   {
+      bool success =
+         encoder.set_channels(mChannels) &&
+         encoder.set_sample_rate(44100) &&
+         encoder.set_bits_per_sample(mBits) &&
+         encoder.set_compression_level(5);
+      assert(success);
+   }
+
+   std::vector<const FLAC__int32*> Pointers(size_t offset)
+   {
+      std::vector<const FLAC__int32*> result;
+      for (auto &channel : mInput)
+         result.push_back(channel.data() + offset);
+      return result;
+   }
+
+   void TestRoundTrip(const FLAC__StreamMetadata *pComments)
+   {
+      const auto length = mInput[0].size();
+
+      // The reference, from one encoder
+      WholeEncoder whole;
+      Configure(whole);
+      bool success =
+         whole.set_blocksize(FLACChunks::BlockSize) &&
+         whole.init() == FLAC__STREAM_ENCODER_INIT_STATUS_OK &&
+         whole.process(Pointers(0).data(), length) &&
+         whole.finish();
+      assert(success);
+
+      // Chunks encoded separately, stitched as the exporter does
+      FLACChunks::MD5 digest;
+      std::vector<FLAC__byte> frames, interleaved;
+      FLAC__uint32 frameNumber = 0;
+      size_t minFrameSize = 0, maxFrameSize = 0;
+      const auto bytesPerSample = mBits / 8;
+      for (size_t start = 0; start < length; start += mChunkLength) {
+         const auto chunkLength = std::min(mChunkLength, length - start);
+
+         interleaved.clear();
+         for (size_t jj = 0; jj < chunkLength; ++jj)
+            for (unsigned ii = 0; ii < mChannels; ++ii)
+               for (unsigned k = 0; k < bytesPerSample; ++k)
+                  interleaved.push_back(
+                     (mInput[ii][start + jj] >> (8 * k)) & 0xFF);
+         digest.Append(interleaved.data(), interleaved.size());
+
+         FLACChunks::ChunkEncoder encoder;
+         Configure(encoder);
+         success = encoder.Encode(Pointers(start).data(), chunkLength);
+         assert(success);
+         assert(!encoder.mFrameEnds.empty());
+         assert(encoder.mFrameEnds.back() == encoder.mBytes.size());
+
+         size_t frameStart = 0;
+         for (auto frameEnd : encoder.mFrameEnds) {
+            auto size = FLACChunks::AppendFrame(frames,
+               encoder.mBytes.data() + frameStart,
+               frameEnd - frameStart, frameNumber++);
+            minFrameSize = minFrameSize ? std::min(minFrameSize, size) : size;
+            maxFrameSize = std::max(maxFrameSize, size);
+            frameStart = frameEnd;
+         }
+      }
+      const auto md5 = digest.Finish();
+
+      // The digest agrees with libFLAC's
+      assert(whole.mMD5.size() == 16);
+      assert(memcmp(md5.data(), whole.mMD5.data(), 16) == 0);
+
+      // Frames are independent, so renumbering reproduces the reference
+      // frames exactly
+      assert(whole.mBytes.size() >= frames.size());
+      assert(memcmp(whole.mBytes.data() + whole.mBytes.size() - frames.size(),
+         frames.data(), frames.size()) == 0);
+
+      auto stream = FLACChunks::MakeStreamHeader(pComments,
+         mChannels, 44100, mBits, length, minFrameSize, maxFrameSize, md5);
+      // The placeholder written first has the same size
+      assert(stream.size() == FLACChunks::MakeStreamHeader(pComments,
+         mChannels, 44100, mBits, 0, 0, 0, {}).size());
+      stream.insert(stream.end(), frames.begin(), frames.end());
+
+      // Decode, with libFLAC checking the MD5 of the samples
+      MemoryDecoder decoder{ stream };
+      success =
+         decoder.set_md5_checking(true) &&
+         decoder.set_metadata_respond(FLAC__METADATA_TYPE_VORBIS_COMMENT) &&
+         decoder.init() == FLAC__STREAM_DECODER_INIT_STATUS_OK &&
+         decoder.process_until_end_of_stream();
+      assert(success);
+      assert(decoder.finish());
+      assert(!decoder.mErrors);
+
+      assert(decoder.mInfo.total_samples == length);
+      assert(decoder.mInfo.channels == mChannels);
+      assert(decoder.mInfo.bits_per_sample == mBits);
+      assert(decoder.mInfo.min_blocksize == FLACChunks::BlockSize);
+      assert(decoder.mInfo.max_blocksize == FLACChunks::BlockSize);
+      assert(decoder.mInfo.min_framesize == minFrameSize);
+      assert(decoder.mInfo.max_framesize == maxFrameSize);
+      assert(memcmp(decoder.mInfo.md5sum, md5.data(), 16) == 0);
+
+      for (size_t ii = 0; ii < decoder.mFrameStarts.size(); ++ii)
+         assert(decoder.mFrameStarts[ii] == ii * FLACChunks::BlockSize);
+
+      assert(decoder.mSamples == mInput);
+
+      if (pComments) {
+         const auto &comments = pComments->data.vorbis_comment;
+         assert(decoder.mComments.size() == comments.num_comments);
+         for (FLAC__uint32 ii = 0; ii < comments.num_comments; ++ii)
+            assert(decoder.mComments[ii] == std::string(
+               reinterpret_cast<const char*>(comments.comments[ii].entry),
+               comments.comments[ii].length));
+      }
+
+      std::cout << "    " << mChannels << " channels, " << mBits
+         << " bits, " << length << " samples: ok\n";
+   }
+};
+
+int main()
+{
+   FLACChunksTest tester;
+
+   // A short last chunk, and a last chunk ending exactly on a block
+   tester.SetUp(2, 16, 5, 1234);
+   tester.TestRoundTrip(nullptr);
+   tester.TearDown();
+
+   tester.SetUp(2, 16, 4, 2 * FLACChunks::BlockSize);
+   tester.TestRoundTrip(nullptr);
+   tester.TearDown();
+
+   tester.SetUp(1, 24, 3, 17);
+   tester.TestRoundTrip(nullptr);
+   tester.TearDown();
+
+   // Many frames, so that frame numbers take more than one coded byte, and
+   // more than two channels
+   tester.SetUp(3, 24, 50, 4095);
+   tester.TestRoundTrip(nullptr);
+   tester.TearDown();
+
+   // With Vorbis comments after STREAMINFO
+   auto pComments =
+      FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT);
+   FLAC::Metadata::VorbisComment::Entry title("TITLE", "Chunks"),
+      artist("ARTIST", "Audacity");
+   FLAC__metadata_object_vorbiscomment_append_comment(
+      pComments, title.get_entry(), true);
+   FLAC__metadata_object_vorbiscomment_append_comment(
+      pComments, artist.get_entry(), true);
+   tester.SetUp(2, 16, 2, 99);
+   tester.TestRoundTrip(pComments);
+   tester.TearDown();
+   FLAC__metadata_object_delete(pComments);
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
@@ -0,0 +1,121 @@
+
+#include "MagnitudeRuns.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+class MagnitudeRunsTest
+{
+   double mThreshold;
+   float mFloatThreshold;
+   std::vector<float> mSamples;
+
+public:
+   MagnitudeRunsTest()
+   {
+      std::cout << "==> Testing MagnitudeRuns\n";
+      srand(time(NULL));
+   }
+
+   //! Runs of random lengths, some long enough for several groups of four,
+   //! of values at, just beside, or far from the threshold, of either sign
+   void SetUp(double threshold, size_t len)
+   {
+      mThreshold = threshold;
+      mFloatThreshold = MagnitudeRuns::RoundUp(threshold);
+      const float below[] = {
+         0.0f, -0.0f, std::nextafter(mFloatThreshold, 0.0f),
+         float(threshold / 2), float(threshold / 1000) };
+      const float above[] = {
+         mFloatThreshold, std::nextafter(mFloatThreshold, HUGE_VALF),
+         float(threshold * 2), std::numeric_limits<float>::infinity(),
+         std::numeric_limits<float>::quiet_NaN() };
+      mSamples.clear();
+      while (mSamples.size() < len) {
+         const bool isAbove = rand() % 2;
+         const size_t runLen = rand() % 3 ? 1 + rand() % 6 : rand() % 200;
+         for (size_t ii = 0; ii < runLen && mSamples.size() < len; ++ii) {
+            const float value = isAbove ? above[rand() % 5] : below[rand() % 5];
+            mSamples.push_back(rand() % 2 ? -value : value);
+         }
+      }
+   }
+
+   void TearDown()
+   {
+      mSamples.clear();
+   }
+
+   // Comparing in double, and taking NaN as above
+   bool Above(float sample) const
+   {
+      return !(std::fabs(double(sample)) < mThreshold);
+   }
+
+   void TestRoundUp()
+   {
+      assert(mFloatThreshold >= mThreshold);
+      assert(std::nextafter(mFloatThreshold, 0.0f) < mThreshold);
+      for (auto sample : mSamples)
+         assert(!(std::fabs(sample) < mFloatThreshold) == Above(sample));
+   }
+
+   // Divide the samples from first into runs, and check each against the
+   // samples one at a time
+   void TestAgainstScalar(size_t first)
+   {
+      const auto len = mSamples.size();
+      for (size_t ii = first; ii < len;) {
+         bool above;
+         const auto count = MagnitudeRuns::RunLength(
+            mSamples.data() + ii, len - ii, mFloatThreshold, above);
+         assert(count > 0 && ii + count <= len);
+         for (size_t jj = ii; jj < ii + count; ++jj)
+            assert(Above(mSamples[jj]) == above);
+         if (ii + count < len)
+            assert(Above(mSamples[ii + count]) != above);
+         ii += count;
+      }
+   }
+};
+
+int main()
+{
+   MagnitudeRunsTest tester;
+
+   // The level of Find Clipping, and levels of Truncate Silence that are
+   // not exact in float; starts at each alignment
+   for (double threshold : { 1.0, pow(10.0, -20 / 20.0), pow(10.0, -60 / 20.0),
+         pow(10.0, -80 / 20.0) }) {
+      tester.SetUp(threshold, 20000);
+      tester.TestRoundUp();
+      for (size_t first = 0; first < 4; ++first)
+         tester.TestAgainstScalar(first);
+      tester.TearDown();
+
+      // Short lengths, left to the scalar loop
+      for (size_t len = 1; len < 8; ++len) {
+         tester.SetUp(threshold, len);
+         tester.TestAgainstScalar(0);
+         tester.TearDown();
+      }
+      std::cout << "    threshold " << threshold << ": ok\n";
+   }
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
@@ -0,0 +1,144 @@
+
+#include "effects/NoiseReductionBands.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+class NoiseReductionBandsTest
+{
+   size_t mBands;
+   double mSensitivity;
+   std::vector<float> mMeans;
+   std::vector<float> mThresholds;
+   std::vector<std::vector<float>> mSpectrums;
+   std::vector<float> mGains;
+
+public:
+   NoiseReductionBandsTest()
+   {
+      std::cout << "==> Testing NoiseReductionBands\n";
+      srand(time(NULL));
+   }
+
+   //! Powers drawn from few values, so that windows tie, and some means
+   //! that make thresholds equal to powers
+   void SetUp(size_t nBands, size_t nWindows, double sensitivity)
+   {
+      mBands = nBands;
+      mSensitivity = sensitivity;
+      mSpectrums.assign(nWindows, std::vector<float>(nBands));
+      for (auto &spectrum : mSpectrums)
+         for (auto &power : spectrum)
+            power = (rand() % 8) * 0.375f;
+      mMeans.resize(nBands);
+      mThresholds.resize(nBands);
+      for (size_t jj = 0; jj < nBands; ++jj) {
+         if (rand() % 4 == 0)
+            mMeans[jj] = mSpectrums[rand() % nWindows][jj] / sensitivity;
+         else
+            mMeans[jj] = (rand() % 10000) / 3000.0f;
+         mThresholds[jj] =
+            NoiseReductionBands::RoundDown(sensitivity * mMeans[jj]);
+      }
+      mGains.resize(nBands);
+      for (auto &gain : mGains)
+         gain = (rand() % 1000) / 1000.0f;
+   }
+
+   void TearDown()
+   {
+      mMeans.clear();
+      mThresholds.clear();
+      mSpectrums.clear();
+      mGains.clear();
+   }
+
+   // EffectNoiseReduction::Worker::Classify, comparing in double
+   bool Reference(size_t band, bool third)
+   {
+      float greatest = 0.0, second = 0.0, thirdGreatest = 0.0;
+      for (const auto &spectrum : mSpectrums) {
+         const float power = spectrum[band];
+         if (power >= greatest)
+            thirdGreatest = second, second = greatest, greatest = power;
+         else if (power >= second)
+            thirdGreatest = second, second = power;
+         else if (power >= thirdGreatest)
+            thirdGreatest = power;
+      }
+      return (third ? thirdGreatest : second) <=
+         mSensitivity * mMeans[band];
+   }
+
+   void TestAgainstScalar(bool third, bool isolate, size_t begin, size_t end)
+   {
+      std::vector<const float*> spectrums;
+      for (const auto &spectrum : mSpectrums)
+         spectrums.push_back(spectrum.data());
+      auto gains = mGains;
+      NoiseReductionBands::Classify(spectrums.data(), spectrums.size(), third,
+         mThresholds.data(), isolate, begin, end, gains.data());
+
+      for (size_t jj = 0; jj < mBands; ++jj) {
+         if (jj < begin || jj >= end) {
+            assert(gains[jj] == mGains[jj]);
+            continue;
+         }
+         const bool isNoise = Reference(jj, third);
+         if (isolate)
+            assert(gains[jj] == (isNoise ? 1.0f : 0.0f));
+         else
+            assert(gains[jj] == (isNoise ? mGains[jj] : 1.0f));
+      }
+   }
+
+   void TestRoundDown()
+   {
+      for (size_t jj = 0; jj < mBands; ++jj) {
+         const double threshold = mSensitivity * mMeans[jj];
+         const float rounded = mThresholds[jj];
+         assert(rounded <= threshold);
+         assert(std::nextafter(rounded, HUGE_VALF) > threshold);
+      }
+   }
+};
+
+int main()
+{
+   NoiseReductionBandsTest tester;
+
+   // Median of three or five windows, and second greatest of more; ranges
+   // that leave bands over after groups of four, or only those
+   const std::vector<std::pair<size_t, bool>> methods{
+      { 3, false }, { 5, true }, { 5, false }, { 9, false } };
+   for (const auto &method : methods) {
+      tester.SetUp(1025, method.first, 6 * log(10.0));
+      tester.TestRoundDown();
+      for (bool isolate : { false, true }) {
+         tester.TestAgainstScalar(method.second, isolate, 0, 1025);
+         tester.TestAgainstScalar(method.second, isolate, 1, 1000);
+         tester.TestAgainstScalar(method.second, isolate, 17, 20);
+         tester.TestAgainstScalar(method.second, isolate, 8, 8);
+      }
+      tester.TearDown();
+      std::cout << "    " << method.first << " windows"
+         << (method.second ? ", third greatest" : ", second greatest")
+         << ": ok\n";
+   }
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
@@ -0,0 +1,110 @@
+#include "effects/NoiseReduction.h"
+#include "Prefs.h"
+
+#include <wx/filename.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+class NoiseReductionSegmentsTest
+{
+   double mRate;
+   std::vector<float> mNoise;
+   std::vector<float> mSamples;
+
+public:
+   NoiseReductionSegmentsTest()
+   {
+      std::cout << "==> Testing NoiseReduction in segments\n";
+      srand(time(NULL));
+
+      // Default settings
+      const char *path = "/tmp/noise-reduction-test.cfg";
+      remove(path);
+      InitPreferences(wxFileName{ path });
+   }
+
+   ~NoiseReductionSegmentsTest()
+   {
+      FinishPreferences();
+   }
+
+   static float Noise()
+   {
+      return (rand() % 20001 - 10000) / 200000.0f;
+   }
+
+   //! A noise profile, and a signal of tones that start and stop, so that
+   //! gains attack and release, in that noise
+   void SetUp(double rate, size_t len)
+   {
+      mRate = rate;
+      mNoise.resize(rate);
+      for (auto &value : mNoise)
+         value = Noise();
+      mSamples.resize(len);
+      for (size_t ii = 0; ii < len; ++ii) {
+         const bool sounding = (ii / 40000) % 3 == 0;
+         mSamples[ii] = Noise() + (sounding
+            ? 0.5f * sin(ii * 0.03) + 0.3f * sin(ii * 0.0071)
+            : 0.0f);
+      }
+   }
+
+   void TearDown()
+   {
+      mNoise.clear();
+      mSamples.clear();
+   }
+
+   // Each segment is reduced from far enough before it that its gains are
+   // those of one pass, so results are identical
+   void TestAgainstSerial()
+   {
+      const auto serial =
+         EffectNoiseReduction::Reduce(mRate, mNoise, mSamples, false);
+      const auto segmented =
+         EffectNoiseReduction::Reduce(mRate, mNoise, mSamples, true);
+      assert(serial.size() == mSamples.size());
+      assert(segmented == serial);
+
+      // The noise between tones was reduced
+      double in = 0, out = 0;
+      for (size_t ii = 40000; ii < 80000; ++ii) {
+         in += mSamples[ii] * mSamples[ii];
+         out += serial[ii] * serial[ii];
+      }
+      assert(out < in / 4);
+   }
+};
+
+int main()
+{
+   NoiseReductionSegmentsTest tester;
+
+   // Segments are about 2^19 samples.  Lengths of several segments, the
+   // second not a multiple of the step between windows
+   for (size_t len : { 5 * (1 << 19), 3 * (1 << 19) + 12345 }) {
+      tester.SetUp(44100, len);
+      tester.TestAgainstSerial();
+      std::cout << "    " << len << " samples: ok\n";
+      tester.TearDown();
+   }
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
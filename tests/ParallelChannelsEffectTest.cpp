@@ -0,0 +1,134 @@
+#include "effects/Phaser.h"
+#include "effects/Wahwah.h"
+#include "WorkerPool.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+// The left and right channels of a stereo track
+static ChannelName LeftMap[]{ ChannelNameFrontLeft, ChannelNameEOL };
+static ChannelName RightMap[]{ ChannelNameFrontRight, ChannelNameEOL };
+
+class ParallelChannelsEffectTest
+{
+   double mRate;
+   std::vector<std::vector<float>> mInput;
+
+public:
+   ParallelChannelsEffectTest()
+   {
+      std::cout << "==> Testing effects that process channels in parallel\n";
+      srand(time(NULL));
+   }
+
+   void SetUp(double rate, size_t len)
+   {
+      mRate = rate;
+      mInput.assign(2, std::vector<float>(len));
+      for (auto &channel : mInput)
+         for (auto &value : channel)
+            value = (rand() % 20001 - 10000) / 10000.0f;
+   }
+
+   void TearDown()
+   {
+      mInput.clear();
+   }
+
+   // Each channel through the master processor in turn, in blocks of the
+   // given size, as Effect::ProcessPass does
+   template< typename MyEffect >
+   std::vector<std::vector<float>> Serial(MyEffect &effect, size_t blockSize)
+   {
+      std::vector<std::vector<float>> result;
+      for (size_t ii = 0; ii < mInput.size(); ++ii) {
+         const auto &input = mInput[ii];
+         const auto len = input.size();
+         std::vector<float> output(len);
+         effect.SetSampleRate(mRate);
+         assert(effect.ProcessInitialize(len, ii == 0 ? LeftMap : RightMap));
+         for (size_t offset = 0; offset < len; offset += blockSize) {
+            float *in = const_cast<float*>(input.data()) + offset;
+            float *out = output.data() + offset;
+            effect.ProcessBlock(&in, &out, std::min(blockSize, len - offset));
+         }
+         assert(effect.ProcessFinalize());
+         result.push_back(output);
+      }
+      return result;
+   }
+
+   // Both channels at once with a realtime processor each, as
+   // Effect::ProcessChannelsInParallel does
+   template< typename MyEffect >
+   std::vector<std::vector<float>> Parallel(MyEffect &effect)
+   {
+      assert(effect.ProcessesChannelsInParallel());
+      assert(effect.RealtimeInitialize());
+      for (size_t ii = 0; ii < mInput.size(); ++ii) {
+         assert(effect.RealtimeAddProcessor(1, mRate));
+         assert(effect.InitializeParallelProcessor(
+            ii, ii == 0 ? LeftMap : RightMap));
+      }
+      const auto blockSize = effect.GetBlockSize();
+
+      std::vector<std::vector<float>> result(
+         mInput.size(), std::vector<float>(mInput[0].size()));
+      WorkerPool::Get().ParallelFor(mInput.size(), [&](size_t ii) {
+         const auto &input = mInput[ii];
+         const auto len = input.size();
+         for (size_t offset = 0; offset < len; offset += blockSize) {
+            float *in = const_cast<float*>(input.data()) + offset;
+            float *out = result[ii].data() + offset;
+            effect.RealtimeProcess(ii, &in, &out,
+               std::min(blockSize, len - offset));
+         }
+      });
+      assert(effect.RealtimeFinalize());
+      return result;
+   }
+
+   // The processors do the same operations as the master, so results are
+   // identical
+   template< typename MyEffect >
+   void TestAgainstSerial(MyEffect &effect)
+   {
+      for (size_t blockSize : { 512, 1000, 4096 })
+         assert(Parallel(effect) == Serial(effect, blockSize));
+   }
+};
+
+int main()
+{
+   ParallelChannelsEffectTest tester;
+
+   // Lengths longer than a block, and not a multiple of one
+   for (size_t len : { 10000, 44100 + 17 }) {
+      tester.SetUp(44100, len);
+
+      EffectPhaser phaser;
+      tester.TestAgainstSerial(phaser);
+      std::cout << "    Phaser, " << len << " samples: ok\n";
+
+      EffectWahwah wahwah;
+      tester.TestAgainstSerial(wahwah);
+      std::cout << "    Wahwah, " << len << " samples: ok\n";
+
+      tester.TearDown();
+   }
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
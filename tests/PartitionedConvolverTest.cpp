@@ -0,0 +1,158 @@
+
+#include "effects/PartitionedConvolver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+class PartitionedConvolverTest
+{
+   std::vector<float> mResponse;
+   std::vector<std::vector<float>> mInput;
+
+public:
+   PartitionedConvolverTest()
+   {
+      std::cout << "==> Testing PartitionedConvolver\n";
+      srand(time(NULL));
+   }
+
+   static float Random()
+   {
+      return (rand() % 20001 - 10000) / 10000.0f;
+   }
+
+   void SetUp(size_t responseLen, size_t nChannels, size_t len)
+   {
+      // A decaying response, as of a filter
+      mResponse.resize(responseLen);
+      for (size_t ii = 0; ii < responseLen; ++ii)
+         mResponse[ii] = Random() * exp(-4.0 * ii / responseLen);
+      mInput.assign(nChannels, std::vector<float>(len));
+      for (auto &channel : mInput)
+         for (auto &value : channel)
+            value = Random();
+   }
+
+   void TearDown()
+   {
+      mResponse.clear();
+      mInput.clear();
+   }
+
+   // Direct convolution in double, delayed by the latency
+   std::vector<double> Reference(const std::vector<float> &input,
+      size_t latency)
+   {
+      std::vector<double> result(input.size());
+      for (size_t nn = latency; nn < input.size(); ++nn) {
+         double sum = 0;
+         const auto last = std::min(mResponse.size(), nn - latency + 1);
+         for (size_t kk = 0; kk < last; ++kk)
+            sum += double(mResponse[kk]) * input[nn - latency - kk];
+         result[nn] = sum;
+      }
+      return result;
+   }
+
+   // Process in calls of the given lengths, in place or not
+   void TestAgainstDirect(size_t blockSize,
+      const std::vector<size_t> &lengths, bool inPlace, bool parallel)
+   {
+      const auto nChannels = mInput.size();
+      const auto len = mInput[0].size();
+      PartitionedConvolver convolver{
+         mResponse.data(), mResponse.size(), nChannels, blockSize };
+      assert(convolver.GetChannels() == nChannels);
+      const auto latency = convolver.GetLatency();
+      assert(latency >= std::max<size_t>(64, blockSize));
+      assert((latency & (latency - 1)) == 0);
+
+      // Process twice, to check that Reset() starts again from silence
+      for (int pass = 0; pass < 2; ++pass) {
+         convolver.Reset();
+         auto output = mInput;
+         std::vector<const float*> in;
+         std::vector<float*> out;
+         for (size_t channel = 0; channel < nChannels; ++channel) {
+            in.push_back(inPlace
+               ? output[channel].data() : mInput[channel].data());
+            out.push_back(output[channel].data());
+         }
+         size_t done = 0;
+         for (size_t ii = 0; done < len; ++ii) {
+            const auto length =
+               std::min(lengths[ii % lengths.size()], len - done);
+            convolver.Process(in.data(), out.data(), length, parallel);
+            for (size_t channel = 0; channel < nChannels; ++channel) {
+               in[channel] += length;
+               out[channel] += length;
+            }
+            done += length;
+         }
+
+         // Errors of the float transforms grow with the sum of magnitudes
+         double scale = 0;
+         for (auto value : mResponse)
+            scale += fabs(value);
+         const double tolerance = 1e-5 * scale;
+
+         for (size_t channel = 0; channel < nChannels; ++channel) {
+            const auto reference = Reference(mInput[channel], latency);
+            for (size_t nn = 0; nn < len; ++nn)
+               assert(fabs(output[channel][nn] - reference[nn]) <= tolerance);
+         }
+      }
+
+      std::cout << "    response " << mResponse.size() << ", block "
+         << convolver.GetBlockSize() << ", " << nChannels << " channels"
+         << (inPlace ? ", in place" : "") << (parallel ? ", parallel" : "")
+         << ": ok\n";
+   }
+};
+
+int main()
+{
+   PartitionedConvolverTest tester;
+
+   const std::vector<size_t> wholeBlocks{ 256 };
+   const std::vector<size_t> ragged{ 1, 100, 63, 1000, 7 };
+
+   // A response shorter than the smallest block, in one partition
+   tester.SetUp(20, 1, 3000);
+   tester.TestAgainstDirect(0, ragged, false, false);
+   tester.TearDown();
+
+   // Responses filling their partitions exactly, and not
+   tester.SetUp(1024, 2, 6000);
+   tester.TestAgainstDirect(256, wholeBlocks, false, false);
+   tester.TestAgainstDirect(256, ragged, true, false);
+   tester.TestAgainstDirect(0, ragged, true, true);
+   tester.TearDown();
+
+   tester.SetUp(1001, 3, 6000);
+   tester.TestAgainstDirect(64, ragged, false, true);
+   tester.TestAgainstDirect(128, wholeBlocks, true, true);
+   tester.TearDown();
+
+   // Block sizes that are not powers of two are rounded up
+   tester.SetUp(4000, 2, 12000);
+   tester.TestAgainstDirect(300, ragged, true, true);
+   tester.TearDown();
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
@@ -0,0 +1,279 @@
+
+#include "RealFFTf.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// The butterfly passes of RealFFTf as they were before the SSE2 helpers,
+// one butterfly at a time; the rest of the transform is unchanged
+static void ScalarRealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   fft_type *A, *B;
+   const fft_type *sptr;
+   const fft_type *endptr1, *endptr2;
+   const int *br1, *br2;
+   fft_type HRplus, HRminus, HIplus, HIminus;
+   fft_type v1, v2, sin, cos;
+
+   auto ButterfliesPerGroup = h->Points / 2;
+   endptr1 = buffer + h->Points * 2;
+   while (ButterfliesPerGroup > 0) {
+      A = buffer;
+      B = buffer + ButterfliesPerGroup * 2;
+      sptr = h->SinTable.get();
+      while (A < endptr1) {
+         sin = *sptr;
+         cos = *(sptr + 1);
+         endptr2 = B;
+         while (A < endptr2) {
+            v1 = *B * cos + *(B + 1) * sin;
+            v2 = *B * sin - *(B + 1) * cos;
+            *B = (*A + v1);
+            *(A++) = *(B++) - 2 * v1;
+            *B = (*A - v2);
+            *(A++) = *(B++) + 2 * v2;
+         }
+         A = B;
+         B += ButterfliesPerGroup * 2;
+         sptr += 2;
+      }
+      ButterfliesPerGroup >>= 1;
+   }
+
+   br1 = h->BitReversed.get() + 1;
+   br2 = h->BitReversed.get() + h->Points - 1;
+   while (br1 < br2) {
+      sin = h->SinTable[*br1];
+      cos = h->SinTable[*br1 + 1];
+      A = buffer + *br1;
+      B = buffer + *br2;
+      HRplus = (HRminus = *A - *B) + (*B * 2);
+      HIplus = (HIminus = *(A + 1) - *(B + 1)) + (*(B + 1) * 2);
+      v1 = (sin * HRminus - cos * HIplus);
+      v2 = (cos * HRminus + sin * HIplus);
+      *A = (HRplus + v1) * (fft_type)0.5;
+      *B = *A - v1;
+      *(A + 1) = (HIminus + v2) * (fft_type)0.5;
+      *(B + 1) = *(A + 1) - HIminus;
+      br1++;
+      br2--;
+   }
+   A = buffer + *br1 + 1;
+   *A = -*A;
+   v1 = buffer[0] - buffer[1];
+   buffer[0] += buffer[1];
+   buffer[1] = v1;
+}
+
+// Likewise for InverseRealFFTf
+static void ScalarInverseRealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   fft_type *A, *B;
+   const fft_type *sptr;
+   const fft_type *endptr1, *endptr2;
+   const int *br1;
+   fft_type HRplus, HRminus, HIplus, HIminus;
+   fft_type v1, v2, sin, cos;
+
+   auto ButterfliesPerGroup = h->Points / 2;
+
+   A = buffer + 2;
+   B = buffer + h->Points * 2 - 2;
+   br1 = h->BitReversed.get() + 1;
+   while (A < B) {
+      sin = h->SinTable[*br1];
+      cos = h->SinTable[*br1 + 1];
+      HRplus = (HRminus = *A - *B) + (*B * 2);
+      HIplus = (HIminus = *(A + 1) - *(B + 1)) + (*(B + 1) * 2);
+      v1 = (sin * HRminus + cos * HIplus);
+      v2 = (cos * HRminus - sin * HIplus);
+      *A = (HRplus + v1) * (fft_type)0.5;
+      *B = *A - v1;
+      *(A + 1) = (HIminus - v2) * (fft_type)0.5;
+      *(B + 1) = *(A + 1) - HIminus;
+      A += 2;
+      B -= 2;
+      br1++;
+   }
+   *(A + 1) = -*(A + 1);
+   v1 = 0.5f * (buffer[0] + buffer[1]);
+   v2 = 0.5f * (buffer[0] - buffer[1]);
+   buffer[0] = v1;
+   buffer[1] = v2;
+
+   endptr1 = buffer + h->Points * 2;
+   while (ButterfliesPerGroup > 0) {
+      A = buffer;
+      B = buffer + ButterfliesPerGroup * 2;
+      sptr = h->SinTable.get();
+      while (A < endptr1) {
+         sin = *(sptr++);
+         cos = *(sptr++);
+         endptr2 = B;
+         while (A < endptr2) {
+            v1 = *B * cos - *(B + 1) * sin;
+            v2 = *B * sin + *(B + 1) * cos;
+            *B = (*A + v1) * (fft_type)0.5;
+            *(A++) = *(B++) - v1;
+            *B = (*A + v2) * (fft_type)0.5;
+            *(A++) = *(B++) - v2;
+         }
+         A = B;
+         B += ButterfliesPerGroup * 2;
+      }
+      ButterfliesPerGroup >>= 1;
+   }
+}
+
+// Both SIMD lanes do the scalar operations in the same order, so results
+// are identical, unless the compiler fuses the scalar multiplies and adds
+static bool Same(const std::vector<fft_type> &a, const std::vector<fft_type> &b)
+{
+#ifdef __FMA__
+   double largest = 1;
+   for (auto value : b)
+      largest = std::max(largest, (double)fabs(value));
+   for (size_t ii = 0; ii < a.size(); ++ii)
+      if (fabs(a[ii] - b[ii]) > 1e-5 * largest)
+         return false;
+   return true;
+#else
+   return a == b;
+#endif
+}
+
+class RealFFTfTest
+{
+   size_t mLength;
+   std::vector<fft_type> mInput;
+
+public:
+   RealFFTfTest()
+   {
+      std::cout << "==> Testing RealFFTf\n";
+      srand(time(NULL));
+   }
+
+   void SetUp(size_t length)
+   {
+      mLength = length;
+      mInput.resize(length);
+      for (auto &value : mInput)
+         value = (rand() % 20001 - 10000) / 10000.0f;
+   }
+
+   void TearDown()
+   {
+      mInput.clear();
+   }
+
+   void TestAgainstScalar()
+   {
+      auto hFFT = GetFFT(mLength);
+
+      auto buffer = mInput, reference = mInput;
+      RealFFTf(buffer.data(), hFFT.get());
+      ScalarRealFFTf(reference.data(), hFFT.get());
+      assert(Same(buffer, reference));
+
+      // Inverse, from the spectrum
+      InverseRealFFTf(buffer.data(), hFFT.get());
+      ScalarInverseRealFFTf(reference.data(), hFFT.get());
+      assert(Same(buffer, reference));
+   }
+
+   void TestAgainstDFT()
+   {
+      auto hFFT = GetFFT(mLength);
+      auto buffer = mInput;
+      RealFFTf(buffer.data(), hFFT.get());
+
+      std::vector<fft_type> re(mLength / 2 + 1), im(mLength / 2 + 1);
+      ReorderToFreq(hFFT.get(), buffer.data(), re.data(), im.data());
+
+      // Errors of the float transform grow with the sum of magnitudes
+      double scale = 0;
+      for (auto value : mInput)
+         scale += fabs(value);
+      const double tolerance = 1e-5 * scale;
+
+      for (size_t kk = 0; kk <= mLength / 2; ++kk) {
+         double sumRe = 0, sumIm = 0;
+         for (size_t nn = 0; nn < mLength; ++nn) {
+            const double phase = 2 * M_PI * ((kk * nn) % mLength) / mLength;
+            sumRe += mInput[nn] * cos(phase);
+            sumIm -= mInput[nn] * sin(phase);
+         }
+         assert(fabs(re[kk] - sumRe) <= tolerance);
+         // DC and Fs/2 are returned as real
+         if (kk > 0 && kk < mLength / 2)
+            assert(fabs(im[kk] - sumIm) <= tolerance);
+      }
+
+      // The inverse takes the bins in natural order, with Fs/2 in place of
+      // the imaginary part of DC, and gives back the input
+      buffer[0] = re[0];
+      buffer[1] = re[mLength / 2];
+      for (size_t kk = 1; kk < mLength / 2; ++kk) {
+         buffer[2 * kk] = re[kk];
+         buffer[2 * kk + 1] = im[kk];
+      }
+      InverseRealFFTf(buffer.data(), hFFT.get());
+      std::vector<fft_type> output(mLength);
+      ReorderToTime(hFFT.get(), buffer.data(), output.data());
+      for (size_t nn = 0; nn < mLength; ++nn)
+         assert(fabs(output[nn] - mInput[nn]) <= 1e-4);
+   }
+
+   void TestSharedTables()
+   {
+      // Callers of the same length get the same tables, which outlive them
+      const FFTParam *first;
+      {
+         auto hFFT = GetFFT(mLength);
+         first = hFFT.get();
+      }
+      auto hFFT = GetFFT(mLength);
+      assert(hFFT.get() == first);
+      assert(hFFT->Points == mLength / 2);
+   }
+};
+
+int main()
+{
+   RealFFTfTest tester;
+
+   // The last pass of each has groups of one butterfly, left to the scalar
+   // loop; the longest is beyond the shared tables
+   for (size_t length : { 4, 8, 16, 64, 256, 2048, 8192, 1 << 17 }) {
+      tester.SetUp(length);
+      tester.TestAgainstScalar();
+      if (length <= 8192)
+         tester.TestAgainstDFT();
+      if (length <= (1 << 16))
+         tester.TestSharedTables();
+      tester.TearDown();
+      std::cout << "    " << length << " points: ok\n";
+   }
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
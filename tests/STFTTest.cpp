@@ -0,0 +1,172 @@
+
+#include "STFT.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+class STFTTest
+{
+   size_t mFFTLen;
+   std::vector<float> mWindow;
+   std::vector<float> mSignal;
+
+public:
+   STFTTest()
+   {
+      std::cout << "==> Testing STFT\n";
+      srand(time(NULL));
+   }
+
+   void SetUp(size_t fftLen, size_t windowLen, size_t signalLen)
+   {
+      mFFTLen = fftLen;
+      mWindow.resize(windowLen);
+      for (size_t ii = 0; ii < windowLen; ++ii)
+         mWindow[ii] = 0.5 - 0.5 * cos(2 * M_PI * ii / windowLen);
+      // A tone with noise, so that no bin is empty
+      mSignal.resize(signalLen);
+      for (size_t ii = 0; ii < signalLen; ++ii)
+         mSignal[ii] = 0.5 * sin(0.3 * ii) + (rand() % 2001 - 1000) / 4000.0;
+   }
+
+   void TearDown()
+   {
+      mWindow.clear();
+      mSignal.clear();
+   }
+
+   // One frame transformed on its own, in double precision, as bins from DC
+   // through Fs/2
+   void DFT(size_t start, std::vector<double> &re, std::vector<double> &im)
+   {
+      const auto windowLen = mWindow.size();
+      const auto padding = (mFFTLen - windowLen) / 2;
+      re.assign(mFFTLen / 2 + 1, 0);
+      im.assign(mFFTLen / 2 + 1, 0);
+      for (size_t kk = 0; kk <= mFFTLen / 2; ++kk)
+         for (size_t nn = 0; nn < windowLen; ++nn) {
+            const double value = mSignal[start + nn] * mWindow[nn];
+            const double phase =
+               2 * M_PI * ((kk * (nn + padding)) % mFFTLen) / mFFTLen;
+            re[kk] += value * cos(phase);
+            im[kk] -= value * sin(phase);
+         }
+   }
+
+   void Check(const std::vector<size_t> &starts, STFT::Output output,
+      const std::vector<float> &results, size_t frameSize)
+   {
+      // Errors of the float transform grow with the sum of magnitudes
+      double scale = 0;
+      for (auto value : mWindow)
+         scale += value;
+      const double tolerance = 1e-5 * scale;
+
+      std::vector<double> re, im;
+      for (size_t ii = 0; ii < starts.size(); ++ii) {
+         DFT(starts[ii], re, im);
+         const float *frame = results.data() + ii * frameSize;
+         if (output == STFT::Output::Complex) {
+            for (size_t kk = 0; kk <= mFFTLen / 2; ++kk) {
+               assert(fabs(frame[2 * kk] - re[kk]) <= tolerance);
+               assert(fabs(frame[2 * kk + 1] - im[kk]) <= tolerance);
+            }
+            // DC and Fs/2 are real
+            assert(frame[1] == 0 && frame[mFFTLen + 1] == 0);
+            continue;
+         }
+         for (size_t kk = 0; kk < mFFTLen / 2; ++kk) {
+            const double power = re[kk] * re[kk] + im[kk] * im[kk];
+            const double magnitude = sqrt(power);
+            switch (output) {
+            case STFT::Output::Power:
+               assert(fabs(frame[kk] - power) <=
+                  tolerance * (2 * magnitude + tolerance));
+               break;
+            case STFT::Output::Magnitude:
+               assert(fabs(frame[kk] - magnitude) <= tolerance);
+               break;
+            case STFT::Output::PowerDB:
+               // Only where the bin is well above the rounding errors
+               if (magnitude > 100 * tolerance)
+                  assert(fabs(frame[kk] - 10 * log10(power)) <= 0.01);
+               break;
+            default:
+               break;
+            }
+         }
+      }
+   }
+
+   void TestOutputs(size_t hop, size_t nFrames)
+   {
+      STFT stft{ mFFTLen, mWindow.data(), mWindow.size() };
+      assert(stft.FFTLength() == mFFTLen);
+
+      std::vector<size_t> starts(nFrames);
+      for (size_t ii = 0; ii < nFrames; ++ii)
+         starts[ii] = ii * hop;
+
+      for (auto output : { STFT::Output::Complex, STFT::Output::Power,
+            STFT::Output::Magnitude, STFT::Output::PowerDB }) {
+         const auto frameSize = stft.FrameSize(output);
+         std::vector<float> results(nFrames * frameSize);
+         stft.Process(mSignal.data(), hop, nFrames, output, results.data());
+         Check(starts, output, results, frameSize);
+
+         // Frames given by their starts give the same, in any order
+         std::vector<size_t> shuffled(starts.rbegin(), starts.rend());
+         std::vector<float> results2(nFrames * frameSize);
+         stft.Process(mSignal.data(), shuffled.data(), nFrames, output,
+            results2.data());
+         for (size_t ii = 0; ii < nFrames; ++ii)
+            assert(std::equal(results.begin() + ii * frameSize,
+               results.begin() + (ii + 1) * frameSize,
+               results2.begin() + (nFrames - 1 - ii) * frameSize));
+      }
+
+      std::cout << "    " << mFFTLen << " points, window " << mWindow.size()
+         << ", " << nFrames << " frames: ok\n";
+   }
+};
+
+int main()
+{
+   STFTTest tester;
+
+   // Frame counts that leave a short batch for the last job, a window as
+   // long as the transform, and a padded window
+   tester.SetUp(256, 256, 256 * 40);
+   tester.TestOutputs(128, 37);
+   tester.TearDown();
+
+   tester.SetUp(1024, 600, 1024 * 20);
+   tester.TestOutputs(300, 50);
+   tester.TearDown();
+
+   tester.SetUp(64, 31, 4000);
+   tester.TestOutputs(7, 16);
+   tester.TestOutputs(7, 1);
+   tester.TearDown();
+
+   return 0;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3